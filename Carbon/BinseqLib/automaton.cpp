@@ -0,0 +1,190 @@
+#include "automaton.hpp"
+#include "bit_stream.hpp"
+#include <cctype>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace binseq {
+
+	/* generations smaller than this many words run on the calling thread */
+	static const u64 parallel_words = 1 << 12;
+
+	life_rule parse_life_rule(const char* rule) {
+		life_rule result = { 0, 0, false };
+		bool birth = false, survive = false;
+		const char* p = rule;
+		auto digits = [&p](u16& mask) {
+			while (*p >= '0' && *p <= '8') mask |= u16(1) << (*p++ - '0');
+		};
+		for (;;) {
+			char c = char(std::toupper((unsigned char)*p));
+			if (c == 'B' && !birth) {
+				p++;
+				digits(result.birth);
+				birth = true;
+			} else if (c == 'S' && !survive) {
+				p++;
+				digits(result.survive);
+				survive = true;
+			} else {
+				break;
+			}
+			if (*p == '/') p++;
+		}
+		if (!birth || !survive)
+			throw std::invalid_argument("rule must use the B/S notation such as B3/S23");
+		if (*p == ':') {
+			if (std::toupper((unsigned char)p[1]) != 'T')
+				throw std::invalid_argument("only the :T toroidal topology is supported");
+			result.wrap = true;
+			p += 2;
+		}
+		if (*p != 0)
+			throw std::invalid_argument("unexpected character in the rule");
+		return result;
+	}
+
+	/* a row of whole stream order words, cell x is bit 63-(x&63) of word x>>6
+	and the unused low bits of the last word are zero */
+	struct row_shape {
+		u64 words;
+		u64 last;
+		u64 tail_mask; // valid bits of the last word
+		u32 edge; // bit of the last cell in the last word
+		bool wrap;
+
+		row_shape(u64 width, bool wrap) : words((width + 63) >> 6), last(((width + 63) >> 6) - 1), wrap(wrap) {
+			u32 tail = u32(width - (last << 6));
+			tail_mask = ~u64(0) << (64 - tail);
+			edge = 63 - u32((width - 1) & 63);
+		}
+
+		/* bit of cell x holds cell x-1 */
+		inline u64 left(const u64* row, u64 k) const {
+			u64 carry = k != 0 ? row[k - 1] << 63 : wrap ? ((row[last] >> edge) & 1) << 63 : 0;
+			return (row[k] >> 1) | carry;
+		}
+
+		/* bit of cell x holds cell x+1 */
+		inline u64 right(const u64* row, u64 k) const {
+			u64 shifted = row[k] << 1;
+			if (k != last) return shifted | (row[k + 1] >> 63);
+			return wrap ? shifted | ((row[0] >> 63) << edge) : shifted;
+		}
+	};
+
+	static void load_rows(const bit_sequence& seq, u64 width, u64 height, const row_shape& shape, u64* rows) {
+		for (u64 y = 0; y < height; y++) {
+			for (u64 k = 0; k < shape.words; k++) {
+				u32 count = k == shape.last ? u32(width - (k << 6)) : 64;
+				*rows++ = read_bits(seq, y * width + (k << 6), count) << (64 - count);
+			}
+		}
+	}
+
+	static bit_sequence store_rows(const u64* rows, u64 width, u64 height, const row_shape& shape) {
+		bit_writer writer;
+		writer.reserve(width * height);
+		for (u64 y = 0; y < height; y++) {
+			for (u64 k = 0; k < shape.words; k++) {
+				u32 count = k == shape.last ? u32(width - (k << 6)) : 64;
+				writer.write(*rows++ >> (64 - count), count);
+			}
+		}
+		return writer.finish();
+	}
+
+	static inline void full_add(u64 a, u64 b, u64 c, u64& sum, u64& carry) {
+		u64 t = a ^ b;
+		sum = t ^ c;
+		carry = (a & b) | (t & c);
+	}
+
+	/* one generation of one row, the eight neighbours are summed into the
+	bit planes s0..s3 of a 4 bit counter per cell */
+	static void life_row(const u64* above, const u64* row, const u64* below, u64* out, const row_shape& shape, const life_rule& rule, bool conway) {
+		for (u64 k = 0; k < shape.words; k++) {
+			u64 c = row[k];
+			u64 top, top_carry, bottom, bottom_carry;
+			full_add(shape.left(above, k), above[k], shape.right(above, k), top, top_carry);
+			full_add(shape.left(below, k), below[k], shape.right(below, k), bottom, bottom_carry);
+			u64 l = shape.left(row, k), r = shape.right(row, k);
+			u64 middle = l ^ r, middle_carry = l & r;
+			u64 s0, ones_carry, twos, twos_carry;
+			full_add(top, bottom, middle, s0, ones_carry);
+			full_add(top_carry, bottom_carry, middle_carry, twos, twos_carry);
+			u64 s1 = twos ^ ones_carry, fours = twos & ones_carry;
+			u64 s2 = twos_carry ^ fours, s3 = twos_carry & fours;
+			u64 next;
+			if (conway) {
+				// exactly 3, or exactly 2 on a live cell
+				next = ~s3 & ~s2 & s1 & (s0 | c);
+			} else {
+				next = 0;
+				for (u32 n = 0; n <= 8; n++) {
+					u64 born = (rule.birth >> n) & 1 ? ~c : 0;
+					u64 stays = (rule.survive >> n) & 1 ? c : 0;
+					if ((born | stays) == 0) continue;
+					u64 equal = (n & 1 ? s0 : ~s0) & (n & 2 ? s1 : ~s1) & (n & 4 ? s2 : ~s2) & (n & 8 ? s3 : ~s3);
+					next |= equal & (born | stays);
+				}
+			}
+			out[k] = k == shape.last ? next & shape.tail_mask : next;
+		}
+	}
+
+	bit_sequence life(const bit_sequence& grid, u64 width, const life_rule& rule, u64 generations, const block_runner& run) {
+		if (width == 0 || grid.size() % width != 0)
+			throw std::invalid_argument("grid size must be a multiple of the width");
+		u64 height = grid.size() / width;
+		if (height == 0 || generations == 0) return grid;
+		row_shape shape(width, rule.wrap);
+		std::vector<u64> first(shape.words * height), second(shape.words * height), zero(shape.words, 0);
+		load_rows(grid, width, height, shape, first.data());
+		u64* src = first.data();
+		u64* dst = second.data();
+		bool conway = rule.birth == (1 << 3) && rule.survive == ((1 << 2) | (1 << 3));
+		auto band = [&](u64 begin, u64 end) {
+			for (u64 y = begin; y < end; y++) {
+				const u64* above = y != 0 ? src + (y - 1) * shape.words : rule.wrap ? src + (height - 1) * shape.words : zero.data();
+				const u64* below = y + 1 != height ? src + (y + 1) * shape.words : rule.wrap ? src : zero.data();
+				life_row(above, src + y * shape.words, below, dst + y * shape.words, shape, rule, conway);
+			}
+		};
+		for (u64 g = 0; g < generations; g++) {
+			if (run && shape.words * height >= parallel_words) run(height, band); else band(0, height);
+			std::swap(src, dst);
+		}
+		return store_rows(src, width, height, shape);
+	}
+
+	bit_sequence elementary(const bit_sequence& cells, u32 rule, u64 generations, bool wrap, const block_runner& run) {
+		if (rule > 255)
+			throw std::invalid_argument("elementary rule must be between 0 and 255");
+		u64 width = cells.size();
+		if (width == 0 || generations == 0) return cells;
+		row_shape shape(width, wrap);
+		std::vector<u64> first(shape.words), second(shape.words);
+		load_rows(cells, width, 1, shape, first.data());
+		u64* src = first.data();
+		u64* dst = second.data();
+		auto range = [&](u64 begin, u64 end) {
+			for (u64 k = begin; k < end; k++) {
+				u64 l = shape.left(src, k), c = src[k], r = shape.right(src, k);
+				u64 next = 0;
+				// one minterm per neighbourhood which the rule maps to 1
+				for (u32 i = 0; i < 8; i++) {
+					if ((rule >> i) & 1) next |= (i & 4 ? l : ~l) & (i & 2 ? c : ~c) & (i & 1 ? r : ~r);
+				}
+				dst[k] = k == shape.last ? next & shape.tail_mask : next;
+			}
+		};
+		for (u64 g = 0; g < generations; g++) {
+			if (run && shape.words >= parallel_words) run(shape.words, range); else range(0, shape.words);
+			std::swap(src, dst);
+		}
+		return store_rows(src, width, 1, shape);
+	}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include "block_runner.hpp"
+
+namespace binseq {
+
+	/* Cellular automata over bit_sequence. A 2D grid is stored row by row in
+	stream order, cell (x, y) is bit x + y * width. The kernels copy the grid
+	into word aligned rows and update 64 cells per word operation, counting
+	neighbours with bit-sliced adders. Rows of a generation are independent,
+	so bands of rows may be spread over a runner. */
+
+	/* Life-like rule, bit k of birth or survive is set when a dead cell is
+	born or a live cell survives with k live neighbours */
+	struct life_rule {
+		u16 birth;
+		u16 survive;
+		bool wrap; // toroidal grid, otherwise cells outside the grid are dead
+	};
+
+	/* parses the B/S notation such as "B3/S23" or "B36/S23", a ":T" suffix
+	makes the grid toroidal, throws std::invalid_argument on bad input */
+	life_rule parse_life_rule(const char* rule);
+
+	/* advances a grid of the given width, the size must be a multiple of it */
+	bit_sequence life(const bit_sequence& grid, u64 width, const life_rule& rule, u64 generations = 1, const block_runner& run = nullptr);
+
+	/* advances a 1D elementary automaton, rule is the Wolfram rule number,
+	with wrap the first and last cells are neighbours */
+	bit_sequence elementary(const bit_sequence& cells, u32 rule, u64 generations = 1, bool wrap = false, const block_runner& run = nullptr);
+
+}
@@ -7,3 +7,21 @@
 #include "bit_sequence.hpp"
 
 #include "popcount.hpp"
+#include "intrinsics.hpp"
+#include "bit_stream.hpp"
+#include "record.hpp"
+#include "sparse_sequence.hpp"
+#include "integer_codes.hpp"
+#include "entropy.hpp"
+#include "block_runner.hpp"
+#include "lz.hpp"
+#include "nist.hpp"
+#include "automaton.hpp"
+#include "bit_matrix.hpp"
+#include "lfsr.hpp"
+#include "crc.hpp"
+#include "fft.hpp"
+#include "correlation.hpp"
+#include "histogram.hpp"
+#include "vertical.hpp"
+#include "prng.hpp"
@@ -0,0 +1,162 @@
+#include "bit_matrix.hpp"
+#include "bit_stream.hpp"
+#include "intrinsics.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace binseq {
+
+	/* products smaller than this many result words run on the calling thread */
+	static const u64 parallel_words = 1 << 12;
+
+	bit_matrix bit_matrix::identity(u64 n) {
+		bit_matrix m(n, n);
+		for (u64 i = 0; i < n; i++) m.set(i, i, true);
+		return m;
+	}
+
+	bit_matrix bit_matrix::from_sequence(const bit_sequence& seq, u64 rows, u64 cols) {
+		if (rows * cols > seq.size())
+			throw std::invalid_argument("the binseq has fewer bits than the matrix");
+		bit_matrix m(rows, cols);
+		for (u64 r = 0; r < rows; r++) {
+			u64* words = m.row(r);
+			for (u64 k = 0; k < m._stride; k++) {
+				u32 count = u32(std::min<u64>(64, cols - (k << 6)));
+				words[k] = read_bits(seq, r * cols + (k << 6), count) << (64 - count);
+			}
+		}
+		return m;
+	}
+
+	bit_sequence bit_matrix::to_sequence() const {
+		bit_writer writer;
+		writer.reserve(_rows * _cols);
+		for (u64 r = 0; r < _rows; r++) {
+			const u64* words = row(r);
+			for (u64 k = 0; k < _stride; k++) {
+				u32 count = u32(std::min<u64>(64, _cols - (k << 6)));
+				writer.write(words[k] >> (64 - count), count);
+			}
+		}
+		return writer.finish();
+	}
+
+	bool operator ==(const bit_matrix& a, const bit_matrix& b) {
+		if (a.rows() != b.rows() || a.cols() != b.cols()) return false;
+		for (u64 r = 0; r < a.rows(); r++) {
+			if (!std::equal(a.row(r), a.row(r) + a.stride(), b.row(r))) return false;
+		}
+		return true;
+	}
+
+	void transpose64(u64* a) {
+		// swap the off diagonal 32x32 blocks, then 16x16 inside each, down to single bits
+		u64 mask = 0x00000000ffffffffull;
+		for (u32 j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+			for (u32 k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+				u64 t = (a[k] ^ (a[k | j] >> j)) & mask;
+				a[k] ^= t;
+				a[k | j] ^= t << j;
+			}
+		}
+	}
+
+	bit_matrix transpose(const bit_matrix& m) {
+		bit_matrix result(m.cols(), m.rows());
+		u64 block[64];
+		for (u64 bi = 0; bi < m.rows(); bi += 64) {
+			for (u64 k = 0; k < m.stride(); k++) {
+				for (u64 i = 0; i < 64; i++) block[i] = bi + i < m.rows() ? m.row(bi + i)[k] : 0;
+				transpose64(block);
+				for (u64 i = 0; i < 64 && (k << 6) + i < m.cols(); i++) result.row((k << 6) + i)[bi >> 6] = block[i];
+			}
+		}
+		return result;
+	}
+
+	bit_matrix multiply(const bit_matrix& a, const bit_matrix& b, const block_runner& run) {
+		if (a.cols() != b.rows())
+			throw std::invalid_argument("the columns of the first matrix must match the rows of the second");
+		bit_matrix c(a.rows(), b.cols());
+		u64 n = a.cols(), stride = b.stride(), groups = (n + 7) >> 3;
+		auto range = [&](u64 first, u64 last) {
+			std::vector<u64> table((size_t)(256 * stride));
+			for (u64 g = 0; g < groups; g++) {
+				// entry i is the sum of the rows 8g+t of b for which bit 7-t of i is set
+				for (u32 i = 1; i < 256; i++) {
+					u64 r = 8 * g + 7 - ctz64(i);
+					u64* dst = &table[(size_t)(i * stride)];
+					const u64* prev = &table[(size_t)((i & (i - 1)) * stride)];
+					if (r < n) {
+						const u64* src = b.row(r);
+						for (u64 k = 0; k < stride; k++) dst[k] = prev[k] ^ src[k];
+					} else {
+						std::copy(prev, prev + stride, dst);
+					}
+				}
+				u64 word = (8 * g) >> 6;
+				u32 shift = 56 - u32((8 * g) & 63);
+				for (u64 r = first; r < last; r++) {
+					u32 index = u32(a.row(r)[word] >> shift) & 255;
+					if (index == 0) continue;
+					const u64* src = &table[(size_t)(index * stride)];
+					u64* dst = c.row(r);
+					for (u64 k = 0; k < stride; k++) dst[k] ^= src[k];
+				}
+			}
+		};
+		if (run && a.rows() * stride >= parallel_words) run(a.rows(), range); else range(0, a.rows());
+		return c;
+	}
+
+	/* Gaussian elimination in place over the first columns, returns the rank
+	and appends the pivot column of each pivot row. With reduce the pivot
+	columns are cleared above the pivots as well. */
+	static u64 eliminate(bit_matrix& m, u64 columns, bool reduce, std::vector<u64>* pivots) {
+		u64 rank = 0;
+		for (u64 col = 0; col < columns && rank < m.rows(); col++) {
+			u64 word = col >> 6;
+			u64 mask = u64(1) << (63 - (col & 63));
+			u64 pivot = rank;
+			while (pivot < m.rows() && (m.row(pivot)[word] & mask) == 0) pivot++;
+			if (pivot == m.rows()) continue;
+			m.swap_rows(rank, pivot);
+			for (u64 i = reduce ? 0 : rank + 1; i < m.rows(); i++) {
+				if (i != rank && (m.row(i)[word] & mask)) m.add_row(i, rank, word);
+			}
+			if (pivots) pivots->push_back(col);
+			rank++;
+		}
+		return rank;
+	}
+
+	u64 rank(const bit_matrix& m) {
+		bit_matrix copy = m;
+		return eliminate(copy, copy.cols(), false, nullptr);
+	}
+
+	bool solve(const bit_matrix& a, const bit_sequence& b, bit_sequence& x) {
+		if (b.size() != a.rows())
+			throw std::invalid_argument("the right hand side needs one bit per row");
+		// augmented matrix [a | b]
+		bit_matrix m(a.rows(), a.cols() + 1);
+		for (u64 r = 0; r < a.rows(); r++) {
+			std::copy(a.row(r), a.row(r) + a.stride(), m.row(r));
+			m.set(r, a.cols(), read_bits(b, r, 1) != 0);
+		}
+		std::vector<u64> pivots;
+		u64 rank = eliminate(m, a.cols(), true, &pivots);
+		// rows past the rank have no coefficients left
+		for (u64 r = rank; r < m.rows(); r++) {
+			if (m.get(r, a.cols())) return false;
+		}
+		std::vector<u64> words((size_t)((a.cols() + 63) >> 6) + 2, 0);
+		for (u64 r = 0; r < rank; r++) {
+			if (m.get(r, a.cols())) words[(size_t)(pivots[(size_t)r] >> 6)] |= u64(1) << (63 - (pivots[(size_t)r] & 63));
+		}
+		x = from_stream_words(words.data(), a.cols());
+		return true;
+	}
+
+}
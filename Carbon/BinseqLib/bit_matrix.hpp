@@ -0,0 +1,107 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include "block_runner.hpp"
+#include <vector>
+
+namespace binseq {
+
+	/* Dense matrix over GF(2). Rows are stored one after the other, each row
+	starts on a word and uses stride() words. Element (r, c) is bit 63-(c&63)
+	of word c>>6 of row r, the same stream order as bit_sequence, and the
+	bits past the last column are always zero. */
+	class bit_matrix {
+	private:
+		u64 _rows;
+		u64 _cols;
+		u64 _stride;
+		std::vector<u64> _words;
+
+	public:
+		inline bit_matrix() : _rows(0), _cols(0), _stride(0) {}
+
+		/* zero matrix */
+		inline bit_matrix(u64 rows, u64 cols)
+			: _rows(rows), _cols(cols), _stride((cols + 63) >> 6), _words((size_t)(rows * ((cols + 63) >> 6)), 0) {}
+
+		static bit_matrix identity(u64 n);
+
+		/* rows x cols matrix from the first rows*cols bits, read row by row */
+		static bit_matrix from_sequence(const bit_sequence&, u64 rows, u64 cols);
+
+		/* the elements row by row */
+		bit_sequence to_sequence() const;
+
+		inline u64 rows() const {
+			return _rows;
+		}
+
+		inline u64 cols() const {
+			return _cols;
+		}
+
+		/* words per row */
+		inline u64 stride() const {
+			return _stride;
+		}
+
+		inline u64* row(u64 r) {
+			return _words.data() + r * _stride;
+		}
+
+		inline const u64* row(u64 r) const {
+			return _words.data() + r * _stride;
+		}
+
+		inline bit get(u64 r, u64 c) const {
+			return ((row(r)[c >> 6] >> (63 - (c & 63))) & 1) != 0;
+		}
+
+		inline void set(u64 r, u64 c, bit value) {
+			u64 mask = u64(1) << (63 - (c & 63));
+			if (value) row(r)[c >> 6] |= mask; else row(r)[c >> 6] &= ~mask;
+		}
+
+		inline void swap_rows(u64 a, u64 b) {
+			u64* p = row(a);
+			u64* q = row(b);
+			for (u64 k = 0; k < _stride; k++) {
+				u64 t = p[k];
+				p[k] = q[k];
+				q[k] = t;
+			}
+		}
+
+		/* row target ^= row source, starting at word first */
+		inline void add_row(u64 target, u64 source, u64 first = 0) {
+			u64* p = row(target);
+			const u64* q = row(source);
+			for (u64 k = first; k < _stride; k++) p[k] ^= q[k];
+		}
+	};
+
+	bool operator ==(const bit_matrix&, const bit_matrix&);
+
+	inline bool operator !=(const bit_matrix& a, const bit_matrix& b) {
+		return !(a == b);
+	}
+
+	/* transposes 64x64 blocks in registers, row i of the block is a[i] */
+	void transpose64(u64* a);
+
+	bit_matrix transpose(const bit_matrix&);
+
+	/* product over GF(2) with the method of four Russians: the sums of every
+	subset of 8 rows of b are tabulated once and each row of a picks one table
+	entry per byte. Rows of the result are independent and may be spread
+	over a runner. Throws std::invalid_argument when the sizes don't match. */
+	bit_matrix multiply(const bit_matrix& a, const bit_matrix& b, const block_runner& run = nullptr);
+
+	/* rank by Gaussian elimination */
+	u64 rank(const bit_matrix&);
+
+	/* solves a x = b, b has one bit per row of a and x gets one bit per
+	column, free variables are zero. Returns false when there is no solution. */
+	bool solve(const bit_matrix& a, const bit_sequence& b, bit_sequence& x);
+
+}
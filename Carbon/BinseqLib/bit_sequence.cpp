@@ -1,5 +1,6 @@
 #include "bit_sequence.hpp"
 #include "bit_collection.hpp"
+#include "bit_stream.hpp"
 #include <cstring>
 #include <stdexcept>
 
@@ -11,168 +12,49 @@ namespace binseq {
 		std::memcpy(address(), str, len);
 	}
 
+	/* compares in stream order, the first bit is the most significant, the
+	unused bits of the last byte are ignored */
+	static int compare_bits(const bit_sequence& a, const bit_sequence& b) {
+		auto p = reinterpret_cast<const u8*>(a.address());
+		auto q = reinterpret_cast<const u8*>(b.address());
+		auto bytes = size_t(a.size() >> 3);
+		int order = std::memcmp(p, q, bytes);
+		if (order != 0 || (a.size() & 7) == 0)
+			return order;
+		u8 mask = u8(0xff00 >> (a.size() & 7));
+		return int(p[bytes] & mask) - int(q[bytes] & mask);
+	}
+
 	bool operator ==(const bit_sequence& a, const bit_sequence& b) {
-		if (a.size() != b.size())
-			return false;
-		auto bits = a.size();
-		auto p64 = reinterpret_cast<const u64*>(a.address());
-		auto q64 = reinterpret_cast<const u64*>(b.address());
-		unsigned i = 0;
-		while (bits > 64) {
-			if (p64[i] != q64[i])
-				return false;
-			bits -= 64;
-			i++;
-		}
-		auto p = bit_collection_reference<const u64>(p64 + i, 0, u8(bits));
-		auto q = bit_collection_reference<const u64>(q64 + i, 0, u8(bits));
-		return p == q;
+		return a.size() == b.size() && compare_bits(a, b) == 0;
 	}
 
 	bool operator !=(const bit_sequence& a, const bit_sequence& b) {
-		if (a.size() != b.size())
-			return true;
-		auto bits = a.size();
-		auto p64 = reinterpret_cast<const u64*>(a.address());
-		auto q64 = reinterpret_cast<const u64*>(b.address());
-		unsigned i = 0;
-		while (bits > 64) {
-			if (p64[i] != q64[i])
-				return true;
-			bits -= 64;
-			i++;
-		}
-		auto p = bit_collection_reference<const u64>(p64 + i, 0, u8(bits));
-		auto q = bit_collection_reference<const u64>(q64 + i, 0, u8(bits));
-		return p != q;
+		return !(a == b);
 	}
 
 	bool operator >(const bit_sequence& a, const bit_sequence& b) {
 		if (a.size() != b.size())
 			throw std::logic_error("can't compare sequences of different length");
-		auto bits = a.size();
-		auto p64 = reinterpret_cast<const u64*>(a.address());
-		auto q64 = reinterpret_cast<const u64*>(b.address());
-		int i = int(bits >> 6);
-		if (i << 6 != bits) {
-			u64 av = bit_collection_reference<const u64>(p64 + i, 0, u8(bits - (i << 6)));
-			u64 bv = bit_collection_reference<const u64>(q64 + i, 0, u8(bits - (i << 6)));
-			if (av == bv) {
-				i--;
-			} else if (av > bv) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-		while (i >= 0) {
-			auto av = p64[i];
-			auto bv = q64[i];
-			if (av == bv) {
-				i--;
-			} else if (av > bv) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-		return false;
+		return compare_bits(a, b) > 0;
 	}
 
 	bool operator <(const bit_sequence& a, const bit_sequence& b) {
 		if (a.size() != b.size())
 			throw std::logic_error("can't compare sequences of different length");
-		auto bits = a.size();
-		auto p64 = reinterpret_cast<const u64*>(a.address());
-		auto q64 = reinterpret_cast<const u64*>(b.address());
-		int i = int(bits >> 6);
-		if (i << 6 != bits) {
-			u64 av = bit_collection_reference<const u64>(p64 + i, 0, u8(bits - (i << 6)));
-			u64 bv = bit_collection_reference<const u64>(q64 + i, 0, u8(bits - (i << 6)));
-			if (av == bv) {
-				i--;
-			} else if (av < bv) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-		while (i >= 0) {
-			auto av = p64[i];
-			auto bv = q64[i];
-			if (av == bv) {
-				i--;
-			} else if (av < bv) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-		return false;
+		return compare_bits(a, b) < 0;
 	}
 
 	bool operator >=(const bit_sequence& a, const bit_sequence& b) {
 		if (a.size() != b.size())
 			throw std::logic_error("can't compare sequences of different length");
-		auto bits = a.size();
-		auto p64 = reinterpret_cast<const u64*>(a.address());
-		auto q64 = reinterpret_cast<const u64*>(b.address());
-		int i = int(bits >> 6);
-		if (i << 6 != bits) {
-			u64 av = bit_collection_reference<const u64>(p64 + i, 0, u8(bits - (i << 6)));
-			u64 bv = bit_collection_reference<const u64>(q64 + i, 0, u8(bits - (i << 6)));
-			if (av == bv) {
-				i--;
-			} else if (av > bv) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-		while (i >= 0) {
-			auto av = p64[i];
-			auto bv = q64[i];
-			if (av == bv) {
-				i--;
-			} else if (av > bv) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-		return true;
+		return compare_bits(a, b) >= 0;
 	}
 
 	bool operator <=(const bit_sequence& a, const bit_sequence& b) {
 		if (a.size() != b.size())
 			throw std::logic_error("can't compare sequences of different length");
-		auto bits = a.size();
-		auto p64 = reinterpret_cast<const u64*>(a.address());
-		auto q64 = reinterpret_cast<const u64*>(b.address());
-		int i = int(bits >> 6);
-		if (i << 6 != bits) {
-			u64 av = bit_collection_reference<const u64>(p64 + i, 0, u8(bits - (i << 6)));
-			u64 bv = bit_collection_reference<const u64>(q64 + i, 0, u8(bits - (i << 6)));
-			if (av == bv) {
-				i--;
-			} else if (av < bv) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-		while (i >= 0) {
-			auto av = p64[i];
-			auto bv = q64[i];
-			if (av == bv) {
-				i--;
-			} else if (av < bv) {
-				return true;
-			} else {
-				return false;
-			}
-		}
-		return true;
+		return compare_bits(a, b) <= 0;
 	}
 
 	bit_sequence operator +(const bit_sequence& a, const bit_sequence& b) {
@@ -181,32 +63,39 @@ namespace binseq {
 		auto a64 = reinterpret_cast<const u64*>(a.address());
 		auto b64 = reinterpret_cast<const u64*>(b.address());
 		auto c64 = reinterpret_cast<u64*>(c.address());
-		auto cap = (a.size() + 63) >> 6;
-		for (unsigned i = 0; i < cap; i++) {
-			c64[i] = a64[i];
-		}
-		if ((a.size() & 7) == 0) { //if byte aligned
-			auto d8 = reinterpret_cast<u8*>(c.address());
-			auto dst = reinterpret_cast<u64*>(&d8[a.size() >> 3]);
-			auto cap = (b.size() + 63) >> 6;
-			for (unsigned i = 0; i < cap; i++) {
-				dst[i] = b64[i];
+		auto acap = (a.size() + 63) >> 6;
+		auto bcap = (b.size() + 63) >> 6;
+		auto ccap = (c.size() + 63) >> 6;
+		// words of c are built in stream order and stored back at the end
+		for (u64 i = 0; i < acap; i++) {
+			c64[i] = load_stream_word(a64, i);
+		}
+		for (u64 i = acap; i < ccap; i++) {
+			c64[i] = 0;
+		}
+		u8 misalign = a.size() & 63;
+		if (misalign) {
+			c64[acap - 1] &= ~(~u64(0) >> misalign); // drop whatever is stored after a
+		}
+		auto dst = c64 + (a.size() >> 6);
+		if (misalign == 0) { //if word aligned
+			for (u64 i = 0; i < bcap; i++) {
+				dst[i] = load_stream_word(b64, i);
 			}
-		} else { // not aligned ... a little bit harder    
-			u8 misalign = a.size() & 7;
+		} else { // not aligned, every word of b is split over two words of c
 			u8 inv_misalign = sizeof(u64) * 8 - misalign;
-			auto d8 = reinterpret_cast<u8*>(c.address());
-			auto dst = reinterpret_cast<u64*>(&d8[a.size() >> 3]); //points to the last u64
-			u64 carry = dst[0];
-			unsigned i;
-			auto cap = (b.size() + 63) >> 6;
-			for (i = 0; i < cap; i++) {
-				u64 loaded = b64[i];
-				dst[i] = carry | (loaded << misalign);
-				carry = loaded >> inv_misalign;
+			auto last = ccap - (a.size() >> 6);
+			for (u64 i = 0; i < bcap; i++) {
+				u64 word = load_stream_word(b64, i);
+				dst[i] |= word >> misalign;
+				if (i + 1 < last) dst[i + 1] = word << inv_misalign;
 			}
-			auto last_byte = reinterpret_cast<u8*>(&dst[i]);
-			last_byte[0] = (u8)carry;
+		}
+		if (c.size() & 63) {
+			c64[ccap - 1] &= ~(~u64(0) >> (c.size() & 63));
+		}
+		for (u64 i = 0; i < ccap; i++) {
+			c64[i] = bswap64(c64[i]);
 		}
 		return c;
 	}
@@ -221,19 +110,24 @@ namespace binseq {
 		auto a64 = reinterpret_cast<const u64*>(a.address());
 		auto b64 = reinterpret_cast<u64*>(b.address());
 
-		u8 misalign = offset & 7;
+		// words which can be read from a, anything after reads as zero
+		u64 words = word_count(a);
+		u8 misalign = offset & 63;
 		u8 inv_misalign = sizeof(u64) * 8 - misalign;
-		auto d8 = reinterpret_cast<const u8*>(a.address());
-		auto src = reinterpret_cast<const u64*>(&d8[offset >> 3]); //points to the last u64
-		u64 carry = src[0] >> misalign;
-		unsigned i;
+		auto first = offset >> 6;
 		auto cap = (b.size() + 63) >> 6;
-		for (i = 0; i < cap; i++) {
-			u64 loaded = src[i + 1];
-			b64[i] = carry | (loaded << inv_misalign);
-			carry = loaded >> misalign;
+		for (u64 i = 0; i < cap; i++) {
+			// shifting left moves forward in stream order
+			u64 word = first + i < words ? load_stream_word(a64, first + i) : 0;
+			if (misalign) {
+				u64 next = first + i + 1 < words ? load_stream_word(a64, first + i + 1) : 0;
+				word = (word << misalign) | (next >> inv_misalign);
+			}
+			if (i + 1 == cap && (size & 63)) {
+				word &= ~(~u64(0) >> (size & 63));
+			}
+			b64[i] = bswap64(word);
 		}
-		b64[i - 1] &= ~(u64(-1) << (size & 63));
 		return b;
 	}
 
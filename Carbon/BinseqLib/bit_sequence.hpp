@@ -45,7 +45,7 @@ namespace binseq {
 		}
 
 		inline bit operator[](u64 bitIndex) const {
-			return operator[](bitIndex);
+			return bit_reference(reinterpret_cast<const u8*>(address()) + (bitIndex >> 3), bitIndex & 7).test();
 		}
 
 		inline void deallocate() {
@@ -0,0 +1,55 @@
+#include "bit_stream.hpp"
+#include <cstring>
+
+namespace binseq {
+
+	void bit_writer::write(const bit_sequence& seq) {
+		auto words = reinterpret_cast<const u64*>(seq.address());
+		u64 full = seq.size() >> 6;
+		for (u64 k = 0; k < full; k++) {
+			write(load_stream_word(words, k), 64);
+		}
+		u32 tail = u32(seq.size() & 63);
+		if (tail) {
+			write(load_stream_word(words, full) >> (64 - tail), tail);
+		}
+	}
+
+	bit_sequence bit_writer::finish() {
+		u64 bits = size();
+		if (_used) {
+			_words.push_back(bswap64(_acc));
+		}
+		bit_sequence seq;
+		seq.reallocate(bits);
+		auto dst = reinterpret_cast<u64*>(seq.address());
+		if (bits <= 128) {
+			dst[0] = dst[1] = 0;
+		}
+		if (!_words.empty()) {
+			std::memcpy(dst, _words.data(), _words.size() * sizeof(u64));
+		}
+		_words.clear();
+		_acc = 0;
+		_used = 0;
+		return seq;
+	}
+
+	bit_sequence from_stream_words(const u64* words, u64 bits) {
+		bit_sequence seq;
+		seq.reallocate(bits);
+		auto dst = reinterpret_cast<u64*>(seq.address());
+		u64 count = (bits + 63) >> 6;
+		if (bits <= 128) {
+			dst[0] = dst[1] = 0;
+		}
+		for (u64 k = 0; k < count; k++) {
+			dst[k] = bswap64(words[k]);
+		}
+		if (bits & 63) {
+			dst[count - 1] &= bswap64(~(~u64(0) >> (bits & 63)));
+		}
+		return seq;
+	}
+
+}
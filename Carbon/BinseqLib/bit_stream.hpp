@@ -0,0 +1,158 @@
+#pragma once
+#include "types.hpp"
+#include "intrinsics.hpp"
+#include "bit_sequence.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace binseq {
+
+	/* Stream order is the order in which bit_sequence::operator[] and the
+	b"..." literals see the bits: bit 0 is the most significant bit of the first
+	byte. Byte swapping a stored u64 gives a word where stream bit 64k+j is
+	bit 63-j, so shifting left moves forward in the stream. */
+
+	/* number of u64 words which can be safely loaded from the sequence */
+	inline u64 word_count(const bit_sequence& seq) {
+		return seq.size() <= 128 ? 2 : (seq.size() + 63) >> 6;
+	}
+
+	/* loads stored word k as a stream order word (first bit is the msb) */
+	inline u64 load_stream_word(const u64* words, u64 k) {
+		return bswap64(words[k]);
+	}
+
+	/* random access read of 1..64 bits at any offset, the first bit read is
+	the most significant bit of the result, caller checks offset+width<=size */
+	inline u64 read_bits(const bit_sequence& seq, u64 offset, u32 width) {
+		auto words = reinterpret_cast<const u64*>(seq.address());
+		u64 k = offset >> 6;
+		u32 s = u32(offset & 63);
+		u64 top = load_stream_word(words, k) << s;
+		if (s + width > 64) {
+			top |= load_stream_word(words, k + 1) >> (64 - s);
+		}
+		return top >> (64 - width);
+	}
+
+	/* sequential reader, reading past the end yields zeros */
+	class bit_reader {
+	private:
+		const u64* _words;
+		u64 _size;
+		u64 _position;
+
+	public:
+		inline bit_reader(const bit_sequence& seq, u64 position = 0)
+			: _words(reinterpret_cast<const u64*>(seq.address())), _size(seq.size()), _position(position) {}
+
+		inline u64 position() const {
+			return _position;
+		}
+
+		inline u64 size() const {
+			return _size;
+		}
+
+		inline u64 remaining() const {
+			return _position < _size ? _size - _position : 0;
+		}
+
+		inline void seek(u64 position) {
+			_position = position;
+		}
+
+		/* next 64 bits msb aligned, bits after the end are zero */
+		inline u64 window() const {
+			if (_position >= _size) return 0;
+			u64 k = _position >> 6;
+			u32 s = u32(_position & 63);
+			u64 top = load_stream_word(_words, k) << s;
+			if (s != 0 && ((k + 1) << 6) < _size) {
+				top |= load_stream_word(_words, k + 1) >> (64 - s);
+			}
+			u64 avail = _size - _position;
+			if (avail < 64) top &= ~(~u64(0) >> avail);
+			return top;
+		}
+
+		/* look at the next 1..64 bits without consuming them */
+		inline u64 peek(u32 width) const {
+			return window() >> (64 - width);
+		}
+
+		inline void skip(u64 width) {
+			_position += width;
+		}
+
+		/* read 0..64 bits, first bit read is the msb of the result */
+		inline u64 read(u32 width) {
+			if (width == 0) return 0;
+			u64 v = peek(width);
+			_position += width;
+			return v;
+		}
+
+		inline bit read_bit() {
+			return read(1) != 0;
+		}
+	};
+
+	/* appends bits in stream order and produces a bit_sequence */
+	class bit_writer {
+	private:
+		std::vector<u64> _words;
+		u64 _acc;
+		u32 _used;
+
+	public:
+		inline bit_writer() : _acc(0), _used(0) {}
+
+		inline void reserve(u64 bits) {
+			_words.reserve((size_t)((bits + 63) >> 6));
+		}
+
+		inline u64 size() const {
+			return (u64(_words.size()) << 6) + _used;
+		}
+
+		/* write the low 0..64 bits of value, most significant first */
+		inline void write(u64 value, u32 width) {
+			if (width == 0) return;
+			value &= low_mask(width);
+			u32 free = 64 - _used;
+			if (width < free) {
+				_acc |= value << (free - width);
+				_used += width;
+			} else {
+				u32 rest = width - free;
+				_acc |= value >> rest;
+				_words.push_back(bswap64(_acc));
+				_acc = rest ? value << (64 - rest) : 0;
+				_used = rest;
+			}
+		}
+
+		inline void write_bit(bit value) {
+			write(value ? 1 : 0, 1);
+		}
+
+		/* write count zero bits followed by a one */
+		inline void write_unary(u64 count) {
+			while (count >= 64) {
+				write(0, 64);
+				count -= 64;
+			}
+			write(1, u32(count) + 1);
+		}
+
+		/* appends a whole sequence */
+		void write(const bit_sequence& seq);
+
+		bit_sequence finish();
+	};
+
+	/* builds a sequence from stream order words (msb is the first bit) */
+	bit_sequence from_stream_words(const u64* words, u64 bits);
+
+}
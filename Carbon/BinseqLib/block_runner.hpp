@@ -0,0 +1,11 @@
+#pragma once
+#include "types.hpp"
+#include <functional>
+
+namespace binseq {
+
+	/* calls fn(first, last) for ranges covering [0, count); blocks are
+	independent so the ranges can run concurrently, default runs serially */
+	using block_runner = std::function<void(u64 count, const std::function<void(u64 first, u64 last)>& fn)>;
+
+}
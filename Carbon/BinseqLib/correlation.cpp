@@ -0,0 +1,126 @@
+#include "correlation.hpp"
+#include "bit_stream.hpp"
+#include "fft.hpp"
+#include "intrinsics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <mutex>
+
+namespace binseq {
+
+	typedef std::complex<double> complex;
+
+	/* segments of the FFT path hold at least this many bits */
+	static const u64 fft_segment_bits = 1 << 15;
+
+	/* cost of one butterfly of the FFT path in word xor and popcount steps */
+	static const double fft_butterfly_cost = 6;
+
+	/* stream order words of the sequence followed by two zero words */
+	static std::vector<u64> stream_words(const bit_sequence& seq) {
+		std::vector<u64> words((size_t)((seq.size() + 63) >> 6) + 2, 0);
+		for (u64 i = 0; i < seq.size(); i += 64) {
+			u32 width = u32(std::min<u64>(64, seq.size() - i));
+			words[(size_t)(i >> 6)] = read_bits(seq, i, width) << (64 - width);
+		}
+		return words;
+	}
+
+	static inline bit stream_bit(const std::vector<u64>& words, u64 i) {
+		return ((words[(size_t)(i >> 6)] >> (63 - (i & 63))) & 1) != 0;
+	}
+
+	/* number of i < min(na, nb-k) with a_i != b_(i+k) */
+	static u64 mismatches(const u64* a, u64 na, const u64* b, u64 nb, u64 k) {
+		if (nb <= k) return 0;
+		u64 m = std::min(na, nb - k), full = m >> 6;
+		u32 rest = u32(m & 63), s = u32(k & 63);
+		b += k >> 6;
+		u64 count = 0;
+		if (s == 0) {
+			for (u64 j = 0; j < full; j++) count += popcount64(a[j] ^ b[j]);
+		} else {
+			for (u64 j = 0; j < full; j++) count += popcount64(a[j] ^ ((b[j] << s) | (b[j + 1] >> (64 - s))));
+		}
+		if (rest != 0) {
+			u64 w = s == 0 ? b[full] : (b[full] << s) | (b[full + 1] >> (64 - s));
+			count += popcount64((a[full] ^ w) & ~(~u64(0) >> rest));
+		}
+		return count;
+	}
+
+	/* out[k] = mismatches at lag k for k = 0..lags-1 */
+	static void lag_mismatches(const bit_sequence& a, const bit_sequence& b, u64 lags, const block_runner& run, u64* out) {
+		u64 na = a.size(), nb = b.size();
+		lags = std::min(lags, nb);
+		u64 overlap = std::min(na, nb);
+		if (lags == 0 || overlap == 0) return;
+		std::vector<u64> aw = stream_words(a), bw = stream_words(b);
+		u64 segment = (std::max(lags, fft_segment_bits) + 63) & ~u64(63);
+		u64 size = 1;
+		while (size < segment + lags) size <<= 1;
+		u64 segments = (overlap + segment - 1) / segment;
+		double direct = double(lags) * double(overlap) / 64;
+		double transform = fft_butterfly_cost * double(segments) * double(size) * std::log2(double(size));
+		if (direct <= transform) {
+			auto range = [&](u64 first, u64 last) {
+				for (u64 k = first; k < last; k++) out[k] = mismatches(aw.data(), na, bw.data(), nb, k);
+			};
+			if (run) run(lags, range); else range(0, lags);
+			return;
+		}
+		// a segment of a in the real part and the matching stretch of b in the
+		// imaginary part share one transform, the sum of x_i y_(i+k) over +1/-1
+		// signals is agreements minus disagreements
+		std::mutex merge;
+		auto range = [&](u64 first, u64 last) {
+			std::vector<complex> z((size_t)size), w((size_t)size);
+			std::vector<u64> local((size_t)lags, 0);
+			for (u64 g = first; g < last; g++) {
+				u64 offset = g * segment;
+				u64 length = std::min(segment, na - offset);
+				u64 stretch = std::min(length + lags, nb - offset);
+				for (u64 i = 0; i < size; i++) {
+					double x = i < length ? (stream_bit(aw, offset + i) ? -1.0 : 1.0) : 0.0;
+					double y = i < stretch ? (stream_bit(bw, offset + i) ? -1.0 : 1.0) : 0.0;
+					z[(size_t)i] = complex(x, y);
+				}
+				fft(z);
+				for (u64 t = 0; t < size; t++) {
+					complex p = z[(size_t)t], q = std::conj(z[(size_t)((size - t) & (size - 1))]);
+					complex X = (p + q) * 0.5, Y = (p - q) * complex(0, -0.5);
+					w[(size_t)t] = std::conj(X) * Y;
+				}
+				fft(w, true);
+				for (u64 k = 0; k < lags && offset + k < nb; k++) {
+					long long agree = std::llround(w[(size_t)k].real() / double(size));
+					long long pairs = (long long)std::min(length, nb - offset - k);
+					local[(size_t)k] += u64((pairs - agree) / 2);
+				}
+			}
+			std::lock_guard<std::mutex> lock(merge);
+			for (u64 k = 0; k < lags; k++) out[k] += local[(size_t)k];
+		};
+		if (run) run(segments, range); else range(0, segments);
+	}
+
+	std::vector<u64> autocorrelation(const bit_sequence& seq, u64 max_lag, const block_runner& run) {
+		std::vector<u64> result((size_t)(max_lag + 1), 0);
+		lag_mismatches(seq, seq, max_lag + 1, run, result.data());
+		return result;
+	}
+
+	std::vector<u64> cross_correlation(const bit_sequence& a, const bit_sequence& b, u64 max_lag, const block_runner& run) {
+		std::vector<u64> forward((size_t)(max_lag + 1), 0), backward((size_t)(max_lag + 1), 0);
+		lag_mismatches(a, b, max_lag + 1, run, forward.data());
+		lag_mismatches(b, a, max_lag + 1, run, backward.data());
+		std::vector<u64> result((size_t)(2 * max_lag + 1));
+		for (u64 k = 0; k <= max_lag; k++) {
+			result[(size_t)(max_lag + k)] = forward[(size_t)k];
+			result[(size_t)(max_lag - k)] = backward[(size_t)k];
+		}
+		return result;
+	}
+
+}
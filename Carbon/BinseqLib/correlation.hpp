@@ -0,0 +1,22 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include "block_runner.hpp"
+#include <vector>
+
+namespace binseq {
+
+	/* Correlation of bit sequences as counts of disagreeing bits. Small lag
+	ranges xor whole words of one sequence with shifted words of the other
+	and count with popcount, the lags are independent and may be spread over
+	a runner. Large lag ranges switch to overlap-save FFT correlation of the
+	+1/-1 signals, where segments are spread over the runner instead. */
+
+	/* entry k for k = 0..max_lag is the number of i < n-k with s_i != s_(i+k) */
+	std::vector<u64> autocorrelation(const bit_sequence&, u64 max_lag, const block_runner& run = nullptr);
+
+	/* entry max_lag+k for k = -max_lag..max_lag is the number of i with
+	a_i != b_(i+k) where both bits exist */
+	std::vector<u64> cross_correlation(const bit_sequence& a, const bit_sequence& b, u64 max_lag, const block_runner& run = nullptr);
+
+}
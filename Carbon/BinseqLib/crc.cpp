@@ -0,0 +1,142 @@
+#include "crc.hpp"
+#include "bit_stream.hpp"
+#include "intrinsics.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace binseq {
+
+	/* inputs are split into blocks of this many bytes when a runner is given */
+	static const u64 crc_block_bytes = 1 << 16;
+
+	struct crc_preset_entry {
+		const char* name;
+		crc_parameters parameters;
+	};
+
+	static const crc_preset_entry crc_presets[] = {
+		{ "crc-8", { 8, 0x07, 0, false, 0 } },
+		{ "crc-16/arc", { 16, 0x8005, 0, true, 0 } },
+		{ "crc-16/xmodem", { 16, 0x1021, 0, false, 0 } },
+		{ "crc-16/ibm-3740", { 16, 0x1021, 0xffff, false, 0 } },
+		{ "crc-32", { 32, 0x04c11db7, 0xffffffff, true, 0xffffffff } },
+		{ "crc-32c", { 32, 0x1edc6f41, 0xffffffff, true, 0xffffffff } },
+		{ "crc-64/ecma-182", { 64, 0x42f0e1eba9ea3693ull, 0, false, 0 } },
+		{ "crc-64/xz", { 64, 0x42f0e1eba9ea3693ull, ~0ull, true, ~0ull } },
+	};
+
+	crc_parameters crc_preset(const char* name) {
+		for (auto& entry : crc_presets) {
+			if (std::strcmp(entry.name, name) == 0) return entry.parameters;
+		}
+		throw std::invalid_argument("unknown crc algorithm");
+	}
+
+	/* reverses the bits inside every byte */
+	static inline u64 reflect_bytes(u64 x) {
+		x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+		x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+		return ((x >> 4) & 0x0f0f0f0f0f0f0f0full) | ((x & 0x0f0f0f0f0f0f0f0full) << 4);
+	}
+
+	crc_engine::crc_engine(const crc_parameters& parameters) : _parameters(parameters), _tables(8 * 256) {
+		if (parameters.width < 1 || parameters.width > 64)
+			throw std::invalid_argument("crc width must be between 1 and 64");
+		_poly = (parameters.poly & low_mask(parameters.width)) << (64 - parameters.width);
+		// table k folds a byte followed by k more bytes
+		for (u32 v = 0; v < 256; v++) {
+			u64 reg = u64(v) << 56;
+			for (u32 i = 0; i < 8; i++) reg = (reg << 1) ^ (reg >> 63 ? _poly : 0);
+			_tables[v] = reg;
+		}
+		for (u32 k = 1; k < 8; k++) {
+			for (u32 v = 0; v < 256; v++) {
+				u64 prev = _tables[(k - 1) * 256 + v];
+				_tables[k * 256 + v] = (prev << 8) ^ _tables[prev >> 56];
+			}
+		}
+	}
+
+	/* folds bytes first..last into the msb aligned register */
+	u64 crc_engine::update(u64 reg, const bit_sequence& seq, u64 first, u64 last) const {
+		const u64* t = _tables.data();
+		bool reflect = _parameters.reflect;
+		u64 i = first;
+		for (; i + 8 <= last; i += 8) {
+			u64 data = read_bits(seq, i << 3, 64);
+			u64 x = reg ^ (reflect ? reflect_bytes(data) : data);
+			reg = t[7 * 256 + (x >> 56)] ^ t[6 * 256 + ((x >> 48) & 255)] ^ t[5 * 256 + ((x >> 40) & 255)] ^ t[4 * 256 + ((x >> 32) & 255)]
+				^ t[3 * 256 + ((x >> 24) & 255)] ^ t[2 * 256 + ((x >> 16) & 255)] ^ t[256 + ((x >> 8) & 255)] ^ t[x & 255];
+		}
+		for (; i < last; i++) {
+			u64 data = read_bits(seq, i << 3, 8);
+			if (reflect) data = reflect_bytes(data);
+			reg = (reg << 8) ^ t[(reg >> 56) ^ data];
+		}
+		return reg;
+	}
+
+	/* carry-less product of two right aligned registers modulo the polynomial */
+	u64 crc_engine::multiply(u64 a, u64 b) const {
+		u32 width = _parameters.width;
+		u64 poly = _poly >> (64 - width);
+		u64 r = 0;
+		for (u32 i = width; i-- != 0;) {
+			u64 carry = (r >> (width - 1)) & 1;
+			r = (r << 1) & low_mask(width);
+			if (carry) r ^= poly;
+			if ((a >> i) & 1) r ^= b;
+		}
+		return r;
+	}
+
+	/* x^bits modulo the polynomial */
+	u64 crc_engine::power(u64 bits) const {
+		u32 width = _parameters.width;
+		u64 result = 1, base = width > 1 ? 2 : _poly >> 63;
+		for (; bits != 0; bits >>= 1) {
+			if (bits & 1) result = multiply(result, base);
+			base = multiply(base, base);
+		}
+		return result;
+	}
+
+	u64 crc_engine::compute(const bit_sequence& seq, const block_runner& run) const {
+		u32 width = _parameters.width;
+		u64 bytes = seq.size() >> 3;
+		u64 reg = (_parameters.init & low_mask(width)) << (64 - width);
+		if (run && bytes > crc_block_bytes) {
+			u64 blocks = (bytes + crc_block_bytes - 1) / crc_block_bytes;
+			std::vector<u64> partial((size_t)blocks);
+			run(blocks, [&](u64 first, u64 last) {
+				for (u64 b = first; b < last; b++) {
+					partial[(size_t)b] = update(0, seq, b * crc_block_bytes, std::min(bytes, (b + 1) * crc_block_bytes));
+				}
+			});
+			// reg(A B) = reg(A) x^|B| + reg(B) for a zero register over B
+			u64 full = power(crc_block_bytes << 3);
+			u64 last_bytes = bytes - (blocks - 1) * crc_block_bytes;
+			u64 tail = last_bytes == crc_block_bytes ? full : power(last_bytes << 3);
+			u64 r = reg >> (64 - width);
+			for (u64 b = 0; b < blocks; b++) {
+				r = multiply(r, b + 1 == blocks ? tail : full) ^ (partial[(size_t)b] >> (64 - width));
+			}
+			reg = r << (64 - width);
+		} else {
+			reg = update(reg, seq, 0, bytes);
+		}
+		for (u64 i = bytes << 3; i < seq.size(); i++) {
+			u64 top = (reg >> 63) ^ read_bits(seq, i, 1);
+			reg = (reg << 1) ^ (top ? _poly : 0);
+		}
+		u64 result = reg >> (64 - width);
+		if (_parameters.reflect) result = bswap64(reflect_bytes(result << (64 - width)));
+		return (result ^ _parameters.xorout) & low_mask(width);
+	}
+
+	u64 crc(const bit_sequence& seq, const crc_parameters& parameters, const block_runner& run) {
+		return crc_engine(parameters).compute(seq, run);
+	}
+
+}
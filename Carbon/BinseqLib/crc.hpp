@@ -0,0 +1,49 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include "block_runner.hpp"
+#include <vector>
+
+namespace binseq {
+
+	/* Cyclic redundancy checks of any width from 1 to 64 in the parameter
+	model of the CRC catalogues: poly and init are given unreflected, with
+	reflect the bits of every input byte and of the final register are
+	reversed, and xorout is applied last. The bytes of the sequence are read
+	in stream order, bits after the last whole byte are shifted in one by one. */
+	struct crc_parameters {
+		u32 width;
+		u64 poly;
+		u64 init;
+		bool reflect;
+		u64 xorout;
+	};
+
+	/* catalogue algorithm by name, such as "crc-32", "crc-32c", "crc-16/arc",
+	"crc-16/xmodem" or "crc-64/xz", throws std::invalid_argument when unknown */
+	crc_parameters crc_preset(const char* name);
+
+	/* Slicing by 8 tables for one parameter set: the register is kept in the
+	top bits of a word and eight bytes are folded in per step. Long inputs
+	are split into blocks which may be spread over a runner; the block CRCs
+	are joined by multiplying with x^(block bits) modulo the polynomial. */
+	class crc_engine {
+	private:
+		crc_parameters _parameters;
+		u64 _poly; // msb aligned
+		std::vector<u64> _tables;
+
+		u64 update(u64 reg, const bit_sequence&, u64 first, u64 last) const;
+		u64 multiply(u64 a, u64 b) const;
+		u64 power(u64 bits) const;
+
+	public:
+		/* throws std::invalid_argument when the width is not 1..64 */
+		explicit crc_engine(const crc_parameters&);
+
+		u64 compute(const bit_sequence&, const block_runner& run = nullptr) const;
+	};
+
+	u64 crc(const bit_sequence&, const crc_parameters&, const block_runner& run = nullptr);
+
+}
@@ -0,0 +1,384 @@
+#include "entropy.hpp"
+#include "bit_stream.hpp"
+#include "integer_codes.hpp"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+
+namespace binseq {
+
+	/* distinct symbols in ascending order, their counts and the alphabet index
+	of every input symbol */
+	struct alphabet {
+		std::vector<s64> values;
+		std::vector<u64> counts;
+		std::vector<u32> index;
+	};
+
+	static alphabet build_alphabet(const s64* symbols, size_t count) {
+		alphabet a;
+		a.index.resize(count);
+		bool bytes = true;
+		for (size_t i = 0; i < count && bytes; i++) {
+			bytes = symbols[i] >= 0 && symbols[i] < 256;
+		}
+		if (bytes) {
+			// byte alphabets are counted directly without sorting
+			u64 histogram[256] = {};
+			u32 map[256];
+			for (size_t i = 0; i < count; i++) histogram[symbols[i]]++;
+			for (u32 v = 0; v < 256; v++) {
+				if (histogram[v] == 0) continue;
+				map[v] = u32(a.values.size());
+				a.values.push_back(v);
+				a.counts.push_back(histogram[v]);
+			}
+			for (size_t i = 0; i < count; i++) a.index[i] = map[symbols[i]];
+			return a;
+		}
+		a.values.assign(symbols, symbols + count);
+		std::sort(a.values.begin(), a.values.end());
+		a.values.erase(std::unique(a.values.begin(), a.values.end()), a.values.end());
+		a.counts.assign(a.values.size(), 0);
+		for (size_t i = 0; i < count; i++) {
+			u32 k = u32(std::lower_bound(a.values.begin(), a.values.end(), symbols[i]) - a.values.begin());
+			a.index[i] = k;
+			a.counts[k]++;
+		}
+		return a;
+	}
+
+	static void write_header(bit_writer& out, bool text, size_t count, const std::vector<s64>& values) {
+		out.write_bit(text);
+		write_delta(out, u64(count) + 1);
+		if (count == 0) return;
+		write_delta(out, values.size());
+		out.write(u64(values[0]), 64);
+		for (size_t i = 1; i < values.size(); i++) {
+			write_delta(out, u64(values[i]) - u64(values[i - 1]));
+		}
+	}
+
+	static std::vector<s64> read_header(bit_reader& in, bool* text, u64& count) {
+		bool is_text = in.read_bit();
+		if (text) *text = is_text;
+		count = read_delta(in) - 1;
+		std::vector<s64> values;
+		if (count == 0) {
+			if (in.remaining() != 0)
+				throw std::invalid_argument("entropy coded header is corrupted");
+			return values;
+		}
+		u64 distinct = read_delta(in);
+		if (distinct > count || distinct > in.remaining())
+			throw std::invalid_argument("entropy coded header is corrupted");
+		values.resize((size_t)distinct);
+		if (in.remaining() < 64)
+			throw std::invalid_argument("entropy coded header is truncated");
+		values[0] = s64(in.read(64));
+		for (size_t i = 1; i < values.size(); i++) {
+			values[i] = s64(u64(values[i - 1]) + read_delta(in));
+		}
+		return values;
+	}
+
+	static const u32 huffman_limit = 24;
+	static const u32 table_bits = 11;
+
+	/* code lengths of a Huffman tree, the counts are flattened until the
+	longest code fits into the limit */
+	static std::vector<u8> huffman_lengths(const std::vector<u64>& counts) {
+		size_t n = counts.size();
+		std::vector<u8> lengths(n, 1);
+		if (n == 1) return lengths;
+		std::vector<u64> weights = counts;
+		std::vector<u32> parent(2 * n - 1);
+		std::vector<u32> depth(2 * n - 1);
+		while (true) {
+			using item = std::pair<u64, u32>;
+			std::priority_queue<item, std::vector<item>, std::greater<item>> heap;
+			for (u32 i = 0; i < n; i++) heap.push(item(weights[i], i));
+			u32 next = u32(n);
+			while (heap.size() > 1) {
+				item a = heap.top(); heap.pop();
+				item b = heap.top(); heap.pop();
+				parent[a.second] = parent[b.second] = next;
+				heap.push(item(a.first + b.first, next++));
+			}
+			// parents always have a higher index than their children
+			u32 root = next - 1;
+			depth[root] = 0;
+			u32 longest = 0;
+			for (u32 node = root; node-- > 0;) {
+				depth[node] = depth[parent[node]] + 1;
+				if (node < n) longest = std::max(longest, depth[node]);
+			}
+			if (longest <= huffman_limit) {
+				for (u32 i = 0; i < n; i++) lengths[i] = u8(depth[i]);
+				return lengths;
+			}
+			for (auto& w : weights) w = (w >> 1) | 1;
+		}
+	}
+
+	/* symbols ordered by (length, index) with the first code of every length */
+	struct canonical_code {
+		std::vector<u32> order;
+		u32 first_code[huffman_limit + 2];
+		u32 first_index[huffman_limit + 2];
+		u32 count[huffman_limit + 2];
+		u32 max_length;
+	};
+
+	static canonical_code build_canonical(const std::vector<u8>& lengths) {
+		canonical_code c;
+		std::fill(c.count, c.count + huffman_limit + 2, 0u);
+		c.max_length = 0;
+		for (auto l : lengths) {
+			if (l < 1 || l > huffman_limit)
+				throw std::invalid_argument("huffman code length is out of range");
+			c.count[l]++;
+			c.max_length = std::max<u32>(c.max_length, l);
+		}
+		u32 code = 0, index = 0;
+		for (u32 l = 1; l <= huffman_limit; l++) {
+			c.first_code[l] = code;
+			c.first_index[l] = index;
+			if (u64(code) + c.count[l] > (u64(1) << l))
+				throw std::invalid_argument("huffman code lengths are not a prefix code");
+			code = (code + c.count[l]) << 1;
+			index += c.count[l];
+		}
+		c.order.resize(lengths.size());
+		std::vector<u32> fill(c.first_index, c.first_index + huffman_limit + 1);
+		for (u32 s = 0; s < lengths.size(); s++) {
+			c.order[fill[lengths[s]]++] = s;
+		}
+		return c;
+	}
+
+	/* finds the code at the top of the available bits, codes are prefix free so
+	the first match by increasing length is the right one */
+	static bool match_code(const canonical_code& c, u32 bits, u32 available, u32 limit, u32& symbol, u32& length) {
+		for (u32 l = 1; l <= std::min(available, limit); l++) {
+			if (c.count[l] == 0) continue;
+			u32 code = bits >> (available - l);
+			if (code >= c.first_code[l] && code - c.first_code[l] < c.count[l]) {
+				symbol = c.order[c.first_index[l] + code - c.first_code[l]];
+				length = l;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bit_sequence huffman_encode(const s64* symbols, size_t count, bool text) {
+		bit_writer out;
+		alphabet a = build_alphabet(symbols, count);
+		write_header(out, text, count, a.values);
+		if (count == 0) return out.finish();
+		if (a.values.size() > (size_t(1) << huffman_limit))
+			throw std::invalid_argument("too many distinct symbols for huffman coding");
+
+		auto lengths = huffman_lengths(a.counts);
+		for (auto l : lengths) write_gamma(out, l);
+		auto c = build_canonical(lengths);
+		std::vector<u32> codes(lengths.size());
+		for (u32 l = 1; l <= c.max_length; l++) {
+			for (u32 k = 0; k < c.count[l]; k++) {
+				codes[c.order[c.first_index[l] + k]] = c.first_code[l] + k;
+			}
+		}
+		u64 bits = 0;
+		for (size_t s = 0; s < lengths.size(); s++) bits += a.counts[s] * lengths[s];
+		out.reserve(out.size() + bits);
+		for (size_t i = 0; i < count; i++) {
+			u32 s = a.index[i];
+			out.write(codes[s], lengths[s]);
+		}
+		return out.finish();
+	}
+
+	std::vector<s64> huffman_decode(const bit_sequence& seq, bool* text) {
+		bit_reader in(seq);
+		u64 count;
+		auto values = read_header(in, text, count);
+		std::vector<s64> result;
+		if (count == 0) return result;
+		std::vector<u8> lengths(values.size());
+		for (auto& l : lengths) {
+			u64 v = read_gamma(in);
+			if (v > huffman_limit)
+				throw std::invalid_argument("huffman code length is out of range");
+			l = u8(v);
+		}
+		auto c = build_canonical(lengths);
+		if (count > in.remaining())
+			throw std::invalid_argument("huffman payload is truncated");
+
+		struct entry {
+			u32 symbols[2];
+			u8 bits[2]; // bits used after the first and after the second symbol
+			u8 count;
+		};
+		std::vector<entry> table(size_t(1) << table_bits);
+		for (u32 v = 0; v < table.size(); v++) {
+			auto& e = table[v];
+			e.count = 0;
+			u32 length;
+			if (!match_code(c, v, table_bits, table_bits, e.symbols[0], length)) continue;
+			e.count = 1;
+			e.bits[0] = u8(length);
+			u32 rest = table_bits - length;
+			u32 second;
+			if (rest > 0 && match_code(c, v & ((1u << rest) - 1), rest, rest, e.symbols[1], second)) {
+				e.count = 2;
+				e.bits[1] = u8(length + second);
+			}
+		}
+
+		result.reserve((size_t)count);
+		u64 done = 0;
+		while (done < count) {
+			u64 window = in.window();
+			auto& e = table[window >> (64 - table_bits)];
+			if (e.count == 2 && done + 2 <= count) {
+				result.push_back(values[e.symbols[0]]);
+				result.push_back(values[e.symbols[1]]);
+				in.skip(e.bits[1]);
+				done += 2;
+			} else if (e.count != 0) {
+				result.push_back(values[e.symbols[0]]);
+				in.skip(e.bits[0]);
+				done++;
+			} else {
+				u32 symbol, length;
+				if (!match_code(c, u32(window >> (64 - c.max_length)), c.max_length, c.max_length, symbol, length))
+					throw std::invalid_argument("invalid huffman code");
+				result.push_back(values[symbol]);
+				in.skip(length);
+				done++;
+			}
+			if (in.position() > in.size())
+				throw std::invalid_argument("huffman payload is truncated");
+		}
+		// the encoder writes exactly the payload, leftover bits mean a corrupted count
+		if (in.position() != in.size())
+			throw std::invalid_argument("huffman payload is corrupted");
+		return result;
+	}
+
+	static const u32 ans_low = 1u << 23; // lower bound of the coder state
+
+	bit_sequence ans_encode(const s64* symbols, size_t count, bool text) {
+		bit_writer out;
+		alphabet a = build_alphabet(symbols, count);
+		write_header(out, text, count, a.values);
+		if (count == 0) return out.finish();
+		size_t n = a.values.size();
+		if (n > 16384)
+			throw std::invalid_argument("too many distinct symbols for ans coding");
+
+		// quantize the counts so they add up to 2^scale, every symbol keeps at least 1
+		u32 scale = n <= 1024 ? 12 : 16;
+		u32 total = 1u << scale;
+		std::vector<u32> freq(n);
+		u64 sum = 0;
+		for (size_t s = 0; s < n; s++) {
+			freq[s] = std::max<u32>(1, u32(a.counts[s] * total / count));
+			sum += freq[s];
+		}
+		std::vector<u32> by_size(n);
+		for (u32 s = 0; s < n; s++) by_size[s] = s;
+		std::sort(by_size.begin(), by_size.end(), [&](u32 x, u32 y) { return freq[x] > freq[y]; });
+		while (sum > total) {
+			for (size_t k = 0; k < n && sum > total; k++) {
+				if (freq[by_size[k]] > 1) {
+					freq[by_size[k]]--;
+					sum--;
+				}
+			}
+		}
+		freq[by_size[0]] += u32(total - sum);
+		std::vector<u32> start(n);
+		for (size_t s = 1; s < n; s++) start[s] = start[s - 1] + freq[s - 1];
+
+		write_gamma(out, scale);
+		for (auto f : freq) write_gamma(out, f);
+
+		// symbols are encoded in reverse so the decoder runs forward
+		std::vector<u8> bytes;
+		bytes.reserve(count / 2 + 8);
+		u32 x = ans_low;
+		for (size_t i = count; i-- > 0;) {
+			u32 s = a.index[i];
+			u32 f = freq[s];
+			u64 x_max = u64((ans_low >> scale) << 8) * f;
+			while (x >= x_max) {
+				bytes.push_back(u8(x));
+				x >>= 8;
+			}
+			x = ((x / f) << scale) + (x % f) + start[s];
+		}
+		for (int k = 0; k < 4; k++) {
+			bytes.push_back(u8(x));
+			x >>= 8;
+		}
+		std::reverse(bytes.begin(), bytes.end());
+		out.reserve(out.size() + bytes.size() * 8);
+		for (auto b : bytes) out.write(b, 8);
+		return out.finish();
+	}
+
+	std::vector<s64> ans_decode(const bit_sequence& seq, bool* text) {
+		bit_reader in(seq);
+		u64 count;
+		auto values = read_header(in, text, count);
+		std::vector<s64> result;
+		if (count == 0) return result;
+		size_t n = values.size();
+		u64 scale = read_gamma(in);
+		if (scale != 12 && scale != 16)
+			throw std::invalid_argument("ans scale is out of range");
+		u32 total = 1u << scale;
+		std::vector<u32> freq(n), start(n);
+		std::vector<u32> slots(total);
+		u64 sum = 0;
+		for (size_t s = 0; s < n; s++) {
+			u64 f = read_gamma(in);
+			if (f > total || sum + f > total)
+				throw std::invalid_argument("ans frequencies are corrupted");
+			freq[s] = u32(f);
+			start[s] = u32(sum);
+			std::fill(slots.begin() + sum, slots.begin() + sum + f, u32(s));
+			sum += f;
+		}
+		if (sum != total)
+			throw std::invalid_argument("ans frequencies are corrupted");
+		if (in.remaining() & 7 || in.remaining() < 32)
+			throw std::invalid_argument("ans payload is truncated");
+
+		std::vector<u8> bytes((size_t)(in.remaining() >> 3));
+		for (auto& b : bytes) b = u8(in.read(8));
+		u32 x = (u32(bytes[0]) << 24) | (u32(bytes[1]) << 16) | (u32(bytes[2]) << 8) | bytes[3];
+		size_t pos = 4;
+		u32 mask = total - 1;
+		result.reserve((size_t)count);
+		for (u64 i = 0; i < count; i++) {
+			u32 slot = x & mask;
+			u32 s = slots[slot];
+			x = freq[s] * (x >> scale) + slot - start[s];
+			while (x < ans_low) {
+				if (pos >= bytes.size())
+					throw std::invalid_argument("ans payload is truncated");
+				x = (x << 8) | bytes[pos++];
+			}
+			result.push_back(values[s]);
+		}
+		if (x != ans_low || pos != bytes.size())
+			throw std::invalid_argument("ans payload is corrupted");
+		return result;
+	}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace binseq {
+
+	/* Entropy coders for arrays of symbols. The produced sequence carries a
+	small header with the symbol count, the alphabet and the model, so it can
+	be decoded without side information. text marks inputs which were byte
+	strings, the decoders report it back so the caller can restore the type.
+	Decoders throw std::invalid_argument on malformed input. */
+
+	/* canonical Huffman code, code lengths are limited to 24 bits and decoding
+	uses a table which resolves up to two short codes per lookup */
+	bit_sequence huffman_encode(const s64* symbols, size_t count, bool text = false);
+	std::vector<s64> huffman_decode(const bit_sequence&, bool* text = nullptr);
+
+	/* range asymmetric numeral system (rANS) coder with a static model,
+	frequencies are quantized to 12 bits, or 16 bits for large alphabets */
+	bit_sequence ans_encode(const s64* symbols, size_t count, bool text = false);
+	std::vector<s64> ans_decode(const bit_sequence&, bool* text = nullptr);
+
+}
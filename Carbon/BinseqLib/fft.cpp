@@ -0,0 +1,112 @@
+#include "fft.hpp"
+#include "bit_stream.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace binseq {
+
+	static const double pi = 3.14159265358979323846;
+
+	/* complex values per cache block, the first stages of a transform finish
+	one block before moving to the next */
+	static const size_t fft_block = 1 << 14;
+
+	typedef std::complex<double> complex;
+
+	/* butterflies of one stage over [begin, end), the twiddles of a stage of
+	length 2h are the h entries from index h of the table */
+	static void butterflies(complex* a, size_t begin, size_t end, size_t length, const complex* twiddle) {
+		size_t half = length >> 1;
+		const complex* w = twiddle + half;
+		for (size_t i = begin; i < end; i += length) {
+			complex* lo = a + i;
+			complex* hi = lo + half;
+			for (size_t k = 0; k < half; k++) {
+				complex v = hi[k] * w[k];
+				hi[k] = lo[k] - v;
+				lo[k] += v;
+			}
+		}
+	}
+
+	void fft(std::vector<complex>& a, bool inverse) {
+		size_t n = a.size();
+		if (n < 2) return;
+		for (size_t i = 1, j = 0; i < n; i++) {
+			size_t bit = n >> 1;
+			for (; j & bit; bit >>= 1) j ^= bit;
+			j ^= bit;
+			if (i < j) std::swap(a[i], a[j]);
+		}
+		// the last stage gets its twiddles directly, each smaller stage takes
+		// every other one of the stage above
+		std::vector<complex> twiddle(n);
+		double angle = (inverse ? 2 : -2) * pi / double(n);
+		for (size_t k = 0; k < n / 2; k++) twiddle[n / 2 + k] = std::polar(1.0, angle * double(k));
+		for (size_t half = n / 4; half != 0; half >>= 1) {
+			for (size_t k = 0; k < half; k++) twiddle[half + k] = twiddle[2 * half + 2 * k];
+		}
+		size_t block = std::min(n, fft_block);
+		for (size_t begin = 0; begin < n; begin += block) {
+			for (size_t length = 2; length <= block; length <<= 1) butterflies(a.data(), begin, begin + block, length, twiddle.data());
+		}
+		for (size_t length = block << 1; length <= n; length <<= 1) butterflies(a.data(), 0, n, length, twiddle.data());
+	}
+
+	void dft(std::vector<complex>& x) {
+		size_t n = x.size();
+		if ((n & (n - 1)) == 0) {
+			fft(x, false);
+			return;
+		}
+		size_t m = 1;
+		while (m < 2 * n - 1) m <<= 1;
+		std::vector<complex> chirp(n), a(m), b(m);
+		for (size_t k = 0; k < n; k++) {
+			u64 square = (u64(k) * k) % (2 * u64(n));
+			chirp[k] = std::polar(1.0, -pi * double(square) / double(n));
+			a[k] = x[k] * chirp[k];
+		}
+		b[0] = std::conj(chirp[0]);
+		for (size_t k = 1; k < n; k++) b[k] = b[m - k] = std::conj(chirp[k]);
+		fft(a, false);
+		fft(b, false);
+		for (size_t i = 0; i < m; i++) a[i] *= b[i];
+		fft(a, true);
+		for (size_t k = 0; k < n; k++) x[k] = chirp[k] * a[k] / double(m);
+	}
+
+	std::vector<complex> real_fft(const std::vector<double>& x) {
+		size_t n = x.size();
+		if (n < 4 || (n & (n - 1)) != 0) {
+			std::vector<complex> z(x.begin(), x.end());
+			dft(z);
+			z.resize(n / 2 + 1);
+			return z;
+		}
+		// even samples in the real part and odd ones in the imaginary part
+		// of a transform of half the size, then split into the two spectra
+		size_t m = n >> 1;
+		std::vector<complex> z(m);
+		for (size_t k = 0; k < m; k++) z[k] = complex(x[2 * k], x[2 * k + 1]);
+		fft(z, false);
+		std::vector<complex> result(m + 1);
+		for (size_t k = 0; k <= m; k++) {
+			complex p = z[k & (m - 1)], q = std::conj(z[(m - k) & (m - 1)]);
+			complex even = (p + q) * 0.5, odd = (p - q) * complex(0, -0.5);
+			result[k] = even + std::polar(1.0, -2 * pi * double(k) / double(n)) * odd;
+		}
+		return result;
+	}
+
+	std::vector<double> bipolar_signal(const bit_sequence& seq, u64 n) {
+		std::vector<double> x((size_t)n);
+		for (u64 i = 0; i < n; i += 64) {
+			u32 count = u32(std::min<u64>(64, n - i));
+			u64 w = read_bits(seq, i, count) << (64 - count);
+			for (u32 j = 0; j < count; j++, w <<= 1) x[size_t(i + j)] = (w >> 63) ? 1.0 : -1.0;
+		}
+		return x;
+	}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include <complex>
+#include <vector>
+
+namespace binseq {
+
+	/* Complex Fourier transforms in double precision, shared by the spectral
+	test, the correlation kernels and the fft native. Neither direction scales
+	the result, an inverse after a forward transform multiplies by the size. */
+
+	/* in place radix 2 transform, the size must be a power of two. The
+	stages which fit in a cache block run block by block. */
+	void fft(std::vector<std::complex<double>>& a, bool inverse = false);
+
+	/* forward transform of any length, Bluestein's algorithm turns lengths
+	which are not a power of two into a convolution */
+	void dft(std::vector<std::complex<double>>& x);
+
+	/* bins 0..n/2 of the forward transform of a real signal, the others are
+	their conjugates. Powers of two run as a complex transform of half the size. */
+	std::vector<std::complex<double>> real_fft(const std::vector<double>& x);
+
+	/* the first n bits as a signal of +1 for one and -1 for zero */
+	std::vector<double> bipolar_signal(const bit_sequence&, u64 n);
+
+}
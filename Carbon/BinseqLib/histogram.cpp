@@ -0,0 +1,91 @@
+#include "histogram.hpp"
+#include "bit_stream.hpp"
+#include "intrinsics.hpp"
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+namespace binseq {
+
+	/* ranges of this many positions or blocks are the unit of parallel work */
+	static const u64 parallel_span = 1 << 20;
+
+	u64 count_ones(const bit_sequence& seq, u64 offset, u64 length) {
+		u64 count = 0;
+		if (length != 0 && (offset & 63) != 0) {
+			u32 head = u32(std::min<u64>(length, 64 - (offset & 63)));
+			count += popcount64(read_bits(seq, offset, head));
+			offset += head;
+			length -= head;
+		}
+		// byte order doesn't matter for counting
+		auto words = reinterpret_cast<const u64*>(seq.address()) + (offset >> 6);
+		for (; length >= 64; length -= 64, offset += 64) count += popcount64(*words++);
+		if (length != 0) count += popcount64(read_bits(seq, offset, u32(length)));
+		return count;
+	}
+
+	std::vector<u64> block_popcount(const bit_sequence& seq, u64 block, const block_runner& run) {
+		if (block == 0)
+			throw std::invalid_argument("block length must be positive");
+		u64 blocks = seq.size() / block;
+		std::vector<u64> counts((size_t)blocks);
+		auto range = [&](u64 first, u64 last) {
+			if (block <= 64) {
+				for (u64 b = first; b < last; b++) counts[(size_t)b] = popcount64(read_bits(seq, b * block, u32(block)));
+			} else {
+				for (u64 b = first; b < last; b++) counts[(size_t)b] = count_ones(seq, b * block, block);
+			}
+		};
+		if (run && blocks * block >= parallel_span) run(blocks, range); else range(0, blocks);
+		return counts;
+	}
+
+	/* overlapping patterns starting at first..last-1, all inside the sequence;
+	one 64 bit window yields the 65-m patterns which start in its first bits */
+	static void count_overlapping(const bit_sequence& seq, u32 m, u64 first, u64 last, u64* counts) {
+		u32 step = 65 - m;
+		u64 i = first;
+		for (; i + step <= last && i + 64 <= seq.size(); i += step) {
+			u64 window = read_bits(seq, i, 64);
+			for (u32 j = 0; j < step; j++) counts[(size_t)((window << j) >> (64 - m))]++;
+		}
+		for (; i < last; i++) counts[(size_t)read_bits(seq, i, m)]++;
+	}
+
+	std::vector<u64> pattern_histogram(const bit_sequence& seq, u32 m, bool overlapping, bool wrap, const block_runner& run) {
+		if (m < 1 || m > 24)
+			throw std::invalid_argument("pattern length must be between 1 and 24 bits");
+		u64 n = seq.size();
+		std::vector<u64> counts(size_t(1) << m, 0);
+		// positions whose pattern lies inside the sequence
+		u64 inside = !overlapping ? n / m : n >= m ? n - m + 1 : 0;
+		auto kernel = [&](u64 first, u64 last, u64* target) {
+			if (overlapping) {
+				count_overlapping(seq, m, first, last, target);
+			} else {
+				for (u64 k = first; k < last; k++) target[(size_t)read_bits(seq, k * m, m)]++;
+			}
+		};
+		if (run && inside >= 2 * parallel_span) {
+			std::mutex merge;
+			run((inside + parallel_span - 1) / parallel_span, [&](u64 first, u64 last) {
+				std::vector<u64> local(counts.size(), 0);
+				kernel(first * parallel_span, std::min(inside, last * parallel_span), local.data());
+				std::lock_guard<std::mutex> lock(merge);
+				for (size_t i = 0; i < local.size(); i++) counts[i] += local[i];
+			});
+		} else {
+			kernel(0, inside, counts.data());
+		}
+		if (overlapping && wrap) {
+			for (u64 i = inside; i < n; i++) {
+				u64 pattern = 0;
+				for (u32 j = 0; j < m; j++) pattern = (pattern << 1) | read_bits(seq, (i + j) % n, 1);
+				counts[(size_t)pattern]++;
+			}
+		}
+		return counts;
+	}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include "block_runner.hpp"
+#include <vector>
+
+namespace binseq {
+
+	/* Counting kernels over bit_sequence which read whole words: popcount of
+	ranges and blocks, and histograms of m bit patterns cut from 64 bit
+	windows. Long inputs are split into ranges which may be spread over a
+	runner, pattern ranges keep their own histogram until they are merged. */
+
+	/* number of ones in [offset, offset+length) */
+	u64 count_ones(const bit_sequence&, u64 offset, u64 length);
+
+	/* ones in every whole block, the bits after the last whole block are not
+	counted, throws std::invalid_argument for an empty block */
+	std::vector<u64> block_popcount(const bit_sequence&, u64 block, const block_runner& run = nullptr);
+
+	/* occurrences of every m bit pattern, indexed by the pattern read msb
+	first. Overlapping patterns start at every position, with wrap the
+	sequence continues at its start so each of the n positions starts one.
+	Otherwise the patterns are read back to back. m must be 1..24, throws
+	std::invalid_argument otherwise. */
+	std::vector<u64> pattern_histogram(const bit_sequence&, u32 m, bool overlapping = true, bool wrap = false, const block_runner& run = nullptr);
+
+}
@@ -0,0 +1,214 @@
+#include "integer_codes.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace binseq {
+
+	static const u64 max_rice_quotient = u64(1) << 24;
+
+	static u32 bit_length(u64 value) {
+		return 64 - clz64(value);
+	}
+
+	/* consumes the zeros in front of the next one bit and returns their count */
+	static u64 read_zeros(bit_reader& in, const char* code) {
+		u64 zeros = 0;
+		u64 window;
+		while ((window = in.window()) == 0) {
+			if (in.remaining() <= 64)
+				throw std::invalid_argument(std::string("truncated ") + code + " code");
+			in.skip(64);
+			zeros += 64;
+		}
+		u32 n = clz64(window);
+		in.skip(n);
+		return zeros + n;
+	}
+
+	static void check_remaining(const bit_reader& in, u64 bits, const char* code) {
+		if (bits > in.remaining())
+			throw std::invalid_argument(std::string("truncated ") + code + " code");
+	}
+
+	void write_gamma(bit_writer& out, u64 value) {
+		if (value == 0)
+			throw std::invalid_argument("gamma code can't represent 0");
+		u32 n = bit_length(value) - 1;
+		if (n < 32) {
+			out.write(value, 2 * n + 1);
+		} else {
+			out.write(0, n);
+			out.write(value, n + 1);
+		}
+	}
+
+	u64 read_gamma(bit_reader& in) {
+		u64 window = in.window();
+		u32 n = clz64(window);
+		if (n < 32) {
+			// the whole code is inside the window
+			u32 length = 2 * n + 1;
+			check_remaining(in, length, "gamma");
+			in.skip(length);
+			return window >> (64 - length);
+		}
+		u64 zeros = read_zeros(in, "gamma");
+		if (zeros > 63)
+			throw std::invalid_argument("gamma code is too long");
+		check_remaining(in, zeros + 1, "gamma");
+		return in.read(u32(zeros + 1));
+	}
+
+	void write_delta(bit_writer& out, u64 value) {
+		if (value == 0)
+			throw std::invalid_argument("delta code can't represent 0");
+		u32 length = bit_length(value);
+		write_gamma(out, length);
+		out.write(value, length - 1);
+	}
+
+	u64 read_delta(bit_reader& in) {
+		u64 length = read_gamma(in);
+		if (length > 64)
+			throw std::invalid_argument("delta code is too long");
+		u32 n = u32(length - 1);
+		check_remaining(in, n, "delta");
+		return (u64(1) << n) | in.read(n);
+	}
+
+	void write_rice(bit_writer& out, u64 value, u32 k) {
+		u64 quotient = k >= 64 ? 0 : value >> k;
+		if (quotient >= max_rice_quotient)
+			throw std::invalid_argument("rice quotient is too large, use a larger k");
+		out.write_unary(quotient);
+		out.write(value, k);
+	}
+
+	u64 read_rice(bit_reader& in, u32 k) {
+		u64 window = in.window();
+		u64 quotient = clz64(window);
+		if (quotient < 64) {
+			in.skip(quotient + 1);
+		} else {
+			quotient = read_zeros(in, "rice");
+			in.skip(1);
+		}
+		check_remaining(in, k, "rice");
+		if (k > 0 && (k >= 64 ? quotient != 0 : (quotient >> (64 - k)) != 0))
+			throw std::invalid_argument("rice code is too long");
+		u64 remainder = in.read(k);
+		return k >= 64 ? remainder : (quotient << k) | remainder;
+	}
+
+	template <class Writer>
+	static bit_sequence encode_all(size_t count, u64 estimate, Writer write) {
+		bit_writer out;
+		out.reserve(estimate);
+		for (size_t i = 0; i < count; i++) {
+			write(out, i);
+		}
+		return out.finish();
+	}
+
+	template <class Reader>
+	static std::vector<u64> decode_all(const bit_sequence& seq, Reader read) {
+		std::vector<u64> values;
+		bit_reader in(seq);
+		while (in.remaining() > 0) {
+			values.push_back(read(in));
+		}
+		return values;
+	}
+
+	bit_sequence gamma_encode(const u64* values, size_t count) {
+		return encode_all(count, count * 8, [values](bit_writer& out, size_t i) { write_gamma(out, values[i]); });
+	}
+
+	std::vector<u64> gamma_decode(const bit_sequence& seq) {
+		return decode_all(seq, [](bit_reader& in) { return read_gamma(in); });
+	}
+
+	bit_sequence delta_encode(const u64* values, size_t count) {
+		return encode_all(count, count * 8, [values](bit_writer& out, size_t i) { write_delta(out, values[i]); });
+	}
+
+	std::vector<u64> delta_decode(const bit_sequence& seq) {
+		return decode_all(seq, [](bit_reader& in) { return read_delta(in); });
+	}
+
+	bit_sequence rice_encode(const u64* values, size_t count, u32 k) {
+		if (k > 64)
+			throw std::invalid_argument("rice parameter must be between 0 and 64");
+		return encode_all(count, count * (k + 2), [values, k](bit_writer& out, size_t i) { write_rice(out, values[i], k); });
+	}
+
+	std::vector<u64> rice_decode(const bit_sequence& seq, u32 k) {
+		if (k > 64)
+			throw std::invalid_argument("rice parameter must be between 0 and 64");
+		return decode_all(seq, [k](bit_reader& in) { return read_rice(in, k); });
+	}
+
+	bit_sequence varint_encode(const u64* values, size_t count) {
+		bit_writer out;
+		out.reserve(count * 16);
+		for (size_t i = 0; i < count; i++) {
+			u64 value = values[i];
+			while (value >= 0x80) {
+				out.write((value & 0x7f) | 0x80, 8);
+				value >>= 7;
+			}
+			out.write(value, 8);
+		}
+		return out.finish();
+	}
+
+	/* gathers the 7 bit groups of up to 8 little endian bytes into one value */
+	static inline u64 compact_groups(u64 x) {
+		x &= 0x7f7f7f7f7f7f7f7full;
+		x = ((x & 0x7f007f007f007f00ull) >> 1) | (x & 0x007f007f007f007full);
+		x = ((x & 0x3fff00003fff0000ull) >> 2) | (x & 0x00003fff00003fffull);
+		x = ((x & 0x0fffffff00000000ull) >> 4) | (x & 0x000000000fffffffull);
+		return x;
+	}
+
+	std::vector<u64> varint_decode(const bit_sequence& seq) {
+		if (seq.size() & 7)
+			throw std::invalid_argument("varint input must be a whole number of bytes");
+		auto bytes = reinterpret_cast<const u8*>(seq.address());
+		u64 size = seq.size() >> 3;
+		std::vector<u64> values;
+		values.reserve((size_t)(size / 2));
+		u64 i = 0;
+		while (i < size) {
+			if (i + 8 <= size) {
+				// codes up to 8 bytes are decoded from a single load without a loop
+				u64 word;
+				std::memcpy(&word, bytes + i, 8);
+				u64 ends = ~word & 0x8080808080808080ull;
+				if (ends != 0) {
+					u32 length = (ctz64(ends) >> 3) + 1;
+					u64 mask = length == 8 ? ~u64(0) : (u64(1) << (length * 8)) - 1;
+					values.push_back(compact_groups(word & mask));
+					i += length;
+					continue;
+				}
+			}
+			u64 value = 0;
+			u32 shift = 0;
+			while (true) {
+				if (i >= size)
+					throw std::invalid_argument("truncated varint code");
+				if (shift > 63)
+					throw std::invalid_argument("varint code is too long");
+				u8 b = bytes[i++];
+				value |= u64(b & 0x7f) << shift;
+				shift += 7;
+				if ((b & 0x80) == 0) break;
+			}
+			values.push_back(value);
+		}
+		return values;
+	}
+
+}
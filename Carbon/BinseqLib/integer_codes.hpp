@@ -0,0 +1,50 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include "bit_stream.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace binseq {
+
+	/* Universal integer codes. The single value functions work on a bit_writer
+	or bit_reader so they can be mixed with other fields, the bulk functions
+	encode a whole array into one sequence and decode until the sequence ends.
+	Decoders throw std::invalid_argument on truncated or malformed input. */
+
+	/* zigzag maps signed values to unsigned ones so small magnitudes stay small */
+	inline u64 zigzag_encode(s64 value) {
+		return (u64(value) << 1) ^ u64(value >> 63);
+	}
+
+	inline s64 zigzag_decode(u64 value) {
+		return s64(value >> 1) ^ -s64(value & 1);
+	}
+
+	/* Elias gamma, value must be at least 1: n zeros followed by the n+1 bits of value */
+	void write_gamma(bit_writer&, u64 value);
+	u64 read_gamma(bit_reader&);
+
+	/* Elias delta, value must be at least 1: gamma coded length followed by the bits under the leading one */
+	void write_delta(bit_writer&, u64 value);
+	u64 read_delta(bit_reader&);
+
+	/* Golomb-Rice with divisor 2^k: unary quotient (zeros ended by a one) then k remainder bits */
+	void write_rice(bit_writer&, u64 value, u32 k);
+	u64 read_rice(bit_reader&, u32 k);
+
+	bit_sequence gamma_encode(const u64* values, size_t count);
+	std::vector<u64> gamma_decode(const bit_sequence&);
+
+	bit_sequence delta_encode(const u64* values, size_t count);
+	std::vector<u64> delta_decode(const bit_sequence&);
+
+	bit_sequence rice_encode(const u64* values, size_t count, u32 k);
+	std::vector<u64> rice_decode(const bit_sequence&, u32 k);
+
+	/* LEB128, 7 bits per byte starting with the least significant group, the
+	high bit of each byte tells if another byte follows */
+	bit_sequence varint_encode(const u64* values, size_t count);
+	std::vector<u64> varint_decode(const bit_sequence&);
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "types.hpp"
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+namespace binseq {
+
+	/* portable wrappers around the word level instructions used by the kernels */
+
+	inline u64 bswap64(u64 x) {
+#if defined(_MSC_VER)
+		return _byteswap_uint64(x);
+#else
+		return __builtin_bswap64(x);
+#endif
+	}
+
+	inline u32 popcount64(u64 x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+		return (u32)__popcnt64(x);
+#elif defined(_MSC_VER)
+		x = x - ((x >> 1) & 0x5555555555555555ull);
+		x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+		x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+		return (u32)((x * 0x0101010101010101ull) >> 56);
+#else
+		return (u32)__builtin_popcountll(x);
+#endif
+	}
+
+	/* count of leading zeros, returns 64 for 0 */
+	inline u32 clz64(u64 x) {
+		if (x == 0) return 64;
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, x);
+		return 63 - (u32)index;
+#else
+		return (u32)__builtin_clzll(x);
+#endif
+	}
+
+	/* count of trailing zeros, returns 64 for 0 */
+	inline u32 ctz64(u64 x) {
+		if (x == 0) return 64;
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, x);
+		return (u32)index;
+#else
+		return (u32)__builtin_ctzll(x);
+#endif
+	}
+
+	/* mask with the lowest n bits set, n can be 0..64 */
+	inline u64 low_mask(u32 n) {
+		return n >= 64 ? ~u64(0) : ((u64(1) << n) - 1);
+	}
+
+	/* high 64 bits of the 128 bit product */
+	inline u64 mulhi64(u64 a, u64 b) {
+#if defined(_MSC_VER) && defined(_M_X64)
+		return __umulh(a, b);
+#elif defined(_MSC_VER)
+		u64 al = a & 0xffffffffull, ah = a >> 32, bl = b & 0xffffffffull, bh = b >> 32;
+		u64 low = al * bl, mid1 = ah * bl, mid2 = al * bh;
+		u64 carry = ((low >> 32) + (mid1 & 0xffffffffull) + (mid2 & 0xffffffffull)) >> 32;
+		return ah * bh + (mid1 >> 32) + (mid2 >> 32) + carry;
+#else
+		return (u64)(((unsigned __int128)a * b) >> 64);
+#endif
+	}
+
+}
@@ -0,0 +1,167 @@
+#include "lfsr.hpp"
+#include "bit_stream.hpp"
+#include "intrinsics.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace binseq {
+
+	/* Berlekamp-Massey, the connection polynomials keep c_i in bit i. H holds
+	the bits reversed, so the bits s_N, s_N-1, .. which meet c_0, c_1, .. are
+	one unaligned word read each and the discrepancy is a parity. Returns the
+	linear complexity and the connection polynomial at *polynomial. */
+	static u64 massey(const bit_sequence& seq, u64 offset, u64 M, std::vector<u64>& workspace, const u64** polynomial) {
+		u64 W = (M + 63) >> 6;
+		if (workspace.size() < 4 * W + 7) workspace.resize((size_t)(4 * W + 7));
+		u64* H = workspace.data();
+		u64* C = H + W + 1;
+		u64* B = C + W + 2;
+		u64* T = B + W + 2;
+		// bit j of H is s_(64W-1-j)
+		for (u64 t = 0; t < W; t++) {
+			u32 width = u32(std::min<u64>(64, M - 64 * t));
+			H[W - 1 - t] = read_bits(seq, offset + 64 * t, width) << (64 - width);
+		}
+		H[W] = 0;
+		u64 base = 64 * W - M;
+		std::fill(C, C + W + 2, 0);
+		std::fill(B, B + W + 2, 0);
+		C[0] = B[0] = 1;
+		u64 L = 0, b_words = 1, last = 0; // last is one past the position of the last length change
+		for (u64 N = 0; N < M; N++) {
+			u64 start = base + M - 1 - N; // s_(N-i) is bit start+i of H
+			u64 words = (L >> 6) + 1;
+			u64 d = 0;
+			for (u64 w = 0; w < words; w++) {
+				u64 x = start + 64 * w, k = x >> 6;
+				u32 s = u32(x & 63);
+				// the double shift is zero for s = 0
+				d ^= C[w] & ((H[k] >> s) | ((H[k + 1] << 1) << (63 - s)));
+			}
+			if ((popcount64(d) & 1) == 0) continue;
+			bool grow = 2 * L <= N;
+			if (grow) std::copy(C, C + words, T);
+			// C ^= B shifted up by N-m
+			u64 shift = N + 1 - last, ws = shift >> 6;
+			u32 bs = u32(shift & 63);
+			for (u64 w = 0; w < b_words; w++) {
+				C[w + ws] ^= B[w] << bs;
+				C[w + ws + 1] ^= (B[w] >> 1) >> (63 - bs);
+			}
+			if (grow) {
+				L = N + 1 - L;
+				last = N + 1;
+				std::swap(B, T);
+				b_words = words;
+			}
+		}
+		if (polynomial) *polynomial = C;
+		return L;
+	}
+
+	u64 linear_complexity(const bit_sequence& seq, u64 offset, u64 length, std::vector<u64>& workspace) {
+		return massey(seq, offset, length, workspace, nullptr);
+	}
+
+	u64 linear_complexity(const bit_sequence& seq) {
+		std::vector<u64> workspace;
+		return massey(seq, 0, seq.size(), workspace, nullptr);
+	}
+
+	bit_sequence connection_polynomial(const bit_sequence& seq) {
+		std::vector<u64> workspace;
+		const u64* C;
+		u64 L = massey(seq, 0, seq.size(), workspace, &C);
+		bit_writer writer;
+		writer.reserve(L + 1);
+		for (u64 i = 0; i <= L; i++) writer.write_bit(((C[i >> 6] >> (i & 63)) & 1) != 0);
+		return writer.finish();
+	}
+
+	/* 64 steps of a register of at most 64 bits. The state has s_(n-1-i) in
+	bit i and every output bit is a linear function of it, so the transition
+	is a 64xL matrix applied with one table lookup per state byte. */
+	class leap_table {
+	private:
+		std::vector<u64> _table;
+		u32 _bytes;
+
+	public:
+		leap_table(const bit_sequence& polynomial, u32 L) : _table((size_t)(((L + 7) >> 3) << 8), 0), _bytes((L + 7) >> 3) {
+			// rows[k] is the mask of the state bits which sum to output k
+			u64 rows[64];
+			for (u32 k = 0; k < 64; k++) {
+				u64 m = 0;
+				for (u32 i = 1; i <= L; i++) {
+					if (!polynomial[i]) continue;
+					m ^= k >= i ? rows[k - i] : u64(1) << (i - k - 1);
+				}
+				rows[k] = m;
+			}
+			for (u32 b = 0; b < _bytes; b++) {
+				u64 columns[8] = {};
+				for (u32 t = 0; t < 8; t++) {
+					for (u32 k = 0; k < 64; k++) {
+						if ((rows[k] >> (8 * b + t)) & 1) columns[t] |= u64(1) << (63 - k);
+					}
+				}
+				u64* entry = &_table[(size_t)b << 8];
+				for (u32 v = 1; v < 256; v++) entry[v] = entry[v & (v - 1)] ^ columns[ctz64(v)];
+			}
+		}
+
+		/* the next 64 outputs in stream order */
+		inline u64 next(u64 state) const {
+			u64 out = 0;
+			for (u32 b = 0; b < _bytes; b++) out ^= _table[((size_t)b << 8) | ((state >> (8 * b)) & 255)];
+			return out;
+		}
+	};
+
+	bit_sequence lfsr(const bit_sequence& polynomial, const bit_sequence& seed, u64 bits) {
+		if (polynomial.size() == 0)
+			throw std::invalid_argument("the connection polynomial needs at least the c_0 bit");
+		u64 L = polynomial.size() - 1;
+		if (seed.size() < L)
+			throw std::invalid_argument("the seed must have as many bits as the degree of the polynomial");
+		if (L <= 64) {
+			leap_table table(polynomial, u32(L));
+			u64 state = L != 0 ? read_bits(seed, 0, u32(L)) : 0;
+			bit_writer writer;
+			writer.reserve(bits);
+			u64 head = std::min(bits, L);
+			if (head != 0) writer.write(state >> (L - head), u32(head));
+			while (writer.size() < bits) {
+				u64 out = table.next(state);
+				u64 rest = bits - writer.size();
+				if (rest >= 64) writer.write(out, 64); else writer.write(out >> (64 - rest), u32(rest));
+				state = out & low_mask(u32(L));
+			}
+			return writer.finish();
+		}
+		// window bit j of the taps meets s_(n-L+j), so it holds c_(L-j)
+		u64 W = (L + 63) >> 6;
+		std::vector<u64> taps((size_t)W, 0);
+		for (u64 j = 0; j < L; j++) {
+			if (polynomial[L - j]) taps[(size_t)(j >> 6)] |= u64(1) << (63 - (j & 63));
+		}
+		std::vector<u64> out((size_t)(std::max(bits, L) >> 6) + 2, 0);
+		for (u64 j = 0; j < L; j += 64) {
+			u32 width = u32(std::min<u64>(64, L - j));
+			out[(size_t)(j >> 6)] = read_bits(seed, j, width) << (64 - width);
+		}
+		auto window = [&out](u64 offset) {
+			u64 k = offset >> 6;
+			u32 s = u32(offset & 63);
+			return s == 0 ? out[(size_t)k] : (out[(size_t)k] << s) | (out[(size_t)k + 1] >> (64 - s));
+		};
+		for (u64 n = L; n < bits; n++) {
+			u64 d = 0;
+			for (u64 k = 0; k < W; k++) d ^= window(n - L + 64 * k) & taps[(size_t)k];
+			if (popcount64(d) & 1) out[(size_t)(n >> 6)] |= u64(1) << (63 - (n & 63));
+		}
+		return from_stream_words(out.data(), bits);
+	}
+
+}
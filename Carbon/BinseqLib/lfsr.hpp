@@ -0,0 +1,29 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include <vector>
+
+namespace binseq {
+
+	/* Linear feedback shift registers over bit_sequence. A register of length
+	L is described by its connection polynomial c_0..c_L with c_0 = 1, stored
+	as L+1 bits in stream order, and generates s_n = c_1 s_(n-1) + .. + c_L s_(n-L). */
+
+	/* linear complexity of length bits from offset with Berlekamp-Massey, the
+	discrepancy of each step is the parity of the connection polynomial and the
+	reversed sequence read one unaligned word at a time. The workspace keeps
+	its buffers between calls on blocks of the same size. */
+	u64 linear_complexity(const bit_sequence&, u64 offset, u64 length, std::vector<u64>& workspace);
+	u64 linear_complexity(const bit_sequence&);
+
+	/* connection polynomial of the shortest register which generates the sequence */
+	bit_sequence connection_polynomial(const bit_sequence&);
+
+	/* runs the register of the polynomial from the first L bits of seed and
+	returns the first bits of the output, seed included. Registers up to 64
+	bits leap 64 steps at a time with a table of the 64 step transition,
+	longer ones step bit by bit. Throws std::invalid_argument when the
+	polynomial is empty or the seed is shorter than L. */
+	bit_sequence lfsr(const bit_sequence& polynomial, const bit_sequence& seed, u64 bits);
+
+}
@@ -0,0 +1,309 @@
+#include "lz.hpp"
+#include "intrinsics.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace binseq {
+
+	static const u32 hash_bits = 14;
+	static const size_t min_match = 4;
+	static const size_t last_literals = 5; // the last bytes of a block are always literals
+	static const size_t match_limit = 12; // no match starts this close to the end
+	static const size_t max_offset = 65535;
+
+	static inline u32 load32(const u8* p) {
+		u32 v;
+		std::memcpy(&v, p, 4);
+		return v;
+	}
+
+	static inline u64 load64(const u8* p) {
+		u64 v;
+		std::memcpy(&v, p, 8);
+		return v;
+	}
+
+	static inline u32 hash32(u32 v) {
+		return (v * 2654435761u) >> (32 - hash_bits);
+	}
+
+	/* writes a length continuation: runs of 255 ended by a smaller byte */
+	static inline bool put_length(u8*& op, const u8* end, size_t length) {
+		while (length >= 255) {
+			if (op >= end) return false;
+			*op++ = 255;
+			length -= 255;
+		}
+		if (op >= end) return false;
+		*op++ = u8(length);
+		return true;
+	}
+
+	static inline bool put_sequence(u8*& op, const u8* end, const u8* literals, size_t literal_count, size_t offset, size_t match) {
+		if (op >= end) return false;
+		u8* token = op++;
+		u8 high = literal_count >= 15 ? 15 : u8(literal_count);
+		if (literal_count >= 15 && !put_length(op, end, literal_count - 15)) return false;
+		if (size_t(end - op) < literal_count) return false;
+		std::memcpy(op, literals, literal_count);
+		op += literal_count;
+		u8 low = 0;
+		if (match != 0) {
+			if (end - op < 2) return false;
+			*op++ = u8(offset);
+			*op++ = u8(offset >> 8);
+			size_t extra = match - min_match;
+			low = extra >= 15 ? 15 : u8(extra);
+			if (extra >= 15 && !put_length(op, end, extra - 15)) return false;
+		}
+		*token = u8((high << 4) | low);
+		return true;
+	}
+
+	size_t lz_compress_block(const u8* src, size_t size, u8* dst) {
+		if (size == 0) return 0;
+		u8* op = dst;
+		const u8* end = dst + size - 1; // anything not smaller is stored raw
+		size_t anchor = 0;
+		if (size > match_limit) {
+			std::vector<u32> table(size_t(1) << hash_bits, 0);
+			size_t limit = size - match_limit;
+			size_t match_end = size - last_literals;
+			size_t ip = 0;
+			while (ip < limit) {
+				u32 sequence = load32(src + ip);
+				u32 h = hash32(sequence);
+				size_t ref = table[h];
+				table[h] = u32(ip + 1);
+				if (ref == 0 || ip + 1 - ref > max_offset || load32(src + ref - 1) != sequence) {
+					// skip faster through data which doesn't match
+					ip += 1 + ((ip - anchor) >> 6);
+					continue;
+				}
+				ref--;
+				size_t length = min_match;
+				while (ip + length + 8 <= match_end) {
+					u64 diff = load64(src + ip + length) ^ load64(src + ref + length);
+					if (diff) {
+						length += ctz64(diff) >> 3;
+						goto found;
+					}
+					length += 8;
+				}
+				while (ip + length < match_end && src[ip + length] == src[ref + length]) length++;
+			found:
+				if (!put_sequence(op, end, src + anchor, ip - anchor, ip - ref, length)) return 0;
+				ip += length;
+				anchor = ip;
+				if (ip < limit) table[hash32(load32(src + ip - 2))] = u32(ip - 1);
+			}
+		}
+		if (!put_sequence(op, end, src + anchor, size - anchor, 0, 0)) return 0;
+		return size_t(op - dst);
+	}
+
+	static inline size_t get_length(const u8*& ip, const u8* end) {
+		size_t length = 0;
+		u8 b;
+		do {
+			if (ip >= end)
+				throw std::invalid_argument("compressed block is truncated");
+			b = *ip++;
+			length += b;
+		} while (b == 255);
+		return length;
+	}
+
+	void lz_decompress_block(const u8* src, size_t compressed, u8* dst, size_t size) {
+		const u8* ip = src;
+		const u8* end = src + compressed;
+		u8* op = dst;
+		u8* out_end = dst + size;
+		while (ip < end) {
+			u8 token = *ip++;
+			size_t literal_count = token >> 4;
+			if (literal_count == 15) literal_count += get_length(ip, end);
+			if (size_t(end - ip) < literal_count || size_t(out_end - op) < literal_count)
+				throw std::invalid_argument("compressed block is corrupted");
+			std::memcpy(op, ip, literal_count);
+			ip += literal_count;
+			op += literal_count;
+			if (ip == end) break; // the last sequence has no match
+			if (end - ip < 2)
+				throw std::invalid_argument("compressed block is truncated");
+			size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+			ip += 2;
+			size_t match = token & 15;
+			if (match == 15) match += get_length(ip, end);
+			match += min_match;
+			if (offset == 0 || offset > size_t(op - dst) || size_t(out_end - op) < match)
+				throw std::invalid_argument("compressed block is corrupted");
+			const u8* from = op - offset;
+			if (offset >= match) {
+				std::memcpy(op, from, match);
+				op += match;
+			} else {
+				// overlapping copy repeats the last offset bytes
+				for (size_t i = 0; i < match; i++) *op++ = from[i];
+			}
+		}
+		if (op != out_end)
+			throw std::invalid_argument("compressed block has the wrong size");
+	}
+
+	/* frame layout, all integers little endian:
+	'C' 'Z' version flags | bits:u64 | block size:u32 | per block size:u32
+	(high bit set for stored blocks) | block data */
+	static const u8 frame_version = 1;
+	static const size_t frame_header = 16;
+	static const u32 stored_block = 0x80000000u;
+
+	static void put32(u8* p, u32 v) {
+		for (int i = 0; i < 4; i++) p[i] = u8(v >> (8 * i));
+	}
+
+	static u32 get32(const u8* p) {
+		u32 v = 0;
+		for (int i = 0; i < 4; i++) v |= u32(p[i]) << (8 * i);
+		return v;
+	}
+
+	static void run_blocks(u64 count, const block_runner& run, const std::function<void(u64)>& block) {
+		// errors are collected so the runner never sees an exception
+		std::vector<std::string> errors((size_t)count);
+		auto range = [&](u64 first, u64 last) {
+			for (u64 b = first; b < last; b++) {
+				try {
+					block(b);
+				} catch (std::exception& error) {
+					errors[(size_t)b] = error.what();
+					if (errors[(size_t)b].empty()) errors[(size_t)b] = "compressed block is corrupted";
+				}
+			}
+		};
+		if (run) run(count, range); else range(0, count);
+		for (auto& error : errors) {
+			if (!error.empty()) throw std::invalid_argument(error);
+		}
+	}
+
+	static bit_sequence from_bytes(const u8* bytes, size_t count, u64 bits) {
+		bit_sequence seq;
+		seq.reallocate(bits);
+		auto dst = reinterpret_cast<u8*>(seq.address());
+		size_t capacity = bits <= 128 ? 16 : size_t((bits + 63) >> 6) * 8;
+		std::memcpy(dst, bytes, count);
+		std::memset(dst + count, 0, capacity - count);
+		return seq;
+	}
+
+	bit_sequence lz_compress(const bit_sequence& seq, bool text, const block_runner& run) {
+		auto src = reinterpret_cast<const u8*>(seq.address());
+		size_t size = size_t((seq.size() + 7) >> 3);
+		u64 blocks = (size + lz_block_size - 1) / lz_block_size;
+
+		std::vector<std::vector<u8>> compressed((size_t)blocks);
+		std::vector<u32> sizes((size_t)blocks);
+		std::vector<u8> tail;
+		if (size & (lz_block_size - 1) || seq.size() & 7) {
+			// the last block is copied so the unused bits of the last byte are zero
+			size_t first = size_t(blocks - 1) * lz_block_size;
+			tail.assign(src + first, src + size);
+			if (seq.size() & 7) tail.back() &= u8(0xff00 >> (seq.size() & 7));
+		}
+		run_blocks(blocks, run, [&](u64 b) {
+			size_t first = size_t(b) * lz_block_size;
+			size_t length = std::min<size_t>(lz_block_size, size - first);
+			const u8* block = b + 1 == blocks && !tail.empty() ? tail.data() : src + first;
+			auto& out = compressed[(size_t)b];
+			out.resize(length);
+			size_t packed = lz_compress_block(block, length, out.data());
+			if (packed == 0) {
+				std::memcpy(out.data(), block, length);
+				sizes[(size_t)b] = u32(length) | stored_block;
+			} else {
+				out.resize(packed);
+				sizes[(size_t)b] = u32(packed);
+			}
+		});
+
+		size_t total = frame_header + size_t(blocks) * 4;
+		for (auto& block : compressed) total += block.size();
+		std::vector<u8> frame(total);
+		frame[0] = 'C';
+		frame[1] = 'Z';
+		frame[2] = frame_version;
+		frame[3] = text ? 1 : 0;
+		put32(&frame[4], u32(seq.size()));
+		put32(&frame[8], u32(seq.size() >> 32));
+		put32(&frame[12], lz_block_size);
+		size_t pos = frame_header;
+		for (auto s : sizes) {
+			put32(&frame[pos], s);
+			pos += 4;
+		}
+		for (auto& block : compressed) {
+			if (!block.empty()) std::memcpy(&frame[pos], block.data(), block.size());
+			pos += block.size();
+		}
+		return from_bytes(frame.data(), frame.size(), u64(frame.size()) * 8);
+	}
+
+	bit_sequence lz_decompress(const bit_sequence& seq, bool* text, const block_runner& run) {
+		auto src = reinterpret_cast<const u8*>(seq.address());
+		size_t size = size_t(seq.size() >> 3);
+		if (seq.size() & 7 || size < frame_header || src[0] != 'C' || src[1] != 'Z')
+			throw std::invalid_argument("binseq is not a compressed frame");
+		if (src[2] != frame_version)
+			throw std::invalid_argument("unsupported compressed frame version");
+		if (text) *text = (src[3] & 1) != 0;
+		u64 bits = u64(get32(src + 4)) | (u64(get32(src + 8)) << 32);
+		u64 block_size = get32(src + 12);
+		// blocks never decompress to more than lz_block_size, so the header
+		// cannot claim more output than the block table can hold
+		if (block_size == 0 || block_size > lz_block_size)
+			throw std::invalid_argument("compressed frame is corrupted");
+		if ((bits + 63) >> 6 > 0xffffffffull || bits > ~u64(0) - 63)
+			throw std::invalid_argument("compressed frame is too large");
+		u64 bytes = (bits + 7) >> 3;
+		u64 blocks = (bytes + block_size - 1) / block_size;
+		if (frame_header + blocks * 4 > size)
+			throw std::invalid_argument("compressed frame is truncated");
+
+		std::vector<size_t> offsets((size_t)blocks + 1);
+		offsets[0] = size_t(frame_header + blocks * 4);
+		for (u64 b = 0; b < blocks; b++) {
+			u32 s = get32(src + frame_header + b * 4);
+			u32 packed = s & ~stored_block;
+			if (s & stored_block && packed != std::min<u64>(block_size, bytes - b * block_size))
+				throw std::invalid_argument("compressed frame is corrupted");
+			offsets[(size_t)b + 1] = offsets[(size_t)b] + packed;
+			if (offsets[(size_t)b + 1] > size)
+				throw std::invalid_argument("compressed frame is truncated");
+		}
+		if (offsets[(size_t)blocks] != size)
+			throw std::invalid_argument("compressed frame is corrupted");
+
+		bit_sequence result;
+		result.reallocate(bits);
+		auto dst = reinterpret_cast<u8*>(result.address());
+		size_t capacity = bits <= 128 ? 16 : size_t((bits + 63) >> 6) * 8;
+		std::memset(dst + bytes, 0, capacity - size_t(bytes));
+		run_blocks(blocks, run, [&](u64 b) {
+			size_t first = size_t(b * block_size);
+			size_t length = size_t(std::min<u64>(block_size, bytes - first));
+			u32 s = get32(src + frame_header + b * 4);
+			const u8* block = src + offsets[(size_t)b];
+			size_t packed = offsets[(size_t)b + 1] - offsets[(size_t)b];
+			if (s & stored_block) {
+				std::memcpy(dst + first, block, length);
+			} else {
+				lz_decompress_block(block, packed, dst + first, length);
+			}
+		});
+		return result;
+	}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include "block_runner.hpp"
+
+namespace binseq {
+
+	/* LZ4 style compression. The input is split into independent blocks which
+	are compressed with a greedy hash matcher into the LZ4 sequence format
+	(token, literals, 16 bit offset, match length). Blocks which don't shrink
+	are stored as they are. The frame keeps the exact bit length so any
+	bit_sequence round trips, and a flag marking inputs which were text. */
+
+	static const u32 lz_block_size = 1 << 18;
+
+	/* compresses one block, returns the compressed size or 0 when the result
+	would not be smaller than the input, dst needs at least size bytes */
+	size_t lz_compress_block(const u8* src, size_t size, u8* dst);
+
+	/* decompresses one block which must expand to exactly size bytes,
+	throws std::invalid_argument on corrupted input */
+	void lz_decompress_block(const u8* src, size_t compressed, u8* dst, size_t size);
+
+	bit_sequence lz_compress(const bit_sequence&, bool text = false, const block_runner& run = nullptr);
+	bit_sequence lz_decompress(const bit_sequence&, bool* text = nullptr, const block_runner& run = nullptr);
+
+}
@@ -0,0 +1,610 @@
+#include "nist.hpp"
+#include "bit_stream.hpp"
+#include "lfsr.hpp"
+#include "fft.hpp"
+#include "histogram.hpp"
+#include "intrinsics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <utility>
+
+namespace binseq {
+
+	static const double sqrt2 = 1.41421356237309504880;
+
+	static void require(bool condition, const char* message) {
+		if (!condition) throw std::invalid_argument(message);
+	}
+
+	static nist_result single(double p, double statistic, u64 bits) {
+		nist_result result;
+		result.p_values.push_back(p);
+		result.statistics.push_back(statistic);
+		result.bits = bits;
+		result.applicable = true;
+		return result;
+	}
+
+	/* special functions, igam and igamc follow the Cephes implementation used
+	by the NIST reference code */
+
+	static const double machine_epsilon = 1.11022302462515654042e-16;
+	static const double big = 4.503599627370496e15;
+	static const double big_inverse = 2.22044604925031308085e-16;
+	static const double max_log = 7.09782712893383996843e2;
+
+	static double igam(double a, double x);
+
+	double igamc(double a, double x) {
+		if (x <= 0 || a <= 0) return 1.0;
+		if (x < 1.0 || x < a) return 1.0 - igam(a, x);
+		double ax = a * std::log(x) - x - std::lgamma(a);
+		if (ax < -max_log) return 0.0;
+		ax = std::exp(ax);
+		// continued fraction
+		double y = 1.0 - a, z = x + y + 1.0, c = 0.0;
+		double pkm2 = 1.0, qkm2 = x, pkm1 = x + 1.0, qkm1 = z * x;
+		double answer = pkm1 / qkm1, t;
+		do {
+			c += 1.0;
+			y += 1.0;
+			z += 2.0;
+			double yc = y * c;
+			double pk = pkm1 * z - pkm2 * yc;
+			double qk = qkm1 * z - qkm2 * yc;
+			if (qk != 0) {
+				double r = pk / qk;
+				t = std::fabs((answer - r) / r);
+				answer = r;
+			} else {
+				t = 1.0;
+			}
+			pkm2 = pkm1;
+			pkm1 = pk;
+			qkm2 = qkm1;
+			qkm1 = qk;
+			if (std::fabs(pk) > big) {
+				pkm2 *= big_inverse;
+				pkm1 *= big_inverse;
+				qkm2 *= big_inverse;
+				qkm1 *= big_inverse;
+			}
+		} while (t > machine_epsilon);
+		return answer * ax;
+	}
+
+	static double igam(double a, double x) {
+		if (x <= 0 || a <= 0) return 0.0;
+		if (x > 1.0 && x > a) return 1.0 - igamc(a, x);
+		double ax = a * std::log(x) - x - std::lgamma(a);
+		if (ax < -max_log) return 0.0;
+		ax = std::exp(ax);
+		// power series
+		double r = a, c = 1.0, answer = 1.0;
+		do {
+			r += 1.0;
+			c *= x / r;
+			answer += c;
+		} while (c / answer > machine_epsilon);
+		return answer * ax / a;
+	}
+
+	static inline double normal_cdf(double x) {
+		return 0.5 * std::erfc(-x / sqrt2);
+	}
+
+	static double chi_square(const u64* observed, const double* probability, size_t classes, double total) {
+		double chi = 0;
+		for (size_t i = 0; i < classes; i++) {
+			double expected = total * probability[i];
+			chi += (observed[i] - expected) * (observed[i] - expected) / expected;
+		}
+		return chi;
+	}
+
+	/* word level kernels */
+
+	/* longest run of ones in [offset, offset+length) */
+	static u32 longest_run(const bit_sequence& seq, u64 offset, u64 length) {
+		u32 best = 0, current = 0;
+		while (length != 0) {
+			u32 width = length < 64 ? u32(length) : 64;
+			u64 chunk = read_bits(seq, offset, width) << (64 - width);
+			u32 lead = clz64(~chunk);
+			if (lead >= width) {
+				current += width;
+			} else {
+				// each step shortens every run by one
+				u32 inner = 0;
+				for (u64 y = chunk; y != 0; y &= y << 1) inner++;
+				best = std::max(best, std::max(current + lead, inner));
+				current = ctz64(~(chunk >> (64 - width)));
+			}
+			offset += width;
+			length -= width;
+		}
+		return std::max(best, current);
+	}
+
+	/* counts of the m-1 bit patterns, each is the prefix of two m bit patterns */
+	static std::vector<u64> fold_patterns(const std::vector<u64>& counts) {
+		std::vector<u64> folded(counts.size() / 2);
+		for (size_t i = 0; i < folded.size(); i++) folded[i] = counts[2 * i] + counts[2 * i + 1];
+		return folded;
+	}
+
+	/* tests */
+
+	nist_result nist_frequency(const bit_sequence& seq) {
+		u64 n = seq.size();
+		require(n > 0, "the frequency test needs a non empty sequence");
+		double ones = double(count_ones(seq, 0, n));
+		double s = std::fabs(2 * ones - double(n)) / std::sqrt(double(n));
+		return single(std::erfc(s / sqrt2), s, n);
+	}
+
+	nist_result nist_block_frequency(const bit_sequence& seq, u64 block) {
+		require(block > 0, "the block length of the block frequency test must be positive");
+		u64 blocks = seq.size() / block;
+		require(blocks > 0, "the sequence is too short for the block frequency test");
+		double chi = 0;
+		for (u64 b = 0; b < blocks; b++) {
+			double proportion = double(count_ones(seq, b * block, block)) / double(block) - 0.5;
+			chi += proportion * proportion;
+		}
+		chi *= 4.0 * double(block);
+		return single(igamc(double(blocks) / 2, chi / 2), chi, blocks * block);
+	}
+
+	nist_result nist_runs(const bit_sequence& seq) {
+		u64 n = seq.size();
+		require(n > 1, "the sequence is too short for the runs test");
+		double proportion = double(count_ones(seq, 0, n)) / double(n);
+		// runs = 1 + number of positions where the next bit differs
+		auto words = reinterpret_cast<const u64*>(seq.address());
+		u64 pairs = n - 1, transitions = 0, available = word_count(seq);
+		for (u64 k = 0; (k << 6) < pairs; k++) {
+			u64 w = load_stream_word(words, k);
+			u64 next = k + 1 < available ? load_stream_word(words, k + 1) : 0;
+			u64 x = w ^ ((w << 1) | (next >> 63));
+			u64 valid = pairs - (k << 6);
+			if (valid < 64) x &= ~(~u64(0) >> valid);
+			transitions += popcount64(x);
+		}
+		double runs = double(transitions + 1);
+		if (std::fabs(proportion - 0.5) >= 2.0 / std::sqrt(double(n))) {
+			// the frequency prerequisite fails, the standard reports zero
+			return single(0.0, runs, n);
+		}
+		double expected = 2.0 * double(n) * proportion * (1 - proportion);
+		double p = std::erfc(std::fabs(runs - expected) / (2.0 * std::sqrt(2.0 * double(n)) * proportion * (1 - proportion)));
+		return single(p, runs, n);
+	}
+
+	nist_result nist_longest_run(const bit_sequence& seq) {
+		static const double pi8[] = { 0.21484375, 0.3671875, 0.23046875, 0.1875 };
+		static const double pi128[] = { 0.1174035788, 0.242955959, 0.249363483, 0.17517706, 0.102701071, 0.112398847 };
+		static const double pi10000[] = { 0.0882, 0.2092, 0.2483, 0.1933, 0.1208, 0.0675, 0.0727 };
+		u64 n = seq.size();
+		require(n >= 128, "the longest run test needs at least 128 bits");
+		u64 block;
+		u32 low, classes;
+		const double* probability;
+		if (n < 6272) {
+			block = 8, low = 1, classes = 4, probability = pi8;
+		} else if (n < 750000) {
+			block = 128, low = 4, classes = 6, probability = pi128;
+		} else {
+			block = 10000, low = 10, classes = 7, probability = pi10000;
+		}
+		u64 blocks = n / block;
+		u64 observed[7] = {};
+		for (u64 b = 0; b < blocks; b++) {
+			u32 run = longest_run(seq, b * block, block);
+			run = std::min(std::max(run, low), low + classes - 1);
+			observed[run - low]++;
+		}
+		double chi = chi_square(observed, probability, classes, double(blocks));
+		return single(igamc(double(classes - 1) / 2, chi / 2), chi, blocks * block);
+	}
+
+	/* rank of a 32x32 matrix over GF(2), each row is reduced by the basis
+	vectors found so far until it is zero or has a new leading bit */
+	static u32 rank32(const u32* rows) {
+		u32 basis[32] = {};
+		u32 rank = 0;
+		for (u32 r = 0; r < 32; r++) {
+			u32 row = rows[r];
+			while (row != 0) {
+				u32 lead = clz64(row) - 32;
+				if (basis[lead] == 0) {
+					basis[lead] = row;
+					rank++;
+					break;
+				}
+				row ^= basis[lead];
+			}
+		}
+		return rank;
+	}
+
+	/* probability that a random MxQ matrix has rank r */
+	static double rank_probability(int r, int M, int Q) {
+		double product = 1;
+		for (int i = 0; i < r; i++) {
+			product *= (1 - std::pow(2.0, i - Q)) * (1 - std::pow(2.0, i - M)) / (1 - std::pow(2.0, i - r));
+		}
+		return std::pow(2.0, r * (Q + M - r) - M * Q) * product;
+	}
+
+	nist_result nist_rank(const bit_sequence& seq) {
+		u64 matrices = seq.size() / 1024;
+		require(matrices > 0, "the rank test needs at least 1024 bits");
+		u64 observed[3] = {};
+		u32 rows[32];
+		for (u64 i = 0; i < matrices; i++) {
+			for (u32 r = 0; r < 32; r++) rows[r] = u32(read_bits(seq, i * 1024 + r * 32, 32));
+			u32 rank = rank32(rows);
+			observed[rank == 32 ? 0 : rank == 31 ? 1 : 2]++;
+		}
+		double probability[3];
+		probability[0] = rank_probability(32, 32, 32);
+		probability[1] = rank_probability(31, 32, 32);
+		probability[2] = 1 - probability[0] - probability[1];
+		double chi = chi_square(observed, probability, 3, double(matrices));
+		return single(std::exp(-chi / 2), chi, matrices * 1024);
+	}
+
+	nist_result nist_dft(const bit_sequence& seq) {
+		u64 n = std::min(seq.size(), nist_dft_max_bits);
+		require(n >= 2, "the spectral test needs at least 2 bits");
+		auto x = real_fft(bipolar_signal(seq, n));
+		double threshold = std::sqrt(std::log(1 / 0.05) * double(n));
+		double expected = 0.95 * double(n) / 2;
+		u64 below = 0;
+		for (u64 j = 0; j < n / 2; j++) {
+			if (std::abs(x[size_t(j)]) < threshold) below++;
+		}
+		double d = (double(below) - expected) / std::sqrt(double(n) * 0.95 * 0.05 / 4);
+		return single(std::erfc(std::fabs(d) / sqrt2), d, n);
+	}
+
+	nist_result nist_non_overlapping_template(const bit_sequence& seq, u64 pattern, u32 m, u32 blocks) {
+		require(m >= 2 && m <= 32, "the template length must be between 2 and 32 bits");
+		require(blocks > 0, "the number of blocks must be positive");
+		u64 block = seq.size() / blocks;
+		require(block >= m, "the sequence is too short for the non overlapping template test");
+		u64 positions = block - m + 1;
+		double chi = 0;
+		double mean = double(positions) / std::pow(2.0, m);
+		double variance = double(block) * (1 / std::pow(2.0, m) - (2.0 * m - 1) / std::pow(2.0, 2.0 * m));
+		for (u32 b = 0; b < blocks; b++) {
+			u64 offset = u64(b) * block, matches = 0, resume = 0;
+			for (u64 position = 0; position < positions; position += 64) {
+				u32 width = u32(std::min<u64>(64, positions - position));
+				// bit 63-j of mask is set when the template starts at position+j
+				u64 mask = ~u64(0) << (64 - width);
+				for (u32 k = 0; k < m && mask != 0; k++) {
+					u64 window = read_bits(seq, offset + position + k, width) << (64 - width);
+					mask &= ((pattern >> (m - 1 - k)) & 1) ? window : ~window;
+				}
+				// a match skips the positions it covers
+				if (resume > position) mask = resume - position >= 64 ? 0 : mask & (~u64(0) >> (resume - position));
+				while (mask != 0) {
+					u32 j = clz64(mask);
+					matches++;
+					resume = position + j + m;
+					mask = j + m >= 64 ? 0 : mask & (~u64(0) >> (j + m));
+				}
+			}
+			chi += (double(matches) - mean) * (double(matches) - mean) / variance;
+		}
+		return single(igamc(double(blocks) / 2, chi / 2), chi, u64(blocks) * block);
+	}
+
+	/* probability of u overlapping template matches in a block, with lambda
+	= 2 eta expected matches */
+	static double overlapping_probability(u32 u, double eta) {
+		if (u == 0) return std::exp(-eta);
+		double sum = 0;
+		for (u32 l = 1; l <= u; l++) {
+			sum += std::exp(-eta - u * std::log(2.0) + l * std::log(eta) - std::lgamma(l + 1.0) + std::lgamma(double(u)) - std::lgamma(double(l)) - std::lgamma(double(u - l + 1)));
+		}
+		return sum;
+	}
+
+	nist_result nist_overlapping_template(const bit_sequence& seq, u32 m) {
+		static const u64 block = 1032;
+		static const double pi9[] = { 0.364091, 0.185659, 0.139381, 0.100571, 0.0704323, 0.139865 };
+		require(m >= 2 && m <= 32, "the template length must be between 2 and 32 bits");
+		u64 blocks = seq.size() / block;
+		require(blocks > 0, "the overlapping template test needs at least 1032 bits");
+		double probability[6];
+		if (m == 9) {
+			std::copy(pi9, pi9 + 6, probability);
+		} else {
+			double eta = double(block - m + 1) / std::pow(2.0, m) / 2;
+			double sum = 0;
+			for (u32 i = 0; i < 5; i++) sum += probability[i] = overlapping_probability(i, eta);
+			probability[5] = 1 - sum;
+		}
+		u64 observed[6] = {};
+		u64 positions = block - m + 1;
+		for (u64 b = 0; b < blocks; b++) {
+			u64 matches = 0;
+			for (u64 position = 0; position < positions; position += 64) {
+				// the template is all ones, the bits past width are shifted in as zeros
+				u32 width = u32(std::min<u64>(64, positions - position));
+				u64 mask = ~u64(0);
+				for (u32 k = 0; k < m && mask != 0; k++) mask &= read_bits(seq, b * block + position + k, width) << (64 - width);
+				matches += popcount64(mask);
+			}
+			observed[std::min<u64>(matches, 5)]++;
+		}
+		double chi = chi_square(observed, probability, 6, double(blocks));
+		return single(igamc(2.5, chi / 2), chi, blocks * block);
+	}
+
+	nist_result nist_universal(const bit_sequence& seq, u32 L) {
+		static const double expected_value[] = { 0, 0.7326495, 1.5374383, 2.4016068, 3.3112247, 4.2534266, 5.2177052, 6.1962507, 7.1836656, 8.1764248, 9.1723243, 10.170032, 11.168765, 12.168070, 13.167693, 14.167488, 15.167379 };
+		static const double variance[] = { 0, 0.690, 1.338, 1.901, 2.358, 2.705, 2.954, 3.125, 3.238, 3.311, 3.356, 3.384, 3.401, 3.410, 3.416, 3.419, 3.421 };
+		static const u64 thresholds[] = { 387840, 904960, 2068480, 4654080, 10342400, 22753280, 49643520, 107560960, 231669760, 496435200, 1059061760 };
+		u64 n = seq.size();
+		if (L == 0) {
+			require(n >= thresholds[0], "the universal test needs at least 387840 bits");
+			L = 5;
+			for (auto threshold : thresholds) {
+				if (n >= threshold) L++;
+			}
+		}
+		require(L >= 1 && L <= 16, "the block length of the universal test must be between 1 and 16");
+		u64 Q = 10 * (u64(1) << L);
+		require(n / L > Q, "the sequence is too short for the universal test");
+		u64 K = n / L - Q;
+		// last block index at which each L bit value was seen
+		std::vector<u64> last(size_t(1) << L, 0);
+		for (u64 i = 1; i <= Q; i++) last[size_t(read_bits(seq, (i - 1) * L, L))] = i;
+		double sum = 0;
+		for (u64 i = Q + 1; i <= Q + K; i++) {
+			auto& seen = last[size_t(read_bits(seq, (i - 1) * L, L))];
+			sum += std::log2(double(i - seen));
+			seen = i;
+		}
+		double fn = sum / double(K);
+		double c = 0.7 - 0.8 / L + (4 + 32.0 / L) * std::pow(double(K), -3.0 / L) / 15;
+		double sigma = c * std::sqrt(variance[L] / double(K));
+		double p = std::erfc(std::fabs(fn - expected_value[L]) / (sqrt2 * sigma));
+		return single(p, fn, (Q + K) * L);
+	}
+
+	nist_result nist_linear_complexity(const bit_sequence& seq, u32 block, const block_runner& run) {
+		static const double probability[] = { 0.010417, 0.03125, 0.125, 0.5, 0.25, 0.0625, 0.020833 };
+		require(block >= 8 && block <= 65536, "the block length of the linear complexity test must be between 8 and 65536");
+		u64 blocks = seq.size() / block;
+		require(blocks > 0, "the sequence is too short for the linear complexity test");
+		double M = block;
+		double sign = (block & 1) ? -1.0 : 1.0;
+		double mean = M / 2 + (9 - sign) / 36 - (M / 3 + 2.0 / 9) / std::pow(2.0, M);
+		// class of each block, blocks are independent so ranges may run concurrently
+		std::vector<u8> classes((size_t)blocks);
+		auto range = [&](u64 first, u64 last) {
+			std::vector<u64> workspace;
+			for (u64 b = first; b < last; b++) {
+				double t = sign * (double(linear_complexity(seq, b * block, block, workspace)) - mean) + 2.0 / 9;
+				classes[(size_t)b] = t <= -2.5 ? 0 : t <= -1.5 ? 1 : t <= -0.5 ? 2 : t <= 0.5 ? 3 : t <= 1.5 ? 4 : t <= 2.5 ? 5 : 6;
+			}
+		};
+		if (run) run(blocks, range); else range(0, blocks);
+		u64 observed[7] = {};
+		for (auto c : classes) observed[c]++;
+		double chi = chi_square(observed, probability, 7, double(blocks));
+		return single(igamc(3, chi / 2), chi, blocks * block);
+	}
+
+	static u32 floor_log2(u64 n) {
+		return 63 - clz64(n);
+	}
+
+	/* psi square statistic of the serial test from the pattern counts */
+	static double psi_square(const std::vector<u64>& counts, u64 n) {
+		double sum = 0;
+		for (auto c : counts) sum += double(c) * double(c);
+		return sum * double(counts.size()) / double(n) - double(n);
+	}
+
+	nist_result nist_serial(const bit_sequence& seq, u32 m) {
+		u64 n = seq.size();
+		require(n >= 8, "the sequence is too short for the serial test");
+		if (m == 0) {
+			m = std::min<u32>(16, floor_log2(n) - 3);
+			require(m >= 2, "the sequence is too short for the serial test");
+		}
+		require(m >= 2 && m <= 24, "the pattern length of the serial test must be between 2 and 24");
+		require(n >= m, "the sequence is too short for the serial test");
+		auto counts = pattern_histogram(seq, m, true, true);
+		double psi0 = psi_square(counts, n);
+		counts = fold_patterns(counts);
+		double psi1 = psi_square(counts, n);
+		double psi2 = m > 2 ? psi_square(fold_patterns(counts), n) : 0;
+		nist_result result;
+		double delta = psi0 - psi1, delta2 = psi0 - 2 * psi1 + psi2;
+		result.p_values.push_back(igamc(std::pow(2.0, m - 2.0), delta / 2));
+		result.p_values.push_back(igamc(std::pow(2.0, m - 3.0), delta2 / 2));
+		result.statistics.push_back(delta);
+		result.statistics.push_back(delta2);
+		result.bits = n;
+		result.applicable = true;
+		return result;
+	}
+
+	static double approximate_phi(const std::vector<u64>& counts, u64 n) {
+		double sum = 0;
+		for (auto c : counts) {
+			if (c != 0) sum += double(c) / double(n) * std::log(double(c) / double(n));
+		}
+		return sum;
+	}
+
+	nist_result nist_approximate_entropy(const bit_sequence& seq, u32 m) {
+		u64 n = seq.size();
+		if (m == 0) {
+			require(n >= 128, "the sequence is too short for the approximate entropy test");
+			m = std::min<u32>(10, floor_log2(n) - 6);
+		}
+		require(m >= 1 && m <= 23, "the pattern length of the approximate entropy test must be between 1 and 23");
+		require(n > m, "the sequence is too short for the approximate entropy test");
+		auto counts = pattern_histogram(seq, m + 1, true, true);
+		double next = approximate_phi(counts, n);
+		double phi = approximate_phi(fold_patterns(counts), n);
+		double entropy = phi - next;
+		double chi = 2.0 * double(n) * (std::log(2.0) - entropy);
+		return single(igamc(std::pow(2.0, m - 1.0), chi / 2), chi, n);
+	}
+
+	/* for each byte the change of the walk and the lowest and highest
+	partial sums after its 8 steps, first bit is the msb */
+	struct byte_walk {
+		s8 change[256], low[256], high[256];
+		byte_walk() {
+			for (int b = 0; b < 256; b++) {
+				int s = 0, lo = 8, hi = -8;
+				for (int i = 7; i >= 0; i--) {
+					s += (b >> i) & 1 ? 1 : -1;
+					lo = std::min(lo, s);
+					hi = std::max(hi, s);
+				}
+				change[b] = s8(s), low[b] = s8(lo), high[b] = s8(hi);
+			}
+		}
+	};
+	static const byte_walk walk_table;
+
+	static double cumulative_sums_p(s64 n, s64 z) {
+		double root = std::sqrt(double(n));
+		double sum1 = 0, sum2 = 0;
+		for (s64 k = (-n / z + 1) / 4; k <= (n / z - 1) / 4; k++) {
+			sum1 += normal_cdf(double(4 * k + 1) * z / root) - normal_cdf(double(4 * k - 1) * z / root);
+		}
+		for (s64 k = (-n / z - 3) / 4; k <= (n / z - 1) / 4; k++) {
+			sum2 += normal_cdf(double(4 * k + 3) * z / root) - normal_cdf(double(4 * k + 1) * z / root);
+		}
+		return 1 - sum1 + sum2;
+	}
+
+	nist_result nist_cumulative_sums(const bit_sequence& seq) {
+		u64 n = seq.size();
+		require(n > 0, "the cumulative sums test needs a non empty sequence");
+		auto bytes = reinterpret_cast<const u8*>(seq.address());
+		s64 s = 0, low = 0, high = 0;
+		u64 full = n >> 3;
+		for (u64 i = 0; i < full; i++) {
+			u8 b = bytes[i];
+			low = std::min<s64>(low, s + walk_table.low[b]);
+			high = std::max<s64>(high, s + walk_table.high[b]);
+			s += walk_table.change[b];
+		}
+		for (u64 i = full << 3; i < n; i++) {
+			s += read_bits(seq, i, 1) ? 1 : -1;
+			low = std::min(low, s);
+			high = std::max(high, s);
+		}
+		// the backward walk reaches s - S_j for every partial sum S_j
+		s64 forward = std::max(high, -low);
+		s64 backward = std::max(s - low, high - s);
+		nist_result result;
+		result.p_values.push_back(cumulative_sums_p(s64(n), forward));
+		result.p_values.push_back(cumulative_sums_p(s64(n), backward));
+		result.statistics.push_back(double(forward));
+		result.statistics.push_back(double(backward));
+		result.bits = n;
+		result.applicable = true;
+		return result;
+	}
+
+	/* walks the +1/-1 sequence, calls visit(S) for every partial sum with
+	|S| <= reach other than zero and cycle() for every return to zero,
+	including the zero appended at the end. Whole words are skipped while
+	the walk is too far away to come back within reach. */
+	template <class Visit, class Cycle>
+	static void random_walk(const bit_sequence& seq, s64 reach, Visit visit, Cycle cycle) {
+		u64 n = seq.size();
+		auto words = reinterpret_cast<const u64*>(seq.address());
+		s64 s = 0;
+		for (u64 k = 0; (k << 6) < n; k++) {
+			u32 width = u32(std::min<u64>(64, n - (k << 6)));
+			u64 w = load_stream_word(words, k);
+			if (width == 64 && (s > 64 + reach || s < -64 - reach)) {
+				s += 2 * s64(popcount64(w)) - 64;
+				continue;
+			}
+			for (u32 j = 0; j < width; j++, w <<= 1) {
+				s += (w >> 63) ? 1 : -1;
+				if (s == 0) cycle();
+				else if (s <= reach && s >= -reach) visit(s);
+			}
+		}
+		if (s != 0) cycle();
+	}
+
+	static bool enough_cycles(u64 cycles, u64 n) {
+		return double(cycles) >= std::max(0.005 * std::sqrt(double(n)), 500.0);
+	}
+
+	nist_result nist_random_excursions(const bit_sequence& seq) {
+		u64 n = seq.size();
+		require(n > 0, "the random excursions test needs a non empty sequence");
+		// states -4..-1, 1..4 map to 0..7
+		u64 visits[8] = {}, observed[8][6] = {}, cycles = 0;
+		random_walk(seq, 4, [&](s64 s) {
+			visits[s < 0 ? s + 4 : s + 3]++;
+		}, [&]() {
+			cycles++;
+			for (int i = 0; i < 8; i++) {
+				observed[i][std::min<u64>(visits[i], 5)]++;
+				visits[i] = 0;
+			}
+		});
+		nist_result result;
+		result.bits = n;
+		result.applicable = enough_cycles(cycles, n);
+		if (!result.applicable) return result;
+		for (int i = 0; i < 8; i++) {
+			double x = i < 4 ? 4 - i : i - 3;
+			double probability[6];
+			double stay = 1 - 1 / (2 * x);
+			probability[0] = stay;
+			for (int k = 1; k < 5; k++) probability[k] = 1 / (4 * x * x) * std::pow(stay, k - 1);
+			probability[5] = 1 / (2 * x) * std::pow(stay, 4);
+			double chi = chi_square(observed[i], probability, 6, double(cycles));
+			result.p_values.push_back(igamc(2.5, chi / 2));
+			result.statistics.push_back(chi);
+		}
+		return result;
+	}
+
+	nist_result nist_random_excursions_variant(const bit_sequence& seq) {
+		u64 n = seq.size();
+		require(n > 0, "the random excursions variant test needs a non empty sequence");
+		// states -9..-1, 1..9 map to 0..17
+		u64 visits[18] = {}, cycles = 0;
+		random_walk(seq, 9, [&](s64 s) {
+			visits[s < 0 ? s + 9 : s + 8]++;
+		}, [&]() {
+			cycles++;
+		});
+		nist_result result;
+		result.bits = n;
+		result.applicable = enough_cycles(cycles, n);
+		if (!result.applicable) return result;
+		for (int i = 0; i < 18; i++) {
+			double x = i < 9 ? 9 - i : i - 8;
+			double p = std::erfc(std::fabs(double(visits[i]) - double(cycles)) / std::sqrt(2.0 * double(cycles) * (4 * x - 2)));
+			result.p_values.push_back(p);
+			result.statistics.push_back(double(visits[i]));
+		}
+		return result;
+	}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include "block_runner.hpp"
+#include <vector>
+
+namespace binseq {
+
+	/* NIST SP 800-22 rev 1a statistical tests for random and pseudorandom
+	number generators. Every test reads the bits in stream order and works on
+	whole words where the statistic allows it. Tests which are defined for a
+	family of sub tests (serial, cumulative sums, random excursions) report one
+	p-value per sub test. Sequences too short for a test and parameters out of
+	range throw std::invalid_argument. */
+
+	struct nist_result {
+		std::vector<double> p_values; // empty when the test is not applicable
+		std::vector<double> statistics; // test statistic behind each p-value
+		u64 bits; // number of bits which took part in the test
+		bool applicable;
+	};
+
+	/* significance level recommended by the standard */
+	static const double nist_alpha = 0.01;
+
+	nist_result nist_frequency(const bit_sequence&);
+	nist_result nist_block_frequency(const bit_sequence&, u64 block = 128);
+	nist_result nist_runs(const bit_sequence&);
+	nist_result nist_longest_run(const bit_sequence&);
+	nist_result nist_rank(const bit_sequence&);
+
+	/* spectral test, sequences longer than nist_dft_max_bits are tested on
+	their first nist_dft_max_bits bits to bound the memory of the transform */
+	static const u64 nist_dft_max_bits = u64(1) << 20;
+	nist_result nist_dft(const bit_sequence&);
+
+	/* pattern holds the m template bits, the first bit is the most significant */
+	nist_result nist_non_overlapping_template(const bit_sequence&, u64 pattern = 1, u32 m = 9, u32 blocks = 8);
+	nist_result nist_overlapping_template(const bit_sequence&, u32 m = 9);
+
+	/* L = 0 picks the block length from the sequence length */
+	nist_result nist_universal(const bit_sequence&, u32 L = 0);
+
+	/* the blocks are independent and may be spread over a runner */
+	nist_result nist_linear_complexity(const bit_sequence&, u32 block = 500, const block_runner& run = nullptr);
+
+	/* m = 0 picks the largest recommended pattern length up to 16 and 10 */
+	nist_result nist_serial(const bit_sequence&, u32 m = 0);
+	nist_result nist_approximate_entropy(const bit_sequence&, u32 m = 0);
+
+	/* p-values of the forward and the backward walk */
+	nist_result nist_cumulative_sums(const bit_sequence&);
+
+	/* p-values for the states -4..-1, 1..4 and -9..-1, 1..9, both tests are
+	not applicable when the walk has fewer than max(500, 0.005*sqrt(n)) cycles */
+	nist_result nist_random_excursions(const bit_sequence&);
+	nist_result nist_random_excursions_variant(const bit_sequence&);
+
+	/* complemented incomplete gamma function Q(a, x) */
+	double igamc(double a, double x);
+
+}
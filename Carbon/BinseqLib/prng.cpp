@@ -0,0 +1,202 @@
+#include "prng.hpp"
+#include "bit_stream.hpp"
+#include "intrinsics.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace binseq {
+
+	/* words per block, the unit which gets its own generator state */
+	static const u64 prng_block_words = 1 << 14;
+
+	prng_kind parse_prng(const char* name) {
+		if (std::strcmp(name, "xoshiro256**") == 0) return prng_kind::xoshiro256;
+		if (std::strcmp(name, "pcg32") == 0) return prng_kind::pcg32;
+		if (std::strcmp(name, "philox4x32") == 0) return prng_kind::philox;
+		throw std::invalid_argument("unknown generator, use xoshiro256**, pcg32 or philox4x32");
+	}
+
+	static inline u64 rotl64(u64 x, u32 k) {
+		return (x << k) | (x >> (64 - k));
+	}
+
+	static inline u64 splitmix64(u64& x) {
+		u64 z = (x += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	struct xoshiro256 {
+		u64 s[4];
+
+		explicit xoshiro256(u64 seed) {
+			for (auto& word : s) word = splitmix64(seed);
+		}
+
+		inline u64 next() {
+			u64 result = rotl64(s[1] * 5, 7) * 9;
+			u64 t = s[1] << 17;
+			s[2] ^= s[0];
+			s[3] ^= s[1];
+			s[1] ^= s[2];
+			s[0] ^= s[3];
+			s[2] ^= t;
+			s[3] = rotl64(s[3], 45);
+			return result;
+		}
+
+		/* advances by the distance encoded in the jump polynomial */
+		void jump(const u64 (&polynomial)[4]) {
+			u64 t[4] = { 0, 0, 0, 0 };
+			for (u64 word : polynomial) {
+				for (u32 b = 0; b < 64; b++) {
+					if ((word >> b) & 1) {
+						for (u32 i = 0; i < 4; i++) t[i] ^= s[i];
+					}
+					next();
+				}
+			}
+			std::memcpy(s, t, sizeof(s));
+		}
+	};
+
+	static const u64 xoshiro_jump[4] = { 0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull };
+	static const u64 xoshiro_long_jump[4] = { 0x76e15d3efefdcbbfull, 0xc5004e441c522fb3ull, 0x77710069854ee241ull, 0x39109bb02acbe635ull };
+
+	struct pcg32 {
+		static const u64 multiplier = 6364136223846793005ull;
+		u64 state;
+		u64 increment;
+
+		pcg32(u64 seed, u64 stream) : state(0), increment((stream << 1) | 1) {
+			next();
+			state += seed;
+			next();
+		}
+
+		inline u32 next() {
+			u64 old = state;
+			state = old * multiplier + increment;
+			u32 shifted = u32(((old >> 18) ^ old) >> 27);
+			u32 rotation = u32(old >> 59);
+			return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+		}
+
+		/* jumps steps outputs ahead by squaring the affine step */
+		void advance(u64 steps) {
+			u64 mul = 1, add = 0, m = multiplier, c = increment;
+			for (; steps != 0; steps >>= 1) {
+				if (steps & 1) {
+					mul *= m;
+					add = add * m + c;
+				}
+				c *= m + 1;
+				m *= m;
+			}
+			state = state * mul + add;
+		}
+	};
+
+	/* philox4x32-10 of one 128 bit counter, written as two words */
+	static inline void philox(u64 counter, u64 stream, u64 key, u64* out) {
+		u32 x0 = u32(counter), x1 = u32(counter >> 32), x2 = u32(stream), x3 = u32(stream >> 32);
+		u32 k0 = u32(key), k1 = u32(key >> 32);
+		for (u32 round = 0; round < 10; round++) {
+			u64 p0 = u64(0xd2511f53u) * x0, p1 = u64(0xcd9e8d57u) * x2;
+			u32 y0 = u32(p1 >> 32) ^ x1 ^ k0, y2 = u32(p0 >> 32) ^ x3 ^ k1;
+			x1 = u32(p1);
+			x3 = u32(p0);
+			x0 = y0;
+			x2 = y2;
+			k0 += 0x9e3779b9u;
+			k1 += 0xbb67ae85u;
+		}
+		out[0] = (u64(x0) << 32) | x1;
+		out[1] = (u64(x2) << 32) | x3;
+	}
+
+	void random_words(prng_kind kind, u64 seed, u64 stream, u64* words, u64 count, const block_runner& run) {
+		u64 blocks = (count + prng_block_words - 1) / prng_block_words;
+		// jumps can't be taken in log time, so the xoshiro block states are prepared up front
+		std::vector<xoshiro256> starts;
+		if (kind == prng_kind::xoshiro256 && stream > xoshiro_max_stream)
+			throw std::invalid_argument("stream of xoshiro256** must be at most " + std::to_string(xoshiro_max_stream));
+		if (kind == prng_kind::xoshiro256 && blocks != 0) {
+			xoshiro256 generator(seed);
+			for (u64 s = 0; s < stream; s++) generator.jump(xoshiro_long_jump);
+			starts.reserve((size_t)blocks);
+			starts.push_back(generator);
+			for (u64 b = 1; b < blocks; b++) {
+				generator.jump(xoshiro_jump);
+				starts.push_back(generator);
+			}
+		}
+		auto range = [&](u64 first, u64 last) {
+			for (u64 b = first; b < last; b++) {
+				u64 begin = b * prng_block_words, end = std::min(count, begin + prng_block_words);
+				switch (kind) {
+					case prng_kind::xoshiro256: {
+						xoshiro256 generator = starts[(size_t)b];
+						for (u64 i = begin; i < end; i++) words[i] = generator.next();
+						break;
+					}
+					case prng_kind::pcg32: {
+						pcg32 generator(seed, stream);
+						generator.advance(begin * 2);
+						for (u64 i = begin; i < end; i++) {
+							u64 high = generator.next();
+							words[i] = (high << 32) | generator.next();
+						}
+						break;
+					}
+					case prng_kind::philox: {
+						u64 i = begin, pair[2];
+						for (; i + 2 <= end; i += 2) philox(i >> 1, stream, seed, words + i);
+						if (i < end) {
+							philox(i >> 1, stream, seed, pair);
+							words[i] = pair[0];
+						}
+						break;
+					}
+				}
+			}
+		};
+		if (run && blocks > 1) run(blocks, range); else range(0, blocks);
+	}
+
+	void random_below(prng_kind kind, u64 seed, u64 stream, u64 bound, u64* values, u64 count, const block_runner& run) {
+		random_words(kind, seed, stream, values, count, run);
+		if (bound == 0) return;
+		// Lemire's multiply and shift with rejection, the low half of the product
+		// is below (2^64 - bound) % bound for the words which would bias the result.
+		// Rejected words are redrawn from splitmix64 seeded by the word itself, so
+		// the values still depend only on the seed and stream.
+		u64 threshold = (0 - bound) % bound;
+		for (u64 i = 0; i < count; i++) {
+			u64 x = values[i];
+			if (x * bound < threshold) {
+				u64 state = x;
+				do x = splitmix64(state); while (x * bound < threshold);
+			}
+			values[i] = mulhi64(x, bound);
+		}
+	}
+
+	std::vector<double> random_doubles(prng_kind kind, u64 seed, u64 stream, u64 count, const block_runner& run) {
+		std::vector<u64> words((size_t)count);
+		random_words(kind, seed, stream, words.data(), count, run);
+		std::vector<double> result((size_t)count);
+		for (u64 i = 0; i < count; i++) result[(size_t)i] = double(words[(size_t)i] >> 11) * (1.0 / 9007199254740992.0);
+		return result;
+	}
+
+	bit_sequence random_bits(prng_kind kind, u64 seed, u64 stream, u64 bits, const block_runner& run) {
+		std::vector<u64> words((size_t)((bits + 63) >> 6));
+		random_words(kind, seed, stream, words.data(), words.size(), run);
+		return from_stream_words(words.data(), bits);
+	}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include "block_runner.hpp"
+#include <vector>
+
+namespace binseq {
+
+	/* Bulk pseudo random generators. The output is cut into blocks of a
+	fixed number of words and every block starts from its own generator
+	state, derived from the seed and stream without running the blocks
+	before it, so blocks may be spread over a runner and the result depends
+	only on the seed and stream, never on the degree of parallelism.
+
+	xoshiro256** is seeded with splitmix64, stream s is s long jumps (2^192
+	steps) away and block b starts b jumps (2^128 steps) into its stream.
+	pcg32 uses the stream as its increment and advances the LCG in log time,
+	so the blocks continue one serial stream. philox4x32-10 is counter based,
+	the seed is its key and the stream the high half of the counter. */
+	enum class prng_kind { xoshiro256, pcg32, philox };
+
+	/* xoshiro256** takes one long jump per stream index, higher streams are
+	rejected with std::invalid_argument so a stream can't stall the caller */
+	static const u64 xoshiro_max_stream = 1 << 16;
+
+	/* "xoshiro256**", "pcg32" or "philox4x32", throws std::invalid_argument otherwise */
+	prng_kind parse_prng(const char* name);
+
+	/* fills count words with 64 bit outputs */
+	void random_words(prng_kind, u64 seed, u64 stream, u64* words, u64 count, const block_runner& run = nullptr);
+
+	/* uniform integers in [0, bound) by multiply and shift, words which
+	would bias the result are rejected and redrawn; a bound of 0 keeps all
+	64 bits */
+	void random_below(prng_kind, u64 seed, u64 stream, u64 bound, u64* values, u64 count, const block_runner& run = nullptr);
+
+	/* uniform doubles in [0, 1) with 53 random bits each */
+	std::vector<double> random_doubles(prng_kind, u64 seed, u64 stream, u64 count, const block_runner& run = nullptr);
+
+	bit_sequence random_bits(prng_kind, u64 seed, u64 stream, u64 bits, const block_runner& run = nullptr);
+
+}
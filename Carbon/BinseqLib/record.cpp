@@ -0,0 +1,116 @@
+#include "record.hpp"
+#include "bit_stream.hpp"
+#include <stdexcept>
+
+namespace binseq {
+
+	record_decoder::record_decoder(std::vector<record_field> fields) : _fields(std::move(fields)), _record_bits(0) {
+		if (_fields.empty())
+			throw std::invalid_argument("record schema has no fields");
+		for (u32 i = 0; i < _fields.size(); i++) {
+			auto& field = _fields[i];
+			if (field.width < 1 || field.width > 64)
+				throw std::invalid_argument("record field " + field.name + " must be 1 to 64 bits wide");
+			if (field.little_endian && (field.width & 7) != 0)
+				throw std::invalid_argument("little endian record field " + field.name + " must be a whole number of bytes");
+			field.offset = _record_bits;
+			_record_bits += field.width;
+			if (field.name == "_")
+				continue;
+			for (auto c : _columns) {
+				if (_fields[c].name == field.name)
+					throw std::invalid_argument("record field " + field.name + " is declared twice");
+			}
+			step s;
+			s.offset = field.offset;
+			s.column = u32(_columns.size());
+			s.width = field.width;
+			s.extend = field.is_signed ? u8(64 - field.width) : 0;
+			s.swap = field.little_endian && field.width > 8;
+			_plan.push_back(s);
+			_columns.push_back(i);
+		}
+	}
+
+	static bool is_space(char c) {
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	record_decoder record_decoder::parse(const std::string& schema) {
+		std::vector<record_field> fields;
+		size_t i = 0, n = schema.size();
+		while (i < n) {
+			while (i < n && (is_space(schema[i]) || schema[i] == ',' || schema[i] == ';')) i++;
+			if (i >= n) break;
+			record_field field;
+			field.is_signed = false;
+			field.little_endian = false;
+			field.offset = 0;
+			while (i < n && schema[i] != ':' && schema[i] != ',' && schema[i] != ';' && !is_space(schema[i]))
+				field.name.push_back(schema[i++]);
+			while (i < n && is_space(schema[i])) i++;
+			if (field.name.empty() || i >= n || schema[i] != ':')
+				throw std::invalid_argument("record schema expects name:type pairs near '" + schema.substr(i < n ? i : n) + "'");
+			i++;
+			while (i < n && is_space(schema[i])) i++;
+			if (i < n && (schema[i] == 'u' || schema[i] == 's' || schema[i] == 'i')) {
+				field.is_signed = schema[i] != 'u';
+				i++;
+			}
+			unsigned width = 0;
+			size_t digits = 0;
+			while (i < n && schema[i] >= '0' && schema[i] <= '9') {
+				width = width * 10 + unsigned(schema[i++] - '0');
+				digits++;
+				if (width > 64) break;
+			}
+			if (digits == 0 || width < 1 || width > 64)
+				throw std::invalid_argument("record field " + field.name + " needs a width between 1 and 64");
+			field.width = u8(width);
+			if (i + 1 < n && schema[i] == 'l' && schema[i + 1] == 'e') {
+				field.little_endian = true;
+				i += 2;
+			} else if (i + 1 < n && schema[i] == 'b' && schema[i + 1] == 'e') {
+				i += 2;
+			}
+			if (i < n && !is_space(schema[i]) && schema[i] != ',' && schema[i] != ';')
+				throw std::invalid_argument("unexpected character in type of record field " + field.name);
+			fields.push_back(std::move(field));
+		}
+		return record_decoder(std::move(fields));
+	}
+
+	u64 record_decoder::record_bits() const {
+		return _record_bits;
+	}
+
+	u64 record_decoder::record_count(const bit_sequence& seq) const {
+		return seq.size() / _record_bits;
+	}
+
+	const std::vector<record_field>& record_decoder::fields() const {
+		return _fields;
+	}
+
+	const std::vector<u32>& record_decoder::columns() const {
+		return _columns;
+	}
+
+	void record_decoder::decode(const bit_sequence& seq, u64 first, u64 count, s64* const* columns) const {
+		if ((first + count) * _record_bits > seq.size())
+			throw std::out_of_range("record range is outside of the sequence");
+		const step* plan = _plan.data();
+		const size_t steps = _plan.size();
+		u64 base = first * _record_bits;
+		for (u64 r = 0; r < count; r++, base += _record_bits) {
+			for (size_t f = 0; f < steps; f++) {
+				const step& s = plan[f];
+				u64 v = read_bits(seq, base + s.offset, s.width);
+				if (s.swap) v = bswap64(v) >> (64 - s.width);
+				if (s.extend) v = u64(s64(v << s.extend) >> s.extend);
+				columns[s.column][r] = s64(v);
+			}
+		}
+	}
+
+}
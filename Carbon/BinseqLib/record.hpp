@@ -0,0 +1,51 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include <string>
+#include <vector>
+
+namespace binseq {
+
+	/* a fixed width field of a binary record */
+	struct record_field {
+		std::string name; // fields named "_" are padding and produce no column
+		u8 width; // 1..64 bits
+		bool is_signed;
+		bool little_endian; // byte order, only for widths which are multiples of 8
+		u64 offset; // bit offset inside the record, filled in by record_decoder
+	};
+
+	/* a record schema compiled into a flat decode plan, fields are read in stream
+	order so the first field starts at the most significant bit of the first byte */
+	class record_decoder {
+	public:
+		explicit record_decoder(std::vector<record_field> fields);
+
+		/* compiles a textual schema such as "id:u16, _:u4, temp:s12, len:u32le" */
+		static record_decoder parse(const std::string& schema);
+
+		u64 record_bits() const;
+		u64 record_count(const bit_sequence&) const;
+		const std::vector<record_field>& fields() const;
+		/* indices into fields() which produce an output column */
+		const std::vector<u32>& columns() const;
+
+		/* decodes records [first, first+count) into one array per column,
+		columns[c][r - first] receives the value of column c for record r */
+		void decode(const bit_sequence&, u64 first, u64 count, s64* const* columns) const;
+
+	private:
+		struct step {
+			u64 offset;
+			u32 column;
+			u8 width;
+			u8 extend; // shift used for sign extension, 0 when unsigned
+			bool swap;
+		};
+		std::vector<record_field> _fields;
+		std::vector<u32> _columns;
+		std::vector<step> _plan;
+		u64 _record_bits;
+	};
+
+}
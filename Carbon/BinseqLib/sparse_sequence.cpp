@@ -0,0 +1,370 @@
+#include "sparse_sequence.hpp"
+#include "intrinsics.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace binseq {
+
+	using container = sparse_sequence::container;
+	using container_kind = sparse_sequence::container_kind;
+
+	static const u64 top_bit = u64(1) << 63;
+
+	/* sets positions [begin, end) in a chunk of stream order words */
+	static void fill_range(u64* words, u32 begin, u32 end) {
+		while (begin < end) {
+			u32 w = begin >> 6;
+			u32 s = begin & 63;
+			u32 e = std::min(end - (w << 6), 64u);
+			u64 mask = (~u64(0) >> s) & (e == 64 ? ~u64(0) : ~(~u64(0) >> e));
+			words[w] |= mask;
+			begin = (w << 6) + e;
+		}
+	}
+
+	/* expands any container into 1024 stream order words */
+	static void to_words(const container& c, u64* words) {
+		if (c.kind == container_kind::bitmap) {
+			std::copy(c.words.begin(), c.words.end(), words);
+			return;
+		}
+		std::fill(words, words + sparse_sequence::chunk_words, u64(0));
+		if (c.kind == container_kind::array) {
+			for (auto v : c.values) {
+				words[v >> 6] |= top_bit >> (v & 63);
+			}
+		} else {
+			for (size_t i = 0; i < c.values.size(); i += 2) {
+				fill_range(words, c.values[i], u32(c.values[i]) + c.values[i + 1] + 1);
+			}
+		}
+	}
+
+	static bool contains(const container& c, u16 low) {
+		switch (c.kind) {
+			case container_kind::array:
+				return std::binary_search(c.values.begin(), c.values.end(), low);
+			case container_kind::bitmap:
+				return (c.words[low >> 6] & (top_bit >> (low & 63))) != 0;
+			case container_kind::run: {
+				// last run which starts at or before low
+				size_t lo = 0, hi = c.values.size() / 2;
+				while (lo < hi) {
+					size_t mid = (lo + hi) >> 1;
+					if (c.values[mid * 2] <= low) lo = mid + 1; else hi = mid;
+				}
+				if (lo == 0) return false;
+				u32 start = c.values[(lo - 1) * 2];
+				return low <= start + c.values[(lo - 1) * 2 + 1];
+			}
+		}
+		return false;
+	}
+
+	/* number of chunk positions which exist in a sequence of the given size */
+	static u32 chunk_length(u64 size, u32 key) {
+		u64 first = u64(key) * sparse_sequence::chunk_bits;
+		return u32(std::min<u64>(size - first, sparse_sequence::chunk_bits));
+	}
+
+	static void push_array(sparse_sequence& seq, u32 key, std::vector<u16>&& values) {
+		if (values.empty()) return;
+		u32 runs = 1;
+		for (size_t i = 1; i < values.size(); i++) {
+			if (values[i] != values[i - 1] + 1) runs++;
+		}
+		container c;
+		c.key = key;
+		c.cardinality = u32(values.size());
+		if (runs * 2 < values.size()) {
+			c.kind = container_kind::run;
+			c.values.reserve(runs * 2);
+			u16 start = values[0];
+			for (size_t i = 1; i <= values.size(); i++) {
+				if (i == values.size() || values[i] != values[i - 1] + 1) {
+					c.values.push_back(start);
+					c.values.push_back(u16(values[i - 1] - start));
+					if (i < values.size()) start = values[i];
+				}
+			}
+		} else {
+			c.kind = container_kind::array;
+			c.values = std::move(values);
+		}
+		seq.push(std::move(c));
+	}
+
+	sparse_sequence::sparse_sequence() : _size(0) {}
+
+	sparse_sequence::sparse_sequence(u64 size) : _size(size) {}
+
+	sparse_sequence::sparse_sequence(const bit_sequence& seq) : _size(seq.size()) {
+		auto src = reinterpret_cast<const u64*>(seq.address());
+		u64 total = (_size + 63) >> 6;
+		std::vector<u64> words(chunk_words);
+		u32 key = 0;
+		for (u64 first = 0; first < total; first += chunk_words, key++) {
+			u64 n = std::min<u64>(chunk_words, total - first);
+			bool any = false;
+			for (u64 i = 0; i < n; i++) {
+				u64 w = bswap64(src[first + i]);
+				if (first + i == total - 1 && (_size & 63)) {
+					w &= ~(~u64(0) >> (_size & 63));
+				}
+				words[i] = w;
+				any |= w != 0;
+			}
+			std::fill(words.begin() + n, words.end(), u64(0));
+			if (any) push_bitmap(key, words.data());
+		}
+	}
+
+	u64 sparse_sequence::size() const {
+		return _size;
+	}
+
+	u64 sparse_sequence::popcount() const {
+		u64 count = 0;
+		for (auto& c : _containers) count += c.cardinality;
+		return count;
+	}
+
+	bit sparse_sequence::get(u64 position) const {
+		u32 key = u32(position >> 16);
+		auto it = std::lower_bound(_containers.begin(), _containers.end(), key,
+			[](const container& c, u32 k) { return c.key < k; });
+		if (it == _containers.end() || it->key != key) return false;
+		return contains(*it, u16(position & 0xffff));
+	}
+
+	const std::vector<container>& sparse_sequence::containers() const {
+		return _containers;
+	}
+
+	u64 sparse_sequence::memory_usage() const {
+		u64 bytes = sizeof(sparse_sequence);
+		for (auto& c : _containers) {
+			bytes += sizeof(container) + c.values.size() * sizeof(u16) + c.words.size() * sizeof(u64);
+		}
+		return bytes;
+	}
+
+	bit_sequence sparse_sequence::to_bit_sequence() const {
+		bit_sequence seq;
+		seq.reallocate(_size);
+		auto dst = reinterpret_cast<u64*>(seq.address());
+		u64 total = _size <= 128 ? 2 : (_size + 63) >> 6;
+		std::fill(dst, dst + total, u64(0));
+		std::vector<u64> words(chunk_words);
+		for (auto& c : _containers) {
+			to_words(c, words.data());
+			u64 first = u64(c.key) * chunk_words;
+			u64 n = std::min<u64>(chunk_words, total - first);
+			for (u64 i = 0; i < n; i++) {
+				dst[first + i] = bswap64(words[i]);
+			}
+		}
+		return seq;
+	}
+
+	void sparse_sequence::push_bitmap(u32 key, const u64* words) {
+		u32 cardinality = 0, runs = 0;
+		u64 previous = 0;
+		for (u32 i = 0; i < chunk_words; i++) {
+			u64 w = words[i];
+			cardinality += popcount64(w);
+			// a run starts where a set bit follows a clear one
+			runs += popcount64(w & ~((w >> 1) | (previous << 63)));
+			previous = w;
+		}
+		if (cardinality == 0) return;
+
+		container c;
+		c.key = key;
+		c.cardinality = cardinality;
+		u64 array_bytes = cardinality <= array_limit ? u64(cardinality) * 2 : ~u64(0);
+		u64 run_bytes = u64(runs) * 4;
+		u64 bitmap_bytes = chunk_words * 8;
+		if (run_bytes < array_bytes && run_bytes < bitmap_bytes) {
+			c.kind = container_kind::run;
+			c.values.reserve(runs * 2);
+			for (u32 i = 0; i < chunk_words; i++) {
+				u64 w = words[i];
+				while (w) {
+					u32 s = clz64(w);
+					u32 ones = clz64(~(w << s));
+					u32 start = (i << 6) + s;
+					size_t n = c.values.size();
+					if (n && u32(c.values[n - 2]) + c.values[n - 1] + 1 == start) {
+						c.values[n - 1] = u16(c.values[n - 1] + ones);
+					} else {
+						c.values.push_back(u16(start));
+						c.values.push_back(u16(ones - 1));
+					}
+					w = s + ones >= 64 ? 0 : w & (~u64(0) >> (s + ones));
+				}
+			}
+		} else if (array_bytes < bitmap_bytes) {
+			c.kind = container_kind::array;
+			c.values.reserve(cardinality);
+			for (u32 i = 0; i < chunk_words; i++) {
+				u64 w = words[i];
+				while (w) {
+					u32 s = clz64(w);
+					c.values.push_back(u16((i << 6) + s));
+					w &= ~(top_bit >> s);
+				}
+			}
+		} else {
+			c.kind = container_kind::bitmap;
+			c.words.assign(words, words + chunk_words);
+		}
+		_containers.push_back(std::move(c));
+	}
+
+	void sparse_sequence::push(container&& c) {
+		if (c.cardinality == 0) return;
+		_containers.push_back(std::move(c));
+	}
+
+	static void check_sizes(const sparse_sequence& a, const sparse_sequence& b) {
+		if (a.size() != b.size())
+			throw std::logic_error("can't compare sequences of different length");
+	}
+
+	sparse_sequence _not(const sparse_sequence& a) {
+		sparse_sequence c(a.size());
+		auto& src = a.containers();
+		u32 chunks = u32((a.size() + sparse_sequence::chunk_bits - 1) / sparse_sequence::chunk_bits);
+		std::vector<u64> words(sparse_sequence::chunk_words);
+		size_t j = 0;
+		for (u32 key = 0; key < chunks; key++) {
+			u32 length = chunk_length(a.size(), key);
+			if (j < src.size() && src[j].key == key) {
+				to_words(src[j++], words.data());
+				for (auto& w : words) w = ~w;
+				// clear everything after the end of the sequence
+				u32 tail = length & 63;
+				u32 last = (length + 63) >> 6;
+				if (tail) words[last - 1] &= ~(~u64(0) >> tail);
+				std::fill(words.begin() + last, words.end(), u64(0));
+				c.push_bitmap(key, words.data());
+			} else {
+				container full;
+				full.key = key;
+				full.kind = container_kind::run;
+				full.cardinality = length;
+				full.values = { 0, u16(length - 1) };
+				c.push(std::move(full));
+			}
+		}
+		return c;
+	}
+
+	sparse_sequence _and(const sparse_sequence& a, const sparse_sequence& b) {
+		check_sizes(a, b);
+		sparse_sequence c(a.size());
+		auto& x = a.containers();
+		auto& y = b.containers();
+		std::vector<u64> p(sparse_sequence::chunk_words), q(sparse_sequence::chunk_words);
+		size_t i = 0, j = 0;
+		while (i < x.size() && j < y.size()) {
+			if (x[i].key < y[j].key) { i++; continue; }
+			if (y[j].key < x[i].key) { j++; continue; }
+			auto& l = x[i++];
+			auto& r = y[j++];
+			if (l.kind == container_kind::array || r.kind == container_kind::array) {
+				// filter the smaller array through the other container
+				auto& small = l.kind == container_kind::array ? l : r;
+				auto& other = &small == &l ? r : l;
+				std::vector<u16> values;
+				for (auto v : small.values) {
+					if (contains(other, v)) values.push_back(v);
+				}
+				push_array(c, l.key, std::move(values));
+			} else {
+				to_words(l, p.data());
+				to_words(r, q.data());
+				for (u32 k = 0; k < sparse_sequence::chunk_words; k++) p[k] &= q[k];
+				c.push_bitmap(l.key, p.data());
+			}
+		}
+		return c;
+	}
+
+	/* shared implementation of or and xor, chunks present on one side are copied */
+	template <bool exclusive>
+	static sparse_sequence merge(const sparse_sequence& a, const sparse_sequence& b) {
+		check_sizes(a, b);
+		sparse_sequence c(a.size());
+		auto& x = a.containers();
+		auto& y = b.containers();
+		std::vector<u64> p(sparse_sequence::chunk_words), q(sparse_sequence::chunk_words);
+		size_t i = 0, j = 0;
+		while (i < x.size() || j < y.size()) {
+			if (j == y.size() || (i < x.size() && x[i].key < y[j].key)) {
+				c.push(container(x[i++]));
+				continue;
+			}
+			if (i == x.size() || y[j].key < x[i].key) {
+				c.push(container(y[j++]));
+				continue;
+			}
+			auto& l = x[i++];
+			auto& r = y[j++];
+			if (l.kind == container_kind::array && r.kind == container_kind::array &&
+				l.cardinality + r.cardinality <= sparse_sequence::array_limit) {
+				std::vector<u16> values;
+				values.reserve(l.cardinality + r.cardinality);
+				if (exclusive) {
+					std::set_symmetric_difference(l.values.begin(), l.values.end(), r.values.begin(), r.values.end(), std::back_inserter(values));
+				} else {
+					std::set_union(l.values.begin(), l.values.end(), r.values.begin(), r.values.end(), std::back_inserter(values));
+				}
+				push_array(c, l.key, std::move(values));
+			} else {
+				to_words(l, p.data());
+				to_words(r, q.data());
+				for (u32 k = 0; k < sparse_sequence::chunk_words; k++) {
+					p[k] = exclusive ? p[k] ^ q[k] : p[k] | q[k];
+				}
+				c.push_bitmap(l.key, p.data());
+			}
+		}
+		return c;
+	}
+
+	sparse_sequence _or(const sparse_sequence& a, const sparse_sequence& b) {
+		return merge<false>(a, b);
+	}
+
+	sparse_sequence _xor(const sparse_sequence& a, const sparse_sequence& b) {
+		return merge<true>(a, b);
+	}
+
+	bool operator ==(const sparse_sequence& a, const sparse_sequence& b) {
+		if (a.size() != b.size()) return false;
+		auto& x = a.containers();
+		auto& y = b.containers();
+		if (x.size() != y.size()) return false;
+		std::vector<u64> p(sparse_sequence::chunk_words), q(sparse_sequence::chunk_words);
+		for (size_t i = 0; i < x.size(); i++) {
+			if (x[i].key != y[i].key || x[i].cardinality != y[i].cardinality) return false;
+			to_words(x[i], p.data());
+			to_words(y[i], q.data());
+			if (p != q) return false;
+		}
+		return true;
+	}
+
+	bool prefer_sparse(const sparse_sequence& seq) {
+		return seq.memory_usage() * 2 < (seq.size() + 7) / 8;
+	}
+
+	bool prefer_sparse(u64 size, u64 popcount) {
+		u64 minority = std::min(popcount, size - popcount);
+		return minority * 32 < size;
+	}
+
+}
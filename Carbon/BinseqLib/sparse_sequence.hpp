@@ -0,0 +1,68 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include <vector>
+
+namespace binseq {
+
+	/* Roaring style compressed sequence for mostly empty (or mostly full) data.
+	Positions are split into chunks of 65536 bits and every non empty chunk is
+	kept in the smallest of three containers: a sorted array of set positions,
+	a bitmap of 1024 words, or a list of runs. Positions use the same order as
+	bit_sequence::operator[], bitmap words are stored in stream order. */
+	class sparse_sequence {
+	public:
+		enum class container_kind : u8 {
+			array, // values holds the sorted set positions
+			bitmap, // words holds 1024 stream order words
+			run // values holds start, length-1 pairs
+		};
+
+		struct container {
+			u32 key; // chunk index, position >> 16
+			container_kind kind;
+			u32 cardinality;
+			std::vector<u16> values;
+			std::vector<u64> words;
+		};
+
+		static const u32 chunk_bits = 65536;
+		static const u32 chunk_words = chunk_bits / 64;
+		static const u32 array_limit = 4096; // largest array container
+
+		sparse_sequence();
+		explicit sparse_sequence(u64 size);
+		explicit sparse_sequence(const bit_sequence&);
+
+		u64 size() const;
+		u64 popcount() const;
+		bit get(u64 position) const;
+		const std::vector<container>& containers() const;
+
+		/* approximate number of bytes held by the containers */
+		u64 memory_usage() const;
+
+		bit_sequence to_bit_sequence() const;
+
+		/* result builders used by the operators, chunks must be pushed in key order */
+		void push_bitmap(u32 key, const u64* words);
+		void push(container&&);
+
+	private:
+		u64 _size;
+		std::vector<container> _containers;
+	};
+
+	sparse_sequence _not(const sparse_sequence&);
+	sparse_sequence _and(const sparse_sequence&, const sparse_sequence&);
+	sparse_sequence _or(const sparse_sequence&, const sparse_sequence&);
+	sparse_sequence _xor(const sparse_sequence&, const sparse_sequence&);
+	bool operator ==(const sparse_sequence&, const sparse_sequence&);
+
+	/* true when the compressed form takes less than half of the dense form */
+	bool prefer_sparse(const sparse_sequence&);
+
+	/* cheap estimate from the density alone, used before compressing a dense sequence */
+	bool prefer_sparse(u64 size, u64 popcount);
+
+}
@@ -0,0 +1,147 @@
+#include "vertical.hpp"
+#include "bit_stream.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace binseq {
+
+	/* counts of 64 columns, plane j holds bit j of each count */
+	struct vertical_counter {
+		u64 planes[64];
+		u32 used;
+
+		vertical_counter() : used(0) {}
+
+		/* adds x at weight 2^level, rippling the carry into higher planes */
+		inline void add(u64 x, u32 level) {
+			for (u32 j = level; x != 0; j++) {
+				while (used <= j) planes[used++] = 0;
+				u64 carry = planes[j] & x;
+				planes[j] ^= x;
+				x = carry;
+			}
+		}
+
+		/* columns whose count is at least k */
+		inline u64 at_least(u64 k) const {
+			if (used < 64 && (k >> used) != 0) return 0;
+			u64 greater = 0, equal = ~u64(0);
+			for (u32 j = used; j-- != 0;) {
+				if ((k >> j) & 1) {
+					equal &= planes[j];
+				} else {
+					greater |= equal & planes[j];
+					equal &= ~planes[j];
+				}
+			}
+			return greater | equal;
+		}
+	};
+
+	static u64 common_size(const std::vector<const bit_sequence*>& seqs) {
+		if (seqs.empty())
+			throw std::invalid_argument("at least one sequence is required");
+		u64 size = seqs[0]->size();
+		for (auto seq : seqs) {
+			if (seq->size() != size)
+				throw std::invalid_argument("sequences must have the same length");
+		}
+		return size;
+	}
+
+	/* counts the columns of word k, three words at a time go through a full
+	adder so only their sum and carry ripple into the planes */
+	static void count_word(const std::vector<const bit_sequence*>& seqs, u64 size, u64 k, vertical_counter& counter) {
+		u64 offset = k << 6;
+		u32 width = u32(std::min<u64>(64, size - offset));
+		auto load = [&](size_t i) { return read_bits(*seqs[i], offset, width) << (64 - width); };
+		size_t i = 0, n = seqs.size();
+		for (; i + 3 <= n; i += 3) {
+			u64 a = load(i), b = load(i + 1), c = load(i + 2);
+			u64 half = a ^ b;
+			counter.add(half ^ c, 0);
+			counter.add((a & b) | (half & c), 1);
+		}
+		for (; i < n; i++) counter.add(load(i), 0);
+	}
+
+	std::vector<u64> column_counts(const std::vector<const bit_sequence*>& seqs, const block_runner& run) {
+		u64 size = common_size(seqs);
+		u64 words = (size + 63) >> 6;
+		std::vector<u64> counts((size_t)size);
+		auto range = [&](u64 first, u64 last) {
+			for (u64 k = first; k < last; k++) {
+				vertical_counter counter;
+				count_word(seqs, size, k, counter);
+				u64 columns = std::min<u64>(64, size - (k << 6));
+				for (u64 c = 0; c < columns; c++) {
+					u64 count = 0;
+					for (u32 j = 0; j < counter.used; j++) count |= ((counter.planes[j] >> (63 - c)) & 1) << j;
+					counts[(size_t)((k << 6) + c)] = count;
+				}
+			}
+		};
+		if (run) run(words, range); else range(0, words);
+		return counts;
+	}
+
+	bit_sequence threshold(const std::vector<const bit_sequence*>& seqs, u64 k, const block_runner& run) {
+		u64 size = common_size(seqs);
+		u64 words = (size + 63) >> 6;
+		std::vector<u64> result((size_t)words);
+		auto range = [&](u64 first, u64 last) {
+			for (u64 w = first; w < last; w++) {
+				vertical_counter counter;
+				count_word(seqs, size, w, counter);
+				u32 width = u32(std::min<u64>(64, size - (w << 6)));
+				result[(size_t)w] = counter.at_least(k) & (~u64(0) << (64 - width));
+			}
+		};
+		if (run) run(words, range); else range(0, words);
+		return from_stream_words(result.data(), size);
+	}
+
+	bit_sequence majority(const std::vector<const bit_sequence*>& seqs, const block_runner& run) {
+		return threshold(seqs, seqs.size() / 2 + 1, run);
+	}
+
+	/* words of the accumulator block, small enough to stay in the L1 cache */
+	static const u64 reduce_block_words = 1 << 11;
+
+	template <class Operator>
+	static bit_sequence reduce(const std::vector<const bit_sequence*>& seqs, const block_runner& run, Operator op) {
+		u64 size = common_size(seqs);
+		bit_sequence result;
+		result.reallocate(size);
+		// bitwise operators don't depend on the byte order, so raw words are combined
+		auto out = reinterpret_cast<u64*>(result.address());
+		u64 words = (size + 63) >> 6;
+		u64 blocks = (words + reduce_block_words - 1) / reduce_block_words;
+		auto range = [&](u64 first, u64 last) {
+			for (u64 b = first; b < last; b++) {
+				u64 begin = b * reduce_block_words, end = std::min(words, begin + reduce_block_words);
+				auto source = reinterpret_cast<const u64*>(seqs[0]->address());
+				for (u64 w = begin; w < end; w++) out[w] = source[w];
+				for (size_t i = 1; i < seqs.size(); i++) {
+					source = reinterpret_cast<const u64*>(seqs[i]->address());
+					for (u64 w = begin; w < end; w++) out[w] = op(out[w], source[w]);
+				}
+			}
+		};
+		if (run && blocks > 1) run(blocks, range); else range(0, blocks);
+		return result;
+	}
+
+	bit_sequence reduce_and(const std::vector<const bit_sequence*>& seqs, const block_runner& run) {
+		return reduce(seqs, run, [](u64 a, u64 b) { return a & b; });
+	}
+
+	bit_sequence reduce_or(const std::vector<const bit_sequence*>& seqs, const block_runner& run) {
+		return reduce(seqs, run, [](u64 a, u64 b) { return a | b; });
+	}
+
+	bit_sequence reduce_xor(const std::vector<const bit_sequence*>& seqs, const block_runner& run) {
+		return reduce(seqs, run, [](u64 a, u64 b) { return a ^ b; });
+	}
+
+}
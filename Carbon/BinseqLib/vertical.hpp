@@ -0,0 +1,32 @@
+#pragma once
+#include "types.hpp"
+#include "bit_sequence.hpp"
+#include "block_runner.hpp"
+#include <vector>
+
+namespace binseq {
+
+	/* Column-wise counting over sequences of equal length. The counts of 64
+	columns are kept bit-sliced, plane j holds bit j of every count, and the
+	words of the sequences are folded in with carry-save adders, so each
+	word of input is read once. Word columns are independent and may be
+	spread over a runner. All functions throw std::invalid_argument when no
+	sequence is given or the lengths differ. */
+
+	/* entry i is the number of sequences with bit i set */
+	std::vector<u64> column_counts(const std::vector<const bit_sequence*>&, const block_runner& run = nullptr);
+
+	/* bit i is set when at least k of the sequences have bit i set */
+	bit_sequence threshold(const std::vector<const bit_sequence*>&, u64 k, const block_runner& run = nullptr);
+
+	/* bit i is set when more than half of the sequences have bit i set */
+	bit_sequence majority(const std::vector<const bit_sequence*>&, const block_runner& run = nullptr);
+
+	/* bitwise and, or and xor of all the sequences. The result is built one
+	block of words at a time, every input is folded into the block while it
+	stays in cache, and blocks may be spread over a runner. */
+	bit_sequence reduce_and(const std::vector<const bit_sequence*>&, const block_runner& run = nullptr);
+	bit_sequence reduce_or(const std::vector<const bit_sequence*>&, const block_runner& run = nullptr);
+	bit_sequence reduce_xor(const std::vector<const bit_sequence*>&, const block_runner& run = nullptr);
+
+}
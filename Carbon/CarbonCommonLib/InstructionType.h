@@ -53,6 +53,7 @@ namespace Carbon
 		FUNCTION_OPERATOR,
 		COMMA,
 		VOIDEXPR,
+		CONSTANT, //internal, folded string or binseq copied on every evaluation
 
 		// it is assumed that all types ater ID require string data
 		ID,   
@@ -1,4 +1,5 @@
 #include "AstNodes.h"
+#include <deque>
 
 namespace Carbon
 {
@@ -51,6 +52,10 @@ namespace Carbon
 		case NodeType::String: return "string";
 		case NodeType::DynamicArray: return "array";
 		case NodeType::DynamicObject: return "object";
+		case NodeType::IntegerArray: return "intarray";
+		case NodeType::FloatArray: return "floatarray";
+		case NodeType::SparseBits: return "sparse";
+		case NodeType::BitMatrix: return "bitmatrix";
 		default: throw ExecutorImplementationException("Unhandled nodetype.");
 		}
 	}
@@ -71,22 +76,71 @@ namespace Carbon
 	}
 
 
-	NodeReturn::NodeReturn(std::shared_ptr<Node> value) : Value(value), Node(NodeType::Return) {}
+	NodeReturn::NodeReturn(Ref<Node> value) : Value(value), Node(NodeType::Return) {}
 
 	const char* NodeReturn::GetText() {
 		return "return";
 	}
 
 
+	static std::mutex SymbolSlotMutex;
+	static std::unordered_map<std::string, int> SymbolSlotMap;
+	static std::deque<std::string> SymbolNames;
+
+	int GetSymbolSlot(const std::string& name) {
+		std::lock_guard<std::mutex> lock(SymbolSlotMutex);
+		auto search = SymbolSlotMap.find(name);
+		if (search != SymbolSlotMap.end()) return search->second;
+		int slot = (int)SymbolNames.size();
+		SymbolNames.push_back(name);
+		SymbolSlotMap[name] = slot;
+		return slot;
+	}
+
+	const std::string& GetSymbolName(int slot) {
+		std::lock_guard<std::mutex> lock(SymbolSlotMutex);
+		return SymbolNames[slot];
+	}
+
 	NodeAtom::NodeAtom(const InstructionType type, const char* text) : Node(NodeType::Atom) {
 		this->AtomType = type;
 		this->AtomText = text;
+		this->Slot = type == InstructionType::ID ? GetSymbolSlot(this->AtomText) : -1;
 	}
 
-	Node::Node(const NodeType ntype) {
+	Node::Node(const NodeType ntype) : references(0) {
 		this->Type = ntype;
 	}
 
+	Node::Node(const Node& other) : Type(other.Type), references(0) { }
+
+	Node& Node::operator=(const Node& other) {
+		this->Type = other.Type;
+		return *this;
+	}
+
+	Node::~Node() { }
+
+	void Node::RetainConcurrent() const {
+		references.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void Node::ReleaseSlow() const {
+		if (ConcurrentReferences::Active()) {
+			if (references.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+		} else delete this;
+	}
+
+	bool ConcurrentReferences::active = false;
+
+	ConcurrentReferences::ConcurrentReferences() : owner(!active) {
+		if (owner) active = true;
+	}
+
+	ConcurrentReferences::~ConcurrentReferences() {
+		if (owner) active = false;
+	}
+
 	NodeCommand::NodeCommand(const InstructionType cmd) : Node(NodeType::Command) {
 		this->DoesPushStack = false;
 		this->IsPure = true;
@@ -135,6 +189,7 @@ namespace Carbon
 		case InstructionType::FUNCTION_OPERATOR: return "FUNCTION_OPERATOR";
 		case InstructionType::COMMA: return "COMMA";
 		case InstructionType::VOIDEXPR: return "VOIDEXPR";
+		case InstructionType::CONSTANT: return "CONSTANT";
 		default: {
 			throw ExecutorImplementationException("Unhandled commandtype.");
 		}
@@ -159,52 +214,218 @@ namespace Carbon
 		Value = b;
 	}
 
-	static int NameIdGenerator = 0;
-	static std::unordered_map<std::string, size_t> NameIdMap;
-	static std::unordered_map<size_t, std::string> IdNameMap;
+	// Interned names of object keys. Lookups never lock: each shard is an
+	// open addressing table of entries which are published once and never
+	// changed, a full table is copied into one twice the size and the old
+	// one stays allocated for readers still probing it. Inserts lock only
+	// their shard. Names are found by id through fixed size segments.
+	struct NameEntry {
+		size_t Hash;
+		size_t Id;
+		std::string Name;
+	};
+
+	struct NameTable {
+		size_t Mask;
+		std::unique_ptr<std::atomic<const NameEntry*>[]> Entries;
+		NameTable(size_t size) : Mask(size - 1), Entries(new std::atomic<const NameEntry*>[size]) {
+			for (size_t i = 0; i < size; i++) Entries[i].store(nullptr, std::memory_order_relaxed);
+		}
+	};
+
+	struct NameShard {
+		std::mutex Lock;
+		std::atomic<NameTable*> Table;
+		size_t Count = 0;
+		std::vector<std::unique_ptr<NameTable>> Tables;
+		NameShard() : Table(nullptr) { }
+	};
+
+	static const size_t NameShardCount = 16; // picked by the top 4 bits of the hash
+	static const size_t NameSegmentSize = 4096;
+	static const size_t NameSegmentCount = 4096;
+	static NameShard NameShards[NameShardCount];
+	static std::atomic<std::atomic<const NameEntry*>*> NameSegments[NameSegmentCount];
+	static std::atomic<size_t> NameIdGenerator(0);
+	static std::mutex NameSegmentMutex;
+
+	static const NameEntry* FindName(const NameTable* table, size_t hash, const std::string& name) {
+		if (table == nullptr) return nullptr;
+		for (size_t i = hash;; i++) {
+			auto entry = table->Entries[i & table->Mask].load(std::memory_order_acquire);
+			if (entry == nullptr) return nullptr;
+			if (entry->Hash == hash && entry->Name == name) return entry;
+		}
+	}
+
+	static void PlaceName(NameTable& table, const NameEntry* entry) {
+		size_t i = entry->Hash;
+		while (table.Entries[i & table.Mask].load(std::memory_order_relaxed) != nullptr) i++;
+		table.Entries[i & table.Mask].store(entry, std::memory_order_release);
+	}
+
+	static NameShard& ShardOf(size_t hash) {
+		// the high bits pick the shard, the low bits the place in its table
+		return NameShards[hash >> (sizeof(size_t) * 8 - 4)];
+	}
+
+	static void PublishName(const NameEntry* entry) {
+		size_t segment = entry->Id / NameSegmentSize;
+		if (segment >= NameSegmentCount) throw ExecutorRuntimeException("too many different object key names");
+		{
+			std::lock_guard<std::mutex> lock(NameSegmentMutex);
+			if (NameSegments[segment].load(std::memory_order_relaxed) == nullptr) {
+				auto entries = new std::atomic<const NameEntry*>[NameSegmentSize];
+				for (size_t i = 0; i < NameSegmentSize; i++) entries[i].store(nullptr, std::memory_order_relaxed);
+				NameSegments[segment].store(entries, std::memory_order_release);
+			}
+		}
+		NameSegments[segment].load(std::memory_order_acquire)[entry->Id % NameSegmentSize].store(entry, std::memory_order_release);
+	}
+
+	static std::mutex ShapeMutex;
+	static std::atomic<unsigned> ShapeIdGenerator(0);
+
+	ObjectShape::ObjectShape(std::vector<size_t>&& keys) : Id(++ShapeIdGenerator), Keys(std::move(keys)), lastTransition(nullptr)
+	{
+		for (size_t i = 0; i < Keys.size(); i++) {
+			slots[Keys[i]] = (int)i;
+		}
+	}
+
+	int ObjectShape::Find(size_t nameId) const
+	{
+		// small shapes are faster to scan than to hash
+		if (Keys.size() <= 8) {
+			for (size_t i = 0; i < Keys.size(); i++) {
+				if (Keys[i] == nameId) return (int)i;
+			}
+			return -1;
+		}
+		auto search = slots.find(nameId);
+		return search == slots.end() ? -1 : search->second;
+	}
+
+	const ObjectShape* ObjectShape::With(size_t nameId) const
+	{
+		// objects built the same way take the same transition every time
+		auto last = lastTransition.load(std::memory_order_acquire);
+		if (last != nullptr && last->Keys.back() == nameId) return last;
+		std::lock_guard<std::mutex> lock(ShapeMutex);
+		auto& next = transitions[nameId];
+		if (next == nullptr) {
+			auto keys = Keys;
+			keys.push_back(nameId);
+			next = new ObjectShape(std::move(keys));
+		}
+		lastTransition.store(next, std::memory_order_release);
+		return next;
+	}
+
+	const ObjectShape* ObjectShape::Empty()
+	{
+		static const ObjectShape* empty = new ObjectShape(std::vector<size_t>());
+		return empty;
+	}
 
 	std::vector<std::string> NodeObject::GetAttributeKeys()
 	{
 		std::vector<std::string> result;
-		for (auto id : this->Map) {
-			result.push_back(IdNameMap[id.first]);
+		for (auto id : Shape->Keys) {
+			result.push_back(GetName(id));
+		}
+		if (Dynamic) {
+			for (auto& entry : *Dynamic) {
+				result.push_back(entry.first);
+			}
 		}
 		return result;
 	}
 
-	void NodeObject::SetAttributeValue(const std::string & byName, std::shared_ptr<Node> value)
+	void NodeObject::SetAttributeValue(const std::string & byName, Ref<Node> value)
+	{
+		auto id = FindNameId(byName);
+		if (id != 0) {
+			SetAttributeValue(id, std::move(value));
+			return;
+		}
+		if (!Dynamic) Dynamic.reset(new std::unordered_map<std::string, Ref<Node>>());
+		(*Dynamic)[byName] = std::move(value);
+	}
+
+	int NodeObject::SetAttributeValue(const size_t byNameId, Ref<Node> value)
 	{
-		SetAttributeValue(GetNameId(byName), value);
+		int slot = Shape->Find(byNameId);
+		if (slot < 0) {
+			// the name may have been set from a string before it was interned
+			if (Dynamic) Dynamic->erase(GetName(byNameId));
+			Shape = Shape->With(byNameId);
+			slot = (int)Values.size();
+			Values.push_back(std::move(value));
+		}
+		else {
+			Values[slot] = std::move(value);
+		}
+		return slot;
 	}
 
-	void NodeObject::SetAttributeValue(const size_t byNameId, std::shared_ptr<Node> value)
+	Ref<Node> NodeObject::GetAttributeValue(const std::string & byName)
 	{
-		this->Map[byNameId] = value;
+		auto id = FindNameId(byName);
+		int slot = id != 0 ? Shape->Find(id) : -1;
+		if (slot >= 0) return Values[slot];
+		if (!Dynamic) return nullptr;
+		auto search = Dynamic->find(byName);
+		return search == Dynamic->end() ? nullptr : search->second;
 	}
 
-	std::shared_ptr<Node> NodeObject::GetAttributeValue(const std::string & byName)
+	Ref<Node> NodeObject::GetAttributeValue(const size_t byNameId)
 	{
-		return GetAttributeValue(GetNameId(byName));
+		int slot = Shape->Find(byNameId);
+		if (slot >= 0) return Values[slot];
+		return Dynamic ? GetAttributeValue(GetName(byNameId)) : nullptr;
 	}
 
-	std::shared_ptr<Node> NodeObject::GetAttributeValue(const size_t byNameId)
+	size_t NodeObject::FindNameId(const std::string & name)
 	{
-		return this->Map[byNameId];
+		size_t hash = std::hash<std::string>()(name);
+		auto entry = FindName(ShardOf(hash).Table.load(std::memory_order_acquire), hash, name);
+		return entry == nullptr ? 0 : entry->Id;
 	}
 
 	size_t NodeObject::GetNameId(const std::string & name)
 	{
-		size_t id;
-		auto search = NameIdMap.find(name);
-		if (search == NameIdMap.end()) {
-			id = ++NameIdGenerator;
-			NameIdMap[name] = id;
-			IdNameMap[id] = name;
-		}
-		else {
-			id = search->second;
+		size_t hash = std::hash<std::string>()(name);
+		auto& shard = ShardOf(hash);
+		auto entry = FindName(shard.Table.load(std::memory_order_acquire), hash, name);
+		if (entry != nullptr) return entry->Id;
+		std::lock_guard<std::mutex> lock(shard.Lock);
+		auto table = shard.Table.load(std::memory_order_relaxed);
+		entry = FindName(table, hash, name);
+		if (entry != nullptr) return entry->Id;
+		auto created = new NameEntry{ hash, ++NameIdGenerator, name };
+		PublishName(created);
+		if (table == nullptr || (shard.Count + 1) * 2 > table->Mask + 1) {
+			auto grown = new NameTable(table == nullptr ? 64 : (table->Mask + 1) * 2);
+			if (table != nullptr) {
+				for (size_t i = 0; i <= table->Mask; i++) {
+					auto moved = table->Entries[i].load(std::memory_order_relaxed);
+					if (moved != nullptr) PlaceName(*grown, moved);
+				}
+			}
+			shard.Tables.emplace_back(grown);
+			shard.Table.store(grown, std::memory_order_release);
+			table = grown;
 		}
-		return id;
+		PlaceName(*table, created);
+		shard.Count++;
+		return created->Id;
+	}
+
+	const std::string& NodeObject::GetName(size_t id)
+	{
+		auto segment = NameSegments[id / NameSegmentSize].load(std::memory_order_acquire);
+		return segment[id % NameSegmentSize].load(std::memory_order_acquire)->Name;
 	}
 
 	const char* NodeObject::GetText() {
@@ -215,7 +436,9 @@ namespace Carbon
 		return "array";
 	}
 
-	NodeObject::NodeObject() :Node(NodeType::DynamicObject) {};
+	NodeObject::NodeObject() :Node(NodeType::DynamicObject), Shape(ObjectShape::Empty()) {};
+
+	NodeObject::NodeObject(const ObjectShape* shape) : Node(NodeType::DynamicObject), Shape(shape), Values(shape->Keys.size()) {};
 
 
 
@@ -225,14 +448,46 @@ namespace Carbon
 
 	NodeArray::NodeArray() : Node(NodeType::DynamicArray) { }
 
-	NodeArray::NodeArray(const std::vector<std::shared_ptr<Node>>& vec) : Node(NodeType::DynamicArray) {
+	NodeArray::NodeArray(const std::vector<Ref<Node>>& vec) : Node(NodeType::DynamicArray) {
 		Vector = vec;
 	};
 
-	NodeArray::NodeArray(std::vector<std::shared_ptr<Node>>&& vec) :Node(NodeType::DynamicArray) {
+	NodeArray::NodeArray(std::vector<Ref<Node>>&& vec) :Node(NodeType::DynamicArray) {
 		Vector = vec;
 	};
 
+	const char* NodeIntegerArray::GetText() {
+		return "intarray";
+	}
+
+	NodeIntegerArray::NodeIntegerArray() : Node(NodeType::IntegerArray) { }
+
+	NodeIntegerArray::NodeIntegerArray(size_t size) : Node(NodeType::IntegerArray), Vector(size) { }
+
+	NodeIntegerArray::NodeIntegerArray(std::vector<long long>&& vec) : Node(NodeType::IntegerArray), Vector(std::move(vec)) { }
+
+	const char* NodeFloatArray::GetText() {
+		return "floatarray";
+	}
+
+	NodeFloatArray::NodeFloatArray() : Node(NodeType::FloatArray) { }
+
+	NodeFloatArray::NodeFloatArray(size_t size) : Node(NodeType::FloatArray), Vector(size) { }
+
+	NodeFloatArray::NodeFloatArray(std::vector<double>&& vec) : Node(NodeType::FloatArray), Vector(std::move(vec)) { }
+
+	const char* NodeSparseBits::GetText() {
+		return "sparse";
+	}
+
+	NodeSparseBits::NodeSparseBits(binseq::sparse_sequence&& s) : Node(NodeType::SparseBits), Value(std::move(s)) { }
+
+	const char* NodeBitMatrix::GetText() {
+		return "bitmatrix";
+	}
+
+	NodeBitMatrix::NodeBitMatrix(binseq::bit_matrix&& m) : Node(NodeType::BitMatrix), Value(std::move(m)) { }
+
 	NodeStructureFactory::NodeStructureFactory(): Node(NodeType::StrctureFactory) { }
 
 	const char* NodeStructureFactory::GetText()
@@ -3,7 +3,12 @@
 #include <memory>
 #include <vector>
 #include "../BinseqLib/bit_sequence.hpp"
+#include "../BinseqLib/sparse_sequence.hpp"
+#include "../BinseqLib/bit_matrix.hpp"
 #include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
 #include "ExecutorException.h"
 
 
@@ -28,12 +33,31 @@ namespace Carbon
 		Function,
 		DynamicArray,
 		DynamicObject,
+		IntegerArray,
+		FloatArray,
+		SparseBits,
+		BitMatrix,
 		StrctureFactory
 	};
 	
 	// get a displayable type text for a NodeType
 	const char* GetTypeText(NodeType nodetype);
 
+	// variable names are numbered once when the tree is built, the executor
+	// keeps the innermost binding of every name in an array by this slot
+	int GetSymbolSlot(const std::string& name);
+	const std::string& GetSymbolName(int slot);
+
+	class BytecodeChunk;
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define CARBON_ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+	#define CARBON_ALWAYS_INLINE __forceinline
+#else
+	#define CARBON_ALWAYS_INLINE inline
+#endif
+
 	class Node {
 	public:
 		bool IsNone() const;
@@ -46,17 +70,97 @@ namespace Carbon
 		virtual InstructionType GetAtomType();
 		virtual const char* GetAtomText(); //get parsed text    
 		Node(const NodeType);
+		Node(const Node& other); // the copy starts without references
+		Node& operator=(const Node& other);
+		virtual ~Node();
+		void Retain() const;
+		void Release() const;
 	protected:
 		NodeType Type;
+	private:
+		mutable std::atomic<long> references;
+		void RetainConcurrent() const;
+		void ReleaseSlow() const;
 	};
 
+	// Reference counts are plain increments while one thread runs the
+	// script. Holding one of these makes every count update atomic, it has
+	// to be taken before worker threads get to copy or drop references and
+	// kept until they are done. Only the outermost one switches the mode, so
+	// the flag never changes while workers read it.
+	class ConcurrentReferences {
+	public:
+		ConcurrentReferences();
+		~ConcurrentReferences();
+		static bool Active() { return active; }
+	private:
+		static bool active;
+		bool owner;
+	};
+
+	CARBON_ALWAYS_INLINE void Node::Retain() const {
+		if (ConcurrentReferences::Active()) RetainConcurrent();
+		else references.store(references.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// the last reference and concurrent updates take the call, the rest is
+	// small enough to be inlined everywhere
+	CARBON_ALWAYS_INLINE void Node::Release() const {
+		long left = references.load(std::memory_order_relaxed) - 1;
+		if (left == 0 || ConcurrentReferences::Active()) ReleaseSlow();
+		else references.store(left, std::memory_order_relaxed);
+	}
+
+	// Owning handle of a node, the count is kept in the node itself.
+	// Functions which only look at a node take it by const reference.
+	template <typename T> class Ref {
+	public:
+		Ref() : pointer(nullptr) { }
+		Ref(std::nullptr_t) : pointer(nullptr) { }
+		explicit Ref(T* node) : pointer(node) { if (pointer) pointer->Retain(); }
+		Ref(const Ref& other) : pointer(other.pointer) { if (pointer) pointer->Retain(); }
+		Ref(Ref&& other) noexcept : pointer(other.pointer) { other.pointer = nullptr; }
+		template <typename U> Ref(const Ref<U>& other) : pointer(other.get()) { if (pointer) pointer->Retain(); }
+		template <typename U> Ref(Ref<U>&& other) noexcept : pointer(other.release()) { }
+		~Ref() { if (pointer) pointer->Release(); }
+		Ref& operator=(const Ref& other) { Ref(other).swap(*this); return *this; }
+		Ref& operator=(Ref&& other) noexcept { Ref(std::move(other)).swap(*this); return *this; }
+		Ref& operator=(std::nullptr_t) { reset(); return *this; }
+		T* get() const { return pointer; }
+		T& operator*() const { return *pointer; }
+		T* operator->() const { return pointer; }
+		explicit operator bool() const { return pointer != nullptr; }
+		void reset() { Ref().swap(*this); }
+		void swap(Ref& other) noexcept { std::swap(pointer, other.pointer); }
+		// gives up the reference without releasing it
+		T* release() { T* node = pointer; pointer = nullptr; return node; }
+	private:
+		T* pointer;
+	};
+
+	template <typename T, typename U> inline bool operator==(const Ref<T>& a, const Ref<U>& b) { return a.get() == b.get(); }
+	template <typename T, typename U> inline bool operator!=(const Ref<T>& a, const Ref<U>& b) { return a.get() != b.get(); }
+	template <typename T> inline bool operator==(const Ref<T>& a, std::nullptr_t) { return a.get() == nullptr; }
+	template <typename T> inline bool operator!=(const Ref<T>& a, std::nullptr_t) { return a.get() != nullptr; }
+	template <typename T> inline bool operator==(std::nullptr_t, const Ref<T>& a) { return a.get() == nullptr; }
+	template <typename T> inline bool operator!=(std::nullptr_t, const Ref<T>& a) { return a.get() != nullptr; }
+
+	template <typename T, typename... TArgs> inline Ref<T> MakeNode(TArgs&&... args) {
+		return Ref<T>(new T(std::forward<TArgs>(args)...));
+	}
+
+	template <typename T, typename U> inline Ref<T> StaticCast(const Ref<U>& node) {
+		return Ref<T>(static_cast<T*>(node.get()));
+	}
+
 	// a native function receives a vector of nodes and retursn another node
-	typedef std::shared_ptr<Node>(*native_function_ptr)(std::vector<std::shared_ptr<Node>>& node);
+	typedef Ref<Node>(*native_function_ptr)(std::vector<Ref<Node>>& node);
 
 	class NodeAtom : public Node {
 	public:
 		InstructionType AtomType;
 		std::string AtomText;
+		int Slot; // of the name for identifiers, -1 otherwise
 		NodeAtom(const InstructionType type, const char* text);
 		virtual const char* GetText() override;
 		virtual InstructionType GetAtomType() override;
@@ -75,11 +179,17 @@ namespace Carbon
 		bool Native;
 		bool Pure;
 		NodeFunction(native_function_ptr nativeptr, bool pure);
-		NodeFunction(std::vector<std::string> parameterList, std::shared_ptr<Node> impl);
+		NodeFunction(std::vector<std::string> parameterList, Ref<Node> impl);
 		native_function_ptr nativeptr;
 		bool InternalNative;
+		// type every call of a native returns, None when it depends on the arguments
+		NodeType Result;
 		std::vector<std::string> ParameterList;
-		std::shared_ptr<Node> Implementation;
+		std::vector<int> ParameterSlots;
+		Ref<Node> Implementation;
+		// compiled body, filled in on the first call
+		std::shared_ptr<BytecodeChunk> Bytecode;
+		std::once_flag BytecodeOnce;
 		virtual const char* GetText() override;
 	};
 
@@ -100,25 +210,97 @@ namespace Carbon
 	};
 	class NodeArray : public Node {
 	public:
-		std::vector<std::shared_ptr<Node>> Vector;
+		std::vector<Ref<Node>> Vector;
 		virtual const char* GetText() override;
 		NodeArray();
 		NodeArray(int size);
-		NodeArray(const std::vector<std::shared_ptr<Node>>& vec);
-		NodeArray(std::vector<std::shared_ptr<Node>>&& vec);
+		NodeArray(const std::vector<Ref<Node>>& vec);
+		NodeArray(std::vector<Ref<Node>>&& vec);
+	};
+
+	// packed array of integers, used by natives which produce or consume bulk numeric data
+	class NodeIntegerArray : public Node {
+	public:
+		std::vector<long long> Vector;
+		virtual const char* GetText() override;
+		NodeIntegerArray();
+		NodeIntegerArray(size_t size);
+		NodeIntegerArray(std::vector<long long>&& vec);
+	};
+
+	// packed array of doubles, spectra and other numeric results stay out of nodes
+	class NodeFloatArray : public Node {
+	public:
+		std::vector<double> Vector;
+		virtual const char* GetText() override;
+		NodeFloatArray();
+		NodeFloatArray(size_t size);
+		NodeFloatArray(std::vector<double>&& vec);
+	};
+
+	// compressed binseq for mostly empty or mostly full sequences
+	class NodeSparseBits : public Node {
+	public:
+		binseq::sparse_sequence Value;
+		virtual const char* GetText() override;
+		NodeSparseBits(binseq::sparse_sequence&& s);
+	};
+
+	// dense matrix over GF(2)
+	class NodeBitMatrix : public Node {
+	public:
+		binseq::bit_matrix Value;
+		virtual const char* GetText() override;
+		NodeBitMatrix(binseq::bit_matrix&& m);
+	};
+
+	// Layout shared by every object which got the same keys in the same
+	// order. Adding a key moves an object along a transition to the next
+	// shape, shapes are never freed so ids and slots stay valid for good.
+	class ObjectShape {
+	public:
+		const unsigned Id;
+		const std::vector<size_t> Keys; // name id of every slot in order
+		// slot of the name or -1
+		int Find(size_t nameId) const;
+		// shape with the name appended as the last slot
+		const ObjectShape* With(size_t nameId) const;
+		// shape of a new object, without keys
+		static const ObjectShape* Empty();
+	private:
+		std::unordered_map<size_t, int> slots;
+		mutable std::unordered_map<size_t, const ObjectShape*> transitions;
+		mutable std::atomic<const ObjectShape*> lastTransition;
+		ObjectShape(std::vector<size_t>&& keys);
 	};
 
 	class NodeObject : public Node {
-		std::unordered_map<size_t, std::shared_ptr<Node>> Map;
+		const ObjectShape* Shape;
+		std::vector<Ref<Node>> Values;
+		// keys set from strings which were never interned, kept out of the
+		// shapes so computed keys do not grow the name table
+		std::unique_ptr<std::unordered_map<std::string, Ref<Node>>> Dynamic;
 	public:
 		std::vector<std::string> GetAttributeKeys();
-		void SetAttributeValue(const std::string & byName, std::shared_ptr<Node> value);
-		void SetAttributeValue(const size_t byNameId, std::shared_ptr<Node> value);
-		std::shared_ptr<Node> GetAttributeValue(const std::string& byName);
-		std::shared_ptr<Node> GetAttributeValue(const size_t byNameId);
+		void SetAttributeValue(const std::string & byName, Ref<Node> value);
+		// returns the slot which holds the value now
+		int SetAttributeValue(const size_t byNameId, Ref<Node> value);
+		// null for names the object does not have
+		Ref<Node> GetAttributeValue(const std::string& byName);
+		Ref<Node> GetAttributeValue(const size_t byNameId);
+		// id of the name, interned on first use, safe from any thread
 		static size_t GetNameId(const std::string& name);
+		// id of the name or 0 when it was never interned
+		static size_t FindNameId(const std::string& name);
+		static const std::string& GetName(size_t nameId);
+		// direct slot access for callers which already checked the shape
+		const ObjectShape& GetShape() const { return *Shape; }
+		const Ref<Node>& GetSlotValue(int slot) const { return Values[slot]; }
+		void SetSlotValue(int slot, Ref<Node>&& value) { Values[slot] = std::move(value); }
 		virtual const char* GetText() override;
 		NodeObject();
+		// every slot of the shape starts out null
+		NodeObject(const ObjectShape* shape);
 	};
 
 	class NodeBit : public Node {
@@ -139,7 +321,7 @@ namespace Carbon
 	class NodeCommand : public Node {
 	public:
 		InstructionType CommandType;
-		std::vector<std::shared_ptr<Node>> Children;
+		std::vector<Ref<Node>> Children;
 		NodeCommand(const InstructionType);
 		virtual const char* GetText() override;
 		virtual InstructionType GetCommandType() override;
@@ -149,8 +331,8 @@ namespace Carbon
 
 	class NodeReturn : public Node {
 	public:
-		std::shared_ptr<Node> Value;
-		NodeReturn(std::shared_ptr<Node> return_value);
+		Ref<Node> Value;
+		NodeReturn(Ref<Node> return_value);
 		virtual const char* GetText() override;
 	};
 
@@ -159,7 +341,7 @@ namespace Carbon
 		bool IsArrayFactory = false;
 		bool IsObjectFactory = false;
 		NodeStructureFactory();
-		std::vector<std::shared_ptr<Node>> Expressions;
+		std::vector<Ref<Node>> Expressions;
 		std::vector<size_t> KeysIds;
 		virtual const char* GetText() override;
 	};
@@ -0,0 +1,528 @@
+#include "Bytecode.h"
+#include <mutex>
+
+namespace Carbon
+{
+	// true when evaluating the node may call a function, calls inherit the
+	// local mode flag so it has to be set for real around such expressions
+	static bool ContainsCall(const Ref<Node>& node) {
+		if (node->IsCommand()) {
+			auto& command = reinterpret_cast<NodeCommand&>(*node);
+			if (command.CommandType == InstructionType::CALL) return true;
+			for (auto& child : command.Children) {
+				if (ContainsCall(child)) return true;
+			}
+		} else if (node->GetNodeType() == NodeType::StrctureFactory) {
+			auto& factory = reinterpret_cast<NodeStructureFactory&>(*node);
+			for (auto& expression : factory.Expressions) {
+				if (ContainsCall(expression)) return true;
+			}
+		}
+		return false;
+	}
+
+	static bool IsEmptyBlock(const Ref<Node>& node) {
+		return node->IsCommand() && node->GetCommandType() == InstructionType::BLOCK
+			&& reinterpret_cast<NodeCommand&>(*node).Children.empty();
+	}
+
+	BytecodeCompiler::BytecodeCompiler(BytecodeChunk& chunk, bool isFunction)
+		: chunk(chunk), isFunction(isFunction) { }
+
+	std::shared_ptr<BytecodeChunk> BytecodeCompiler::CompileStatement(const Ref<Node>& statement) {
+		auto chunk = std::make_shared<BytecodeChunk>();
+		BytecodeCompiler(*chunk, false).CompileRoot(statement);
+		return chunk;
+	}
+
+	const BytecodeChunk& BytecodeCompiler::FunctionBody(NodeFunction& function, const Pass& pass, FILE* dump) {
+		std::call_once(function.BytecodeOnce, [&function, &pass, dump]() {
+			auto chunk = std::make_shared<BytecodeChunk>();
+			BytecodeCompiler compiler(*chunk, true);
+			for (int slot : function.ParameterSlots) compiler.Slot(slot);
+			compiler.CompileRoot(function.Implementation);
+			if (dump != nullptr) chunk->Disassemble(dump);
+			if (pass) pass(*chunk);
+			function.Bytecode = chunk;
+		});
+		return *function.Bytecode;
+	}
+
+	void BytecodeCompiler::CompileRoot(const Ref<Node>& node) {
+		int result = Allocate();
+		Compile(node, result);
+		Emit(OpCode::Return, result);
+	}
+
+	int BytecodeCompiler::Allocate() {
+		int reg = top++;
+		if (top > chunk.RegisterCount) chunk.RegisterCount = top;
+		return reg;
+	}
+
+	int BytecodeCompiler::Emit(OpCode op, int a, int b, int c, InstructionType type) {
+		chunk.Code.push_back(Instruction{ op, type, false, a, b, c });
+		return (int)chunk.Code.size() - 1;
+	}
+
+	void BytecodeCompiler::PatchTarget(int at) {
+		chunk.Code[at].B = (int)chunk.Code.size();
+	}
+
+	int BytecodeCompiler::Constant(const Ref<Node>& value) {
+		chunk.Constants.push_back(value);
+		return (int)chunk.Constants.size() - 1;
+	}
+
+	int BytecodeCompiler::Slot(int slot) {
+		if (slot >= chunk.SlotCount) chunk.SlotCount = slot + 1;
+		return slot;
+	}
+
+	int BytecodeCompiler::Message(const char* text) {
+		for (size_t i = 0; i < chunk.Messages.size(); i++) {
+			if (chunk.Messages[i] == text) return (int)i;
+		}
+		chunk.Messages.push_back(text);
+		return (int)chunk.Messages.size() - 1;
+	}
+
+	void BytecodeCompiler::EmitThrow(int dst, const char* message, bool implementation) {
+		Emit(OpCode::Throw, dst, Message(message), implementation ? 1 : 0);
+	}
+
+	void BytecodeCompiler::EmitReturn(int dst) {
+		if (!isFunction) Emit(OpCode::MakeReturn, dst, dst);
+		Emit(OpCode::Return, dst);
+	}
+
+	// break and continue leave the scopes opened since the loop started, outside
+	// of a loop the tree walker handed the marker node back as the result
+	void BytecodeCompiler::EmitJumpOut(bool isBreak, int dst) {
+		if (loops.empty()) {
+			Emit(OpCode::LoadConstant, dst, Constant(MakeNode<Node>(isBreak ? NodeType::Break : NodeType::Continue)));
+			Emit(OpCode::Return, dst);
+			return;
+		}
+		auto& loop = loops.back();
+		if (scopeDepth > loop.ScopeDepth) Emit(OpCode::PopScope, scopeDepth - loop.ScopeDepth);
+		int jump = Emit(OpCode::Jump);
+		if (isBreak) loop.Breaks.push_back(jump);
+		else loop.Continues.push_back(jump);
+	}
+
+	template <typename TBody>
+	void BytecodeCompiler::WithMode(LookupMode newMode, bool hasCalls, TBody body) {
+		auto savedMode = mode, savedFlag = flag;
+		int saved = -1;
+		if (hasCalls && flag != newMode) {
+			saved = Allocate();
+			Emit(OpCode::SetMode, saved, newMode == LookupMode::Local ? 1 : 0);
+			flag = newMode;
+		}
+		mode = newMode;
+		body();
+		if (saved >= 0) {
+			Emit(OpCode::RestoreMode, saved);
+			top = saved;
+		}
+		mode = savedMode;
+		flag = savedFlag;
+	}
+
+	void BytecodeCompiler::Compile(const Ref<Node>& node, int dst) {
+		switch (node->GetNodeType()) {
+			case NodeType::Command:
+				CompileCommand(reinterpret_cast<NodeCommand&>(*node), dst);
+				break;
+			case NodeType::Atom: {
+				auto& atom = reinterpret_cast<NodeAtom&>(*node);
+				if (atom.AtomType == InstructionType::ID)
+					Emit(OpCode::GetVariable, dst, Slot(atom.Slot), (int)mode);
+				else
+					Emit(OpCode::LoadConstant, dst, Constant(node));
+				break;
+			}
+			case NodeType::StrctureFactory:
+				CompileStructure(reinterpret_cast<NodeStructureFactory&>(*node), dst);
+				break;
+			default:
+				Emit(OpCode::LoadConstant, dst, Constant(node));
+				break;
+		}
+	}
+
+	void BytecodeCompiler::CompileCommand(NodeCommand& node, int dst) {
+		if (node.DoesPushStack) {
+			Emit(OpCode::PushScope);
+			scopeDepth++;
+		}
+		switch (node.CommandType) {
+			case InstructionType::ADD:
+			case InstructionType::SUBTRACT:
+			case InstructionType::MULTIPLY:
+			case InstructionType::DIVIDE:
+			case InstructionType::COMP_EQ:
+			case InstructionType::COMP_NE:
+			case InstructionType::COMP_LE:
+			case InstructionType::COMP_GE:
+			case InstructionType::COMP_LT:
+			case InstructionType::COMP_GT:
+				CompileInfix(node, dst);
+				break;
+			case InstructionType::NEGATIVE:
+			case InstructionType::POSITIVE:
+				if (node.Children.size() == 1) {
+					Compile(node.Children[0], dst);
+					Emit(OpCode::Prefix, dst, dst, 0, node.CommandType);
+				} else EmitThrow(dst, "Prefix op can only have 1 child.", true);
+				break;
+			case InstructionType::ASSIGN:
+				CompileAssignment(node, dst);
+				break;
+			case InstructionType::CONSTANT:
+				Emit(OpCode::CopyConstant, dst, Constant(node.Children[0]));
+				break;
+			case InstructionType::MEMBER:
+				CompileMember(node, dst);
+				break;
+			case InstructionType::CALL:
+				CompileCall(node, dst);
+				break;
+			case InstructionType::BLOCK:
+				CompileSequence(node.Children, dst);
+				break;
+			case InstructionType::LOCAL:
+				CompileLocal(node, dst);
+				break;
+			case InstructionType::LOOP0:
+			case InstructionType::LOOP1:
+			case InstructionType::LOOP2:
+			case InstructionType::LOOP3:
+				CompileLoop(node, dst);
+				break;
+			case InstructionType::IF:
+			case InstructionType::IFELSE:
+				CompileConditional(node, dst);
+				break;
+			case InstructionType::BREAK:
+				EmitJumpOut(true, dst);
+				break;
+			case InstructionType::CONTINUE:
+				EmitJumpOut(false, dst);
+				break;
+			case InstructionType::RETURN0:
+				Emit(OpCode::LoadConstant, dst, Constant(MakeNode<Node>(NodeType::None)));
+				EmitReturn(dst);
+				break;
+			case InstructionType::RETURN1:
+				CompileSequence(node.Children, dst);
+				EmitReturn(dst);
+				break;
+			case InstructionType::BLOCKBEGIN:
+			case InstructionType::BLOCKEND:
+			case InstructionType::CALLBEGIN:
+			case InstructionType::CALLEND:
+			case InstructionType::END_STATEMENT:
+				EmitThrow(dst, "should have been processed", true);
+				break;
+			case InstructionType::COMMA:
+				EmitThrow(dst, "the \",\" operator  should only be used for separating function parameters", true);
+				break;
+			default:
+				EmitThrow(dst, "unhandled case", true);
+				break;
+		}
+		if (node.DoesPushStack) {
+			scopeDepth--;
+			Emit(OpCode::PopScope, 1);
+		}
+	}
+
+	// statements of a block in order, the value is the one of the last statement
+	void BytecodeCompiler::CompileSequence(const std::vector<Ref<Node>>& nodes, int dst) {
+		if (nodes.empty()) {
+			Emit(OpCode::LoadConstant, dst, Constant(MakeNode<Node>(NodeType::None)));
+			return;
+		}
+		for (auto& node : nodes) {
+			Compile(node, dst);
+		}
+	}
+
+	// operands go to consecutive registers, the executor reads them as a range
+	void BytecodeCompiler::CompileInfix(NodeCommand& node, int dst) {
+		if (node.Children.size() < 2) {
+			EmitThrow(dst, "arithmetic operators need to have at least 2 arguments", true);
+			return;
+		}
+		int base = top;
+		for (auto& child : node.Children) {
+			Compile(child, Allocate());
+		}
+		Emit(OpCode::Arithmetic, dst, base, (int)node.Children.size(), node.CommandType);
+		top = base;
+	}
+
+	void BytecodeCompiler::CompileMember(NodeCommand& node, int dst) {
+		if (node.Children.size() != 2) {
+			EmitThrow(dst, "Member operator requires 2 parameters.", true);
+			return;
+		}
+		Compile(node.Children[0], dst);
+		auto& name = node.Children[1];
+		if (name->GetNodeType() == NodeType::Atom) {
+			chunk.Members.emplace_back(NodeObject::GetNameId(reinterpret_cast<NodeAtom&>(*name).AtomText));
+			Emit(OpCode::GetMember, dst, dst, (int)chunk.Members.size() - 1);
+		} else EmitThrow(dst, "right side of an object member operator must be an identifier", false);
+	}
+
+	// the value is evaluated first with the local mode off, then stored in
+	// the target resolved with the mode of the surrounding expression
+	void BytecodeCompiler::CompileAssignment(NodeCommand& node, int dst) {
+		if (node.Children.size() != 2) {
+			EmitThrow(dst, "Assignment requires 2 parameters.", true);
+			return;
+		}
+		auto& value = node.Children[1];
+		WithMode(LookupMode::Search, ContainsCall(value), [&]() { Compile(value, dst); });
+
+		Node* target = &*node.Children[0];
+		bool isLocal = false;
+		if (target->IsCommand() && target->GetCommandType() == InstructionType::LOCAL) {
+			target = &*reinterpret_cast<NodeCommand*>(target)->Children[0];
+			isLocal = true;
+		}
+		if (target->GetNodeType() == NodeType::Atom) {
+			int name = Slot(reinterpret_cast<NodeAtom*>(target)->Slot);
+			if (isLocal) Emit(OpCode::SetLocal, dst, name);
+			else Emit(OpCode::SetVariable, dst, name, (int)mode);
+		} else if (target->IsCommand() && target->GetCommandType() == InstructionType::MEMBER) {
+			auto& member = reinterpret_cast<NodeCommand&>(*target);
+			int container = Allocate();
+			Compile(member.Children[0], container);
+			auto& index = member.Children[1];
+			if (index->GetNodeType() == NodeType::Atom) {
+				chunk.Members.emplace_back(NodeObject::GetNameId(reinterpret_cast<NodeAtom&>(*index).AtomText));
+				Emit(OpCode::SetMember, dst, container, (int)chunk.Members.size() - 1);
+			} else EmitThrow(dst, "right side of member oeprator is not an identifier", false);
+			top = container;
+		} else if (target->IsCommand()) {
+			EmitThrow(dst, "left side of an assignment must be an identifier", false);
+		} else EmitThrow(dst, "Unspecified node type.", true);
+	}
+
+	void BytecodeCompiler::CompileLocal(NodeCommand& node, int dst) {
+		bool hasCalls = false;
+		for (auto& child : node.Children) hasCalls = hasCalls || ContainsCall(child);
+		WithMode(LookupMode::Local, hasCalls, [&]() { CompileSequence(node.Children, dst); });
+	}
+
+	// the function goes to the first register, arguments to the ones after it
+	void BytecodeCompiler::CompileCall(NodeCommand& node, int dst) {
+		int base = top;
+		int function = Allocate();
+		auto& callee = node.Children[0];
+		if (callee->GetNodeType() == NodeType::Atom) {
+			Emit(OpCode::GetFunction, function, Slot(reinterpret_cast<NodeAtom&>(*callee).Slot), (int)mode);
+		} else if (callee->GetNodeType() == NodeType::Function) {
+			Emit(OpCode::LoadConstant, function, Constant(callee));
+		} else {
+			EmitThrow(dst, "parameter is not a function", false);
+			top = base;
+			return;
+		}
+		for (size_t i = 1; i < node.Children.size(); i++) {
+			Compile(node.Children[i], Allocate());
+		}
+		Emit(OpCode::Call, dst, function, (int)node.Children.size() - 1);
+		top = base;
+	}
+
+	void BytecodeCompiler::CompileConditional(NodeCommand& node, int dst) {
+		Compile(node.Children[0], dst);
+		int skip = Emit(OpCode::JumpIfFalse, dst, 0, Message("condition is not a bit"));
+		Compile(node.Children[1], dst);
+		int end = Emit(OpCode::Jump);
+		PatchTarget(skip);
+		if (node.Children.size() == 3) Compile(node.Children[2], dst);
+		else Emit(OpCode::LoadConstant, dst, Constant(MakeNode<Node>(NodeType::None)));
+		PatchTarget(end);
+	}
+
+	void BytecodeCompiler::CompileLoop(NodeCommand& node, int dst) {
+		Ref<Node> init, cond, iterate, body;
+		switch (node.Children.size()) {
+			case 1:
+				body = node.Children[0];
+				break;
+			case 2:
+				cond = node.Children[0];
+				body = node.Children[1];
+				break;
+			case 3:
+				cond = node.Children[0];
+				iterate = node.Children[1];
+				body = node.Children[2];
+				break;
+			case 4:
+				init = node.Children[0];
+				cond = node.Children[1];
+				iterate = node.Children[2];
+				body = node.Children[3];
+				break;
+			default:
+				EmitThrow(dst, "loop expects 1 or 2 or 3 or 4 children", true);
+				return;
+		}
+
+		if (init != nullptr) Compile(init, dst);
+		int start = (int)chunk.Code.size();
+		int exit = -1;
+		if (cond != nullptr) {
+			Compile(cond, dst);
+			exit = Emit(OpCode::JumpIfFalse, dst, 0, Message("condition did not evaluate to a bit"));
+		}
+		loops.push_back(Loop{ scopeDepth });
+		Compile(body, dst);
+		// an empty body had no result, which the tree walker took for a break
+		if (IsEmptyBlock(body)) loops.back().Breaks.push_back(Emit(OpCode::Jump));
+		for (int at : loops.back().Continues) PatchTarget(at);
+		if (iterate != nullptr) Compile(iterate, dst);
+		Emit(OpCode::Jump, 0, start);
+		if (exit >= 0) PatchTarget(exit);
+		for (int at : loops.back().Breaks) PatchTarget(at);
+		loops.pop_back();
+		Emit(OpCode::LoadConstant, dst, Constant(MakeNode<Node>(NodeType::None)));
+	}
+
+	void BytecodeCompiler::CompileStructure(NodeStructureFactory& node, int dst) {
+		if (!node.IsObjectFactory && !node.IsArrayFactory) {
+			EmitThrow(dst, "invalid structure factory", false);
+			return;
+		}
+		int base = top;
+		for (auto& expression : node.Expressions) {
+			Compile(expression, Allocate());
+		}
+		if (node.IsObjectFactory) {
+			ObjectLayout layout = { ObjectShape::Empty(), {} };
+			for (auto key : node.KeysIds) {
+				int slot = layout.Shape->Find(key);
+				if (slot < 0) {
+					slot = (int)layout.Shape->Keys.size();
+					layout.Shape = layout.Shape->With(key);
+				}
+				layout.Slots.push_back(slot);
+			}
+			chunk.Layouts.push_back(std::move(layout));
+			Emit(OpCode::MakeObject, dst, base, (int)chunk.Layouts.size() - 1);
+		} else {
+			Emit(OpCode::MakeArray, dst, base, (int)node.Expressions.size());
+		}
+		top = base;
+	}
+
+	OpCode TypedArithmetic(InstructionType type, NodeType left, NodeType right) {
+		if (left == NodeType::Integer && right == NodeType::Integer) {
+			switch (type) {
+				case InstructionType::ADD: return OpCode::AddInt;
+				case InstructionType::SUBTRACT: return OpCode::SubtractInt;
+				case InstructionType::MULTIPLY: return OpCode::MultiplyInt;
+				case InstructionType::DIVIDE: return OpCode::DivideInt;
+				case InstructionType::COMP_EQ: return OpCode::EqualInt;
+				case InstructionType::COMP_NE: return OpCode::NotEqualInt;
+				case InstructionType::COMP_LT: return OpCode::LessInt;
+				case InstructionType::COMP_LE: return OpCode::LessEqualInt;
+				case InstructionType::COMP_GT: return OpCode::GreaterInt;
+				case InstructionType::COMP_GE: return OpCode::GreaterEqualInt;
+				default: return OpCode::Arithmetic;
+			}
+		}
+		if (left == NodeType::Float && right == NodeType::Float) {
+			switch (type) {
+				case InstructionType::ADD: return OpCode::AddFloat;
+				case InstructionType::SUBTRACT: return OpCode::SubtractFloat;
+				case InstructionType::MULTIPLY: return OpCode::MultiplyFloat;
+				case InstructionType::DIVIDE: return OpCode::DivideFloat;
+				case InstructionType::COMP_EQ: return OpCode::EqualFloat;
+				case InstructionType::COMP_NE: return OpCode::NotEqualFloat;
+				case InstructionType::COMP_LT: return OpCode::LessFloat;
+				case InstructionType::COMP_LE: return OpCode::LessEqualFloat;
+				case InstructionType::COMP_GT: return OpCode::GreaterFloat;
+				case InstructionType::COMP_GE: return OpCode::GreaterEqualFloat;
+				default: return OpCode::Arithmetic;
+			}
+		}
+		if (left == NodeType::Bit && right == NodeType::Bit) {
+			switch (type) {
+				case InstructionType::COMP_EQ: return OpCode::EqualBit;
+				case InstructionType::COMP_NE: return OpCode::NotEqualBit;
+				default: return OpCode::Arithmetic;
+			}
+		}
+		if (left == NodeType::Bits && right == NodeType::Bits) {
+			switch (type) {
+				case InstructionType::ADD: return OpCode::ConcatBits;
+				case InstructionType::COMP_EQ: return OpCode::EqualBits;
+				case InstructionType::COMP_NE: return OpCode::NotEqualBits;
+				default: return OpCode::Arithmetic;
+			}
+		}
+		if (left == NodeType::Bits && right == NodeType::Integer && type == InstructionType::MULTIPLY) return OpCode::RepeatBits;
+		return OpCode::Arithmetic;
+	}
+
+	OpCode UncheckedArithmetic(OpCode typed) {
+		if (typed < OpCode::AddInt || typed > OpCode::NotEqualBit) return OpCode::Arithmetic;
+		return static_cast<OpCode>((int)typed - (int)OpCode::AddInt + (int)OpCode::AddIntUnchecked);
+	}
+
+	const char* OpCodeName(OpCode op) {
+		switch (op) {
+			#define CARBON_OPCODE_NAME(name) case OpCode::name: return #name;
+			CARBON_OPCODES(CARBON_OPCODE_NAME)
+			#undef CARBON_OPCODE_NAME
+		}
+		return "?";
+	}
+
+	void BytecodeChunk::Disassemble(FILE* out) const {
+		for (size_t i = 0; i < Code.size(); i++) {
+			auto& instruction = Code[i];
+			fprintf(out, "%4d  %-12s %d %d %d", (int)i, OpCodeName(instruction.Op), instruction.A, instruction.B, instruction.C);
+			switch (instruction.Op) {
+				case OpCode::LoadConstant:
+				case OpCode::CopyConstant: {
+					auto& constant = Constants[instruction.B];
+					switch (constant.GetNodeType()) {
+						case NodeType::Break: fprintf(out, "  ; break"); break;
+						case NodeType::Continue: fprintf(out, "  ; continue"); break;
+						default: fprintf(out, "  ; %s", GetTypeText(constant.GetNodeType())); break;
+					}
+					break;
+				}
+				case OpCode::GetVariable:
+				case OpCode::SetVariable:
+				case OpCode::SetLocal:
+				case OpCode::GetFunction:
+					fprintf(out, "  ; %s", GetSymbolName(instruction.B).c_str());
+					break;
+				case OpCode::Arithmetic:
+				case OpCode::Prefix: {
+					NodeCommand command(instruction.Operator);
+					fprintf(out, "  ; %s", command.GetText());
+					break;
+				}
+				case OpCode::JumpIfFalse:
+				case OpCode::Throw:
+					fprintf(out, "  ; %s", Messages[instruction.Op == OpCode::Throw ? instruction.B : instruction.C].c_str());
+					break;
+				default:
+					break;
+			}
+			fprintf(out, "\n");
+		}
+	}
+
+}
@@ -0,0 +1,242 @@
+#pragma once
+#include "AstNodes.h"
+#include "Value.h"
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Carbon
+{
+	// forms of two operand arithmetic specialized to scalar operand types,
+	// each has an unchecked twin below in the same order
+	#define CARBON_SCALAR_OPCODES(X) \
+		X(AddInt) \
+		X(SubtractInt) \
+		X(MultiplyInt) \
+		X(DivideInt) \
+		X(EqualInt) \
+		X(NotEqualInt) \
+		X(LessInt) \
+		X(LessEqualInt) \
+		X(GreaterInt) \
+		X(GreaterEqualInt) \
+		X(AddFloat) \
+		X(SubtractFloat) \
+		X(MultiplyFloat) \
+		X(DivideFloat) \
+		X(EqualFloat) \
+		X(NotEqualFloat) \
+		X(LessFloat) \
+		X(LessEqualFloat) \
+		X(GreaterFloat) \
+		X(GreaterEqualFloat) \
+		X(EqualBit) \
+		X(NotEqualBit)
+
+	// scalar forms without the operand type check, only emitted where type
+	// inference proved the operand types
+	#define CARBON_UNCHECKED_OPCODES(X) \
+		X(AddIntUnchecked) \
+		X(SubtractIntUnchecked) \
+		X(MultiplyIntUnchecked) \
+		X(DivideIntUnchecked) \
+		X(EqualIntUnchecked) \
+		X(NotEqualIntUnchecked) \
+		X(LessIntUnchecked) \
+		X(LessEqualIntUnchecked) \
+		X(GreaterIntUnchecked) \
+		X(GreaterEqualIntUnchecked) \
+		X(AddFloatUnchecked) \
+		X(SubtractFloatUnchecked) \
+		X(MultiplyFloatUnchecked) \
+		X(DivideFloatUnchecked) \
+		X(EqualFloatUnchecked) \
+		X(NotEqualFloatUnchecked) \
+		X(LessFloatUnchecked) \
+		X(LessEqualFloatUnchecked) \
+		X(GreaterFloatUnchecked) \
+		X(GreaterEqualFloatUnchecked) \
+		X(EqualBitUnchecked) \
+		X(NotEqualBitUnchecked)
+
+	// forms of two operand arithmetic on binary sequences
+	#define CARBON_BITS_OPCODES(X) \
+		X(ConcatBits) \
+		X(RepeatBits) \
+		X(EqualBits) \
+		X(NotEqualBits)
+
+	// every opcode of the register machine, expanded into the enum, the
+	// dispatch table of the executor and the disassembler
+	#define CARBON_OPCODES(X) \
+		X(LoadConstant) \
+		X(CopyConstant) \
+		X(GetVariable) \
+		X(SetVariable) \
+		X(SetLocal) \
+		X(GetFunction) \
+		X(GetMember) \
+		X(SetMember) \
+		X(Arithmetic) \
+		CARBON_SCALAR_OPCODES(X) \
+		CARBON_UNCHECKED_OPCODES(X) \
+		CARBON_BITS_OPCODES(X) \
+		X(Prefix) \
+		X(Call) \
+		X(CallNative) \
+		X(CallFolded) \
+		X(MakeArray) \
+		X(MakeObject) \
+		X(PushScope) \
+		X(PopScope) \
+		X(SetMode) \
+		X(RestoreMode) \
+		X(Jump) \
+		X(JumpIfFalse) \
+		X(JumpIfFalseUnchecked) \
+		X(MakeReturn) \
+		X(Return) \
+		X(Throw)
+
+	enum class OpCode : unsigned char {
+		#define CARBON_OPCODE_ENUM(name) name,
+		CARBON_OPCODES(CARBON_OPCODE_ENUM)
+		#undef CARBON_OPCODE_ENUM
+	};
+
+	const char* OpCodeName(OpCode op);
+
+	// typed form of two operand arithmetic for the operand types, Arithmetic
+	// when the generic code has to run
+	OpCode TypedArithmetic(InstructionType type, NodeType left, NodeType right);
+
+	// the unchecked twin of a scalar form, Arithmetic for any other opcode
+	OpCode UncheckedArithmetic(OpCode typed);
+
+	// how a variable access resolves its name, dynamic follows the local
+	// mode flag of the symbol table at runtime like the tree walker did
+	enum class LookupMode : unsigned char {
+		Dynamic,
+		Search,
+		Local
+	};
+
+	// A is the destination register unless noted otherwise, jump targets
+	// are always in B, variables are addressed by symbol slot. Arithmetic
+	// on two operands is rewritten in place to the typed form of the first
+	// operands it sees and back when a guard fails, only while no parallel
+	// workers run.
+	struct Instruction {
+		mutable OpCode Op;
+		InstructionType Operator;
+		mutable bool Generic; // a typed form failed its guard, not typed again
+		int A;
+		int B;
+		int C;
+	};
+
+	// name of one member operator with a monomorphic inline cache, the
+	// last shape id seen in the high half and its slot in the low half,
+	// kept in one word so parallel workers can share the chunk
+	struct MemberAccess {
+		size_t NameId;
+		mutable std::atomic<unsigned long long> Cache;
+		MemberAccess(size_t nameId) : NameId(nameId), Cache(0) { }
+		MemberAccess(const MemberAccess& other) : NameId(other.NameId), Cache(other.Cache.load(std::memory_order_relaxed)) { }
+		static unsigned long long Entry(unsigned shapeId, int slot) { return (unsigned long long)shapeId << 32 | (unsigned)slot; }
+	};
+
+	// final shape of an object literal and the slot of every expression,
+	// repeated keys share a slot and the last value wins
+	struct ObjectLayout {
+		const ObjectShape* Shape;
+		std::vector<int> Slots;
+	};
+
+	// Copy of the code where type inference replaced checked instructions
+	// with unchecked ones, calls of natives with CallNative and what it could
+	// compute in advance with constants. Instructions keep their index, when
+	// a guard fails the executor goes on in the generic code at the same
+	// place. Code using the values of sealed globals is only valid in the
+	// seal epoch it was built in.
+	struct TypedCode {
+		std::vector<Instruction> Code;
+		std::vector<Ref<Node>> Callees; // the native each CallNative or CallFolded expects
+		unsigned Epoch = 0; // 0 when the code does not depend on sealed globals
+	};
+
+	// compiled form of one top level statement or one function body
+	class BytecodeChunk {
+	public:
+		std::vector<Instruction> Code;
+		std::unique_ptr<TypedCode> Typed; // used while the local mode flag is off
+
+		std::vector<Value> Constants;
+		std::vector<MemberAccess> Members;
+		std::vector<ObjectLayout> Layouts;
+		std::vector<std::string> Messages;
+		int RegisterCount = 1;
+		int SlotCount = 0; // above every symbol slot the chunk binds or reads
+		void Disassemble(FILE* out) const;
+	};
+
+	// Translates the tree built by the instruction writer into register
+	// bytecode. Registers are allocated like a stack, every expression is
+	// compiled into a destination register chosen by its parent.
+	class BytecodeCompiler {
+	public:
+		// runs over a freshly compiled chunk before it is used
+		typedef std::function<void(BytecodeChunk&)> Pass;
+
+		static std::shared_ptr<BytecodeChunk> CompileStatement(const Ref<Node>& statement);
+		// compiled once on first use, safe to call from parallel workers,
+		// the listing goes to dump when given
+		static const BytecodeChunk& FunctionBody(NodeFunction& function, const Pass& pass = nullptr, FILE* dump = nullptr);
+
+	private:
+		struct Loop {
+			int ScopeDepth;
+			std::vector<int> Breaks;
+			std::vector<int> Continues;
+		};
+
+		BytecodeChunk& chunk;
+		bool isFunction;
+		int top = 0;
+		int scopeDepth = 0;
+		LookupMode mode = LookupMode::Dynamic;
+		LookupMode flag = LookupMode::Dynamic;
+		std::vector<Loop> loops;
+
+		BytecodeCompiler(BytecodeChunk& chunk, bool isFunction);
+		void CompileRoot(const Ref<Node>& node);
+
+		int Allocate();
+		int Emit(OpCode op, int a = 0, int b = 0, int c = 0, InstructionType type = InstructionType::END_STATEMENT);
+		void PatchTarget(int at);
+		int Constant(const Ref<Node>& value);
+		int Slot(int slot);
+		int Message(const char* text);
+		void EmitThrow(int dst, const char* message, bool implementation);
+		void EmitReturn(int dst);
+		void EmitJumpOut(bool isBreak, int dst);
+
+		void Compile(const Ref<Node>& node, int dst);
+		void CompileCommand(NodeCommand& node, int dst);
+		void CompileSequence(const std::vector<Ref<Node>>& nodes, int dst);
+		void CompileInfix(NodeCommand& node, int dst);
+		void CompileMember(NodeCommand& node, int dst);
+		void CompileAssignment(NodeCommand& node, int dst);
+		void CompileLocal(NodeCommand& node, int dst);
+		void CompileCall(NodeCommand& node, int dst);
+		void CompileConditional(NodeCommand& node, int dst);
+		void CompileLoop(NodeCommand& node, int dst);
+		void CompileStructure(NodeStructureFactory& node, int dst);
+
+		template <typename TBody> void WithMode(LookupMode newMode, bool hasCalls, TBody body);
+	};
+
+}
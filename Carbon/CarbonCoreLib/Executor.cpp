@@ -1,15 +1,24 @@
 #include "Executor.h"
 
 #include <cstdio>
+#include <cstring>
+#include <climits>
 #include <string>
 #include <stack>
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <map>
 #include <queue>
+#include <deque>
+#include <mutex>
+#include <cmath>
+#include <algorithm>
 
 #include "../BinseqLib/binseq.hpp"
 #include "AstNodes.h"
+#include "Bytecode.h"
+#include "TypeInference.h"
 #include "ExecutorException.h"
 #include <chrono>
 #include <sstream>
@@ -48,24 +57,86 @@ namespace Carbon {
 		}
 	}
 
+	/**
+	 * \brief 
+	 * Splits the range [0, count) into contiguous parts and processes them on the thread pool.
+	 * Small ranges and calls made from inside worker threads run on the calling thread.
+	 * \param grain 
+	 * Smallest amount of work worth handing to another thread.
+	 * \param degreeOfParallelism 
+	 * Maximum number of parts, 0 uses every thread of the pool.
+	 */
+	template <typename TRangeFunction>
+	static void ParallelFor(binseq::u64 count, binseq::u64 grain, int degreeOfParallelism, TRangeFunction function)
+	{
+		if (degreeOfParallelism == 1 || count <= grain || ThreadPool::IsWorkerThread())
+		{
+			function(binseq::u64(0), count);
+			return;
+		}
+		auto& pool = *GetThreadPool();
+		binseq::u64 parts = degreeOfParallelism > 0 ? degreeOfParallelism : pool.GetNumberOfThreads();
+		binseq::u64 maxParts = (count + grain - 1) / grain;
+		if (parts > maxParts) parts = maxParts;
+		if (parts <= 1)
+		{
+			function(binseq::u64(0), count);
+			return;
+		}
+		std::vector<std::function<void(void)>> tasks((size_t)parts);
+		for (binseq::u64 i = 0; i < parts; i++)
+		{
+			binseq::u64 begin = count * i / parts;
+			binseq::u64 end = count * (i + 1) / parts;
+			tasks[(size_t)i] = [&function, begin, end]() { function(begin, end); };
+		}
+		ConcurrentReferences concurrent;
+		auto task = pool.SubmitForExecution(tasks, degreeOfParallelism);
+		task->WaitUntilDone();
+	}
+
 	namespace native
 	{
-		static std::shared_ptr<Node> view(std::vector<std::shared_ptr<Node>>& node); //forwarddecl
+		static Ref<Node> view(std::vector<Ref<Node>>& node); //forwarddecl
 	};
 
+	// Scopes with shallow binding: every symbol slot holds its innermost
+	// binding, a binding made in an inner scope saves the one it hides and
+	// popping the scope puts the saved bindings back. Lookups by slot are
+	// array accesses, names are turned into slots by GetSymbolSlot.
 	class SymbolTableStack {
 	public:
 		bool LocalMode;
 		void Push();
 		void Pop();
-		std::shared_ptr<Node>& operator [](const std::string&);
-		std::shared_ptr<Node>& Global(const std::string&);
-		std::shared_ptr<Node>& Local(const std::string&);
+		// makes room for slots below count, compiled code reserves its slots
+		// before it runs
+		void Reserve(size_t count);
+		inline Value& Find(int slot);
+		inline Value& Local(int slot);
+		Value& Global(int slot);
+		// innermost binding without binding anything, null when unbound
+		const Value* Peek(int slot) const;
+		Value& operator [](const std::string&);
+		Value& Find(const std::string&);
+		Value& Global(const std::string&);
+		Value& Local(const std::string&);
 		std::vector<std::string> GlobalKeys();
 		int GetLevel();
 		SymbolTableStack();
 	private:
-		std::vector<std::unordered_map<std::string, std::shared_ptr<Node>>> table;
+		struct Binding {
+			Carbon::Value Value;
+			int Level = 0; // scope of the binding, 0 when unbound
+		};
+		struct Shadowed {
+			int Slot;
+			Binding Saved;
+		};
+		std::vector<Binding> bindings;
+		std::vector<Shadowed> shadowed;
+		std::vector<size_t> scopes; // size of shadowed when each scope was pushed
+		Value& Bind(int slot);
 
 	};
 
@@ -75,31 +146,40 @@ namespace Carbon {
 		bool VERBOSE_SUBMIT;
 		bool VERBOSE_TREE;
 		bool VERBOSE_PERFORMANCE;
+		bool VERBOSE_BYTECODE;
+		bool VERBOSE_TYPES;
+		bool TYPE_INFERENCE;
+		bool FOLD_CONSTANTS;
 		bool ShowPrompt;
 		SymbolTableStack SymbolTable;
-		std::stack<std::shared_ptr<Node>> stack;
-		std::vector<std::shared_ptr<Node>> StatementList;
+		std::stack<Ref<Node>> stack;
+		std::vector<Ref<Node>> StatementList;
 		ThreadPool* threadPool;
-		std::shared_ptr<Node> ReplaceIdIfPossible(std::shared_ptr<Node>);
-		std::shared_ptr<Node> OptimizeIfPossible(std::shared_ptr<Node>);
-		void RegisterNativeFunction(const char* name, native_function_ptr, bool pure);
-		void RegisterInternalNativeFunction(const char* name, std::shared_ptr<Node> (*fptr)(ExecutorImp* ex, std::vector<std::shared_ptr<Node>>& node), bool pure);
+		Ref<Node> ReplaceIdIfPossible(Ref<Node>);
+		Ref<Node> FoldConstants(const Ref<Node>&);
+		void RegisterNativeFunction(const char* name, native_function_ptr, bool pure, NodeType result = NodeType::None);
+		void RegisterInternalNativeFunction(const char* name, Ref<Node> (*fptr)(ExecutorImp* ex, std::vector<Ref<Node>>& node), bool pure);
 		ExecutorImp();
-		std::shared_ptr<Node> ExecuteStatement(std::shared_ptr<Node>);
-		std::shared_ptr<Node> ExecuteStatementList();
+		Ref<Node> ExecuteStatement(const Ref<Node>&);
+		Ref<Node> ExecuteStatementList();
 		void ClearStatementList();
 
-		inline std::shared_ptr<Node> ExecuteInfixArithmetic(NodeCommand& node);
-		inline std::shared_ptr<Node> ExecutePrefixArithmetic(NodeCommand& node);
-		inline std::shared_ptr<Node> ExecuteAssignment(NodeCommand& node);
-		inline std::shared_ptr<Node> ExecuteCall(NodeCommand& node);
-		inline std::shared_ptr<Node> ExecuteCommand(NodeCommand& node);
-		inline std::shared_ptr<Node> ExecuteBlock(NodeCommand& node);
-		inline std::shared_ptr<Node> ExecuteConditional(NodeCommand& node);
-		inline std::shared_ptr<Node> ExecuteLoop(NodeCommand& node);
-		inline std::shared_ptr<Node> ExecuteMemberOperator(NodeCommand& node);
-		inline std::shared_ptr<Node> ExecuteStructureFactory(NodeStructureFactory& node);
-		inline std::shared_ptr<Node> Error(std::string message);
+		inline Ref<Node> ExecuteCall(NodeCommand& node);
+		Value Call(NodeFunction& function, Value* arguments, size_t count);
+		Value Run(const BytecodeChunk& chunk);
+		void InferTypes(BytecodeChunk& chunk, bool entry);
+		BytecodeCompiler::Pass InferFunctionTypes;
+		// globals which no code assigns again keep their value here by slot,
+		// typed code reading them is only used in the epoch it was built in
+		std::vector<Value> Sealed;
+		std::vector<bool> Unsealable; // assigned by a function or bound as a local
+		bool SealingDisabled; // delete can unbind any name
+		unsigned SealEpoch;
+		std::vector<int> SealGlobals(const std::vector<Ref<Node>>& statements);
+		void Seal(int slot, const Value& value);
+		void Unseal(int slot);
+		inline Value& Lookup(int slot, LookupMode mode);
+		inline Ref<Node> Error(std::string message);
 	};
 
 	Executor::Executor() {
@@ -108,6 +188,10 @@ namespace Carbon {
 		this->imp->VERBOSE_SUBMIT = false;
 		this->imp->VERBOSE_TREE = false;
 		this->imp->VERBOSE_PERFORMANCE = true;
+		this->imp->VERBOSE_BYTECODE = false;
+		this->imp->VERBOSE_TYPES = false;
+		this->imp->TYPE_INFERENCE = true;
+		this->imp->FOLD_CONSTANTS = true;
 	}
 
 	Executor::~Executor() {
@@ -179,34 +263,34 @@ namespace Carbon {
 	void Executor::WriteInstruction(InstructionType type, const char* text) {
 		switch (type) {
 			case InstructionType::NUM:
-				imp->stack.push(std::make_shared<NodeInteger>(atoll(text)));
+				imp->stack.push(MakeNode<NodeInteger>(atoll(text)));
 				break;
 			case InstructionType::ONUM:
-				imp->stack.push(std::make_shared<NodeInteger>(std::stoi(text, nullptr,8)));
+				imp->stack.push(MakeNode<NodeInteger>(std::stoi(text, nullptr,8)));
 				break;
 			case InstructionType::XNUM:
 				if (text[0]!=0 && text[1]!=0)
-					imp->stack.push(std::make_shared<NodeInteger>(std::stoi(text + 2, nullptr, 16)));
+					imp->stack.push(MakeNode<NodeInteger>(std::stoi(text + 2, nullptr, 16)));
 				else
-					imp->stack.push(std::make_shared<NodeInteger>(std::stoi(text, nullptr, 16)));
+					imp->stack.push(MakeNode<NodeInteger>(std::stoi(text, nullptr, 16)));
 				break;
 			case InstructionType::BNUM:
 				if (text[0] != 0 && text[1] != 0)
-					imp->stack.push(std::make_shared<NodeInteger>(std::stoi(text + 2, nullptr, 2)));
+					imp->stack.push(MakeNode<NodeInteger>(std::stoi(text + 2, nullptr, 2)));
 				else
-					imp->stack.push(std::make_shared<NodeInteger>(std::stoi(text, nullptr, 2)));
+					imp->stack.push(MakeNode<NodeInteger>(std::stoi(text, nullptr, 2)));
 				break;
 			case InstructionType::FLOAT:
-				imp->stack.push(std::make_shared<NodeFloat>(atof(text)));
+				imp->stack.push(MakeNode<NodeFloat>(atof(text)));
 				break;
 			case InstructionType::STR:
-				imp->stack.push(std::make_shared<NodeString>(ParseEscapedString(text)));
+				imp->stack.push(MakeNode<NodeString>(ParseEscapedString(text)));
 				break;
 			case InstructionType::BSTR:
-				imp->stack.push(std::make_shared<NodeBits>(ParseBSTR(text)));
+				imp->stack.push(MakeNode<NodeBits>(ParseBSTR(text)));
 				break;
 			case InstructionType::ID:
-				imp->stack.push(std::make_shared<NodeAtom>(type, text));
+				imp->stack.push(MakeNode<NodeAtom>(type, text));
 				break;
 			default:
 				throw ExecutorImplementationException("Command needs no arg."); 
@@ -233,7 +317,7 @@ namespace Carbon {
 		}
 	}
 
-	void FlattenCommaExpressionToFunctionParams(const std::shared_ptr<Node>& expr, std::vector<std::string>& outp) {
+	void FlattenCommaExpressionToFunctionParams(const Ref<Node>& expr, std::vector<std::string>& outp) {
 		if (expr->IsNone()) {
 			return;
 		}
@@ -252,12 +336,12 @@ namespace Carbon {
 	// instructions that  do not have argument
 	void Executor::WriteInstruction(InstructionType cmd) {
 		//transform into tree
-		auto node = std::make_shared<NodeCommand>(cmd);
+		auto node = MakeNode<NodeCommand>(cmd);
 		if (imp->VERBOSE_SUBMIT)
 			printf("CMD %s\n", node->GetText());
 		switch (cmd) {
 			case InstructionType::VOIDEXPR:
-				imp->stack.push(std::make_shared<Node>(NodeType::None));
+				imp->stack.push(MakeNode<Node>(NodeType::None));
 				break;
 			case InstructionType::ASSIGN:
 			case InstructionType::ADD:
@@ -280,7 +364,7 @@ namespace Carbon {
 					? imp->stack.top() 
 					: imp->ReplaceIdIfPossible(imp->stack.top());
 				imp->stack.pop();
-				imp->stack.push(imp->OptimizeIfPossible(node));
+				imp->stack.push(node);
 				break;
 			case InstructionType::CONTROL:
 				//imp->ControlLevel++;
@@ -364,7 +448,7 @@ namespace Carbon {
 					FlattenCommaExpressionToFunctionParams(p, plist);
 				}
 				else throw ExecutorImplementationException("invalid function syntax");
-				imp->stack.push(std::make_shared<NodeFunction>(plist, fimpl));
+				imp->stack.push(MakeNode<NodeFunction>(plist, fimpl));
 				break;
 			}
 			case InstructionType::FUNCTIONEND: {
@@ -385,7 +469,7 @@ namespace Carbon {
 								plist.push_back(pstack.top());
 								pstack.pop();
 							}
-							imp->stack.push(std::make_shared<NodeFunction>(plist, fimpl));
+							imp->stack.push(MakeNode<NodeFunction>(plist, fimpl));
 							break;
 						} else throw ExecutorImplementationException("invalid");
 					} else throw ExecutorImplementationException("invalid");
@@ -405,7 +489,7 @@ namespace Carbon {
 				imp->stack.push(node);
 				break;
 			case InstructionType::ARRAYEND: {
-				auto arrayNode = std::make_shared<NodeStructureFactory>();
+				auto arrayNode = MakeNode<NodeStructureFactory>();
 				arrayNode->IsArrayFactory = true;
 				auto& vector = arrayNode->Expressions;
 				bool finished = false;
@@ -425,7 +509,7 @@ namespace Carbon {
 			}
 				break;
 			case InstructionType::OBJECTEND: {
-				std::vector<std::shared_ptr<Node>> collector;
+				std::vector<Ref<Node>> collector;
 				bool finished = false;
 				while(!finished)
 				{
@@ -444,7 +528,7 @@ namespace Carbon {
 					}
 				}
 
-				auto structure = std::make_shared<NodeStructureFactory>();
+				auto structure = MakeNode<NodeStructureFactory>();
 				structure->IsObjectFactory = true;
 
 				for (int i = collector.size(); i > 0; i -= 2)
@@ -470,11 +554,11 @@ namespace Carbon {
 				node->Children.resize(1);
 				node->Children[0] = imp->stack.top();
 				imp->stack.pop();
-				imp->stack.push(imp->OptimizeIfPossible(node));
+				imp->stack.push(node);
 				break;
 			case InstructionType::CALLEND: {
 				//compile the call list
-				std::stack<std::shared_ptr<Node>> callstack;
+				std::stack<Ref<Node>> callstack;
 				bool finished = false;
 				do {
 					auto top = imp->stack.top();
@@ -506,7 +590,7 @@ namespace Carbon {
 				break;
 			case InstructionType::BLOCKEND: {
 				//compile the call list
-				std::stack<std::shared_ptr<Node>> blockstack;
+				std::stack<Ref<Node>> blockstack;
 				bool finished = false;
 				do {
 					auto top = imp->stack.top();
@@ -552,7 +636,7 @@ namespace Carbon {
 					while (!imp->stack.empty()) imp->stack.pop();
 					if (imp->ShowPrompt) {
 						//if console mode, execute
-						std::vector<std::shared_ptr<Node>> args;
+						std::vector<Ref<Node>> args;
 
 						std::chrono::steady_clock::time_point t1;
 						// if we need to know perf, we need to know time before starting execution
@@ -560,7 +644,7 @@ namespace Carbon {
 						// execute recorded statements
 						auto result = imp->ExecuteStatementList();
 						args.push_back(result);
-						args.push_back(std::make_shared<NodeString>(std::string(":") + GetTypeText(result->GetNodeType())));
+						args.push_back(MakeNode<NodeString>(std::string(":") + GetTypeText(result->GetNodeType())));
 						if (imp->VERBOSE_PERFORMANCE == true)
 						{
 							// if perf is enabled, check time now and print delta
@@ -570,7 +654,7 @@ namespace Carbon {
 							std::ostringstream strs;
 							strs << "(" << ms << "ms" << ")";
 							std::string str = strs.str();
-							args.push_back(std::make_shared<NodeString>(strs.str()));
+							args.push_back(MakeNode<NodeString>(strs.str()));
 						}
 						
 						native::view(args);
@@ -602,7 +686,7 @@ namespace Carbon {
 
 	};
 
-	std::shared_ptr<Node> ExecutorImp::ReplaceIdIfPossible(std::shared_ptr<Node> node) {
+	Ref<Node> ExecutorImp::ReplaceIdIfPossible(Ref<Node> node) {
 		/*if (node->IsAtom())
     {
       auto atom = reinterpret_cast<NodeAtom*>(&*node);
@@ -620,69 +704,6 @@ namespace Carbon {
 		return imp->stack.top()->GetText();
 	}
 
-	std::shared_ptr<Node> ExecutorImp::OptimizeIfPossible(std::shared_ptr<Node> node) {
-		if (node->IsCommand()) {
-			auto cmd = reinterpret_cast<NodeCommand*>(&*node);
-			if (cmd->Children.size() == 1) {
-				auto cmdtype = cmd->GetCommandType();
-				if (cmdtype == InstructionType::POSITIVE) {
-					if (cmd->Children[0]->GetNodeType() == NodeType::Integer ||
-						cmd->Children[0]->GetNodeType() == NodeType::Float)
-						return cmd->Children[0];
-				} else if (cmdtype == InstructionType::NEGATIVE) {
-					if (cmd->Children[0]->GetNodeType() == NodeType::Integer)
-						return std::make_shared<NodeInteger>(- reinterpret_cast<NodeInteger*>(&*cmd->Children[0])->Value);
-					if (cmd->Children[0]->GetNodeType() == NodeType::Float)
-						return std::make_shared<NodeFloat>(- reinterpret_cast<NodeFloat*>(&*cmd->Children[0])->Value);
-				}
-
-			} else if (cmd->Children.size() == 2) {
-				auto cmdtype = cmd->GetCommandType();
-
-				//try reduce arithmetic nodes
-				if (cmdtype == InstructionType::ADD || cmdtype == InstructionType::SUBTRACT ||
-					cmdtype == InstructionType::MULTIPLY || cmdtype == InstructionType::DIVIDE) {
-					//reduce integer arithmetic
-					if (cmd->Children[0]->GetNodeType() == NodeType::Integer &&
-						cmd->Children[1]->GetNodeType() == NodeType::Integer) {
-						auto a = reinterpret_cast<NodeInteger*>(&*cmd->Children[0]);
-						auto b = reinterpret_cast<NodeInteger*>(&*cmd->Children[1]);
-						switch (cmdtype) {
-							case InstructionType::ADD: return std::make_shared<NodeInteger>(a->Value + b->Value);
-							case InstructionType::SUBTRACT: return std::make_shared<NodeInteger>(a->Value - b->Value);
-							case InstructionType::MULTIPLY: return std::make_shared<NodeInteger>(a->Value * b->Value);
-							case InstructionType::DIVIDE:
-								if (b->Value == 0) {
-									throw ExecutorRuntimeException("Division by zero.");
-									return node;
-								};
-								return std::make_shared<NodeInteger>(a->Value / b->Value);
-							default:
-								throw ExecutorImplementationException("Unhandled integer operator.");
-						}
-					}
-
-					//reduce float arithmetic
-					if (cmd->Children[0]->GetNodeType() == NodeType::Float &&
-						cmd->Children[1]->GetNodeType() == NodeType::Float) {
-						auto a = reinterpret_cast<NodeFloat*>(&*cmd->Children[0]);
-						auto b = reinterpret_cast<NodeFloat*>(&*cmd->Children[1]);
-						switch (cmdtype) {
-							case InstructionType::ADD: return std::make_shared<NodeFloat>(a->Value + b->Value);
-							case InstructionType::SUBTRACT: return std::make_shared<NodeFloat>(a->Value - b->Value);
-							case InstructionType::MULTIPLY: return std::make_shared<NodeFloat>(a->Value * b->Value);
-							case InstructionType::DIVIDE:
-								return std::make_shared<NodeFloat>(a->Value / b->Value);
-							default:
-								throw ExecutorImplementationException("Unhandled float operator.");
-						}
-					}
-				}
-			}
-		}
-		return node;
-	}
-
 	static char integerTextBuffer[256];
 
 	const char* NodeInteger::GetText() {
@@ -729,60 +750,122 @@ namespace Carbon {
 		imp->ClearStatementList();
 	}
 
-	std::shared_ptr<Node> Executor::Execute() {
+	Ref<Node> Executor::Execute() {
 		auto node = imp->ExecuteStatementList();
 		imp->ClearStatementList();
 		return node;
 	}
 
 	int SymbolTableStack::GetLevel() {
-		return table.size();
+		return (int)scopes.size() + 1;
 	}
 
 	SymbolTableStack::SymbolTableStack() {
 		this->LocalMode = false;
-		this->Push();
 	};
 
 	void SymbolTableStack::Push() {
-		table.push_back(std::unordered_map<std::string, std::shared_ptr<Node>>());
+		scopes.push_back(shadowed.size());
 	}
 
 	void SymbolTableStack::Pop() {
-		table.pop_back();
+		size_t mark = scopes.back();
+		scopes.pop_back();
+		while (shadowed.size() > mark) {
+			auto& entry = shadowed.back();
+			bindings[entry.Slot] = std::move(entry.Saved);
+			shadowed.pop_back();
+		}
 	}
 
-	std::shared_ptr<Node>& SymbolTableStack::operator[](const std::string& key) {
-		if (!LocalMode)
-			for (auto i = table.rbegin(); i != table.rend(); i++) {
-				if (i->find(key) != i->end())
-					return (*i)[key];
+	void SymbolTableStack::Reserve(size_t count) {
+		if (bindings.size() < count) bindings.resize(count);
+	}
+
+	// new empty binding in the top scope, the global scope is never popped
+	// so bindings made there have nothing to save
+	Value& SymbolTableStack::Bind(int slot) {
+		int level = GetLevel();
+		auto& binding = bindings[slot];
+		if (level > 1) shadowed.push_back(Shadowed{ slot, std::move(binding) });
+		binding.Value = Value();
+		binding.Level = level;
+		return binding.Value;
+	}
+
+	// innermost binding of the slot, a new binding in the top scope otherwise
+	inline Value& SymbolTableStack::Find(int slot) {
+		auto& binding = bindings[slot];
+		return binding.Level != 0 ? binding.Value : Bind(slot);
+	}
+
+	inline Value& SymbolTableStack::Local(int slot) {
+		auto& binding = bindings[slot];
+		return binding.Level == GetLevel() ? binding.Value : Bind(slot);
+	}
+
+	// the global binding is either the current one or the oldest one saved
+	// for the slot, which is unbound when only inner scopes bind the slot
+	Value& SymbolTableStack::Global(int slot) {
+		auto& binding = bindings[slot];
+		if (binding.Level <= 1) {
+			binding.Level = 1;
+			return binding.Value;
+		}
+		for (auto& entry : shadowed) {
+			if (entry.Slot == slot) {
+				entry.Saved.Level = 1;
+				return entry.Saved.Value;
 			}
-		return table.back()[key];
+		}
+		throw ExecutorImplementationException("binding without saved global binding");
+	}
+
+	const Value* SymbolTableStack::Peek(int slot) const {
+		if (slot >= (int)bindings.size() || bindings[slot].Level == 0) return nullptr;
+		return &bindings[slot].Value;
+	}
+
+	Value& SymbolTableStack::operator[](const std::string& key) {
+		return LocalMode ? Local(key) : Find(key);
+	}
+
+	Value& SymbolTableStack::Find(const std::string& key) {
+		int slot = GetSymbolSlot(key);
+		Reserve(slot + 1);
+		return Find(slot);
 	}
 
-	std::shared_ptr<Node>& SymbolTableStack::Global(const std::string& key) {
-		return table.front()[key];
+	Value& SymbolTableStack::Global(const std::string& key) {
+		int slot = GetSymbolSlot(key);
+		Reserve(slot + 1);
+		return Global(slot);
 	}
 
 	std::vector<std::string> SymbolTableStack::GlobalKeys() {
+		std::vector<int> level(bindings.size());
+		for (size_t slot = 0; slot < bindings.size(); slot++) level[slot] = bindings[slot].Level;
+		for (auto i = shadowed.rbegin(); i != shadowed.rend(); i++) level[i->Slot] = i->Saved.Level;
 		std::vector<std::string> result;
-		auto& global = table.front();
-		for (auto i = global.begin(); i != global.end(); i++) {
-			result.push_back(i->first);
+		for (size_t slot = 0; slot < level.size(); slot++) {
+			if (level[slot] == 1) result.push_back(GetSymbolName((int)slot));
 		}
 		return result;
 	}
 
-	std::shared_ptr<Node>& SymbolTableStack::Local(const std::string& key) {
-		return table.back()[key];
+	Value& SymbolTableStack::Local(const std::string& key) {
+		int slot = GetSymbolSlot(key);
+		Reserve(slot + 1);
+		return Local(slot);
 	}
 
 	NodeFunction::NodeFunction(native_function_ptr fptr, bool pure)
-		: Node(NodeType::Function), Native(true), nativeptr(fptr), Pure(pure), InternalNative(false) { }
+		: Node(NodeType::Function), Native(true), nativeptr(fptr), Pure(pure), InternalNative(false), Result(NodeType::None) { }
 
-	NodeFunction::NodeFunction(std::vector<std::string> parameterList, std::shared_ptr<Node> impl)
-		:Node(NodeType::Function), Native(false), nativeptr(nullptr), ParameterList(parameterList), Implementation(impl), InternalNative(false), Pure(false) {}
+	NodeFunction::NodeFunction(std::vector<std::string> parameterList, Ref<Node> impl)
+		:Node(NodeType::Function), Native(false), nativeptr(nullptr), ParameterList(parameterList), Implementation(impl), InternalNative(false), Pure(false), Result(NodeType::None) {
+		for (auto& parameter : ParameterList) ParameterSlots.push_back(GetSymbolSlot(parameter));
+	}
 
 	const char* NodeFunction::GetText() {
 		if (Native) return "native function";
@@ -801,637 +884,1185 @@ namespace Carbon {
 
 
 	// a native function receives a vector of nodes and retursn another node
-	typedef std::shared_ptr<Node>(*internal_native_function_ptr)(ExecutorImp* ex, std::vector<std::shared_ptr<Node>>& node);
+	typedef Ref<Node>(*internal_native_function_ptr)(ExecutorImp* ex, std::vector<Ref<Node>>& node);
 
-	void ExecutorImp::RegisterNativeFunction(const char* name, native_function_ptr fptr, bool pure) {
-		auto newfunction = std::make_shared<NodeFunction>(fptr, pure);
+	void ExecutorImp::RegisterNativeFunction(const char* name, native_function_ptr fptr, bool pure, NodeType result) {
+		auto newfunction = MakeNode<NodeFunction>(fptr, pure);
 		newfunction->InternalNative = false;
+		newfunction->Result = result;
 		auto& symbol = SymbolTable.Global(name);
-		symbol = newfunction;
+		symbol = Value(newfunction);
+		Unseal(GetSymbolSlot(name));
 	}
 
 	void ExecutorImp::RegisterInternalNativeFunction(const char* name, internal_native_function_ptr fptr, bool pure) {
-		auto newfunction = std::make_shared<NodeFunction>(reinterpret_cast<native_function_ptr>(fptr), pure);
+		auto newfunction = MakeNode<NodeFunction>(reinterpret_cast<native_function_ptr>(fptr), pure);
 		newfunction->InternalNative = true;
 		auto& symbol = SymbolTable.Global(name);
-		symbol = newfunction;
+		symbol = Value(newfunction);
+		Unseal(GetSymbolSlot(name));
 	}
 
 	void ExecutorImp::ClearStatementList() {
 		this->StatementList.clear();
 	}
 
-	std::shared_ptr<Node> ExecutorImp::ExecuteStatementList() {
-		std::shared_ptr<Node> node;
-		for (auto i = StatementList.begin(); i != StatementList.end(); ++i) {
-			node = ExecuteStatement(*i);
+	Ref<Node> ExecutorImp::ExecuteStatementList() {
+		if (FOLD_CONSTANTS) {
+			for (auto& statement : StatementList) statement = FoldConstants(statement);
+		}
+		auto seals = SealGlobals(StatementList);
+		Ref<Node> node;
+		for (size_t i = 0; i < StatementList.size(); i++) {
+			node = ExecuteStatement(StatementList[i]);
 			if (node->GetNodeType() == NodeType::Error) {
 				if (!ShowPrompt) {
 					fprintf(stderr, "Execution halted to prevent unknown sidefects.\n");
 				} else { }
 			}
+			if (seals[i] >= 0) {
+				auto value = SymbolTable.Peek(seals[i]);
+				if (value != nullptr && !value->IsEmpty()) Seal(seals[i], *value);
+			}
 		}
 		return node;
 	}
 
-	inline std::shared_ptr<Node> ExecutorImp::ExecutePrefixArithmetic(NodeCommand& node) {
-		if (node.Children.size() == 1) {
-			auto executed = ExecuteStatement(node.Children[0]);
-			switch (executed->GetNodeType()) {
-				case NodeType::Integer: {
-					auto& integer = reinterpret_cast<NodeInteger&>(*executed);
-					switch (node.CommandType) {
-						case InstructionType::POSITIVE: return executed;
-						case InstructionType::NEGATIVE: return std::make_shared<NodeInteger>(-integer.Value);
-						default: throw ExecutorImplementationException("unexpected commandtype");
-					}
+	static Ref<Node> PrefixArithmetic(InstructionType type, const Ref<Node>& executed) {
+		switch (executed->GetNodeType()) {
+			case NodeType::Integer: {
+				auto& integer = reinterpret_cast<NodeInteger&>(*executed);
+				switch (type) {
+					case InstructionType::POSITIVE: return executed;
+					case InstructionType::NEGATIVE: return MakeNode<NodeInteger>(-integer.Value);
+					default: throw ExecutorImplementationException("unexpected commandtype");
 				}
-				case NodeType::Float: {
-					auto& fval = reinterpret_cast<NodeFloat&>(*executed);
-					switch (node.CommandType) {
-						case InstructionType::POSITIVE: return executed;
-						case InstructionType::NEGATIVE: std::make_shared<NodeFloat>(-fval.Value);
-						default: throw ExecutorImplementationException("unexpected commandtype");
-					}
+			}
+			case NodeType::Float: {
+				auto& fval = reinterpret_cast<NodeFloat&>(*executed);
+				switch (type) {
+					case InstructionType::POSITIVE: return executed;
+					case InstructionType::NEGATIVE: return MakeNode<NodeFloat>(-fval.Value);
+					default: throw ExecutorImplementationException("unexpected commandtype");
 				}
-				case NodeType::Bit: {
-					auto& bval = reinterpret_cast<NodeBit&>(*executed);
-					switch (node.CommandType) {
-						case InstructionType::POSITIVE: return executed;
-						case InstructionType::NEGATIVE: return std::make_shared<NodeBit>(!bval.Value);
-						default: throw ExecutorImplementationException("unexpected commandtype");
-					}
+			}
+			case NodeType::Bit: {
+				auto& bval = reinterpret_cast<NodeBit&>(*executed);
+				switch (type) {
+					case InstructionType::POSITIVE: return executed;
+					case InstructionType::NEGATIVE: return MakeNode<NodeBit>(!bval.Value);
+					default: throw ExecutorImplementationException("unexpected commandtype");
 				}
-				default:
-					throw ExecutorRuntimeException("prefix operators + or - only work on numeric values");
 			}
-		} else throw ExecutorImplementationException("Prefix op can only have 1 child.");
+			default:
+				throw ExecutorRuntimeException("prefix operators + or - only work on numeric values");
+		}
 	}
 
-	inline std::shared_ptr<Node> ExecutorImp::ExecuteInfixArithmetic(NodeCommand& node) {
-		if (node.Children.size() >= 2) {
-			std::vector<std::shared_ptr<Node>> executed;
-			for (auto i = node.Children.begin(); i != node.Children.end(); i++) {
-				executed.push_back(ExecuteStatement(*i));
-			}
-			// swap none to always be first child
-			if (node.Children.size() == 2 &&
-				(node.CommandType == InstructionType::COMP_EQ || node.CommandType == InstructionType::COMP_NE) &&
-				executed[1]->GetNodeType() == NodeType::None) {
-				std::swap(node.Children[0], node.Children[1]); //optimize, next run wont enter this branch
-				std::swap(executed[0], executed[1]);
+	// keeps the compressed form only while it is smaller, otherwise goes back to dense
+	static Ref<Node> PickBitsRepresentation(binseq::sparse_sequence&& seq) {
+		if (binseq::prefer_sparse(seq)) return MakeNode<NodeSparseBits>(std::move(seq));
+		return MakeNode<NodeBits>(seq.to_bit_sequence());
+	}
+
+	// a binseq result of a sparse operand is compressed when it is sparse enough,
+	// any other value is returned as it is
+	static Ref<Node> PickBitsRepresentation(const Ref<Node>& node) {
+		if (node->GetNodeType() != NodeType::Bits) return node;
+		auto& seq = reinterpret_cast<NodeBits&>(*node).Value;
+		if (!binseq::prefer_sparse(seq.size(), binseq::popcount(seq))) return node;
+		binseq::sparse_sequence compressed(seq);
+		if (!binseq::prefer_sparse(compressed)) return node;
+		return MakeNode<NodeSparseBits>(std::move(compressed));
+	}
+
+	// the binseq a compressed sequence stands for, other values stay as they are
+	static Ref<Node> DenseBits(const Ref<Node>& node) {
+		if (node->GetNodeType() != NodeType::SparseBits) return node;
+		return MakeNode<NodeBits>(reinterpret_cast<NodeSparseBits&>(*node).Value.to_bit_sequence());
+	}
+
+	// operands are already evaluated, executed points to count of them
+	static Ref<Node> InfixArithmetic(InstructionType type, Ref<Node>* executed, size_t count) {
+		// operators work on the dense form of compressed sequences
+		for (size_t i = 0; i < count; i++) {
+			if (executed[i]->GetNodeType() == NodeType::SparseBits) {
+				std::vector<Ref<Node>> dense(executed, executed + count);
+				for (auto& operand : dense) operand = DenseBits(operand);
+				return PickBitsRepresentation(InfixArithmetic(type, dense.data(), count));
 			}
-		reexecute:
-			switch (executed[0]->GetNodeType()) {
-				case NodeType::Integer: {
-					if (node.CommandType == InstructionType::MULTIPLY &&
-						(executed[1]->GetNodeType() == NodeType::String ||
-						executed[1]->GetNodeType() == NodeType::Bits ||
-						executed[1]->GetNodeType() == NodeType::DynamicArray)) {
-						std::swap(node.Children[0], node.Children[1]); //optimize, next run wont enter this branch
-						std::swap(executed[0], executed[1]);
-						goto reexecute;
-					}
-					if (node.CommandType == InstructionType::ADD ||
-						node.CommandType == InstructionType::SUBTRACT ||
-						node.CommandType == InstructionType::MULTIPLY ||
-						node.CommandType == InstructionType::DIVIDE) {
-						auto i = executed.begin();
-						auto acc = std::make_shared<NodeInteger>(reinterpret_cast<NodeInteger*>(&**i)->Value);
-						for (i++; i != executed.end(); i++) {
-							if ((*i)->GetNodeType() != NodeType::Integer) throw ExecutorRuntimeException("unexpected type in an arithmetic integer expression");
-							auto val = reinterpret_cast<NodeInteger*>(&**i)->Value;
-							switch (node.CommandType) {
-								case InstructionType::ADD: acc->Value += val;
-									break;
-								case InstructionType::SUBTRACT: acc->Value -= val;
-									break;
-								case InstructionType::MULTIPLY: acc->Value *= val;
-									break;
-								case InstructionType::DIVIDE: if (val == 0) throw ExecutorRuntimeException("integer division by 0"); else acc->Value /= val;
-									break;
-								default: throw ExecutorImplementationException("unhandled infix arithmetic operator");
-							}
-						}
-						return acc;
-					} else if (executed[0]->GetNodeType() == executed[1]->GetNodeType()) {
-						auto& a = reinterpret_cast<NodeInteger&>(*executed[0]);
-						auto& b = reinterpret_cast<NodeInteger&>(*executed[1]);
-						switch (node.CommandType) {
-							case InstructionType::COMP_EQ: return std::make_shared<NodeBit>(a.Value == b.Value);
-							case InstructionType::COMP_NE: return std::make_shared<NodeBit>(a.Value != b.Value);
-							case InstructionType::COMP_LE: return std::make_shared<NodeBit>(a.Value <= b.Value);
-							case InstructionType::COMP_GE: return std::make_shared<NodeBit>(a.Value >= b.Value);
-							case InstructionType::COMP_LT: return std::make_shared<NodeBit>(a.Value < b.Value);
-							case InstructionType::COMP_GT: return std::make_shared<NodeBit>(a.Value > b.Value);
-							default: throw ExecutorImplementationException("unhandled infix comparison operator");
-						}
-					} else throw ExecutorRuntimeException("error in expression");
-
-				}
-				case NodeType::Float: {
-
-					if (node.CommandType == InstructionType::ADD ||
-						node.CommandType == InstructionType::SUBTRACT ||
-						node.CommandType == InstructionType::MULTIPLY ||
-						node.CommandType == InstructionType::DIVIDE) {
-						auto i = executed.begin();
-						auto acc = std::make_shared<NodeFloat>(reinterpret_cast<NodeFloat*>(&**i)->Value);
-						for (i++; i != executed.end(); i++) {
-							if ((*i)->GetNodeType() != NodeType::Float) throw ExecutorRuntimeException("unexpected type in an arithmetic float expression");
-							auto val = reinterpret_cast<NodeFloat*>(&**i)->Value;
-							switch (node.CommandType) {
-								case InstructionType::ADD: acc->Value += val;
-									break;
-								case InstructionType::SUBTRACT: acc->Value -= val;
-									break;
-								case InstructionType::MULTIPLY: acc->Value *= val;
-									break;
-								case InstructionType::DIVIDE: acc->Value /= val;
-									break;
-								default: throw ExecutorImplementationException("unhandled infix float operator");
-							}
+		}
+		// swap none to always be first child
+		if (count == 2 &&
+			(type == InstructionType::COMP_EQ || type == InstructionType::COMP_NE) &&
+			executed[1]->GetNodeType() == NodeType::None) {
+			std::swap(executed[0], executed[1]);
+		}
+	reexecute:
+		switch (executed[0]->GetNodeType()) {
+			case NodeType::Integer: {
+				if (type == InstructionType::MULTIPLY &&
+					(executed[1]->GetNodeType() == NodeType::String ||
+					executed[1]->GetNodeType() == NodeType::Bits ||
+					executed[1]->GetNodeType() == NodeType::DynamicArray)) {
+					std::swap(executed[0], executed[1]);
+					goto reexecute;
+				}
+				if (type == InstructionType::ADD ||
+					type == InstructionType::SUBTRACT ||
+					type == InstructionType::MULTIPLY ||
+					type == InstructionType::DIVIDE) {
+					auto i = executed;
+					auto acc = MakeNode<NodeInteger>(reinterpret_cast<NodeInteger*>(&**i)->Value);
+					for (i++; i != executed + count; i++) {
+						if ((*i)->GetNodeType() != NodeType::Integer) throw ExecutorRuntimeException("unexpected type in an arithmetic integer expression");
+						auto val = reinterpret_cast<NodeInteger*>(&**i)->Value;
+						switch (type) {
+							case InstructionType::ADD: acc->Value += val;
+								break;
+							case InstructionType::SUBTRACT: acc->Value -= val;
+								break;
+							case InstructionType::MULTIPLY: acc->Value *= val;
+								break;
+							case InstructionType::DIVIDE: if (val == 0) throw ExecutorRuntimeException("integer division by 0"); else acc->Value /= val;
+								break;
+							default: throw ExecutorImplementationException("unhandled infix arithmetic operator");
 						}
-						return acc;
-					} else if (executed[0]->GetNodeType() == executed[1]->GetNodeType()) {
-						auto& a = reinterpret_cast<NodeFloat&>(*executed[0]);
-						auto& b = reinterpret_cast<NodeFloat&>(*executed[1]);
-						switch (node.CommandType) {
-							case InstructionType::COMP_EQ: return std::make_shared<NodeBit>(a.Value == b.Value);
-							case InstructionType::COMP_NE: return std::make_shared<NodeBit>(a.Value != b.Value);
-							case InstructionType::COMP_LE: return std::make_shared<NodeBit>(a.Value <= b.Value);
-							case InstructionType::COMP_GE: return std::make_shared<NodeBit>(a.Value >= b.Value);
-							case InstructionType::COMP_LT: return std::make_shared<NodeBit>(a.Value < b.Value);
-							case InstructionType::COMP_GT: return std::make_shared<NodeBit>(a.Value > b.Value);
-							default: throw ExecutorImplementationException("unhandled infix float comparison");
+					}
+					return acc;
+				} else if (executed[0]->GetNodeType() == executed[1]->GetNodeType()) {
+					auto& a = reinterpret_cast<NodeInteger&>(*executed[0]);
+					auto& b = reinterpret_cast<NodeInteger&>(*executed[1]);
+					switch (type) {
+						case InstructionType::COMP_EQ: return MakeNode<NodeBit>(a.Value == b.Value);
+						case InstructionType::COMP_NE: return MakeNode<NodeBit>(a.Value != b.Value);
+						case InstructionType::COMP_LE: return MakeNode<NodeBit>(a.Value <= b.Value);
+						case InstructionType::COMP_GE: return MakeNode<NodeBit>(a.Value >= b.Value);
+						case InstructionType::COMP_LT: return MakeNode<NodeBit>(a.Value < b.Value);
+						case InstructionType::COMP_GT: return MakeNode<NodeBit>(a.Value > b.Value);
+						default: throw ExecutorImplementationException("unhandled infix comparison operator");
+					}
+				} else throw ExecutorRuntimeException("error in expression");
+
+			}
+			case NodeType::Float: {
+
+				if (type == InstructionType::ADD ||
+					type == InstructionType::SUBTRACT ||
+					type == InstructionType::MULTIPLY ||
+					type == InstructionType::DIVIDE) {
+					auto i = executed;
+					auto acc = MakeNode<NodeFloat>(reinterpret_cast<NodeFloat*>(&**i)->Value);
+					for (i++; i != executed + count; i++) {
+						if ((*i)->GetNodeType() != NodeType::Float) throw ExecutorRuntimeException("unexpected type in an arithmetic float expression");
+						auto val = reinterpret_cast<NodeFloat*>(&**i)->Value;
+						switch (type) {
+							case InstructionType::ADD: acc->Value += val;
+								break;
+							case InstructionType::SUBTRACT: acc->Value -= val;
+								break;
+							case InstructionType::MULTIPLY: acc->Value *= val;
+								break;
+							case InstructionType::DIVIDE: acc->Value /= val;
+								break;
+							default: throw ExecutorImplementationException("unhandled infix float operator");
 						}
 					}
+					return acc;
+				} else if (executed[0]->GetNodeType() == executed[1]->GetNodeType()) {
+					auto& a = reinterpret_cast<NodeFloat&>(*executed[0]);
+					auto& b = reinterpret_cast<NodeFloat&>(*executed[1]);
+					switch (type) {
+						case InstructionType::COMP_EQ: return MakeNode<NodeBit>(a.Value == b.Value);
+						case InstructionType::COMP_NE: return MakeNode<NodeBit>(a.Value != b.Value);
+						case InstructionType::COMP_LE: return MakeNode<NodeBit>(a.Value <= b.Value);
+						case InstructionType::COMP_GE: return MakeNode<NodeBit>(a.Value >= b.Value);
+						case InstructionType::COMP_LT: return MakeNode<NodeBit>(a.Value < b.Value);
+						case InstructionType::COMP_GT: return MakeNode<NodeBit>(a.Value > b.Value);
+						default: throw ExecutorImplementationException("unhandled infix float comparison");
+					}
 				}
-				case NodeType::String: {
-					//if (executed[1]->GetNodeType()!=NodeType::String) throw ExecutorRuntimeException("non string value in string expression");
-					auto& left = reinterpret_cast<NodeString&>(*executed[0]);
-					NodeString* right = nullptr;
-
-					if (node.CommandType != InstructionType::MULTIPLY) {
-						if (executed[1]->GetNodeType() != NodeType::String) {
-							throw ExecutorRuntimeException("non string value in string expression");
-						} else {
-							right = reinterpret_cast<NodeString*>(&*executed[1]);
-						}
+			}
+			case NodeType::String: {
+				//if (executed[1]->GetNodeType()!=NodeType::String) throw ExecutorRuntimeException("non string value in string expression");
+				auto& left = reinterpret_cast<NodeString&>(*executed[0]);
+				NodeString* right = nullptr;
+
+				if (type != InstructionType::MULTIPLY) {
+					if (executed[1]->GetNodeType() != NodeType::String) {
+						throw ExecutorRuntimeException("non string value in string expression");
+					} else {
+						right = reinterpret_cast<NodeString*>(&*executed[1]);
 					}
+				}
 
-					switch (node.CommandType) {
-						case InstructionType::ADD: {
-							std::string acc = left.Value;
-							for (unsigned i = 1; i < executed.size(); i++) {
-								if (executed[i]->GetNodeType() == NodeType::String) {
-									acc += reinterpret_cast<NodeString&>(*executed[i]).Value;
-								} else throw ExecutorRuntimeException("non string value in string concatenation");
-							}
-							return std::make_shared<NodeString>(acc);
+				switch (type) {
+					case InstructionType::ADD: {
+						std::string acc = left.Value;
+						for (unsigned i = 1; i < count; i++) {
+							if (executed[i]->GetNodeType() == NodeType::String) {
+								acc += reinterpret_cast<NodeString&>(*executed[i]).Value;
+							} else throw ExecutorRuntimeException("non string value in string concatenation");
 						}
-						case InstructionType::MULTIPLY:
-							if (executed.size() == 2) {
-								if (executed[1]->GetNodeType() == NodeType::Integer) {
-									auto ival = reinterpret_cast<NodeInteger&>(*executed[1]).Value;
-									std::string result;
-									result.reserve(left.Value.size() * ival);
-									while (ival--) result += left.Value;
-									return std::make_shared<NodeString>(result);
-								} else throw ExecutorRuntimeException("multiplication is not defined between the given arguments (try string * int)");
-							} else throw ExecutorRuntimeException("multiplication when left side is string is only valid with an integer");
-							break;
-						case InstructionType::COMP_EQ: return std::make_shared<NodeBit>(left.Value == right->Value);
-						case InstructionType::COMP_NE: return std::make_shared<NodeBit>(left.Value != right->Value);
-						case InstructionType::COMP_GE: return std::make_shared<NodeBit>(left.Value >= right->Value);
-						case InstructionType::COMP_LE: return std::make_shared<NodeBit>(left.Value <= right->Value);
-						case InstructionType::COMP_GT: return std::make_shared<NodeBit>(left.Value > right->Value);
-						case InstructionType::COMP_LT: return std::make_shared<NodeBit>(left.Value < right->Value);
-						default: throw ExecutorRuntimeException("string doesn't support the requested command");
+						return MakeNode<NodeString>(acc);
 					}
+					case InstructionType::MULTIPLY:
+						if (count == 2) {
+							if (executed[1]->GetNodeType() == NodeType::Integer) {
+								auto ival = reinterpret_cast<NodeInteger&>(*executed[1]).Value;
+								std::string result;
+								result.reserve(left.Value.size() * ival);
+								while (ival--) result += left.Value;
+								return MakeNode<NodeString>(result);
+							} else throw ExecutorRuntimeException("multiplication is not defined between the given arguments (try string * int)");
+						} else throw ExecutorRuntimeException("multiplication when left side is string is only valid with an integer");
+						break;
+					case InstructionType::COMP_EQ: return MakeNode<NodeBit>(left.Value == right->Value);
+					case InstructionType::COMP_NE: return MakeNode<NodeBit>(left.Value != right->Value);
+					case InstructionType::COMP_GE: return MakeNode<NodeBit>(left.Value >= right->Value);
+					case InstructionType::COMP_LE: return MakeNode<NodeBit>(left.Value <= right->Value);
+					case InstructionType::COMP_GT: return MakeNode<NodeBit>(left.Value > right->Value);
+					case InstructionType::COMP_LT: return MakeNode<NodeBit>(left.Value < right->Value);
+					default: throw ExecutorRuntimeException("string doesn't support the requested command");
 				}
-				case NodeType::Bits: {
-					//if (executed[1]->GetNodeType()!=NodeType::String) throw ExecutorRuntimeException("non string value in string expression");
-					auto& left = reinterpret_cast<NodeBits&>(*executed[0]);
-					NodeBits* right = nullptr;
-
-					if (node.CommandType != InstructionType::MULTIPLY) {
-						if (executed[1]->GetNodeType() != NodeType::Bits) {
-							throw ExecutorRuntimeException("non binseq value in string expression");
-						} else {
-							right = reinterpret_cast<NodeBits*>(&*executed[1]);
-						}
+			}
+			case NodeType::Bits: {
+				//if (executed[1]->GetNodeType()!=NodeType::String) throw ExecutorRuntimeException("non string value in string expression");
+				auto& left = reinterpret_cast<NodeBits&>(*executed[0]);
+				NodeBits* right = nullptr;
+
+				if (type != InstructionType::MULTIPLY) {
+					if (executed[1]->GetNodeType() != NodeType::Bits) {
+						throw ExecutorRuntimeException("non binseq value in string expression");
+					} else {
+						right = reinterpret_cast<NodeBits*>(&*executed[1]);
 					}
+				}
 
-					switch (node.CommandType) {
-						case InstructionType::ADD: {
-							binseq::bit_sequence acc = left.Value;
-							for (unsigned i = 1; i < executed.size(); i++) {
-								if (executed[i]->GetNodeType() == NodeType::Bits) {
-									acc = acc + reinterpret_cast<NodeBits&>(*executed[i]).Value;
-								} else throw ExecutorRuntimeException("non binseq value in binseq concatenation");
-							}
-							return std::make_shared<NodeBits>(std::move(acc));
+				switch (type) {
+					case InstructionType::ADD: {
+						binseq::bit_sequence acc = left.Value;
+						for (unsigned i = 1; i < count; i++) {
+							if (executed[i]->GetNodeType() == NodeType::Bits) {
+								acc = acc + reinterpret_cast<NodeBits&>(*executed[i]).Value;
+							} else throw ExecutorRuntimeException("non binseq value in binseq concatenation");
 						}
-						case InstructionType::MULTIPLY:
-							if (executed.size() == 2) {
-								if (executed[1]->GetNodeType() == NodeType::Integer) {
-									auto ival = reinterpret_cast<NodeInteger&>(*executed[1]).Value;
-									binseq::bit_sequence result;
-									while (ival--) result = result + left.Value;
-									return std::make_shared<NodeBits>(std::move(result));
-								} else throw ExecutorRuntimeException("multiplication is not defined between the given arguments (try binseq * int)");
-							} else throw ExecutorRuntimeException("multiplication when left side is binseq is only valid with an integer");
-							break;
-						case InstructionType::COMP_EQ: return std::make_shared<NodeBit>(left.Value == right->Value);
-						case InstructionType::COMP_NE: return std::make_shared<NodeBit>(left.Value != right->Value);
-						case InstructionType::COMP_GE: return std::make_shared<NodeBit>(left.Value >= right->Value);
-						case InstructionType::COMP_LE: return std::make_shared<NodeBit>(left.Value <= right->Value);
-						case InstructionType::COMP_GT: return std::make_shared<NodeBit>(left.Value > right->Value);
-						case InstructionType::COMP_LT: return std::make_shared<NodeBit>(left.Value < right->Value);
-						default: throw ExecutorRuntimeException("binseq doesn't support the requested command");
+						return MakeNode<NodeBits>(std::move(acc));
 					}
+					case InstructionType::MULTIPLY:
+						if (count == 2) {
+							if (executed[1]->GetNodeType() == NodeType::Integer) {
+								auto ival = reinterpret_cast<NodeInteger&>(*executed[1]).Value;
+								binseq::bit_sequence result;
+								while (ival--) result = result + left.Value;
+								return MakeNode<NodeBits>(std::move(result));
+							} else throw ExecutorRuntimeException("multiplication is not defined between the given arguments (try binseq * int)");
+						} else throw ExecutorRuntimeException("multiplication when left side is binseq is only valid with an integer");
+						break;
+					case InstructionType::COMP_EQ: return MakeNode<NodeBit>(left.Value == right->Value);
+					case InstructionType::COMP_NE: return MakeNode<NodeBit>(left.Value != right->Value);
+					case InstructionType::COMP_GE: return MakeNode<NodeBit>(left.Value >= right->Value);
+					case InstructionType::COMP_LE: return MakeNode<NodeBit>(left.Value <= right->Value);
+					case InstructionType::COMP_GT: return MakeNode<NodeBit>(left.Value > right->Value);
+					case InstructionType::COMP_LT: return MakeNode<NodeBit>(left.Value < right->Value);
+					default: throw ExecutorRuntimeException("binseq doesn't support the requested command");
 				}
-				case NodeType::DynamicArray: {
-					auto& left = reinterpret_cast<NodeArray&>(*executed[0]);
-					NodeArray* right = nullptr;
+			}
+			case NodeType::DynamicArray: {
+				auto& left = reinterpret_cast<NodeArray&>(*executed[0]);
+				NodeArray* right = nullptr;
 
-					if (node.CommandType != InstructionType::MULTIPLY) {
-						if (executed[1]->GetNodeType() != NodeType::DynamicArray) {
-							throw ExecutorRuntimeException("non array value in string expression");
-						} else {
-							right = reinterpret_cast<NodeArray*>(&*executed[1]);
-						}
+				if (type != InstructionType::MULTIPLY) {
+					if (executed[1]->GetNodeType() != NodeType::DynamicArray) {
+						throw ExecutorRuntimeException("non array value in string expression");
+					} else {
+						right = reinterpret_cast<NodeArray*>(&*executed[1]);
 					}
+				}
 
-					switch (node.CommandType) {
-						case InstructionType::ADD: {
-							auto acc = std::make_shared<NodeArray>();
-							for (unsigned i = 1; i < executed.size(); i++) {
-								acc->Vector = left.Vector; //copy
-								if (executed[i]->GetNodeType() == NodeType::DynamicArray) {
-									auto& other = reinterpret_cast<NodeArray&>(*executed[i]).Vector;
+				switch (type) {
+					case InstructionType::ADD: {
+						auto acc = MakeNode<NodeArray>();
+						for (unsigned i = 1; i < count; i++) {
+							acc->Vector = left.Vector; //copy
+							if (executed[i]->GetNodeType() == NodeType::DynamicArray) {
+								auto& other = reinterpret_cast<NodeArray&>(*executed[i]).Vector;
+								for (auto i = other.begin(); i != other.end(); i++) {
+									acc->Vector.push_back(*i);
+								}
+							} else throw ExecutorRuntimeException("non array value in array concatenation");
+						}
+						return acc;
+					}
+					case InstructionType::MULTIPLY:
+						if (count == 2) {
+							if (executed[1]->GetNodeType() == NodeType::DynamicArray) {
+								auto ival = reinterpret_cast<NodeInteger&>(*executed[1]).Value;
+								auto acc = MakeNode<NodeArray>();
+								while (ival--) {
+									auto& other = left.Vector;
 									for (auto i = other.begin(); i != other.end(); i++) {
 										acc->Vector.push_back(*i);
 									}
-								} else throw ExecutorRuntimeException("non array value in array concatenation");
-							}
-							return acc;
-						}
-						case InstructionType::MULTIPLY:
-							if (executed.size() == 2) {
-								if (executed[1]->GetNodeType() == NodeType::DynamicArray) {
-									auto ival = reinterpret_cast<NodeInteger&>(*executed[1]).Value;
-									auto acc = std::make_shared<NodeArray>();
-									while (ival--) {
-										auto& other = left.Vector;
-										for (auto i = other.begin(); i != other.end(); i++) {
-											acc->Vector.push_back(*i);
-										}
-									};
-									return acc;
-								} else throw ExecutorRuntimeException("multiplication is not defined between the given arguments (try array * int)");
-							} else throw ExecutorRuntimeException("multiplication when left side is array is only valid with an integer");
-							break;
-						default: throw ExecutorRuntimeException("binseq doesn't support the requested command");
-					}
+								};
+								return acc;
+							} else throw ExecutorRuntimeException("multiplication is not defined between the given arguments (try array * int)");
+						} else throw ExecutorRuntimeException("multiplication when left side is array is only valid with an integer");
+						break;
+					default: throw ExecutorRuntimeException("binseq doesn't support the requested command");
 				}
-				case NodeType::Bit: {
-					if (node.CommandType == InstructionType::ADD ||
-						node.CommandType == InstructionType::MULTIPLY) {
-						auto i = executed.begin();
-						auto acc = std::make_shared<NodeBit>(reinterpret_cast<NodeBit*>(&**i)->Value);
-						for (i++; i != executed.end(); i++) {
-							if ((*i)->GetNodeType() != NodeType::Bit) throw ExecutorRuntimeException("unexpected type in a bit expression");
-							auto val = reinterpret_cast<NodeBit*>(&**i)->Value;
-							switch (node.CommandType) {
-								case InstructionType::ADD: acc->Value = acc->Value || val;
-									break;
-								case InstructionType::MULTIPLY: acc->Value = acc->Value && val;
-									break;
-								default: throw ExecutorImplementationException("unhandled bit operator");
-							}
-						}
-						return acc;
-					} else if (executed[0]->GetNodeType() == executed[1]->GetNodeType()) {
-						auto& a = reinterpret_cast<NodeBit&>(*executed[0]);
-						auto& b = reinterpret_cast<NodeBit&>(*executed[1]);
-						switch (node.CommandType) {
-							case InstructionType::COMP_EQ: return std::make_shared<NodeBit>(a.Value == b.Value);
-							case InstructionType::COMP_NE: return std::make_shared<NodeBit>(a.Value != b.Value);
-							default: throw ExecutorRuntimeException("unhandled bit comparison");
+			}
+			case NodeType::Bit: {
+				if (type == InstructionType::ADD ||
+					type == InstructionType::MULTIPLY) {
+					auto i = executed;
+					auto acc = MakeNode<NodeBit>(reinterpret_cast<NodeBit*>(&**i)->Value);
+					for (i++; i != executed + count; i++) {
+						if ((*i)->GetNodeType() != NodeType::Bit) throw ExecutorRuntimeException("unexpected type in a bit expression");
+						auto val = reinterpret_cast<NodeBit*>(&**i)->Value;
+						switch (type) {
+							case InstructionType::ADD: acc->Value = acc->Value || val;
+								break;
+							case InstructionType::MULTIPLY: acc->Value = acc->Value && val;
+								break;
+							default: throw ExecutorImplementationException("unhandled bit operator");
 						}
-					} else throw ExecutorRuntimeException("error in expression");
-
-				}
-				case NodeType::None: {
-					if (executed.size() != 2) {
-						throw ExecutorRuntimeException("expression with void are only valid with 2 operands");
 					}
-					switch (node.CommandType) {
-						case InstructionType::COMP_EQ: return std::make_shared<NodeBit>(executed[1]->GetNodeType() == NodeType::None);
-						case InstructionType::COMP_NE: return std::make_shared<NodeBit>(executed[1]->GetNodeType() != NodeType::None);
-						default: throw ExecutorRuntimeException("cannot perform requested operation on void type");
+					return acc;
+				} else if (executed[0]->GetNodeType() == executed[1]->GetNodeType()) {
+					auto& a = reinterpret_cast<NodeBit&>(*executed[0]);
+					auto& b = reinterpret_cast<NodeBit&>(*executed[1]);
+					switch (type) {
+						case InstructionType::COMP_EQ: return MakeNode<NodeBit>(a.Value == b.Value);
+						case InstructionType::COMP_NE: return MakeNode<NodeBit>(a.Value != b.Value);
+						default: throw ExecutorRuntimeException("unhandled bit comparison");
 					}
+				} else throw ExecutorRuntimeException("error in expression");
+
+			}
+			case NodeType::BitMatrix: {
+				if (count != 2 || executed[1]->GetNodeType() != NodeType::BitMatrix) {
+					throw ExecutorRuntimeException("bitmatrix can only be compared with a bitmatrix");
+				}
+				auto& a = reinterpret_cast<NodeBitMatrix&>(*executed[0]).Value;
+				auto& b = reinterpret_cast<NodeBitMatrix&>(*executed[1]).Value;
+				switch (type) {
+					case InstructionType::COMP_EQ: return MakeNode<NodeBit>(a == b);
+					case InstructionType::COMP_NE: return MakeNode<NodeBit>(a != b);
+					default: throw ExecutorRuntimeException("bitmatrix only supports == and !=");
 				}
-				default:
-					throw ExecutorRuntimeException(std::string("arithmetic operators not implemented for ") + (GetTypeText(executed[0]->GetNodeType())));
 			}
-		} else throw ExecutorImplementationException("arithmetic operators need to have at least 2 arguments");
-
-	}
-
-	inline std::shared_ptr<Node> ExecutorImp::ExecuteMemberOperator(NodeCommand& node) {
-		if (node.Children.size() == 2) {
-			auto lvalue = ExecuteStatement(node.Children[0]);
-			auto rvalue = reinterpret_cast<Node*>(&*node.Children[1]);
-			if (rvalue->GetNodeType() == NodeType::Atom) {
-				auto atom = reinterpret_cast<NodeAtom*>(rvalue);
-				if (atom->GetAtomType() == InstructionType::ID) {
-					auto& idx = atom->AtomText;
-					if (lvalue->GetNodeType() == NodeType::DynamicObject) {
-						auto& object = reinterpret_cast<NodeObject&>(*lvalue);
-						auto result = object.GetAttributeValue(idx);
-						if (result != nullptr)
-							return result;
-						else
-							return std::make_shared<Node>(NodeType::None);
-					}
-					else throw ExecutorRuntimeException("left side of an object member operator must be an object");
+			case NodeType::None: {
+				if (count != 2) {
+					throw ExecutorRuntimeException("expression with void are only valid with 2 operands");
+				}
+				switch (type) {
+					case InstructionType::COMP_EQ: return MakeNode<NodeBit>(executed[1]->GetNodeType() == NodeType::None);
+					case InstructionType::COMP_NE: return MakeNode<NodeBit>(executed[1]->GetNodeType() != NodeType::None);
+					default: throw ExecutorRuntimeException("cannot perform requested operation on void type");
 				}
-				else throw ExecutorRuntimeException(atom->AtomText + " is not a valid indentifier");
 			}
-			else throw ExecutorRuntimeException("right side of an object member operator must be an identifier");
+			default:
+				throw ExecutorRuntimeException(std::string("arithmetic operators not implemented for ") + (GetTypeText(executed[0]->GetNodeType())));
 		}
-		else throw ExecutorImplementationException("Member operator requires 2 parameters.");
 	}
 
-	inline std::shared_ptr<Node> ExecutorImp::ExecuteStructureFactory(NodeStructureFactory& node)
-	{
-		if (node.IsObjectFactory) {
-			auto object = std::make_shared<NodeObject>();
-			for (size_t i = 0; i < node.Expressions.size(); i++) {
-				const auto& expression = node.Expressions[i];
-				const auto& key = node.KeysIds[i];
-				object->SetAttributeValue(key, ExecuteStatement(expression));
-			}
-			return object;
-		}
-		else if (node.IsArrayFactory)
-		{
-			auto array = std::make_shared<NodeArray>();
-			array->Vector.resize(node.Expressions.size());
-			for (size_t i = 0; i < node.Expressions.size(); i++) {
-				const auto& expression = node.Expressions[i];
-				array->Vector[i] = ExecuteStatement(expression);
-			}
-			return array;
-		}
-		else
-		{
-			throw ExecutorRuntimeException("invalid structure factory");
+	inline Value& ExecutorImp::Lookup(int slot, LookupMode mode) {
+		switch (mode) {
+			case LookupMode::Search: return SymbolTable.Find(slot);
+			case LookupMode::Local: return SymbolTable.Local(slot);
+			default: return SymbolTable.LocalMode ? SymbolTable.Local(slot) : SymbolTable.Find(slot);
 		}
 	}
 
-	inline std::shared_ptr<Node> ExecutorImp::ExecuteAssignment(NodeCommand& node) {
-		if (node.Children.size() == 2) {
-			Node* lvalue = &*node.Children[0];
+	static const Ref<Node> noneValue = MakeNode<Node>(NodeType::None);
 
-			auto savedLocalState = SymbolTable.LocalMode;
-			SymbolTable.LocalMode = false;
-			auto rvalue = ExecuteStatement(node.Children[1]);
-			SymbolTable.LocalMode = savedLocalState;
+	static const size_t registerSegmentSize = 4096;
 
-			bool isLocalAssign = false;
-			if (lvalue->IsCommand() && lvalue->GetCommandType() == InstructionType::LOCAL) {
-				lvalue = &*(reinterpret_cast<NodeCommand*>(lvalue))->Children[0];
-				isLocalAssign = true;
-			}
+	// Registers and native argument lists of the calls running on one thread.
+	// The storage is kept for the next call, so calls and blocks do not
+	// allocate once the thread has reached its deepest recursion. Registers
+	// come from fixed segments which never move, a frame stays valid while
+	// deeper calls open more segments.
+	class CallStack {
+	public:
+		class Frame {
+		public:
+			Value* Registers;
+			Frame(CallStack& stack, int count);
+			~Frame(); // releases the values left in the registers
+		private:
+			CallStack& stack;
+			size_t segment;
+			size_t top;
+			int count;
+		};
+		class Arguments {
+		public:
+			std::vector<Ref<Node>>& List;
+			Arguments(CallStack& stack, Value* arguments, size_t count); // boxed
+			~Arguments();
+		private:
+			CallStack& stack;
+		};
+		static CallStack& Current();
+	private:
+		std::vector<std::vector<Value>> segments;
+		size_t segment = 0;
+		size_t top = 0;
+		std::deque<std::vector<Ref<Node>>> argumentLists;
+		size_t argumentDepth = 0;
+		std::vector<Ref<Node>>& NextArguments();
+	};
 
-			if (lvalue->GetNodeType() == NodeType::Atom) {
-				auto atom = reinterpret_cast<NodeAtom*>(lvalue);
-				if (atom->GetAtomType() == InstructionType::ID) {
-					if (isLocalAssign) {
-						return this->SymbolTable.Local(atom->AtomText) = rvalue;
-					}
-					else {
-						return this->SymbolTable[atom->AtomText] = rvalue;
-					}
-				} else throw ExecutorRuntimeException(atom->AtomText + " is not a valid indentifier");
-			} 
-			else if (lvalue->GetCommandType() == InstructionType::MEMBER)
-			{
-				auto& member = reinterpret_cast<NodeCommand&>(*lvalue);
-				auto container = ExecuteStatement(member.Children[0]);
-				if (container->GetNodeType() != NodeType::DynamicObject)
-					throw ExecutorRuntimeException("left side of member operator is not an object");
-				auto& object = reinterpret_cast<NodeObject&>(*container);
-				auto& index = member.Children[1];
-				if (index->GetAtomType() != InstructionType::ID)
-					throw ExecutorRuntimeException("right side of member oeprator is not an identifier");
-				auto& idx = reinterpret_cast<NodeAtom&>(*index).AtomText;
-				object.SetAttributeValue(idx, rvalue);
-				return rvalue;
-			}
-			else {
-				printf("CT %d\n", lvalue->GetCommandType());
-			}
-			throw ExecutorRuntimeException("left side of an assignment must be an identifier");
-		} else throw ExecutorImplementationException("Assignment requires 2 parameters.");
-	}
-
-	inline std::shared_ptr<Node> ExecutorImp::ExecuteBlock(NodeCommand& node) {
-		std::shared_ptr<Node> result;
-		for (auto i = node.Children.begin(); i != node.Children.end(); i++) {
-			result = ExecuteStatement(*i);
-			switch (result->GetNodeType()) {
-				case NodeType::Error: return result;
-				case NodeType::Return: return result;
-				case NodeType::Break: return result;
-				case NodeType::Continue: return result;
-				default: continue;
-			}
-		}
-		return result;
+	CallStack& CallStack::Current() {
+		static thread_local CallStack stack;
+		return stack;
 	}
 
-	inline std::shared_ptr<Node> ExecutorImp::ExecuteConditional(NodeCommand& node) {
-		std::shared_ptr<Node> result;
-		auto cond = ExecuteStatement(node.Children[0]);
-		if (cond->GetNodeType() == NodeType::Bit) {
-			if (reinterpret_cast<NodeBit&>(*cond).Value) {
-				return ExecuteStatement(node.Children[1]);
-			} else if (node.Children.size() == 3) {
-				return ExecuteStatement(node.Children[2]);
-			} else {
-				return std::make_shared<Node>(NodeType::None);
-			}
-		} else throw ExecutorRuntimeException("condition is not a bit");
-		return std::make_shared<Node>(NodeType::None);
+	std::vector<Ref<Node>>& CallStack::NextArguments() {
+		if (argumentDepth == argumentLists.size()) argumentLists.emplace_back();
+		return argumentLists[argumentDepth++];
 	}
 
-	inline std::shared_ptr<Node> ExecutorImp::ExecuteLoop(NodeCommand& node) {
-		std::shared_ptr<Node> result, init = nullptr, cond = nullptr, iterate = nullptr, body;
-		switch (node.Children.size()) {
-			case 1:
-				cond = std::make_shared<NodeBit>(true);
-				body = node.Children[0];
-				break;
-			case 2:
-				cond = node.Children[0];
-				body = node.Children[1];
-				break;
-			case 3:
-				cond = node.Children[0];
-				iterate = node.Children[1];
-				body = node.Children[2];
-				break;
-			case 4:
-				init = node.Children[0];
-				cond = node.Children[1];
-				iterate = node.Children[2];
-				body = node.Children[3];
-				break;
-			default: throw ExecutorImplementationException("loop expects 1 or 2 or 3 or 4 children");
-		}
-
-		if (init != nullptr) ExecuteStatement(init);
-
-		while (true) {
-			auto condResult = ExecuteStatement(cond);
-			if (condResult->GetNodeType() == NodeType::Bit) {
-				if (reinterpret_cast<NodeBit&>(*condResult).Value) {
-					auto result = ExecuteStatement(body);
-					if (result == nullptr || result->GetNodeType() == NodeType::Break)
-						return std::make_shared<Node>(NodeType::None);
-					if (result->GetNodeType() == NodeType::Return)
-						return result;
-					if (iterate != nullptr) ExecuteStatement(iterate);
-				} else {
-					break;
-				}
-			} else throw ExecutorRuntimeException("condition did not evaluate to a bit");
+	CallStack::Frame::Frame(CallStack& stack, int count)
+		: stack(stack), segment(stack.segment), top(stack.top), count(count) {
+		size_t size = (size_t)count;
+		if (stack.segments.empty()) {
+			stack.segments.emplace_back(std::max(registerSegmentSize, size));
+		} else if (stack.top + size > stack.segments[stack.segment].size()) {
+			stack.segment++;
+			stack.top = 0;
+			if (stack.segment == stack.segments.size()) stack.segments.emplace_back(std::max(registerSegmentSize, size));
+			else if (stack.segments[stack.segment].size() < size) stack.segments[stack.segment].resize(size);
 		}
-		return std::make_shared<Node>(NodeType::None);
+		Registers = stack.segments[stack.segment].data() + stack.top;
+		stack.top += size;
 	}
 
-	inline std::shared_ptr<Node> ExecutorImp::ExecuteCommand(NodeCommand& node) {
-		std::shared_ptr<Node> result;
-		const char* imp_error = nullptr;
-		bool pushpop = node.DoesPushStack;
+	CallStack::Frame::~Frame() {
+		for (int i = 0; i < count; i++) Registers[i] = Value();
+		stack.segment = segment;
+		stack.top = top;
+	}
 
-		if (pushpop)
-			SymbolTable.Push();
+	CallStack::Arguments::Arguments(CallStack& stack, Value* arguments, size_t count)
+		: List(stack.NextArguments()), stack(stack) {
+		for (size_t i = 0; i < count; i++) List.push_back(arguments[i].Box());
+	}
 
-		switch (node.CommandType) {
-				//arithmetic
-			case InstructionType::ADD:
-			case InstructionType::SUBTRACT:
-			case InstructionType::MULTIPLY:
-			case InstructionType::DIVIDE:
-			case InstructionType::COMP_EQ:
-			case InstructionType::COMP_NE:
-			case InstructionType::COMP_LE:
-			case InstructionType::COMP_GE:
-			case InstructionType::COMP_LT:
-			case InstructionType::COMP_GT:
-				result = ExecuteInfixArithmetic(node);
-				break;
-				//arithmetic prefix
-			case InstructionType::NEGATIVE:
-			case InstructionType::POSITIVE:
-				result = ExecutePrefixArithmetic(node);
-				break;
-				//assignment :)
-			case InstructionType::ASSIGN:
-				result = ExecuteAssignment(node);
-				break;
-				//object member operator
-			case InstructionType::MEMBER:
-				result = ExecuteMemberOperator(node);
-				break;
-				//function calls
-			case InstructionType::CALL:
-				result = ExecuteCall(node);
-				break;
-			case InstructionType::BLOCK:
-				result = ExecuteBlock(node);
-				break;
-			case InstructionType::LOCAL: {
-				auto state = SymbolTable.LocalMode;
-				SymbolTable.LocalMode = true;
-				result = ExecuteBlock(node);
-				SymbolTable.LocalMode = state;
-			}
-				break;
-			case InstructionType::LOOP0:
-			case InstructionType::LOOP1:
-			case InstructionType::LOOP2:
-			case InstructionType::LOOP3:
-				result = ExecuteLoop(node);
-				break;
-			case InstructionType::IF:
-			case InstructionType::IFELSE:
-				result = ExecuteConditional(node);
-				break;
-			case InstructionType::BREAK:
-				result = std::make_shared<Node>(NodeType::Break);
-				break;
-			case InstructionType::CONTINUE:
-				result = std::make_shared<Node>(NodeType::Continue);
-				break;
-			case InstructionType::RETURN0:
-				result = std::make_shared<NodeReturn>(std::make_shared<Node>(NodeType::None));
-				break;
-			case InstructionType::RETURN1:
-				result = std::make_shared<NodeReturn>(ExecuteBlock(node));
-				break;
-			case InstructionType::BLOCKBEGIN:
-			case InstructionType::BLOCKEND:
-			case InstructionType::CALLBEGIN:
-			case InstructionType::CALLEND:
-			case InstructionType::END_STATEMENT: throw ExecutorImplementationException("should have been processed");
-			case InstructionType::COMMA: throw ExecutorImplementationException("the \",\" operator  should only be used for separating function parameters");
-			default: throw ExecutorImplementationException("unhandled case");
+	CallStack::Arguments::~Arguments() {
+		List.clear();
+		stack.argumentDepth--;
+	}
+
+	// values which can be computed in advance and put back into the code,
+	// containers are left out because every evaluation makes a new one
+	static bool IsFoldable(NodeType type) {
+		switch (type) {
+			case NodeType::Integer:
+			case NodeType::Float:
+			case NodeType::Bit:
+			case NodeType::String:
+			case NodeType::Bits:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	// the literal value of a node folded or written in the source, null
+	// for anything which has to be evaluated
+	static Ref<Node> FoldedValue(const Ref<Node>& node) {
+		if (node->IsCommand()) {
+			auto& command = reinterpret_cast<NodeCommand&>(*node);
+			return command.CommandType == InstructionType::CONSTANT ? command.Children[0] : nullptr;
 		}
+		return IsFoldable(node->GetNodeType()) ? node : nullptr;
+	}
 
-		if (pushpop)
-			SymbolTable.Pop();
+	// folded strings and binary sequences are copied on every evaluation
+	// because natives like set change them in place
+	static Ref<Node> FoldedNode(Ref<Node> value) {
+		switch (value->GetNodeType()) {
+			case NodeType::String:
+			case NodeType::Bits: {
+				auto constant = MakeNode<NodeCommand>(InstructionType::CONSTANT);
+				constant->Children.push_back(std::move(value));
+				return constant;
+			}
+			default:
+				return value;
+		}
+	}
 
-		return result;
+	static Value CopyConstant(const Value& value) {
+		switch (value.GetNodeType()) {
+			case NodeType::String: return Value(MakeNode<NodeString>(reinterpret_cast<NodeString&>(value.GetNode()).Value));
+			case NodeType::Bits: return Value(MakeNode<NodeBits>(reinterpret_cast<NodeBits&>(value.GetNode()).Value));
+			default: return value;
+		}
 	}
 
-	std::shared_ptr<Node> ExecutorImp::ExecuteStatement(std::shared_ptr<Node> node) {
+	// Replaces operators on literals with their value, bottom up so nested
+	// expressions fold completely. Runs over the statements before they are
+	// compiled and over the bodies of functions which were not called yet,
+	// operators which fail are left to report the error when they run.
+	Ref<Node> ExecutorImp::FoldConstants(const Ref<Node>& node) {
 		switch (node->GetNodeType()) {
-			case NodeType::Command:
-				//pass by simple reference, we're already holding the shared ptr at least 2 times
-				return ExecuteCommand(reinterpret_cast<NodeCommand&>(*node));
-			case NodeType::Atom: {
-				auto id = reinterpret_cast<NodeAtom&>(*node);
-				if (id.GetAtomType() == InstructionType::ID) {
-					auto ptr = SymbolTable[id.AtomText];
-					if (ptr != nullptr)
-						return ptr;
-					else
-						throw ExecutorRuntimeException(id.AtomText + " is undefined");
-				} else return node;
+			case NodeType::StrctureFactory: {
+				auto& structure = reinterpret_cast<NodeStructureFactory&>(*node);
+				for (auto& expression : structure.Expressions) expression = FoldConstants(expression);
+				return node;
 			}
-			case NodeType::StrctureFactory:
-				return ExecuteStructureFactory(reinterpret_cast<NodeStructureFactory&>(*node));
+			case NodeType::Function: {
+				auto& function = reinterpret_cast<NodeFunction&>(*node);
+				if (!function.Native && function.Bytecode == nullptr && function.Implementation != nullptr) {
+					function.Implementation = FoldConstants(function.Implementation);
+				}
+				return node;
+			}
+			case NodeType::Command:
+				break;
 			default:
 				return node;
 		}
+		auto& command = reinterpret_cast<NodeCommand&>(*node);
+		if (command.CommandType == InstructionType::CONSTANT) return node;
+		bool folded = true;
+		for (auto& child : command.Children) {
+			child = FoldConstants(child);
+			folded = folded && FoldedValue(child) != nullptr;
+		}
+		if (!folded || command.Children.empty()) return node;
+		try {
+			Ref<Node> value;
+			switch (command.CommandType) {
+				case InstructionType::POSITIVE:
+				case InstructionType::NEGATIVE:
+					if (command.Children.size() != 1) return node;
+					value = PrefixArithmetic(command.CommandType, FoldedValue(command.Children[0]));
+					break;
+				case InstructionType::ADD:
+				case InstructionType::SUBTRACT:
+				case InstructionType::MULTIPLY:
+				case InstructionType::DIVIDE:
+				case InstructionType::COMP_EQ:
+				case InstructionType::COMP_NE:
+				case InstructionType::COMP_GE:
+				case InstructionType::COMP_LE:
+				case InstructionType::COMP_GT:
+				case InstructionType::COMP_LT: {
+					std::vector<Ref<Node>> operands;
+					for (auto& child : command.Children) operands.push_back(FoldedValue(child));
+					value = InfixArithmetic(command.CommandType, operands.data(), operands.size());
+					break;
+				}
+				default:
+					return node;
+			}
+			if (!IsFoldable(value->GetNodeType())) return node;
+			return FoldedNode(std::move(value));
+		} catch (std::exception&) {
+			return node;
+		}
 	}
 
-	inline std::shared_ptr<Node> ExecutorImp::Error(std::string message) {
+	// where the statements of a batch bind global names, writes are counted
+	// at the top level and only flagged inside functions
+	struct GlobalUse {
+		int Writes = 0;
+		bool FunctionWrites = false;
+		bool Read = false;
+	};
+
+	static void CollectGlobalUses(const Ref<Node>& node, bool inFunction, bool inLocal, std::map<int, GlobalUse>& uses, bool& deletes) {
+		auto write = [&](int slot) {
+			if (inFunction) uses[slot].FunctionWrites = true;
+			else uses[slot].Writes++;
+		};
+		switch (node->GetNodeType()) {
+			case NodeType::Atom: {
+				auto& atom = reinterpret_cast<NodeAtom&>(*node);
+				if (atom.Slot < 0) break;
+				uses[atom.Slot].Read = true;
+				if (inLocal) write(atom.Slot);
+				if (atom.AtomText == "delete") deletes = true;
+				break;
+			}
+			case NodeType::Command: {
+				auto& command = reinterpret_cast<NodeCommand&>(*node);
+				if (command.CommandType == InstructionType::ASSIGN && !command.Children.empty()) {
+					Node* target = &*command.Children[0];
+					if (target->IsCommand() && target->GetCommandType() == InstructionType::LOCAL && !reinterpret_cast<NodeCommand*>(target)->Children.empty()) {
+						target = &*reinterpret_cast<NodeCommand*>(target)->Children[0];
+					}
+					if (target->IsAtom() && reinterpret_cast<NodeAtom*>(target)->Slot >= 0) write(reinterpret_cast<NodeAtom*>(target)->Slot);
+				}
+				bool local = inLocal || command.CommandType == InstructionType::LOCAL;
+				for (auto& child : command.Children) CollectGlobalUses(child, inFunction, local, uses, deletes);
+				break;
+			}
+			case NodeType::StrctureFactory:
+				for (auto& expression : reinterpret_cast<NodeStructureFactory&>(*node).Expressions) {
+					CollectGlobalUses(expression, inFunction, inLocal, uses, deletes);
+				}
+				break;
+			case NodeType::Function: {
+				auto& function = reinterpret_cast<NodeFunction&>(*node);
+				if (function.Native) break;
+				for (int slot : function.ParameterSlots) uses[slot].FunctionWrites = true;
+				if (function.Implementation != nullptr) CollectGlobalUses(function.Implementation, true, false, uses, deletes);
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	// slot a statement assigns directly at the top level, -1 otherwise
+	static int AssignedGlobal(const Ref<Node>& statement) {
+		if (!statement->IsCommand() || statement->GetCommandType() != InstructionType::ASSIGN) return -1;
+		auto& command = reinterpret_cast<NodeCommand&>(*statement);
+		if (command.Children.size() != 2 || !command.Children[0]->IsAtom()) return -1;
+		return reinterpret_cast<NodeAtom&>(*command.Children[0]).Slot;
+	}
+
+	/**
+	 * \brief
+	 * Drops the seal of every global the statements assign and seals the
+	 * ones they only read. A global assigned by exactly one top level
+	 * statement is sealed after that statement runs.
+	 * \return
+	 * Returns the slot to seal after each statement, -1 for none.
+	 */
+	std::vector<int> ExecutorImp::SealGlobals(const std::vector<Ref<Node>>& statements) {
+		std::map<int, GlobalUse> uses;
+		bool deletes = false;
+		for (auto& statement : statements) CollectGlobalUses(statement, false, false, uses, deletes);
+		if (deletes && !SealingDisabled) {
+			SealingDisabled = true;
+			for (size_t slot = 0; slot < Sealed.size(); slot++) Unseal((int)slot);
+		}
+		std::vector<int> seals(statements.size(), -1);
+		if (SealingDisabled) return seals;
+		for (auto& use : uses) {
+			int slot = use.first;
+			if (use.second.FunctionWrites) {
+				if ((int)Unsealable.size() <= slot) Unsealable.resize(slot + 1, false);
+				Unsealable[slot] = true;
+			}
+			bool unsealable = slot < (int)Unsealable.size() && Unsealable[slot];
+			if (unsealable || use.second.Writes > 0) {
+				Unseal(slot);
+				continue;
+			}
+			if (!use.second.Read || (slot < (int)Sealed.size() && !Sealed[slot].IsEmpty())) continue;
+			auto value = SymbolTable.Peek(slot);
+			if (value != nullptr && !value->IsEmpty()) Seal(slot, *value);
+		}
+		for (size_t i = 0; i < statements.size(); i++) {
+			int slot = AssignedGlobal(statements[i]);
+			if (slot < 0) continue;
+			auto& use = uses[slot];
+			if (use.Writes == 1 && !use.FunctionWrites && !(slot < (int)Unsealable.size() && Unsealable[slot])) seals[i] = slot;
+		}
+		return seals;
+	}
+
+	void ExecutorImp::Seal(int slot, const Value& value) {
+		if ((int)Sealed.size() <= slot) Sealed.resize(slot + 1);
+		Sealed[slot] = value;
+	}
+
+	// code built with the old value is not used any more
+	void ExecutorImp::Unseal(int slot) {
+		if (slot >= (int)Sealed.size() || Sealed[slot].IsEmpty()) return;
+		Sealed[slot] = Value();
+		SealEpoch++;
+	}
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define CARBON_COMPUTED_GOTO
+#endif
+
+#ifdef CARBON_COMPUTED_GOTO
+	#define VM_DISPATCH() goto *dispatchTable[static_cast<int>(pc->Op)]
+#else
+	#define VM_DISPATCH() goto dispatch
+#endif
+#define VM_NEXT() do { ++pc; VM_DISPATCH(); } while (0)
+#define VM_JUMP(target) do { pc = code + (target); VM_DISPATCH(); } while (0)
+
+	/**
+	 * \brief 
+	 * Executes a compiled statement or function body on top of the current scope.
+	 * Handlers jump straight to the next one through a table of label addresses
+	 * where the compiler supports it, otherwise through a switch.
+	 * \return 
+	 * Returns the value of the statement, scopes opened by the chunk are closed.
+	 */
+	Value ExecutorImp::Run(const BytecodeChunk& chunk) {
+		CallStack::Frame frame(CallStack::Current(), chunk.RegisterCount);
+		auto R = frame.Registers;
+		auto K = chunk.Constants.data();
+		// the typed code assumes the local mode flag is off when it starts and
+		// that the globals it read were not assigned since
+		bool typed = chunk.Typed != nullptr && TYPE_INFERENCE && !SymbolTable.LocalMode
+			&& (chunk.Typed->Epoch == 0 || chunk.Typed->Epoch == SealEpoch);
+		auto code = typed ? chunk.Typed->Code.data() : chunk.Code.data();
+		auto pc = code;
+		int level = SymbolTable.GetLevel();
+		SymbolTable.Reserve(chunk.SlotCount);
+#ifdef CARBON_COMPUTED_GOTO
+		static void* const dispatchTable[] = {
+			#define CARBON_OPCODE_LABEL(name) &&op_##name,
+			CARBON_OPCODES(CARBON_OPCODE_LABEL)
+			#undef CARBON_OPCODE_LABEL
+		};
+#endif
+		VM_DISPATCH();
+#ifndef CARBON_COMPUTED_GOTO
+	dispatch:
+		switch (pc->Op) {
+			#define CARBON_OPCODE_CASE(name) case OpCode::name: goto op_##name;
+			CARBON_OPCODES(CARBON_OPCODE_CASE)
+			#undef CARBON_OPCODE_CASE
+			default: throw ExecutorImplementationException("invalid opcode");
+		}
+#endif
+
+	op_LoadConstant:
+		R[pc->A] = K[pc->B];
+		VM_NEXT();
+
+	op_CopyConstant:
+		R[pc->A] = CopyConstant(K[pc->B]);
+		VM_NEXT();
+
+	op_GetVariable: {
+		auto& value = Lookup(pc->B, static_cast<LookupMode>(pc->C));
+		if (value.IsEmpty()) throw ExecutorRuntimeException(GetSymbolName(pc->B) + " is undefined");
+		R[pc->A] = value;
+		VM_NEXT();
+	}
+
+	op_SetVariable:
+		Lookup(pc->B, static_cast<LookupMode>(pc->C)) = R[pc->A];
+		VM_NEXT();
+
+	op_SetLocal:
+		SymbolTable.Local(pc->B) = R[pc->A];
+		VM_NEXT();
+
+	op_GetFunction: {
+		auto& value = Lookup(pc->B, static_cast<LookupMode>(pc->C));
+		if (value.GetNodeType() != NodeType::Function)
+			throw ExecutorRuntimeException(GetSymbolName(pc->B) + " is not a function");
+		R[pc->A] = value;
+		VM_NEXT();
+	}
+
+	op_GetMember: {
+		auto& object = R[pc->B];
+		if (object.GetNodeType() != NodeType::DynamicObject)
+			throw ExecutorRuntimeException("left side of an object member operator must be an object");
+		auto& target = reinterpret_cast<NodeObject&>(object.GetNode());
+		auto& member = chunk.Members[pc->C];
+		auto shape = target.GetShape().Id;
+		auto cached = member.Cache.load(std::memory_order_relaxed);
+		int slot = (int)(unsigned)cached;
+		if ((cached >> 32) != shape) {
+			slot = target.GetShape().Find(member.NameId);
+			if (slot >= 0) member.Cache.store(MemberAccess::Entry(shape, slot), std::memory_order_relaxed);
+		}
+		if (slot >= 0) {
+			R[pc->A] = Value(target.GetSlotValue(slot));
+		} else {
+			auto result = target.GetAttributeValue(member.NameId);
+			R[pc->A] = result != nullptr ? Value(std::move(result)) : noneValue;
+		}
+		VM_NEXT();
+	}
+
+	op_SetMember: {
+		auto& container = R[pc->B];
+		if (container.GetNodeType() != NodeType::DynamicObject)
+			throw ExecutorRuntimeException("left side of member operator is not an object");
+		auto& target = reinterpret_cast<NodeObject&>(container.GetNode());
+		auto& member = chunk.Members[pc->C];
+		auto cached = member.Cache.load(std::memory_order_relaxed);
+		if ((cached >> 32) == target.GetShape().Id) {
+			target.SetSlotValue((int)(unsigned)cached, R[pc->A].Box());
+		} else {
+			int slot = target.SetAttributeValue(member.NameId, R[pc->A].Box());
+			member.Cache.store(MemberAccess::Entry(target.GetShape().Id, slot), std::memory_order_relaxed);
+		}
+		VM_NEXT();
+	}
+
+	op_Arithmetic: {
+		auto operands = R + pc->B;
+		if (pc->C == 2 && !pc->Generic && !ConcurrentReferences::Active()) {
+			auto typed = TypedArithmetic(pc->Operator, operands[0].GetNodeType(), operands[1].GetNodeType());
+			if (typed != OpCode::Arithmetic) {
+				pc->Op = typed;
+				VM_DISPATCH();
+			}
+		}
+		if (pc->C == 2) {
+			// same typed scalar operands skip the general operator code
+			auto left = operands[0].GetNodeType(), right = operands[1].GetNodeType();
+			if (left == NodeType::Integer && right == NodeType::Integer) {
+				auto a = operands[0].GetInteger();
+				auto b = operands[1].GetInteger();
+				switch (pc->Operator) {
+					case InstructionType::ADD: R[pc->A] = Value::Integer(a + b); VM_NEXT();
+					case InstructionType::SUBTRACT: R[pc->A] = Value::Integer(a - b); VM_NEXT();
+					case InstructionType::MULTIPLY: R[pc->A] = Value::Integer(a * b); VM_NEXT();
+					case InstructionType::DIVIDE:
+						if (b == 0) throw ExecutorRuntimeException("integer division by 0");
+						R[pc->A] = Value::Integer(a / b);
+						VM_NEXT();
+					case InstructionType::COMP_EQ: R[pc->A] = Value::Bit(a == b); VM_NEXT();
+					case InstructionType::COMP_NE: R[pc->A] = Value::Bit(a != b); VM_NEXT();
+					case InstructionType::COMP_LE: R[pc->A] = Value::Bit(a <= b); VM_NEXT();
+					case InstructionType::COMP_GE: R[pc->A] = Value::Bit(a >= b); VM_NEXT();
+					case InstructionType::COMP_LT: R[pc->A] = Value::Bit(a < b); VM_NEXT();
+					case InstructionType::COMP_GT: R[pc->A] = Value::Bit(a > b); VM_NEXT();
+					default: break;
+				}
+			} else if (left == NodeType::Float && right == NodeType::Float) {
+				auto a = operands[0].GetFloat();
+				auto b = operands[1].GetFloat();
+				switch (pc->Operator) {
+					case InstructionType::ADD: R[pc->A] = Value::Float(a + b); VM_NEXT();
+					case InstructionType::SUBTRACT: R[pc->A] = Value::Float(a - b); VM_NEXT();
+					case InstructionType::MULTIPLY: R[pc->A] = Value::Float(a * b); VM_NEXT();
+					case InstructionType::DIVIDE: R[pc->A] = Value::Float(a / b); VM_NEXT();
+					case InstructionType::COMP_EQ: R[pc->A] = Value::Bit(a == b); VM_NEXT();
+					case InstructionType::COMP_NE: R[pc->A] = Value::Bit(a != b); VM_NEXT();
+					case InstructionType::COMP_LE: R[pc->A] = Value::Bit(a <= b); VM_NEXT();
+					case InstructionType::COMP_GE: R[pc->A] = Value::Bit(a >= b); VM_NEXT();
+					case InstructionType::COMP_LT: R[pc->A] = Value::Bit(a < b); VM_NEXT();
+					case InstructionType::COMP_GT: R[pc->A] = Value::Bit(a > b); VM_NEXT();
+					default: break;
+				}
+			} else if (left == NodeType::Bit && right == NodeType::Bit) {
+				auto a = operands[0].GetBit();
+				auto b = operands[1].GetBit();
+				switch (pc->Operator) {
+					case InstructionType::COMP_EQ: R[pc->A] = Value::Bit(a == b); VM_NEXT();
+					case InstructionType::COMP_NE: R[pc->A] = Value::Bit(a != b); VM_NEXT();
+					default: break;
+				}
+			}
+		}
+		if (pc->C > 2 && operands[0].GetNodeType() == NodeType::Integer && pc->Operator != InstructionType::DIVIDE) {
+			// longer integer sums and products without an accumulator node
+			auto acc = operands[0].GetInteger();
+			int i = 1;
+			for (; i < pc->C && operands[i].GetNodeType() == NodeType::Integer; i++) {
+				auto b = operands[i].GetInteger();
+				switch (pc->Operator) {
+					case InstructionType::ADD: acc += b; break;
+					case InstructionType::SUBTRACT: acc -= b; break;
+					case InstructionType::MULTIPLY: acc *= b; break;
+					default: i = pc->C + 1; break;
+				}
+			}
+			if (i == pc->C) {
+				R[pc->A] = Value::Integer(acc);
+				VM_NEXT();
+			}
+		}
+		CallStack::Arguments boxed(CallStack::Current(), operands, pc->C);
+		R[pc->A] = InfixArithmetic(pc->Operator, boxed.List.data(), pc->C);
+		VM_NEXT();
+	}
+
+	// Typed forms check the operand types and go back to the generic code
+	// when they do not match, the instruction is not typed again after that.
+	// Unchecked forms enter after the check, type inference proved it.
+	#define VM_TYPED(name, type, get, make, expression) \
+	op_##name: \
+		if (R[pc->B].GetNodeType() != NodeType::type || R[pc->B + 1].GetNodeType() != NodeType::type) goto deoptimize; \
+	op_##name##Unchecked: { \
+		auto operands = R + pc->B; \
+		auto a = operands[0].get(); \
+		auto b = operands[1].get(); \
+		R[pc->A] = Value::make(expression); \
+		VM_NEXT(); \
+	}
+	VM_TYPED(AddInt, Integer, GetInteger, Integer, a + b)
+	VM_TYPED(SubtractInt, Integer, GetInteger, Integer, a - b)
+	VM_TYPED(MultiplyInt, Integer, GetInteger, Integer, a * b)
+	VM_TYPED(EqualInt, Integer, GetInteger, Bit, a == b)
+	VM_TYPED(NotEqualInt, Integer, GetInteger, Bit, a != b)
+	VM_TYPED(LessInt, Integer, GetInteger, Bit, a < b)
+	VM_TYPED(LessEqualInt, Integer, GetInteger, Bit, a <= b)
+	VM_TYPED(GreaterInt, Integer, GetInteger, Bit, a > b)
+	VM_TYPED(GreaterEqualInt, Integer, GetInteger, Bit, a >= b)
+	VM_TYPED(AddFloat, Float, GetFloat, Float, a + b)
+	VM_TYPED(SubtractFloat, Float, GetFloat, Float, a - b)
+	VM_TYPED(MultiplyFloat, Float, GetFloat, Float, a * b)
+	VM_TYPED(DivideFloat, Float, GetFloat, Float, a / b)
+	VM_TYPED(EqualFloat, Float, GetFloat, Bit, a == b)
+	VM_TYPED(NotEqualFloat, Float, GetFloat, Bit, a != b)
+	VM_TYPED(LessFloat, Float, GetFloat, Bit, a < b)
+	VM_TYPED(LessEqualFloat, Float, GetFloat, Bit, a <= b)
+	VM_TYPED(GreaterFloat, Float, GetFloat, Bit, a > b)
+	VM_TYPED(GreaterEqualFloat, Float, GetFloat, Bit, a >= b)
+	VM_TYPED(EqualBit, Bit, GetBit, Bit, a == b)
+	VM_TYPED(NotEqualBit, Bit, GetBit, Bit, a != b)
+	#undef VM_TYPED
+
+	op_DivideInt:
+		if (R[pc->B].GetNodeType() != NodeType::Integer || R[pc->B + 1].GetNodeType() != NodeType::Integer) goto deoptimize;
+	op_DivideIntUnchecked: {
+		auto operands = R + pc->B;
+		auto b = operands[1].GetInteger();
+		if (b == 0) throw ExecutorRuntimeException("integer division by 0");
+		R[pc->A] = Value::Integer(operands[0].GetInteger() / b);
+		VM_NEXT();
+	}
+
+	#define VM_TYPED_BITS(name, expression) \
+	op_##name: { \
+		auto operands = R + pc->B; \
+		if (operands[0].GetNodeType() != NodeType::Bits || operands[1].GetNodeType() != NodeType::Bits) goto deoptimize; \
+		auto& a = reinterpret_cast<NodeBits&>(operands[0].GetNode()).Value; \
+		auto& b = reinterpret_cast<NodeBits&>(operands[1].GetNode()).Value; \
+		R[pc->A] = expression; \
+		VM_NEXT(); \
+	}
+	VM_TYPED_BITS(ConcatBits, Value(MakeNode<NodeBits>(a + b)))
+	VM_TYPED_BITS(EqualBits, Value::Bit(a == b))
+	VM_TYPED_BITS(NotEqualBits, Value::Bit(a != b))
+	#undef VM_TYPED_BITS
+
+	op_RepeatBits: {
+		auto operands = R + pc->B;
+		if (operands[0].GetNodeType() != NodeType::Bits || operands[1].GetNodeType() != NodeType::Integer) goto deoptimize;
+		auto& a = reinterpret_cast<NodeBits&>(operands[0].GetNode()).Value;
+		auto count = operands[1].GetInteger();
+		// the generic code handles the empty sequence and negative counts
+		if (a.size() == 0 || count < 0) goto deoptimize;
+		R[pc->A] = Value(MakeNode<NodeBits>(binseq::repeat(a, a.size() * (binseq::u64)count)));
+		VM_NEXT();
+	}
+
+	deoptimize:
+		if (!ConcurrentReferences::Active()) {
+			pc->Op = OpCode::Arithmetic;
+			pc->Generic = true;
+		}
+		goto op_Arithmetic;
+
+	op_Prefix: {
+		auto& operand = R[pc->B];
+		if (pc->Operator == InstructionType::NEGATIVE && operand.GetNodeType() == NodeType::Integer) {
+			R[pc->A] = Value::Integer(-operand.GetInteger());
+			VM_NEXT();
+		}
+		R[pc->A] = PrefixArithmetic(pc->Operator, operand.Box());
+		VM_NEXT();
+	}
+
+	op_Call:
+		R[pc->A] = Call(reinterpret_cast<NodeFunction&>(R[pc->B].GetNode()), R + pc->B + 1, pc->C);
+		VM_NEXT();
+
+	op_CallNative: {
+		auto index = pc - code;
+		if (&R[pc->B].GetNode() != chunk.Typed->Callees[index].get()) {
+			// the name is bound to another function now, what was proven after
+			// the call does not hold so the rest runs in the generic code
+			code = chunk.Code.data();
+			pc = code + index;
+			VM_DISPATCH();
+		}
+		auto& function = reinterpret_cast<NodeFunction&>(R[pc->B].GetNode());
+		CallStack::Arguments arguments(CallStack::Current(), R + pc->B + 1, pc->C);
+		R[pc->A] = function.nativeptr(arguments.List);
+		VM_NEXT();
+	}
+
+	op_CallFolded: {
+		auto index = pc - code;
+		if (&R[pc->B].GetNode() != chunk.Typed->Callees[index].get()) {
+			code = chunk.Code.data();
+			pc = code + index;
+			VM_DISPATCH();
+		}
+		R[pc->A] = CopyConstant(K[pc->C]);
+		VM_NEXT();
+	}
+
+	op_MakeArray: {
+		auto array = MakeNode<NodeArray>(pc->C);
+		for (int i = 0; i < pc->C; i++) array->Vector[i] = R[pc->B + i].Box();
+		R[pc->A] = Value(std::move(array));
+		VM_NEXT();
+	}
+
+	op_MakeObject: {
+		auto& layout = chunk.Layouts[pc->C];
+		auto object = MakeNode<NodeObject>(layout.Shape);
+		for (size_t i = 0; i < layout.Slots.size(); i++) {
+			object->SetSlotValue(layout.Slots[i], R[pc->B + i].Box());
+		}
+		R[pc->A] = Value(std::move(object));
+		VM_NEXT();
+	}
+
+	op_PushScope:
+		SymbolTable.Push();
+		VM_NEXT();
+
+	op_PopScope:
+		for (int i = 0; i < pc->A; i++) SymbolTable.Pop();
+		VM_NEXT();
+
+	op_SetMode:
+		R[pc->A] = Value::Bit(SymbolTable.LocalMode);
+		SymbolTable.LocalMode = pc->B != 0;
+		VM_NEXT();
+
+	op_RestoreMode:
+		SymbolTable.LocalMode = R[pc->A].GetBit();
+		VM_NEXT();
+
+	op_Jump:
+		VM_JUMP(pc->B);
+
+	op_JumpIfFalse: {
+		auto& condition = R[pc->A];
+		if (condition.GetNodeType() != NodeType::Bit) throw ExecutorRuntimeException(chunk.Messages[pc->C]);
+		if (!condition.GetBit()) VM_JUMP(pc->B);
+		VM_NEXT();
+	}
+
+	op_JumpIfFalseUnchecked:
+		if (!R[pc->A].GetBit()) VM_JUMP(pc->B);
+		VM_NEXT();
+
+	op_MakeReturn:
+		R[pc->A] = Value(MakeNode<NodeReturn>(R[pc->B].Box()));
+		VM_NEXT();
+
+	op_Return:
+		while (SymbolTable.GetLevel() > level) SymbolTable.Pop();
+		return std::move(R[pc->A]);
+
+	op_Throw:
+		if (pc->C != 0) throw ExecutorImplementationException(chunk.Messages[pc->B]);
+		throw ExecutorRuntimeException(chunk.Messages[pc->B]);
+	}
+
+#undef VM_JUMP
+#undef VM_NEXT
+#undef VM_DISPATCH
+
+	Ref<Node> ExecutorImp::ExecuteStatement(const Ref<Node>& node) {
+		switch (node->GetNodeType()) {
+			case NodeType::Command:
+			case NodeType::Atom:
+			case NodeType::StrctureFactory: {
+				auto chunk = BytecodeCompiler::CompileStatement(node);
+				if (VERBOSE_BYTECODE) chunk->Disassemble(stdout);
+				InferTypes(*chunk, true);
+				return Run(*chunk).Box();
+			}
+			default:
+				return node;
+		}
+	}
+
+	// what type inference may assume of the executor, values are computed
+	// in advance only while constant folding is on
+	class ExecutorEnvironment : public TypeInference::Environment {
+	public:
+		ExecutorEnvironment(ExecutorImp& executor) : executor(executor) { }
+
+		const Value* Binding(int slot) override {
+			return executor.SymbolTable.Peek(slot);
+		}
+
+		const Value* Sealed(int slot) override {
+			if (!executor.FOLD_CONSTANTS || slot >= (int)executor.Sealed.size() || executor.Sealed[slot].IsEmpty()) return nullptr;
+			return &executor.Sealed[slot];
+		}
+
+		bool Evaluate(const Instruction& instruction, const Value* operands, Value& result) override {
+			if (!executor.FOLD_CONSTANTS) return false;
+			try {
+				Ref<Node> value;
+				std::vector<Ref<Node>> boxed;
+				switch (instruction.Op) {
+					case OpCode::Arithmetic:
+						for (int i = 0; i < instruction.C; i++) boxed.push_back(operands[i].Box());
+						value = InfixArithmetic(instruction.Operator, boxed.data(), boxed.size());
+						break;
+					case OpCode::Prefix:
+						value = PrefixArithmetic(instruction.Operator, operands[0].Box());
+						break;
+					case OpCode::Call:
+						for (int i = 1; i <= instruction.C; i++) boxed.push_back(operands[i].Box());
+						value = reinterpret_cast<NodeFunction&>(operands[0].GetNode()).nativeptr(boxed);
+						break;
+					default:
+						return false;
+				}
+				if (value == nullptr || !IsFoldable(value->GetNodeType())) return false;
+				result = Value(std::move(value));
+				return true;
+			} catch (std::exception&) {
+				return false;
+			}
+		}
+
+	private:
+		ExecutorImp& executor;
+	};
+
+	// variables of a top level statement start with the bindings seen now,
+	// function bodies run in many environments and start knowing nothing
+	void ExecutorImp::InferTypes(BytecodeChunk& chunk, bool entry) {
+		if (!TYPE_INFERENCE) return;
+		ExecutorEnvironment environment(*this);
+		TypeInference::Run(chunk, environment, entry, SealEpoch, VERBOSE_TYPES ? stdout : nullptr);
+	}
+
+	inline Ref<Node> ExecutorImp::Error(std::string message) {
 		fprintf(stderr, "Runtime Error: %s.\n", message.c_str());
-		return std::make_shared<Node>(NodeType::Error);
+		return MakeNode<Node>(NodeType::Error);
 	}
 
 	/* native function implementation */
 
 	namespace native {
 
+		static bool HasSparseOperand(std::vector<Ref<Node>>& node) {
+			for (auto& n : node) {
+				if (n->GetNodeType() == NodeType::SparseBits) return true;
+			}
+			return false;
+		}
+
+		// natives without a compressed path take sparse operands as binseq
+		static void DenseOperands(std::vector<Ref<Node>>& node) {
+			for (auto& n : node) n = DenseBits(n);
+		}
+
+		// bitwise operators and selectors without a compressed kernel run on the
+		// dense operands, the result is compressed again when it is sparse enough
+		template <class Native>
+		static Ref<Node> DenseOperator(std::vector<Ref<Node>>& node, Native native) {
+			DenseOperands(node);
+			return PickBitsRepresentation(native(node));
+		}
+
 		static void view_primitive(Node& node, const char* sep = 0) {
 			if (sep == 0) sep = " ";
 			switch (node.GetNodeType()) {
@@ -1443,8 +2074,16 @@ namespace Carbon {
 					break;
 				case NodeType::DynamicArray: printf("array(%lu)%s", reinterpret_cast<NodeArray&>(node).Vector.size(), sep);
 					break;
+				case NodeType::IntegerArray: printf("intarray(%lu)%s", reinterpret_cast<NodeIntegerArray&>(node).Vector.size(), sep);
+					break;
+				case NodeType::FloatArray: printf("floatarray(%lu)%s", reinterpret_cast<NodeFloatArray&>(node).Vector.size(), sep);
+					break;
 				case NodeType::Bits: printf("binseq(%lu)%s", reinterpret_cast<NodeArray&>(node).Vector.size(), sep);
 					break;
+				case NodeType::SparseBits: printf("sparse(%llu)%s", reinterpret_cast<NodeSparseBits&>(node).Value.size(), sep);
+					break;
+				case NodeType::BitMatrix: printf("bitmatrix(%llux%llu)%s", reinterpret_cast<NodeBitMatrix&>(node).Value.rows(), reinterpret_cast<NodeBitMatrix&>(node).Value.cols(), sep);
+					break;
 				case NodeType::DynamicObject: printf("object%s", sep);
 					break;
 				case NodeType::Function: printf("function%s", sep);
@@ -1455,14 +2094,34 @@ namespace Carbon {
 			}
 		}
 
-		static std::shared_ptr<Node> print(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> print(std::vector<Ref<Node>>& node) {
 			for (auto i = node.begin(); i != node.end(); i++) {
 				view_primitive(**i,"");
 			}
-			return std::make_shared<Node>(NodeType::None);
+			return MakeNode<Node>(NodeType::None);
+		}
+
+		static void view_bits(const binseq::bit_sequence& seq) {
+			auto size = seq.size();
+			char buffer[65];
+			char bcount = 0;
+			for (binseq::u64 i = 0; i < size; i++) {
+				if (seq[i]) buffer[bcount++] = '1'; else buffer[bcount++] = '0';
+				if (bcount == 64) {
+					buffer[bcount] = 0;
+					printf("%s", buffer);
+					bcount = 0;
+				}
+			}
+			if (bcount > 0) {
+				buffer[bcount] = 0;
+				printf("%s", buffer);
+				bcount = 0;
+			}
+			printf(" ");
 		}
 
-		static std::shared_ptr<Node> view(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> view(std::vector<Ref<Node>>& node) {
 			for (auto i = node.begin(); i != node.end(); i++) {
 				switch ((*i)->GetNodeType()) {
 					case NodeType::DynamicArray: {
@@ -1475,6 +2134,26 @@ namespace Carbon {
 						}
 					}
 						break;
+					case NodeType::IntegerArray: {
+						auto& n = reinterpret_cast<NodeIntegerArray&>(**i);
+						auto size = n.Vector.size();
+						printf("intarray(%lu): (", size);
+						for (unsigned i = 0; i < size; i++) {
+							printf("%lld%s", n.Vector[i], i < size - 1 ? ", " : "");
+						}
+						printf(") ");
+					}
+						break;
+					case NodeType::FloatArray: {
+						auto& n = reinterpret_cast<NodeFloatArray&>(**i);
+						auto size = n.Vector.size();
+						printf("floatarray(%lu): (", size);
+						for (unsigned i = 0; i < size; i++) {
+							printf("%g%s", n.Vector[i], i < size - 1 ? ", " : "");
+						}
+						printf(") ");
+					}
+						break;
 					case NodeType::DynamicObject: {
 						auto& n = reinterpret_cast<NodeObject&>(**i);
 						printf("object: {");
@@ -1487,47 +2166,40 @@ namespace Carbon {
 						printf("} ");
 						break;
 					}
-					case NodeType::Bits: {
-						auto& n = reinterpret_cast<NodeBits&>(**i);
-						auto size = n.Value.size();
-						auto i = size;
-						char buffer[65];
-						char bcount = 0;
-						for (i = 0; i < size; i++) {
-							if (n.Value[i]) buffer[bcount++] = '1'; else buffer[bcount++] = '0';
-							if (bcount == 64) {
-								buffer[bcount] = 0;
-								printf("%s", buffer);
-								bcount = 0;
-							}
-						}
-						if (bcount > 0) {
-							buffer[bcount] = 0;
-							printf("%s", buffer);
-							bcount = 0;
+					case NodeType::Bits:
+						view_bits(reinterpret_cast<NodeBits&>(**i).Value);
+						break;
+					case NodeType::SparseBits:
+						view_bits(reinterpret_cast<NodeSparseBits&>(**i).Value.to_bit_sequence());
+						break;
+					case NodeType::BitMatrix: {
+						auto& m = reinterpret_cast<NodeBitMatrix&>(**i).Value;
+						printf("bitmatrix(%llux%llu):\n", m.rows(), m.cols());
+						for (binseq::u64 r = 0; r < m.rows(); r++) {
+							for (binseq::u64 c = 0; c < m.cols(); c++) putchar(m.get(r, c) ? '1' : '0');
+							putchar('\n');
 						}
-						printf(" ");
-					}
 						break;
+					}
 					default: view_primitive(**i, " ");
 				}
 			}
 			printf("\n");
-			return std::make_shared<Node>(NodeType::None);
+			return MakeNode<Node>(NodeType::None);
 		}
 
-		static std::shared_ptr<Node> system(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> system(std::vector<Ref<Node>>& node) {
 			auto result = 0;
 			for (auto i = node.begin(); i != node.end(); i++) {
 				if ((*i)->GetNodeType() == NodeType::String) {
 					auto result = std::system(reinterpret_cast<NodeString&>(*node[0]).Value.c_str());
-					if (result != 0) return std::make_shared<NodeInteger>(result);
+					if (result != 0) return MakeNode<NodeInteger>(result);
 				} else throw Carbon::ExecutorRuntimeException("parameter of system must be a string");
 			}
-			return std::make_shared<NodeInteger>(result);
+			return MakeNode<NodeInteger>(result);
 		}
 
-		static std::shared_ptr<Node> parallel(ExecutorImp* ex, std::vector<std::shared_ptr<Node>>& node)
+		static Ref<Node> parallel(ExecutorImp* ex, std::vector<Ref<Node>>& node)
 		{
 			//throw Carbon::ExecutorRuntimeException("unfortunately parallel is not fully implemented");
 			// get hanle to thread pool
@@ -1548,6 +2220,8 @@ namespace Carbon {
 
 			// check if more parameters
 			if (node.size()>3) throw Carbon::ExecutorRuntimeException("parallel does not accept more than 3 paramters");
+			// workers copy and drop references to the arguments and results
+			ConcurrentReferences concurrent;
 			// execution vastly depends on the type of first paramter
 			switch (functionParam.GetNodeType())
 			{
@@ -1561,7 +2235,7 @@ namespace Carbon {
 				else if (argumentParam->GetNodeType() == NodeType::DynamicArray)
 				{
 					auto& vec = reinterpret_cast<NodeArray*>(argumentParam)->Vector;
-					auto results = std::make_shared<NodeArray>(vec.size());
+					auto results = MakeNode<NodeArray>(vec.size());
 					auto& rvec = results->Vector;
 					std::vector<std::function<void(void)>> tasks(vec.size());
 					for (int i=0; i<vec.size(); i++)
@@ -1581,10 +2255,10 @@ namespace Carbon {
 				else if (argumentParam->GetNodeType() == NodeType::DynamicObject)
 				{
 					auto argument = reinterpret_cast<NodeObject*>(argumentParam);
-					auto results = std::make_shared<NodeObject>();
+					auto results = MakeNode<NodeObject>();
 					auto keys = argument->GetAttributeKeys();
 					std::vector<std::function<void(void)>> tasks(keys.size());
-					std::vector<std::pair<std::string, std::shared_ptr<Node>>> resultsVector(keys.size());
+					std::vector<std::pair<std::string, Ref<Node>>> resultsVector(keys.size());
 					int i = 0;
 					for (auto key : keys)
 					{
@@ -1620,7 +2294,7 @@ namespace Carbon {
 				{
 					auto& fnVec = reinterpret_cast<NodeArray&>(functionParam).Vector;
 					std::vector<std::function<void(void)>> tasks(fnVec.size());
-					auto results = std::make_shared<NodeArray>(fnVec.size());
+					auto results = MakeNode<NodeArray>(fnVec.size());
 					auto& rvec = results->Vector;
 					int i = 0;
 					for (auto function:fnVec)
@@ -1641,12 +2315,14 @@ namespace Carbon {
 				{
 					auto& fnVec = reinterpret_cast<NodeArray&>(functionParam).Vector;
 					std::vector<std::function<void(void)>> tasks(fnVec.size());
-					auto results = std::make_shared<NodeArray>(fnVec.size());
+					auto results = MakeNode<NodeArray>(fnVec.size());
 					auto& rvec = results->Vector;
 					int i = 0;
-					for (auto function : fnVec)
+					// tasks borrow the functions, workers may drop their copy of a
+					// task after the results were handed back
+					for (auto& function : fnVec)
 					{
-						tasks[i] = [function, i, &rvec, &node, ex]()
+						tasks[i] = [&function, i, &rvec, &node, ex]()
 						{
 							NodeCommand cmd(InstructionType::CALL);
 							cmd.Children.push_back(function);
@@ -1666,15 +2342,17 @@ namespace Carbon {
 					auto argument = reinterpret_cast<NodeObject*>(argumentParam);
 					auto argumentKeys = argument->GetAttributeKeys();
 					std::vector<std::function<void(void)>> tasks(argumentKeys.size());
-					auto results = std::make_shared<NodeObject>();
-					std::vector<std::pair<std::string, std::shared_ptr<Node>>> resultsVector(argumentKeys.size());
+					auto results = MakeNode<NodeObject>();
+					std::vector<std::pair<std::string, Ref<Node>>> resultsVector(argumentKeys.size());
+					std::vector<Ref<Node>> params(argumentKeys.size());
 					int i = 0;
 					for (auto key : argumentKeys)
 					{
 						resultsVector[i].first = key;
-						auto param = argument->GetAttributeValue(key);
-						tasks[i] = [param, i, &resultsVector, &node, ex]()
+						params[i] = argument->GetAttributeValue(key);
+						tasks[i] = [i, &params, &resultsVector, &node, ex]()
 						{
+							auto& param = params[i];
 							NodeCommand cmd(InstructionType::CALL);
 							cmd.Children.push_back(param);
 							resultsVector[i].second = ex->ExecuteCall(cmd);
@@ -1694,15 +2372,17 @@ namespace Carbon {
 					auto argument = reinterpret_cast<NodeObject*>(argumentParam);
 					auto argumentKeys = argument->GetAttributeKeys();
 					std::vector<std::function<void(void)>> tasks(argumentKeys.size());
-					auto results = std::make_shared<NodeObject>();
-					std::vector<std::pair<std::string, std::shared_ptr<Node>>> resultsVector(argumentKeys.size());
+					auto results = MakeNode<NodeObject>();
+					std::vector<std::pair<std::string, Ref<Node>>> resultsVector(argumentKeys.size());
+					std::vector<Ref<Node>> params(argumentKeys.size());
 					int i = 0;
 					for (auto key : argumentKeys)
 					{
 						resultsVector[i].first = key;
-						auto param = argument->GetAttributeValue(key);
-						tasks[i] = [param, i, &resultsVector, &node, ex]()
+						params[i] = argument->GetAttributeValue(key);
+						tasks[i] = [i, &params, &resultsVector, &node, ex]()
 						{
+							auto& param = params[i];
 							NodeCommand cmd(InstructionType::CALL);
 							cmd.Children.push_back(param);
 							cmd.Children.push_back(node[1]);
@@ -1725,7 +2405,7 @@ namespace Carbon {
 			}
 		}
 
-		static std::shared_ptr<Node> clock(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> clock(std::vector<Ref<Node>>& node) {
 			long long result = 0;
 			auto timepoint = std::chrono::high_resolution_clock::now();
 			auto epoch = timepoint.time_since_epoch();
@@ -1747,10 +2427,10 @@ namespace Carbon {
 				// if no parameter return nanoseconds
 				result = std::chrono::duration_cast<std::chrono::nanoseconds>(epoch).count();
 			}
-			return std::make_shared<NodeInteger>(result);
+			return MakeNode<NodeInteger>(result);
 		}
 
-		static std::shared_ptr<Node> exit(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> exit(std::vector<Ref<Node>>& node) {
 			if (node.size() == 1) {
 				if (node[0]->GetNodeType() == NodeType::Integer) {
 					std::exit((int)reinterpret_cast<NodeInteger&>(*node[0]).Value);
@@ -1760,22 +2440,22 @@ namespace Carbon {
 			} else throw Carbon::ExecutorRuntimeException("exit requires 0 or 1 paramter");
 		}
 
-		static std::shared_ptr<Node> del(ExecutorImp* ex, std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> del(ExecutorImp* ex, std::vector<Ref<Node>>& node) {
 			int released = 0;
 			for (auto i = node.begin(); i != node.end(); i++) {
 				if ((*i)->GetNodeType() == NodeType::String) {
 					auto str = reinterpret_cast<NodeString&>(**i);
 					auto& ptr = ex->SymbolTable[str.Value];
-					if (ptr != nullptr) {
-						ptr = nullptr;
+					if (!ptr.IsEmpty()) {
+						ptr = Value();
 						released++;
 					}
 				} else throw Carbon::ExecutorRuntimeException("delete requires strings as a parameters");
 			}
-			return std::make_shared<NodeInteger>(released);
+			return MakeNode<NodeInteger>(released);
 		}
 
-		static std::shared_ptr<Node> file_read(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> file_read(std::vector<Ref<Node>>& node) {
 			//read(16,32,"x.bin");
 			if (node.size() <= 0 || node.size() > 3) throw Carbon::ExecutorRuntimeException("incorrect number of parameters at file read call");
 			binseq::u64 read_offset = 0, read_size = -1;
@@ -1807,11 +2487,12 @@ namespace Carbon {
 			fseek(f, read_byte_offset,SEEK_SET);
 			fread(bits.address(), read_byte_size, 1, f);
 			fclose(f);
-			return std::make_shared<NodeBits>(binseq::subseq(bits, read_misalign, read_size));
+			return MakeNode<NodeBits>(binseq::subseq(bits, read_misalign, read_size));
 		}
 
-		static std::shared_ptr<Node> file_write(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> file_write(std::vector<Ref<Node>>& node) {
 			//write(b"0010",16,"x.bin");
+			DenseOperands(node);
 			if (node.size() == 2) {
 				if (node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("first parameter of file write must be a binseq");
 				if (node[1]->GetNodeType() != NodeType::String) throw Carbon::ExecutorRuntimeException("second parameter of file write must be a string");
@@ -1851,12 +2532,13 @@ namespace Carbon {
 				fwrite(seq->address(), write_size, 1, f);
 				fclose(f);
 			}
-			return std::make_shared<Node>(NodeType::None);
+			return MakeNode<Node>(NodeType::None);
 		}
 
-		static std::shared_ptr<Node> cast_integer(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> cast_integer(std::vector<Ref<Node>>& node) {
+			DenseOperands(node);
 			if (node.size() == 0) {
-				return std::make_shared<NodeInteger>(0);
+				return MakeNode<NodeInteger>(0);
 			} else if (node.size() == 1) {
 				long long ival = 0;
 				switch (node[0]->GetNodeType()) {
@@ -1871,14 +2553,15 @@ namespace Carbon {
 						break;
 					default: throw Carbon::ExecutorRuntimeException("cannot convert parameter to integer");
 				}
-				return std::make_shared<NodeInteger>(ival);
+				return MakeNode<NodeInteger>(ival);
 			}
 			throw Carbon::ExecutorRuntimeException("conversion function expects no more than one parameter");
 		}
 
-		static std::shared_ptr<Node> cast_float(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> cast_float(std::vector<Ref<Node>>& node) {
+			DenseOperands(node);
 			if (node.size() == 0) {
-				return std::make_shared<NodeFloat>(.0);
+				return MakeNode<NodeFloat>(.0);
 			} else if (node.size() == 1) {
 				double val = 0;
 				switch (node[0]->GetNodeType()) {
@@ -1892,14 +2575,15 @@ namespace Carbon {
 						break;
 					default: throw Carbon::ExecutorRuntimeException("cannot convert parameter to float");
 				}
-				return std::make_shared<NodeFloat>(val);
+				return MakeNode<NodeFloat>(val);
 			}
 			throw Carbon::ExecutorRuntimeException("conversion function expects no more than one parameter");
 		}
 
-		static std::shared_ptr<Node> cast_bit(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> cast_bit(std::vector<Ref<Node>>& node) {
+			DenseOperands(node);
 			if (node.size() == 0) {
-				return std::make_shared<NodeFloat>(.0);
+				return MakeNode<NodeFloat>(.0);
 			} else if (node.size() == 1) {
 				bool val = 0;
 				switch (node[0]->GetNodeType()) {
@@ -1914,14 +2598,15 @@ namespace Carbon {
 						break;
 					default: throw Carbon::ExecutorRuntimeException("cannot convert parameter to bit");
 				}
-				return std::make_shared<NodeBit>(val);
+				return MakeNode<NodeBit>(val);
 			}
 			throw Carbon::ExecutorRuntimeException("conversion function expects no more than one parameter");
 		}
 
-		static std::shared_ptr<Node> cast_string(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> cast_string(std::vector<Ref<Node>>& node) {
+			DenseOperands(node);
 			if (node.size() == 0) {
-				return std::make_shared<NodeFloat>(.0);
+				return MakeNode<NodeFloat>(.0);
 			} else if (node.size() == 1) {
 				char buffer[256];
 				switch (node[0]->GetNodeType()) {
@@ -1933,7 +2618,7 @@ namespace Carbon {
 						break;
 					case NodeType::String: return node[0];
 					case NodeType::Bits: {
-						auto newnode = std::make_shared<NodeString>("");
+						auto newnode = MakeNode<NodeString>("");
 						auto& bitsnode = reinterpret_cast<NodeBits&>(*node[0]);
 						auto bytestream = (binseq::u8*) bitsnode.Value.address();
 						auto count = (bitsnode.Value.size() + 7) >> 3;
@@ -1945,28 +2630,32 @@ namespace Carbon {
 						break;
 					default: throw Carbon::ExecutorRuntimeException("cannot convert parameter to float");
 				}
-				return std::make_shared<NodeString>(buffer);
+				return MakeNode<NodeString>(buffer);
 			}
 			throw Carbon::ExecutorRuntimeException("conversion function expects no more than one parameter");
 		}
 
-		static std::shared_ptr<Node> cast_bits(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> cast_bits(std::vector<Ref<Node>>& node) {
 			if (node.size() == 0) {
-				return std::make_shared<NodeBits>();
+				return MakeNode<NodeBits>();
 			} else if (node.size() == 1) {
 				switch (node[0]->GetNodeType()) {
 					case NodeType::Bit:
-						return std::make_shared<NodeBits>(
+						return MakeNode<NodeBits>(
 							binseq::bit_sequence(reinterpret_cast<NodeBit&>(*node[0]).Value));
 					case NodeType::Integer:
-						return std::make_shared<NodeBits>(
+						return MakeNode<NodeBits>(
 							binseq::bit_sequence((binseq::u64)reinterpret_cast<NodeInteger&>(*node[0]).Value));
 					case NodeType::Float:
-						return std::make_shared<NodeBits>(
+						return MakeNode<NodeBits>(
 							binseq::bit_sequence(*((binseq::u64*)&reinterpret_cast<NodeFloat&>(*node[0]).Value)));
 					case NodeType::Bits: return node[0];
+					case NodeType::SparseBits:
+						return MakeNode<NodeBits>(reinterpret_cast<NodeSparseBits&>(*node[0]).Value.to_bit_sequence());
+					case NodeType::BitMatrix:
+						return MakeNode<NodeBits>(reinterpret_cast<NodeBitMatrix&>(*node[0]).Value.to_sequence());
 					case NodeType::String:
-						return std::make_shared<NodeBits>(
+						return MakeNode<NodeBits>(
 							binseq::bit_sequence(reinterpret_cast<NodeString&>(*node[0]).Value.c_str()));
 						break;
 					default: throw Carbon::ExecutorRuntimeException("cannot convert parameter to binseq");
@@ -1975,14 +2664,30 @@ namespace Carbon {
 			throw Carbon::ExecutorRuntimeException("conversion function expects no more than one parameter");
 		}
 
-		static std::shared_ptr<Node> cast_array(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> cast_array(std::vector<Ref<Node>>& node) {
 			if (node.size() == 0) {
-				return std::make_shared<NodeArray>();
+				return MakeNode<NodeArray>();
 			} else if (node.size() == 1) {
-				if (node[0]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("array can only receive integer as a parameter");
+				if (node[0]->GetNodeType() == NodeType::IntegerArray) {
+					auto& packed = reinterpret_cast<NodeIntegerArray&>(*node[0]).Vector;
+					auto newnode = MakeNode<NodeArray>((int)packed.size());
+					for (size_t i = 0; i < packed.size(); i++) {
+						newnode->Vector[i] = MakeNode<NodeInteger>(packed[i]);
+					}
+					return newnode;
+				}
+				if (node[0]->GetNodeType() == NodeType::FloatArray) {
+					auto& packed = reinterpret_cast<NodeFloatArray&>(*node[0]).Vector;
+					auto newnode = MakeNode<NodeArray>((int)packed.size());
+					for (size_t i = 0; i < packed.size(); i++) {
+						newnode->Vector[i] = MakeNode<NodeFloat>(packed[i]);
+					}
+					return newnode;
+				}
+				if (node[0]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("array can only receive integer, intarray or floatarray as a parameter");
 				auto& size = reinterpret_cast<NodeInteger&>(*node[0]).Value;
-				auto newnode = std::make_shared<NodeArray>(size);
-				auto nothing = std::make_shared<Node>(NodeType::None);
+				auto newnode = MakeNode<NodeArray>(size);
+				auto nothing = MakeNode<Node>(NodeType::None);
 				auto& vec = newnode->Vector;
 				for (auto i = vec.begin(); i != vec.end(); i++) {
 					*i = nothing;
@@ -1993,15 +2698,75 @@ namespace Carbon {
 			}
 		}
 
-		static std::shared_ptr<Node> cast_object(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> cast_intarray(std::vector<Ref<Node>>& node) {
+			if (node.size() == 0) {
+				return MakeNode<NodeIntegerArray>();
+			} else if (node.size() == 1) {
+				switch (node[0]->GetNodeType()) {
+					case NodeType::IntegerArray: return node[0];
+					case NodeType::Integer: {
+						auto size = reinterpret_cast<NodeInteger&>(*node[0]).Value;
+						if (size < 0) throw Carbon::ExecutorRuntimeException("intarray size can't be negative");
+						return MakeNode<NodeIntegerArray>((size_t)size);
+					}
+					case NodeType::DynamicArray: {
+						auto& vec = reinterpret_cast<NodeArray&>(*node[0]).Vector;
+						auto newnode = MakeNode<NodeIntegerArray>(vec.size());
+						for (size_t i = 0; i < vec.size(); i++) {
+							if (vec[i] == nullptr || vec[i]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("intarray can only be built from an array of integers");
+							newnode->Vector[i] = reinterpret_cast<NodeInteger&>(*vec[i]).Value;
+						}
+						return newnode;
+					}
+					default: throw Carbon::ExecutorRuntimeException("intarray can receive a size or an array of integers");
+				}
+			} else throw Carbon::ExecutorRuntimeException("intarray can't have more than 1 parameter");
+		}
+
+		static Ref<Node> cast_floatarray(std::vector<Ref<Node>>& node) {
+			if (node.size() == 0) {
+				return MakeNode<NodeFloatArray>();
+			} else if (node.size() == 1) {
+				switch (node[0]->GetNodeType()) {
+					case NodeType::FloatArray: return node[0];
+					case NodeType::Integer: {
+						auto size = reinterpret_cast<NodeInteger&>(*node[0]).Value;
+						if (size < 0) throw Carbon::ExecutorRuntimeException("floatarray size can't be negative");
+						return MakeNode<NodeFloatArray>((size_t)size);
+					}
+					case NodeType::IntegerArray: {
+						auto& vec = reinterpret_cast<NodeIntegerArray&>(*node[0]).Vector;
+						return MakeNode<NodeFloatArray>(std::vector<double>(vec.begin(), vec.end()));
+					}
+					case NodeType::DynamicArray: {
+						auto& vec = reinterpret_cast<NodeArray&>(*node[0]).Vector;
+						auto newnode = MakeNode<NodeFloatArray>(vec.size());
+						for (size_t i = 0; i < vec.size(); i++) {
+							if (vec[i] == nullptr) throw Carbon::ExecutorRuntimeException("floatarray can only be built from an array of numbers");
+							switch (vec[i]->GetNodeType()) {
+								case NodeType::Float: newnode->Vector[i] = reinterpret_cast<NodeFloat&>(*vec[i]).Value;
+									break;
+								case NodeType::Integer: newnode->Vector[i] = (double)reinterpret_cast<NodeInteger&>(*vec[i]).Value;
+									break;
+								default: throw Carbon::ExecutorRuntimeException("floatarray can only be built from an array of numbers");
+							}
+						}
+						return newnode;
+					}
+					default: throw Carbon::ExecutorRuntimeException("floatarray can receive a size, an intarray or an array of numbers");
+				}
+			} else throw Carbon::ExecutorRuntimeException("floatarray can't have more than 1 parameter");
+		}
+
+		static Ref<Node> cast_object(std::vector<Ref<Node>>& node) {
 			if (node.size() == 0) {
-				return std::make_shared<NodeObject>();
+				return MakeNode<NodeObject>();
 			} else throw Carbon::ExecutorRuntimeException("object constructor accepts no parameters");
 		}
 
-		static std::shared_ptr<Node> type(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> type(std::vector<Ref<Node>>& node) {
 			if (node.size() == 0) {
-				return std::make_shared<NodeString>("void");
+				return MakeNode<NodeString>("void");
 			} else if (node.size() == 1) {
 				const char* r = "unknown";
 				switch (node[0]->GetNodeType()) {
@@ -2035,6 +2800,14 @@ namespace Carbon {
 						break;
 					case NodeType::DynamicObject: r = "object";
 						break;
+					case NodeType::IntegerArray: r = "intarray";
+						break;
+					case NodeType::FloatArray: r = "floatarray";
+						break;
+					case NodeType::SparseBits: r = "sparse";
+						break;
+					case NodeType::BitMatrix: r = "bitmatrix";
+						break;
 					case NodeType::Continue: r = "continue"; 
 						break;
 					case NodeType::Break: r = "break"; 
@@ -2044,13 +2817,30 @@ namespace Carbon {
 					case NodeType::StrctureFactory: r = "StrctureFactory"; 
 						break;
 				}
-				return std::make_shared<NodeString>(r);
+				return MakeNode<NodeString>(r);
 			}
 			throw Carbon::ExecutorRuntimeException("type function expects no more than one parameter");
 		}
 
 
-		static std::shared_ptr<Node> get(std::vector<std::shared_ptr<Node>>& node) {
+		// validates the row and column of get(m, r, c) and set(m, r, c, bit)
+		static binseq::bit_matrix& MatrixElement(std::vector<Ref<Node>>& node, binseq::u64& row, binseq::u64& col) {
+			auto& matrix = reinterpret_cast<NodeBitMatrix&>(*node[0]).Value;
+			if (node[1]->GetNodeType() != NodeType::Integer || node[2]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("bitmatrix can only be indexed by integer row and column");
+			auto r = reinterpret_cast<NodeInteger&>(*node[1]).Value;
+			auto c = reinterpret_cast<NodeInteger&>(*node[2]).Value;
+			if (r < 0 || c < 0 || (binseq::u64)r >= matrix.rows() || (binseq::u64)c >= matrix.cols()) throw Carbon::ExecutorRuntimeException("bitmatrix index out of bounds");
+			row = (binseq::u64)r;
+			col = (binseq::u64)c;
+			return matrix;
+		}
+
+		static Ref<Node> get(std::vector<Ref<Node>>& node) {
+			if (node.size() == 3 && node[0]->GetNodeType() == NodeType::BitMatrix) {
+				binseq::u64 row, col;
+				auto& matrix = MatrixElement(node, row, col);
+				return MakeNode<NodeBit>(matrix.get(row, col));
+			}
 			if (node.size() == 2) {
 				switch (node[0]->GetNodeType()) {
 					case NodeType::String: {
@@ -2058,7 +2848,7 @@ namespace Carbon {
 						auto& container = reinterpret_cast<NodeString&>(*node[0]).Value;
 						auto& idx = reinterpret_cast<NodeInteger&>(*node[1]).Value;
 						if (idx < 0 || idx >= container.size()) throw Carbon::ExecutorRuntimeException("string index out of bounds");
-						return std::make_shared<NodeInteger>((unsigned char)container[idx]);
+						return MakeNode<NodeInteger>((unsigned char)container[idx]);
 					}
 						break;
 
@@ -2071,16 +2861,43 @@ namespace Carbon {
 					}
 						break;
 
+					case NodeType::IntegerArray: {
+						if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("intarray can only be indexed by integer");
+						auto& container = reinterpret_cast<NodeIntegerArray&>(*node[0]).Vector;
+						auto& idx = reinterpret_cast<NodeInteger&>(*node[1]).Value;
+						if (idx < 0 || idx >= container.size()) throw Carbon::ExecutorRuntimeException("intarray index out of bounds");
+						return MakeNode<NodeInteger>(container[idx]);
+					}
+						break;
+
+					case NodeType::FloatArray: {
+						if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("floatarray can only be indexed by integer");
+						auto& container = reinterpret_cast<NodeFloatArray&>(*node[0]).Vector;
+						auto& idx = reinterpret_cast<NodeInteger&>(*node[1]).Value;
+						if (idx < 0 || idx >= container.size()) throw Carbon::ExecutorRuntimeException("floatarray index out of bounds");
+						return MakeNode<NodeFloat>(container[idx]);
+					}
+						break;
+
 					case NodeType::Bits: {
 						if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("string can only be indexed by integer");
 						auto& container = reinterpret_cast<NodeBits&>(*node[0]).Value;
 						auto& idx = reinterpret_cast<NodeInteger&>(*node[1]).Value;
 						if (idx < 0 || idx >= container.size()) throw Carbon::ExecutorRuntimeException("string index out of bounds");
-						return std::make_shared<NodeBit>((bool)container[idx]);
+						return MakeNode<NodeBit>((bool)container[idx]);
 						return node[2];
 					}
 						break;
 
+					case NodeType::SparseBits: {
+						if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("sparse can only be indexed by integer");
+						auto& container = reinterpret_cast<NodeSparseBits&>(*node[0]).Value;
+						auto& idx = reinterpret_cast<NodeInteger&>(*node[1]).Value;
+						if (idx < 0 || idx >= container.size()) throw Carbon::ExecutorRuntimeException("sparse index out of bounds");
+						return MakeNode<NodeBit>(container.get(idx));
+					}
+						break;
+
 					case NodeType::DynamicObject: {
 						if (node[1]->GetNodeType() != NodeType::String) throw Carbon::ExecutorRuntimeException("object can only be indexed by string");
 						auto& object = reinterpret_cast<NodeObject&>(*node[0]);
@@ -2089,7 +2906,7 @@ namespace Carbon {
 						if (result != nullptr)
 							return result;
 						else
-							return std::make_shared<Node>(NodeType::None);
+							return MakeNode<Node>(NodeType::None);
 					}
 						break;
 
@@ -2099,7 +2916,14 @@ namespace Carbon {
 		}
 
 
-		static std::shared_ptr<Node> set(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> set(std::vector<Ref<Node>>& node) {
+			if (node.size() == 4 && node[0]->GetNodeType() == NodeType::BitMatrix) {
+				if (node[3]->GetNodeType() != NodeType::Bit) throw Carbon::ExecutorRuntimeException("value must be a bit");
+				binseq::u64 row, col;
+				auto& matrix = MatrixElement(node, row, col);
+				matrix.set(row, col, reinterpret_cast<NodeBit&>(*node[3]).Value);
+				return node[3];
+			}
 			if (node.size() == 3) {
 				switch (node[0]->GetNodeType()) {
 					case NodeType::String: {
@@ -2125,6 +2949,28 @@ namespace Carbon {
 					}
 						break;
 
+					case NodeType::IntegerArray: {
+						if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("intarray can only be indexed by integer");
+						if (node[2]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("value must be an integer");
+						auto& container = reinterpret_cast<NodeIntegerArray&>(*node[0]).Vector;
+						auto& idx = reinterpret_cast<NodeInteger&>(*node[1]).Value;
+						if (idx < 0 || idx >= container.size()) throw Carbon::ExecutorRuntimeException("index out of bounds when trying to set element in intarray");
+						container[idx] = reinterpret_cast<NodeInteger&>(*node[2]).Value;
+						return node[2];
+					}
+						break;
+
+					case NodeType::FloatArray: {
+						if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("floatarray can only be indexed by integer");
+						if (node[2]->GetNodeType() != NodeType::Float) throw Carbon::ExecutorRuntimeException("value must be a float");
+						auto& container = reinterpret_cast<NodeFloatArray&>(*node[0]).Vector;
+						auto& idx = reinterpret_cast<NodeInteger&>(*node[1]).Value;
+						if (idx < 0 || idx >= container.size()) throw Carbon::ExecutorRuntimeException("index out of bounds when trying to set element in floatarray");
+						container[idx] = reinterpret_cast<NodeFloat&>(*node[2]).Value;
+						return node[2];
+					}
+						break;
+
 					case NodeType::Bits: {
 						if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("binary sequence can only be indexed by integer");
 						if (node[2]->GetNodeType() != NodeType::Bit) throw Carbon::ExecutorRuntimeException("value must be a bit");
@@ -2147,12 +2993,14 @@ namespace Carbon {
 					}
 						break;
 
+					case NodeType::SparseBits: throw Carbon::ExecutorRuntimeException("sparse sequences can't be changed in place, convert with binseq() first");
+
 					default: throw Carbon::ExecutorRuntimeException("set requires the first parameter to be a container");
 				}
 			} else throw Carbon::ExecutorRuntimeException("set requires container, index and value");
 		}
 
-		static std::shared_ptr<Node> length(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> length(std::vector<Ref<Node>>& node) {
 			if (node.size() == 1) {
 				long long val = 0;
 				switch (node[0]->GetNodeType()) {
@@ -2160,11 +3008,17 @@ namespace Carbon {
 						break;
 					case NodeType::DynamicArray: val = reinterpret_cast<NodeArray&>(*node[0]).Vector.size();
 						break;
+					case NodeType::IntegerArray: val = reinterpret_cast<NodeIntegerArray&>(*node[0]).Vector.size();
+						break;
+					case NodeType::FloatArray: val = reinterpret_cast<NodeFloatArray&>(*node[0]).Vector.size();
+						break;
 					case NodeType::Bits: val = reinterpret_cast<NodeBits&>(*node[0]).Value.size();
 						break;
+					case NodeType::SparseBits: val = reinterpret_cast<NodeSparseBits&>(*node[0]).Value.size();
+						break;
 					default: throw Carbon::ExecutorRuntimeException("parameter has no length, only array, string and binseq has length");
 				}
-				return std::make_shared<NodeInteger>(val);
+				return MakeNode<NodeInteger>(val);
 			} else throw Carbon::ExecutorRuntimeException("length requires one parameter");
 		}
 
@@ -2208,109 +3062,1001 @@ namespace Carbon {
 			return result;
 		}
 
-		static std::shared_ptr<Node> sel_head(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> sel_head(std::vector<Ref<Node>>& node) {
+			if (HasSparseOperand(node)) return DenseOperator(node, sel_head);
 			if (node.size() == 2) {
 				if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("second parameter of head must be an integer");
 				auto count = reinterpret_cast<NodeInteger&>(*node[1]).Value;
 				switch (node[0]->GetNodeType()) {
-					case NodeType::Bits: return std::make_shared<NodeBits>(binseq::head(reinterpret_cast<NodeBits&>(*node[0]).Value, count));
-					case NodeType::String: return std::make_shared<NodeString>(vec_head(reinterpret_cast<NodeString&>(*node[0]).Value, count));
-					case NodeType::DynamicArray: return std::make_shared<NodeArray>(vec_head(reinterpret_cast<NodeArray&>(*node[0]).Vector, count));
+					case NodeType::Bits: return MakeNode<NodeBits>(binseq::head(reinterpret_cast<NodeBits&>(*node[0]).Value, count));
+					case NodeType::String: return MakeNode<NodeString>(vec_head(reinterpret_cast<NodeString&>(*node[0]).Value, count));
+					case NodeType::DynamicArray: return MakeNode<NodeArray>(vec_head(reinterpret_cast<NodeArray&>(*node[0]).Vector, count));
 					default: throw Carbon::ExecutorRuntimeException("head only works on sequences");
 				}
 			} else throw Carbon::ExecutorRuntimeException("head needs 2 parameters, a sequence and an integer");
 		}
 
-		static std::shared_ptr<Node> sel_tail(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> sel_tail(std::vector<Ref<Node>>& node) {
+			if (HasSparseOperand(node)) return DenseOperator(node, sel_tail);
 			if (node.size() == 2) {
 				if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("second parameter of tail must be an integer");
 				auto count = reinterpret_cast<NodeInteger&>(*node[1]).Value;
 				switch (node[0]->GetNodeType()) {
-					case NodeType::Bits: return std::make_shared<NodeBits>(binseq::tail(reinterpret_cast<NodeBits&>(*node[0]).Value, count));
-					case NodeType::String: return std::make_shared<NodeString>(vec_tail(reinterpret_cast<NodeString&>(*node[0]).Value, count));
-					case NodeType::DynamicArray: return std::make_shared<NodeArray>(vec_tail(reinterpret_cast<NodeArray&>(*node[0]).Vector, count));
+					case NodeType::Bits: return MakeNode<NodeBits>(binseq::tail(reinterpret_cast<NodeBits&>(*node[0]).Value, count));
+					case NodeType::String: return MakeNode<NodeString>(vec_tail(reinterpret_cast<NodeString&>(*node[0]).Value, count));
+					case NodeType::DynamicArray: return MakeNode<NodeArray>(vec_tail(reinterpret_cast<NodeArray&>(*node[0]).Vector, count));
 					default: throw Carbon::ExecutorRuntimeException("tail only works on sequences");
 				}
 			} else throw Carbon::ExecutorRuntimeException("tail needs 2 parameters, a sequence and an integer");
 		}
 
-		static std::shared_ptr<Node> sel_subseq(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> sel_subseq(std::vector<Ref<Node>>& node) {
+			if (HasSparseOperand(node)) return DenseOperator(node, sel_subseq);
 			if (node.size() == 3) {
 				if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("second parameter of subseq must be an integer");
 				if (node[2]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("third parameter of subseq must be an integer");
 				auto offset = reinterpret_cast<NodeInteger&>(*node[1]).Value;
 				auto count = reinterpret_cast<NodeInteger&>(*node[2]).Value;
 				switch (node[0]->GetNodeType()) {
-					case NodeType::Bits: return std::make_shared<NodeBits>(binseq::subseq(reinterpret_cast<NodeBits&>(*node[0]).Value, offset, count));
-					case NodeType::String: return std::make_shared<NodeString>(vec_subseq(reinterpret_cast<NodeString&>(*node[0]).Value, offset, count));
-					case NodeType::DynamicArray: return std::make_shared<NodeArray>(vec_subseq(reinterpret_cast<NodeArray&>(*node[0]).Vector, offset, count));
+					case NodeType::Bits: return MakeNode<NodeBits>(binseq::subseq(reinterpret_cast<NodeBits&>(*node[0]).Value, offset, count));
+					case NodeType::String: return MakeNode<NodeString>(vec_subseq(reinterpret_cast<NodeString&>(*node[0]).Value, offset, count));
+					case NodeType::DynamicArray: return MakeNode<NodeArray>(vec_subseq(reinterpret_cast<NodeArray&>(*node[0]).Vector, offset, count));
 					default: throw Carbon::ExecutorRuntimeException("subseq only works on sequences");
 				}
 			} else throw Carbon::ExecutorRuntimeException("subseq needs 3 parameters, a sequence and two integers");
 		}
 
-		static std::shared_ptr<Node> seq_repeat(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> seq_repeat(std::vector<Ref<Node>>& node) {
+			if (HasSparseOperand(node)) return DenseOperator(node, seq_repeat);
 			if (node.size() == 2) {
 				if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("second parameter of repeat must be an integer");
 				auto count = reinterpret_cast<NodeInteger&>(*node[1]).Value;
 				switch (node[0]->GetNodeType()) {
-					case NodeType::Bits: return std::make_shared<NodeBits>(binseq::repeat(reinterpret_cast<NodeBits&>(*node[0]).Value, count));
-					case NodeType::String: return std::make_shared<NodeString>(vec_repeat(reinterpret_cast<NodeString&>(*node[0]).Value, count));
-					case NodeType::DynamicArray: return std::make_shared<NodeArray>(vec_repeat(reinterpret_cast<NodeArray&>(*node[0]).Vector, count));
+					case NodeType::Bits: return MakeNode<NodeBits>(binseq::repeat(reinterpret_cast<NodeBits&>(*node[0]).Value, count));
+					case NodeType::String: return MakeNode<NodeString>(vec_repeat(reinterpret_cast<NodeString&>(*node[0]).Value, count));
+					case NodeType::DynamicArray: return MakeNode<NodeArray>(vec_repeat(reinterpret_cast<NodeArray&>(*node[0]).Vector, count));
 					default: throw Carbon::ExecutorRuntimeException("repeat only works on sequences");
 				}
 			} else throw Carbon::ExecutorRuntimeException("repeat needs 2 parameters, a sequence and an integer");
 		}
 
-		static std::shared_ptr<Node> popcount(std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> popcount(std::vector<Ref<Node>>& node) {
 			if (node.size() == 1) {
+				if (node[0]->GetNodeType() == NodeType::SparseBits) {
+					return MakeNode<NodeInteger>((long long)reinterpret_cast<NodeSparseBits&>(*node[0]).Value.popcount());
+				}
 				if (node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("the parameter of popcount must be binseq");
 				auto& seq = reinterpret_cast<NodeBits&>(*node[0]).Value;
 				auto count = binseq::popcount(seq);
-				return std::make_shared<NodeInteger>((long long)count);
+				return MakeNode<NodeInteger>((long long)count);
 			} else throw Carbon::ExecutorRuntimeException("popcount only accepts one parameter");
 		}
 
-		static std::shared_ptr<Node> verbose(ExecutorImp* ex, std::vector<std::shared_ptr<Node>>& node) {
-			if (node.size() > 1) {
-				throw Carbon::ExecutorRuntimeException("verbose accepts only one or zero parameters of string which should contain the words tree, none, submit");
+		static const binseq::sparse_sequence& SparseOperand(Node& node, binseq::sparse_sequence& converted) {
+			switch (node.GetNodeType()) {
+				case NodeType::SparseBits: return reinterpret_cast<NodeSparseBits&>(node).Value;
+				case NodeType::Bits: return converted = binseq::sparse_sequence(reinterpret_cast<NodeBits&>(node).Value);
+				default: throw Carbon::ExecutorRuntimeException("bitwise operator only works on binseq or bit");
 			}
-			if (node.size() == 1) {
-				if (node[0]->GetNodeType() == NodeType::String) {
-					auto& node0 = reinterpret_cast<NodeString&>(*node[0]);
-					auto& str = node0.Value;
-					if (str.find("submit") != std::string::npos) ex->VERBOSE_SUBMIT = true;
-					if (str.find("tree") != std::string::npos) ex->VERBOSE_TREE = true;
-					if (str.find("performance") != std::string::npos) ex->VERBOSE_PERFORMANCE = true;
-					if (str.find("none") != std::string::npos) ex->VERBOSE_SUBMIT = ex->VERBOSE_TREE = ex->VERBOSE_PERFORMANCE = false;
-				} else throw Carbon::ExecutorRuntimeException("parameter is not a string");
+		}
+
+		// bitwise operator on compressed sequences, dense operands are compressed first
+		template <class Operator>
+		static Ref<Node> SparseOperator(std::vector<Ref<Node>>& node, Operator op) {
+			binseq::sparse_sequence l, r;
+			auto& left = SparseOperand(*node[0], l);
+			auto& right = SparseOperand(*node[1], r);
+			try {
+				return PickBitsRepresentation(op(left, right));
+			} catch (std::logic_error& error) {
+				throw Carbon::ExecutorRuntimeException(error.what());
 			}
-			std::string acc = "";
-			if (ex->VERBOSE_SUBMIT) acc += "submit";
-			if (ex->VERBOSE_TREE) {
+		}
+
+		static Ref<Node> sparse(std::vector<Ref<Node>>& node) {
+			//sparse(read("capture.bin")); stays binseq when the data is not sparse enough
+			if (node.size() != 1) throw Carbon::ExecutorRuntimeException("sparse requires one binseq parameter");
+			switch (node[0]->GetNodeType()) {
+				case NodeType::SparseBits: return node[0];
+				case NodeType::Bits: return PickBitsRepresentation(node[0]);
+				default: throw Carbon::ExecutorRuntimeException("sparse requires one binseq parameter");
+			}
+		}
+
+		// reports errors of the binseq codecs as script errors
+		template <class Function>
+		static auto TranslateCodecErrors(Function fn) -> decltype(fn()) {
+			try {
+				return fn();
+			} catch (std::logic_error& error) {
+				throw Carbon::ExecutorRuntimeException(error.what());
+			}
+		}
+
+		// accepts an intarray or an array of integers, used by the bulk codecs
+		static Ref<NodeIntegerArray> IntegerArrayParameter(Ref<Node>& param, const char* message) {
+			if (param->GetNodeType() != NodeType::IntegerArray && param->GetNodeType() != NodeType::DynamicArray) throw Carbon::ExecutorRuntimeException(message);
+			std::vector<Ref<Node>> args{ param };
+			return StaticCast<NodeIntegerArray>(cast_intarray(args));
+		}
+
+		static Ref<NodeIntegerArray> ToIntegerArray(std::vector<binseq::u64>&& values) {
+			auto result = MakeNode<NodeIntegerArray>(values.size());
+			for (size_t i = 0; i < values.size(); i++) {
+				result->Vector[i] = (long long)values[i];
+			}
+			return result;
+		}
+
+		static binseq::u32 RiceParameter(std::vector<Ref<Node>>& node, const char* message) {
+			if (node.size() != 2 || node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException(message);
+			auto k = reinterpret_cast<NodeInteger&>(*node[1]).Value;
+			if (k < 0 || k > 64) throw Carbon::ExecutorRuntimeException("rice parameter must be between 0 and 64");
+			return (binseq::u32)k;
+		}
+
+		// values below minimum are rejected before they are encoded as u64
+		template <class Encoder>
+		static Ref<Node> IntegerEncode(std::vector<Ref<Node>>& node, size_t parameters, long long minimum, const char* message, Encoder encode) {
+			if (node.size() != parameters) throw Carbon::ExecutorRuntimeException(message);
+			auto values = IntegerArrayParameter(node[0], message);
+			for (auto value : values->Vector) {
+				if (value < minimum) throw Carbon::ExecutorRuntimeException(message);
+			}
+			auto data = reinterpret_cast<const binseq::u64*>(values->Vector.data());
+			return TranslateCodecErrors([&]() {
+				return MakeNode<NodeBits>(encode(data, values->Vector.size()));
+			});
+		}
+
+		template <class Decoder>
+		static Ref<Node> IntegerDecode(std::vector<Ref<Node>>& node, size_t parameters, const char* message, Decoder decode) {
+			DenseOperands(node);
+			if (node.size() != parameters || node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException(message);
+			auto& seq = reinterpret_cast<NodeBits&>(*node[0]).Value;
+			return TranslateCodecErrors([&]() {
+				return ToIntegerArray(decode(seq));
+			});
+		}
+
+		static Ref<Node> gamma_encode(std::vector<Ref<Node>>& node) {
+			return IntegerEncode(node, 1, 1, "gamma_encode requires an intarray of positive integers", binseq::gamma_encode);
+		}
+
+		static Ref<Node> gamma_decode(std::vector<Ref<Node>>& node) {
+			return IntegerDecode(node, 1, "gamma_decode requires a binseq", binseq::gamma_decode);
+		}
+
+		static Ref<Node> delta_encode(std::vector<Ref<Node>>& node) {
+			return IntegerEncode(node, 1, 1, "delta_encode requires an intarray of positive integers", binseq::delta_encode);
+		}
+
+		static Ref<Node> delta_decode(std::vector<Ref<Node>>& node) {
+			return IntegerDecode(node, 1, "delta_decode requires a binseq", binseq::delta_decode);
+		}
+
+		static Ref<Node> rice_encode(std::vector<Ref<Node>>& node) {
+			//rice_encode(values, k); divisor is 2^k
+			auto k = RiceParameter(node, "rice_encode requires an intarray of non negative integers and the parameter k");
+			return IntegerEncode(node, 2, 0, "rice_encode requires an intarray of non negative integers and the parameter k", [k](const binseq::u64* values, size_t count) {
+				return binseq::rice_encode(values, count, k);
+			});
+		}
+
+		static Ref<Node> rice_decode(std::vector<Ref<Node>>& node) {
+			auto k = RiceParameter(node, "rice_decode requires a binseq and the parameter k");
+			return IntegerDecode(node, 2, "rice_decode requires a binseq and the parameter k", [k](const binseq::bit_sequence& seq) {
+				return binseq::rice_decode(seq, k);
+			});
+		}
+
+		static Ref<Node> varint_encode(std::vector<Ref<Node>>& node) {
+			return IntegerEncode(node, 1, LLONG_MIN, "varint_encode requires an intarray", binseq::varint_encode);
+		}
+
+		static Ref<Node> varint_decode(std::vector<Ref<Node>>& node) {
+			return IntegerDecode(node, 1, "varint_decode requires a binseq", binseq::varint_decode);
+		}
+
+		static Ref<Node> zigzag_encode(std::vector<Ref<Node>>& node) {
+			if (node.size() != 1) throw Carbon::ExecutorRuntimeException("zigzag_encode requires an intarray");
+			auto values = IntegerArrayParameter(node[0], "zigzag_encode requires an intarray");
+			auto result = MakeNode<NodeIntegerArray>(values->Vector.size());
+			for (size_t i = 0; i < values->Vector.size(); i++) {
+				result->Vector[i] = (long long)binseq::zigzag_encode(values->Vector[i]);
+			}
+			return result;
+		}
+
+		static Ref<Node> zigzag_decode(std::vector<Ref<Node>>& node) {
+			if (node.size() != 1) throw Carbon::ExecutorRuntimeException("zigzag_decode requires an intarray");
+			auto values = IntegerArrayParameter(node[0], "zigzag_decode requires an intarray");
+			auto result = MakeNode<NodeIntegerArray>(values->Vector.size());
+			for (size_t i = 0; i < values->Vector.size(); i++) {
+				result->Vector[i] = binseq::zigzag_decode((binseq::u64)values->Vector[i]);
+			}
+			return result;
+		}
+
+		// entropy coders take the bytes of a string or the values of an integer array
+		template <class Encoder>
+		static Ref<Node> SymbolEncode(std::vector<Ref<Node>>& node, const char* message, Encoder encode) {
+			if (node.size() != 1) throw Carbon::ExecutorRuntimeException(message);
+			if (node[0]->GetNodeType() == NodeType::String) {
+				auto& text = reinterpret_cast<NodeString&>(*node[0]).Value;
+				std::vector<binseq::s64> symbols(text.begin(), text.end());
+				for (auto& s : symbols) s = (unsigned char)s;
+				return TranslateCodecErrors([&]() {
+					return MakeNode<NodeBits>(encode(symbols.data(), symbols.size(), true));
+				});
+			}
+			auto values = IntegerArrayParameter(node[0], message);
+			return TranslateCodecErrors([&]() {
+				return MakeNode<NodeBits>(encode(values->Vector.data(), values->Vector.size(), false));
+			});
+		}
+
+		template <class Decoder>
+		static Ref<Node> SymbolDecode(std::vector<Ref<Node>>& node, const char* message, Decoder decode) {
+			DenseOperands(node);
+			if (node.size() != 1 || node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException(message);
+			auto& seq = reinterpret_cast<NodeBits&>(*node[0]).Value;
+			bool text = false;
+			auto symbols = TranslateCodecErrors([&]() { return decode(seq, &text); });
+			if (!text) return MakeNode<NodeIntegerArray>(std::move(symbols));
+			std::string result(symbols.size(), '\0');
+			for (size_t i = 0; i < symbols.size(); i++) {
+				if (symbols[i] < 0 || symbols[i] > 255) throw Carbon::ExecutorRuntimeException("decoded text contains a symbol which is not a byte");
+				result[i] = (char)symbols[i];
+			}
+			return MakeNode<NodeString>(result);
+		}
+
+		static Ref<Node> huffman_encode(std::vector<Ref<Node>>& node) {
+			return SymbolEncode(node, "huffman_encode requires a string or an intarray", binseq::huffman_encode);
+		}
+
+		static Ref<Node> huffman_decode(std::vector<Ref<Node>>& node) {
+			return SymbolDecode(node, "huffman_decode requires a binseq", binseq::huffman_decode);
+		}
+
+		static Ref<Node> ans_encode(std::vector<Ref<Node>>& node) {
+			return SymbolEncode(node, "ans_encode requires a string or an intarray", binseq::ans_encode);
+		}
+
+		static Ref<Node> ans_decode(std::vector<Ref<Node>>& node) {
+			return SymbolDecode(node, "ans_decode requires a binseq", binseq::ans_decode);
+		}
+
+		// spreads independent blocks over the thread pool
+		static binseq::block_runner BlockRunner(int degreeOfParallelism) {
+			return [degreeOfParallelism](binseq::u64 count, const std::function<void(binseq::u64, binseq::u64)>& fn) {
+				ParallelFor(count, 1, degreeOfParallelism, fn);
+			};
+		}
+
+		static int DegreeOfParallelismParameter(std::vector<Ref<Node>>& node, size_t index, const char* message) {
+			if (node.size() <= index) return 0;
+			if (node[index]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException(message);
+			return (int)reinterpret_cast<NodeInteger&>(*node[index]).Value;
+		}
+
+		static Ref<Node> compress(std::vector<Ref<Node>>& node) {
+			//compress(data[, dop]); data is a binseq or a string
+			DenseOperands(node);
+			if (node.size() < 1 || node.size() > 2) throw Carbon::ExecutorRuntimeException("compress requires a binseq or a string and optionally the degree of parallelism");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 1, "second parameter of compress must be an integer"));
+			switch (node[0]->GetNodeType()) {
+				case NodeType::Bits:
+					return TranslateCodecErrors([&]() {
+						return MakeNode<NodeBits>(binseq::lz_compress(reinterpret_cast<NodeBits&>(*node[0]).Value, false, run));
+					});
+				case NodeType::String: {
+					auto& text = reinterpret_cast<NodeString&>(*node[0]).Value;
+					binseq::bit_sequence seq;
+					seq.reallocate(text.size() * 8);
+					if (!text.empty()) std::memcpy(seq.address(), text.data(), text.size());
+					return TranslateCodecErrors([&]() {
+						return MakeNode<NodeBits>(binseq::lz_compress(seq, true, run));
+					});
+				}
+				default: throw Carbon::ExecutorRuntimeException("compress requires a binseq or a string");
+			}
+		}
+
+		static Ref<Node> decompress(std::vector<Ref<Node>>& node) {
+			DenseOperands(node);
+			if (node.size() < 1 || node.size() > 2 || node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("decompress requires a compressed binseq and optionally the degree of parallelism");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 1, "second parameter of decompress must be an integer"));
+			bool text = false;
+			auto seq = TranslateCodecErrors([&]() {
+				return binseq::lz_decompress(reinterpret_cast<NodeBits&>(*node[0]).Value, &text, run);
+			});
+			if (!text) return MakeNode<NodeBits>(std::move(seq));
+			return MakeNode<NodeString>(std::string(reinterpret_cast<const char*>(seq.address()), (size_t)(seq.size() >> 3)));
+		}
+
+		// p-value object of a NIST SP 800-22 test
+		static Ref<Node> NistResult(const binseq::nist_result& result) {
+			// the tests run concurrently under parallel, so the names are resolved once
+			static const size_t names[] = {
+				NodeObject::GetNameId("applicable"), NodeObject::GetNameId("bits"), NodeObject::GetNameId("p"),
+				NodeObject::GetNameId("passed"), NodeObject::GetNameId("pvalues"), NodeObject::GetNameId("statistics")
+			};
+			auto object = MakeNode<NodeObject>();
+			object->SetAttributeValue(names[0], MakeNode<NodeBit>(result.applicable));
+			object->SetAttributeValue(names[1], MakeNode<NodeInteger>((long long)result.bits));
+			if (!result.applicable) return object;
+			auto pvalues = MakeNode<NodeArray>();
+			auto statistics = MakeNode<NodeArray>();
+			double p = 1;
+			for (size_t i = 0; i < result.p_values.size(); i++) {
+				p = std::min(p, result.p_values[i]);
+				pvalues->Vector.push_back(MakeNode<NodeFloat>(result.p_values[i]));
+				statistics->Vector.push_back(MakeNode<NodeFloat>(result.statistics[i]));
+			}
+			object->SetAttributeValue(names[2], MakeNode<NodeFloat>(p));
+			object->SetAttributeValue(names[3], MakeNode<NodeBit>(p >= binseq::nist_alpha));
+			object->SetAttributeValue(names[4], pvalues);
+			object->SetAttributeValue(names[5], statistics);
+			return object;
+		}
+
+		static const binseq::bit_sequence& NistSequence(std::vector<Ref<Node>>& node, size_t maxParams, const char* message) {
+			DenseOperands(node);
+			if (node.size() < 1 || node.size() > maxParams || node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException(message);
+			return reinterpret_cast<NodeBits&>(*node[0]).Value;
+		}
+
+		// optional positive integer parameter of the NIST tests
+		static binseq::u32 NistParameter(std::vector<Ref<Node>>& node, size_t index, binseq::u32 fallback, const char* message) {
+			if (node.size() <= index) return fallback;
+			if (node[index]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException(message);
+			auto value = reinterpret_cast<NodeInteger&>(*node[index]).Value;
+			if (value < 1 || value > 0xffffffffll) throw Carbon::ExecutorRuntimeException(message);
+			return (binseq::u32)value;
+		}
+
+		template <class Test>
+		static Ref<Node> NistTest(Test test) {
+			return NistResult(TranslateCodecErrors(test));
+		}
+
+		static Ref<Node> nistFrequency(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 1, "nistFrequency requires a binseq");
+			return NistTest([&]() { return binseq::nist_frequency(seq); });
+		}
+
+		static Ref<Node> nistBlockFrequency(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 2, "nistBlockFrequency requires a binseq and optionally the block length");
+			auto block = NistParameter(node, 1, 128, "block length of nistBlockFrequency must be a positive integer");
+			return NistTest([&]() { return binseq::nist_block_frequency(seq, block); });
+		}
+
+		static Ref<Node> nistRuns(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 1, "nistRuns requires a binseq");
+			return NistTest([&]() { return binseq::nist_runs(seq); });
+		}
+
+		static Ref<Node> nistLongestRun(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 1, "nistLongestRun requires a binseq");
+			return NistTest([&]() { return binseq::nist_longest_run(seq); });
+		}
+
+		static Ref<Node> nistRank(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 1, "nistRank requires a binseq");
+			return NistTest([&]() { return binseq::nist_rank(seq); });
+		}
+
+		static Ref<Node> nistDft(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 1, "nistDft requires a binseq");
+			return NistTest([&]() { return binseq::nist_dft(seq); });
+		}
+
+		static Ref<Node> nistNonOverlappingTemplate(std::vector<Ref<Node>>& node) {
+			//nistNonOverlappingTemplate(data, b"000000001", 8);
+			auto& seq = NistSequence(node, 3, "nistNonOverlappingTemplate requires a binseq, optionally the template and the number of blocks");
+			binseq::u64 pattern = 1;
+			binseq::u32 m = 9;
+			if (node.size() >= 2) {
+				if (node[1]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("template of nistNonOverlappingTemplate must be a binseq");
+				auto& templ = reinterpret_cast<NodeBits&>(*node[1]).Value;
+				if (templ.size() < 2 || templ.size() > 32) throw Carbon::ExecutorRuntimeException("template of nistNonOverlappingTemplate must have 2 to 32 bits");
+				m = (binseq::u32)templ.size();
+				pattern = binseq::read_bits(templ, 0, m);
+			}
+			auto blocks = NistParameter(node, 2, 8, "number of blocks of nistNonOverlappingTemplate must be a positive integer");
+			return NistTest([&]() { return binseq::nist_non_overlapping_template(seq, pattern, m, blocks); });
+		}
+
+		static Ref<Node> nistOverlappingTemplate(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 2, "nistOverlappingTemplate requires a binseq and optionally the template length");
+			auto m = NistParameter(node, 1, 9, "template length of nistOverlappingTemplate must be a positive integer");
+			return NistTest([&]() { return binseq::nist_overlapping_template(seq, m); });
+		}
+
+		static Ref<Node> nistUniversal(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 2, "nistUniversal requires a binseq and optionally the block length");
+			auto L = NistParameter(node, 1, 0, "block length of nistUniversal must be a positive integer");
+			return NistTest([&]() { return binseq::nist_universal(seq, L); });
+		}
+
+		static Ref<Node> nistLinearComplexity(std::vector<Ref<Node>>& node) {
+			//nistLinearComplexity(data, 500, 4); the blocks are spread over the thread pool
+			auto& seq = NistSequence(node, 3, "nistLinearComplexity requires a binseq, optionally the block length and the degree of parallelism");
+			auto block = NistParameter(node, 1, 500, "block length of nistLinearComplexity must be a positive integer");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 2, "third parameter of nistLinearComplexity must be an integer"));
+			return NistTest([&]() { return binseq::nist_linear_complexity(seq, block, run); });
+		}
+
+		static Ref<Node> nistSerial(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 2, "nistSerial requires a binseq and optionally the pattern length");
+			auto m = NistParameter(node, 1, 0, "pattern length of nistSerial must be a positive integer");
+			return NistTest([&]() { return binseq::nist_serial(seq, m); });
+		}
+
+		static Ref<Node> nistApproximateEntropy(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 2, "nistApproximateEntropy requires a binseq and optionally the pattern length");
+			auto m = NistParameter(node, 1, 0, "pattern length of nistApproximateEntropy must be a positive integer");
+			return NistTest([&]() { return binseq::nist_approximate_entropy(seq, m); });
+		}
+
+		static Ref<Node> nistCumulativeSums(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 1, "nistCumulativeSums requires a binseq");
+			return NistTest([&]() { return binseq::nist_cumulative_sums(seq); });
+		}
+
+		static Ref<Node> nistRandomExcursion(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 1, "nistRandomExcursion requires a binseq");
+			return NistTest([&]() { return binseq::nist_random_excursions(seq); });
+		}
+
+		static Ref<Node> nistRandomExcursionVariant(std::vector<Ref<Node>>& node) {
+			auto& seq = NistSequence(node, 1, "nistRandomExcursionVariant requires a binseq");
+			return NistTest([&]() { return binseq::nist_random_excursions_variant(seq); });
+		}
+
+		static Ref<Node> life(std::vector<Ref<Node>>& node) {
+			//life(grid, width[, generations[, rule[, dop]]]); rule like "B3/S23", ":T" suffix wraps around
+			DenseOperands(node);
+			if (node.size() < 2 || node.size() > 5) throw Carbon::ExecutorRuntimeException("life requires a binseq grid, the width and optionally the generations, the rule and the degree of parallelism");
+			if (node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("first parameter of life must be a binseq");
+			if (node[1]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[1]).Value < 1) throw Carbon::ExecutorRuntimeException("width of life must be a positive integer");
+			long long generations = 1;
+			if (node.size() >= 3) {
+				if (node[2]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[2]).Value < 0) throw Carbon::ExecutorRuntimeException("generations of life must be a non negative integer");
+				generations = reinterpret_cast<NodeInteger&>(*node[2]).Value;
+			}
+			std::string rule = "B3/S23";
+			if (node.size() >= 4) {
+				if (node[3]->GetNodeType() != NodeType::String) throw Carbon::ExecutorRuntimeException("rule of life must be a string such as \"B3/S23\"");
+				rule = reinterpret_cast<NodeString&>(*node[3]).Value;
+			}
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 4, "fifth parameter of life must be an integer"));
+			return TranslateCodecErrors([&]() {
+				auto& grid = reinterpret_cast<NodeBits&>(*node[0]).Value;
+				auto width = (binseq::u64)reinterpret_cast<NodeInteger&>(*node[1]).Value;
+				return MakeNode<NodeBits>(binseq::life(grid, width, binseq::parse_life_rule(rule.c_str()), (binseq::u64)generations, run));
+			});
+		}
+
+		static Ref<Node> elementary(std::vector<Ref<Node>>& node) {
+			//elementary(cells, 110[, generations[, wrap[, dop]]]);
+			DenseOperands(node);
+			if (node.size() < 2 || node.size() > 5) throw Carbon::ExecutorRuntimeException("elementary requires a binseq, the rule number and optionally the generations, wrap and the degree of parallelism");
+			if (node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("first parameter of elementary must be a binseq");
+			if (node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("rule of elementary must be an integer");
+			auto rule = reinterpret_cast<NodeInteger&>(*node[1]).Value;
+			if (rule < 0 || rule > 255) throw Carbon::ExecutorRuntimeException("rule of elementary must be between 0 and 255");
+			long long generations = 1;
+			if (node.size() >= 3) {
+				if (node[2]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[2]).Value < 0) throw Carbon::ExecutorRuntimeException("generations of elementary must be a non negative integer");
+				generations = reinterpret_cast<NodeInteger&>(*node[2]).Value;
+			}
+			bool wrap = false;
+			if (node.size() >= 4) {
+				if (node[3]->GetNodeType() != NodeType::Bit) throw Carbon::ExecutorRuntimeException("wrap of elementary must be a bit");
+				wrap = reinterpret_cast<NodeBit&>(*node[3]).Value;
+			}
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 4, "fifth parameter of elementary must be an integer"));
+			auto& cells = reinterpret_cast<NodeBits&>(*node[0]).Value;
+			return MakeNode<NodeBits>(binseq::elementary(cells, (binseq::u32)rule, (binseq::u64)generations, wrap, run));
+		}
+
+		static binseq::bit_matrix& MatrixParameter(std::vector<Ref<Node>>& node, size_t index, const char* message) {
+			if (node.size() <= index || node[index]->GetNodeType() != NodeType::BitMatrix) throw Carbon::ExecutorRuntimeException(message);
+			return reinterpret_cast<NodeBitMatrix&>(*node[index]).Value;
+		}
+
+		static Ref<Node> bitmatrix(std::vector<Ref<Node>>& node) {
+			//bitmatrix(rows, cols) zero matrix, bitmatrix(seq, cols) read row by row, bitmatrix(n) identity
+			DenseOperands(node);
+			if (node.size() == 1 && node[0]->GetNodeType() == NodeType::Integer) {
+				auto n = reinterpret_cast<NodeInteger&>(*node[0]).Value;
+				if (n < 0) throw Carbon::ExecutorRuntimeException("size of bitmatrix must be a non negative integer");
+				return MakeNode<NodeBitMatrix>(binseq::bit_matrix::identity((binseq::u64)n));
+			}
+			if (node.size() != 2 || node[1]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("bitmatrix requires the rows and columns, a binseq and the columns or the size of an identity");
+			auto cols = reinterpret_cast<NodeInteger&>(*node[1]).Value;
+			switch (node[0]->GetNodeType()) {
+				case NodeType::Integer: {
+					auto rows = reinterpret_cast<NodeInteger&>(*node[0]).Value;
+					if (rows < 0 || cols < 0) throw Carbon::ExecutorRuntimeException("rows and columns of bitmatrix must be non negative integers");
+					return MakeNode<NodeBitMatrix>(binseq::bit_matrix((binseq::u64)rows, (binseq::u64)cols));
+				}
+				case NodeType::Bits: {
+					auto& seq = reinterpret_cast<NodeBits&>(*node[0]).Value;
+					if (cols < 1 || seq.size() % (binseq::u64)cols != 0) throw Carbon::ExecutorRuntimeException("binseq size must be a multiple of the bitmatrix columns");
+					return MakeNode<NodeBitMatrix>(binseq::bit_matrix::from_sequence(seq, seq.size() / (binseq::u64)cols, (binseq::u64)cols));
+				}
+				default: throw Carbon::ExecutorRuntimeException("first parameter of bitmatrix must be an integer or a binseq");
+			}
+		}
+
+		static Ref<Node> rows(std::vector<Ref<Node>>& node) {
+			auto& m = MatrixParameter(node, 0, "rows requires a bitmatrix");
+			if (node.size() != 1) throw Carbon::ExecutorRuntimeException("rows requires a bitmatrix");
+			return MakeNode<NodeInteger>((long long)m.rows());
+		}
+
+		static Ref<Node> cols(std::vector<Ref<Node>>& node) {
+			auto& m = MatrixParameter(node, 0, "cols requires a bitmatrix");
+			if (node.size() != 1) throw Carbon::ExecutorRuntimeException("cols requires a bitmatrix");
+			return MakeNode<NodeInteger>((long long)m.cols());
+		}
+
+		static Ref<Node> transpose(std::vector<Ref<Node>>& node) {
+			auto& m = MatrixParameter(node, 0, "transpose requires a bitmatrix");
+			if (node.size() != 1) throw Carbon::ExecutorRuntimeException("transpose requires a bitmatrix");
+			return MakeNode<NodeBitMatrix>(binseq::transpose(m));
+		}
+
+		static Ref<Node> matmul(std::vector<Ref<Node>>& node) {
+			//matmul(a, b[, dop]); rows of the product are spread over the thread pool
+			if (node.size() < 2 || node.size() > 3) throw Carbon::ExecutorRuntimeException("matmul requires two bitmatrix and optionally the degree of parallelism");
+			auto& a = MatrixParameter(node, 0, "first parameter of matmul must be a bitmatrix");
+			auto& b = MatrixParameter(node, 1, "second parameter of matmul must be a bitmatrix");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 2, "third parameter of matmul must be an integer"));
+			return TranslateCodecErrors([&]() { return MakeNode<NodeBitMatrix>(binseq::multiply(a, b, run)); });
+		}
+
+		static Ref<Node> rank(std::vector<Ref<Node>>& node) {
+			auto& m = MatrixParameter(node, 0, "rank requires a bitmatrix");
+			if (node.size() != 1) throw Carbon::ExecutorRuntimeException("rank requires a bitmatrix");
+			return MakeNode<NodeInteger>((long long)binseq::rank(m));
+		}
+
+		static Ref<Node> solve(std::vector<Ref<Node>>& node) {
+			//solve(a, b); x with a x = b, void when there is no solution
+			DenseOperands(node);
+			if (node.size() != 2 || node[1]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("solve requires a bitmatrix and a binseq");
+			auto& a = MatrixParameter(node, 0, "first parameter of solve must be a bitmatrix");
+			auto& b = reinterpret_cast<NodeBits&>(*node[1]).Value;
+			return TranslateCodecErrors([&]() -> Ref<Node> {
+				binseq::bit_sequence x;
+				if (!binseq::solve(a, b, x)) return MakeNode<Node>(NodeType::None);
+				return MakeNode<NodeBits>(std::move(x));
+			});
+		}
+
+		static Ref<Node> linear_complexity(std::vector<Ref<Node>>& node) {
+			DenseOperands(node);
+			if (node.size() != 1 || node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("linear_complexity requires a binseq");
+			return MakeNode<NodeInteger>((long long)binseq::linear_complexity(reinterpret_cast<NodeBits&>(*node[0]).Value));
+		}
+
+		static Ref<Node> connection_polynomial(std::vector<Ref<Node>>& node) {
+			//connection_polynomial(seq); c_0..c_L of the shortest LFSR, its length minus one is the linear complexity
+			DenseOperands(node);
+			if (node.size() != 1 || node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("connection_polynomial requires a binseq");
+			return MakeNode<NodeBits>(binseq::connection_polynomial(reinterpret_cast<NodeBits&>(*node[0]).Value));
+		}
+
+		static Ref<Node> lfsr(std::vector<Ref<Node>>& node) {
+			//lfsr(polynomial, seed, bits); output starts with the seed
+			DenseOperands(node);
+			if (node.size() != 3 || node[0]->GetNodeType() != NodeType::Bits || node[1]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("lfsr requires the connection polynomial, the seed and the number of bits");
+			if (node[2]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[2]).Value < 0) throw Carbon::ExecutorRuntimeException("number of bits of lfsr must be a non negative integer");
+			return TranslateCodecErrors([&]() {
+				auto& polynomial = reinterpret_cast<NodeBits&>(*node[0]).Value;
+				auto& seed = reinterpret_cast<NodeBits&>(*node[1]).Value;
+				return MakeNode<NodeBits>(binseq::lfsr(polynomial, seed, (binseq::u64)reinterpret_cast<NodeInteger&>(*node[2]).Value));
+			});
+		}
+
+		static Ref<Node> crc(std::vector<Ref<Node>>& node) {
+			//crc(seq, "crc-32"[, dop]) or crc(seq, width, poly, init, reflect, xorout[, dop])
+			DenseOperands(node);
+			if (node.size() < 2 || node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("crc requires a binseq and an algorithm name or its parameters");
+			auto& seq = reinterpret_cast<NodeBits&>(*node[0]).Value;
+			if (node[1]->GetNodeType() == NodeType::String) {
+				if (node.size() > 3) throw Carbon::ExecutorRuntimeException("crc with an algorithm name accepts only the degree of parallelism after it");
+				auto run = BlockRunner(DegreeOfParallelismParameter(node, 2, "third parameter of crc must be an integer"));
+				return TranslateCodecErrors([&]() {
+					auto parameters = binseq::crc_preset(reinterpret_cast<NodeString&>(*node[1]).Value.c_str());
+					return MakeNode<NodeInteger>((long long)binseq::crc(seq, parameters, run));
+				});
+			}
+			if (node.size() < 6 || node.size() > 7) throw Carbon::ExecutorRuntimeException("crc requires the width, poly, init, reflect and xorout parameters");
+			for (size_t i = 1; i < 6; i++) {
+				if (node[i]->GetNodeType() != (i == 4 ? NodeType::Bit : NodeType::Integer)) throw Carbon::ExecutorRuntimeException("crc parameters are integers except reflect which is a bit");
+			}
+			binseq::crc_parameters parameters;
+			parameters.width = (binseq::u32)reinterpret_cast<NodeInteger&>(*node[1]).Value;
+			parameters.poly = (binseq::u64)reinterpret_cast<NodeInteger&>(*node[2]).Value;
+			parameters.init = (binseq::u64)reinterpret_cast<NodeInteger&>(*node[3]).Value;
+			parameters.reflect = reinterpret_cast<NodeBit&>(*node[4]).Value;
+			parameters.xorout = (binseq::u64)reinterpret_cast<NodeInteger&>(*node[5]).Value;
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 6, "seventh parameter of crc must be an integer"));
+			return TranslateCodecErrors([&]() { return MakeNode<NodeInteger>((long long)binseq::crc(seq, parameters, run)); });
+		}
+
+		static Ref<Node> autocorr(std::vector<Ref<Node>>& node) {
+			//autocorr(seq, maxLag[, dop]); entry k counts the bits which differ from the bit k places later
+			DenseOperands(node);
+			if (node.size() < 2 || node.size() > 3 || node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("autocorr requires a binseq, the maximum lag and optionally the degree of parallelism");
+			if (node[1]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[1]).Value < 0) throw Carbon::ExecutorRuntimeException("maximum lag of autocorr must be a non negative integer");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 2, "third parameter of autocorr must be an integer"));
+			auto& seq = reinterpret_cast<NodeBits&>(*node[0]).Value;
+			return ToIntegerArray(binseq::autocorrelation(seq, (binseq::u64)reinterpret_cast<NodeInteger&>(*node[1]).Value, run));
+		}
+
+		static Ref<Node> xcorr(std::vector<Ref<Node>>& node) {
+			//xcorr(a, b, maxLag[, dop]); entry maxLag+k counts the i where a[i] differs from b[i+k]
+			DenseOperands(node);
+			if (node.size() < 3 || node.size() > 4 || node[0]->GetNodeType() != NodeType::Bits || node[1]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("xcorr requires two binseq, the maximum lag and optionally the degree of parallelism");
+			if (node[2]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[2]).Value < 0) throw Carbon::ExecutorRuntimeException("maximum lag of xcorr must be a non negative integer");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 3, "fourth parameter of xcorr must be an integer"));
+			auto& a = reinterpret_cast<NodeBits&>(*node[0]).Value;
+			auto& b = reinterpret_cast<NodeBits&>(*node[1]).Value;
+			return ToIntegerArray(binseq::cross_correlation(a, b, (binseq::u64)reinterpret_cast<NodeInteger&>(*node[2]).Value, run));
+		}
+
+		static Ref<Node> fft(std::vector<Ref<Node>>& node) {
+			//fft(signal); a binseq is taken as +1 for one and -1 for zero, the result packs re, im of the bins 0..n/2
+			DenseOperands(node);
+			if (node.size() != 1) throw Carbon::ExecutorRuntimeException("fft requires one binseq, intarray or floatarray");
+			std::vector<std::complex<double>> spectrum;
+			switch (node[0]->GetNodeType()) {
+				case NodeType::Bits: {
+					auto& seq = reinterpret_cast<NodeBits&>(*node[0]).Value;
+					spectrum = binseq::real_fft(binseq::bipolar_signal(seq, seq.size()));
+					break;
+				}
+				case NodeType::IntegerArray: {
+					auto& vec = reinterpret_cast<NodeIntegerArray&>(*node[0]).Vector;
+					spectrum = binseq::real_fft(std::vector<double>(vec.begin(), vec.end()));
+					break;
+				}
+				case NodeType::FloatArray:
+					spectrum = binseq::real_fft(reinterpret_cast<NodeFloatArray&>(*node[0]).Vector);
+					break;
+				default: throw Carbon::ExecutorRuntimeException("fft requires one binseq, intarray or floatarray");
+			}
+			auto result = MakeNode<NodeFloatArray>(2 * spectrum.size());
+			for (size_t k = 0; k < spectrum.size(); k++) {
+				result->Vector[2 * k] = spectrum[k].real();
+				result->Vector[2 * k + 1] = spectrum[k].imag();
+			}
+			return result;
+		}
+
+		static const std::vector<double>& SpectrumParameter(std::vector<Ref<Node>>& node, const char* message) {
+			if (node.size() == 0 || node[0]->GetNodeType() != NodeType::FloatArray) throw Carbon::ExecutorRuntimeException(message);
+			auto& spectrum = reinterpret_cast<NodeFloatArray&>(*node[0]).Vector;
+			if (spectrum.size() % 2 != 0) throw Carbon::ExecutorRuntimeException("spectrum must hold pairs of real and imaginary parts");
+			return spectrum;
+		}
+
+		static Ref<Node> magnitude(std::vector<Ref<Node>>& node) {
+			auto& spectrum = SpectrumParameter(node, "magnitude requires a spectrum as returned by fft");
+			if (node.size() != 1) throw Carbon::ExecutorRuntimeException("magnitude requires a spectrum as returned by fft");
+			auto result = MakeNode<NodeFloatArray>(spectrum.size() / 2);
+			for (size_t k = 0; k < result->Vector.size(); k++) result->Vector[k] = std::hypot(spectrum[2 * k], spectrum[2 * k + 1]);
+			return result;
+		}
+
+		static Ref<Node> threshold_count(std::vector<Ref<Node>>& node) {
+			//threshold_count(spectrum, threshold[, bins]); number of the first bins with a magnitude below the threshold
+			auto& spectrum = SpectrumParameter(node, "threshold_count requires a spectrum as returned by fft, the threshold and optionally the bins");
+			if (node.size() < 2 || node.size() > 3) throw Carbon::ExecutorRuntimeException("threshold_count requires a spectrum as returned by fft, the threshold and optionally the bins");
+			double threshold;
+			switch (node[1]->GetNodeType()) {
+				case NodeType::Float: threshold = reinterpret_cast<NodeFloat&>(*node[1]).Value;
+					break;
+				case NodeType::Integer: threshold = (double)reinterpret_cast<NodeInteger&>(*node[1]).Value;
+					break;
+				default: throw Carbon::ExecutorRuntimeException("threshold of threshold_count must be a number");
+			}
+			size_t bins = spectrum.size() / 2;
+			if (node.size() == 3) {
+				if (node[2]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[2]).Value < 0) throw Carbon::ExecutorRuntimeException("bins of threshold_count must be a non negative integer");
+				bins = std::min(bins, (size_t)reinterpret_cast<NodeInteger&>(*node[2]).Value);
+			}
+			// compares squared magnitudes so no square root is taken per bin
+			double limit = threshold * threshold;
+			long long count = 0;
+			for (size_t k = 0; k < bins; k++) {
+				double re = spectrum[2 * k], im = spectrum[2 * k + 1];
+				if (re * re + im * im < limit) count++;
+			}
+			return MakeNode<NodeInteger>(threshold < 0 ? 0 : count);
+		}
+
+		static Ref<Node> block_popcount(std::vector<Ref<Node>>& node) {
+			//block_popcount(seq, blockBits[, dop]); the number of ones in every whole block
+			DenseOperands(node);
+			if (node.size() < 2 || node.size() > 3 || node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("block_popcount requires a binseq, the block length and optionally the degree of parallelism");
+			if (node[1]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[1]).Value <= 0) throw Carbon::ExecutorRuntimeException("block length of block_popcount must be a positive integer");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 2, "third parameter of block_popcount must be an integer"));
+			auto& seq = reinterpret_cast<NodeBits&>(*node[0]).Value;
+			return ToIntegerArray(binseq::block_popcount(seq, (binseq::u64)reinterpret_cast<NodeInteger&>(*node[1]).Value, run));
+		}
+
+		static Ref<Node> pattern_histogram(std::vector<Ref<Node>>& node) {
+			//pattern_histogram(seq, m, overlapping[, dop]); entry p counts the m bit windows which read p
+			DenseOperands(node);
+			if (node.size() < 3 || node.size() > 4 || node[0]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("pattern_histogram requires a binseq, the pattern length, whether patterns overlap and optionally the degree of parallelism");
+			if (node[1]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[1]).Value < 1 || reinterpret_cast<NodeInteger&>(*node[1]).Value > 24) throw Carbon::ExecutorRuntimeException("pattern length of pattern_histogram must be between 1 and 24");
+			if (node[2]->GetNodeType() != NodeType::Bit) throw Carbon::ExecutorRuntimeException("overlapping of pattern_histogram must be a bit");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 3, "fourth parameter of pattern_histogram must be an integer"));
+			auto& seq = reinterpret_cast<NodeBits&>(*node[0]).Value;
+			auto m = (binseq::u32)reinterpret_cast<NodeInteger&>(*node[1]).Value;
+			return ToIntegerArray(binseq::pattern_histogram(seq, m, reinterpret_cast<NodeBit&>(*node[2]).Value, false, run));
+		}
+
+		static std::vector<const binseq::bit_sequence*> SequenceArrayParameter(std::vector<Ref<Node>>& node, size_t index, const char* message) {
+			if (node.size() <= index || node[index]->GetNodeType() != NodeType::DynamicArray) throw Carbon::ExecutorRuntimeException(message);
+			std::vector<const binseq::bit_sequence*> seqs;
+			for (auto& item : reinterpret_cast<NodeArray&>(*node[index]).Vector) {
+				if (item->GetNodeType() == NodeType::SparseBits) throw Carbon::ExecutorRuntimeException(std::string(message) + ", convert sparse elements with binseq()");
+				if (item->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException(message);
+				seqs.push_back(&reinterpret_cast<NodeBits&>(*item).Value);
+			}
+			return seqs;
+		}
+
+		static Ref<Node> column_count(std::vector<Ref<Node>>& node) {
+			//column_count(array[, dop]); entry i counts the sequences which have bit i set
+			if (node.size() < 1 || node.size() > 2) throw Carbon::ExecutorRuntimeException("column_count requires an array of binseq and optionally the degree of parallelism");
+			auto seqs = SequenceArrayParameter(node, 0, "first parameter of column_count must be an array of binseq");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 1, "second parameter of column_count must be an integer"));
+			return TranslateCodecErrors([&] { return ToIntegerArray(binseq::column_counts(seqs, run)); });
+		}
+
+		static Ref<Node> majority(std::vector<Ref<Node>>& node) {
+			//majority(array[, dop]); bit i is set where more than half of the sequences have it set
+			if (node.size() < 1 || node.size() > 2) throw Carbon::ExecutorRuntimeException("majority requires an array of binseq and optionally the degree of parallelism");
+			auto seqs = SequenceArrayParameter(node, 0, "first parameter of majority must be an array of binseq");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 1, "second parameter of majority must be an integer"));
+			return TranslateCodecErrors([&] { return MakeNode<NodeBits>(binseq::majority(seqs, run)); });
+		}
+
+		static Ref<Node> threshold(std::vector<Ref<Node>>& node) {
+			//threshold(array, k[, dop]); bit i is set where at least k of the sequences have it set
+			if (node.size() < 2 || node.size() > 3) throw Carbon::ExecutorRuntimeException("threshold requires an array of binseq, the minimum count and optionally the degree of parallelism");
+			auto seqs = SequenceArrayParameter(node, 0, "first parameter of threshold must be an array of binseq");
+			if (node[1]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[1]).Value < 0) throw Carbon::ExecutorRuntimeException("minimum count of threshold must be a non negative integer");
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 2, "third parameter of threshold must be an integer"));
+			auto k = (binseq::u64)reinterpret_cast<NodeInteger&>(*node[1]).Value;
+			return TranslateCodecErrors([&] { return MakeNode<NodeBits>(binseq::threshold(seqs, k, run)); });
+		}
+
+		template <class Reduction>
+		static Ref<Node> ReduceSequences(std::vector<Ref<Node>>& node, const std::string& name, Reduction reduction) {
+			if (node.size() < 1 || node.size() > 2) throw Carbon::ExecutorRuntimeException(name + " requires an array of binseq and optionally the degree of parallelism");
+			auto seqs = SequenceArrayParameter(node, 0, (std::string("first parameter of ") + name + " must be an array of binseq").c_str());
+			auto run = BlockRunner(DegreeOfParallelismParameter(node, 1, (std::string("second parameter of ") + name + " must be an integer").c_str()));
+			return TranslateCodecErrors([&] { return MakeNode<NodeBits>(reduction(seqs, run)); });
+		}
+
+		static Ref<Node> reduce_and(std::vector<Ref<Node>>& node) {
+			//reduce_and(array[, dop]); bitwise and of all the sequences
+			return ReduceSequences(node, "reduce_and", binseq::reduce_and);
+		}
+
+		static Ref<Node> reduce_or(std::vector<Ref<Node>>& node) {
+			//reduce_or(array[, dop]); bitwise or of all the sequences
+			return ReduceSequences(node, "reduce_or", binseq::reduce_or);
+		}
+
+		static Ref<Node> reduce_xor(std::vector<Ref<Node>>& node) {
+			//reduce_xor(array[, dop]); bitwise xor of all the sequences
+			return ReduceSequences(node, "reduce_xor", binseq::reduce_xor);
+		}
+
+		// shared trailing parameters of the random natives: seed[, generator[, stream[, dop]]]
+		struct RandomOptions {
+			binseq::prng_kind kind;
+			binseq::u64 seed;
+			binseq::u64 stream;
+			binseq::block_runner run;
+		};
+
+		static RandomOptions RandomParameters(std::vector<Ref<Node>>& node, size_t index, const std::string& name) {
+			if (node.size() <= index || node.size() > index + 4) throw Carbon::ExecutorRuntimeException(name + " requires the count, the seed and optionally the generator, the stream and the degree of parallelism");
+			if (node[0]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[0]).Value < 0) throw Carbon::ExecutorRuntimeException("count of " + name + " must be a non negative integer");
+			if (node[index]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("seed of " + name + " must be an integer");
+			RandomOptions options{ binseq::prng_kind::xoshiro256, (binseq::u64)reinterpret_cast<NodeInteger&>(*node[index]).Value, 0, nullptr };
+			if (node.size() > index + 1) {
+				if (node[index + 1]->GetNodeType() != NodeType::String) throw Carbon::ExecutorRuntimeException("generator of " + name + " must be a string");
+				options.kind = TranslateCodecErrors([&] { return binseq::parse_prng(reinterpret_cast<NodeString&>(*node[index + 1]).Value.c_str()); });
+			}
+			if (node.size() > index + 2) {
+				if (node[index + 2]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[index + 2]).Value < 0) throw Carbon::ExecutorRuntimeException("stream of " + name + " must be a non negative integer");
+				options.stream = (binseq::u64)reinterpret_cast<NodeInteger&>(*node[index + 2]).Value;
+				if (options.kind == binseq::prng_kind::xoshiro256 && options.stream > binseq::xoshiro_max_stream) throw Carbon::ExecutorRuntimeException("stream of " + name + " must be at most " + std::to_string(binseq::xoshiro_max_stream) + " with xoshiro256**. pcg32 and philox4x32 take any stream");
+			}
+			options.run = BlockRunner(DegreeOfParallelismParameter(node, index + 3, ("degree of parallelism of " + name + " must be an integer").c_str()));
+			return options;
+		}
+
+		static Ref<Node> random_bits(std::vector<Ref<Node>>& node) {
+			//random_bits(count, seed[, generator[, stream[, dop]]]); the result only depends on the seed, generator and stream
+			auto options = RandomParameters(node, 1, "random_bits");
+			auto count = (binseq::u64)reinterpret_cast<NodeInteger&>(*node[0]).Value;
+			return MakeNode<NodeBits>(binseq::random_bits(options.kind, options.seed, options.stream, count, options.run));
+		}
+
+		static Ref<Node> random_ints(std::vector<Ref<Node>>& node) {
+			//random_ints(count, bound, seed[, generator[, stream[, dop]]]); values are in [0, bound), a bound of 0 keeps all 64 bits
+			auto options = RandomParameters(node, 2, "random_ints");
+			if (node[1]->GetNodeType() != NodeType::Integer || reinterpret_cast<NodeInteger&>(*node[1]).Value < 0) throw Carbon::ExecutorRuntimeException("bound of random_ints must be a non negative integer");
+			auto result = MakeNode<NodeIntegerArray>((size_t)reinterpret_cast<NodeInteger&>(*node[0]).Value);
+			auto bound = (binseq::u64)reinterpret_cast<NodeInteger&>(*node[1]).Value;
+			binseq::random_below(options.kind, options.seed, options.stream, bound, reinterpret_cast<binseq::u64*>(result->Vector.data()), result->Vector.size(), options.run);
+			return result;
+		}
+
+		static Ref<Node> random_floats(std::vector<Ref<Node>>& node) {
+			//random_floats(count, seed[, generator[, stream[, dop]]]); uniform in [0, 1)
+			auto options = RandomParameters(node, 1, "random_floats");
+			auto count = (binseq::u64)reinterpret_cast<NodeInteger&>(*node[0]).Value;
+			return MakeNode<NodeFloatArray>(binseq::random_doubles(options.kind, options.seed, options.stream, count, options.run));
+		}
+
+		// compiled record schemas, so each distinct schema is parsed only once
+		static std::shared_ptr<const binseq::record_decoder> CompileRecordSchema(const std::string& schema) {
+			static std::mutex mutex;
+			static std::unordered_map<std::string, std::shared_ptr<const binseq::record_decoder>> compiled;
+			std::lock_guard<std::mutex> lock(mutex);
+			auto found = compiled.find(schema);
+			if (found != compiled.end()) return found->second;
+			try {
+				auto decoder = std::make_shared<const binseq::record_decoder>(binseq::record_decoder::parse(schema));
+				compiled[schema] = decoder;
+				return decoder;
+			} catch (std::invalid_argument& error) {
+				throw Carbon::ExecutorRuntimeException(error.what());
+			}
+		}
+
+		static Ref<Node> record_layout(std::vector<Ref<Node>>& node) {
+			if (node.size() != 1 || node[0]->GetNodeType() != NodeType::String) throw Carbon::ExecutorRuntimeException("record_layout requires a schema string such as \"id:u16, temp:s12, len:u32le\"");
+			auto decoder = CompileRecordSchema(reinterpret_cast<NodeString&>(*node[0]).Value);
+			auto names = MakeNode<NodeArray>();
+			auto offsets = MakeNode<NodeIntegerArray>();
+			for (auto column : decoder->columns()) {
+				auto& field = decoder->fields()[column];
+				names->Vector.push_back(MakeNode<NodeString>(field.name));
+				offsets->Vector.push_back((long long)field.offset);
+			}
+			auto layout = MakeNode<NodeObject>();
+			layout->SetAttributeValue("bits", MakeNode<NodeInteger>((long long)decoder->record_bits()));
+			layout->SetAttributeValue("fields", names);
+			layout->SetAttributeValue("offsets", offsets);
+			return layout;
+		}
+
+		static Ref<Node> record_decode(std::vector<Ref<Node>>& node) {
+			//record_decode("id:u16, len:u8", capture, 4);
+			DenseOperands(node);
+			if (node.size() < 2 || node.size() > 3) throw Carbon::ExecutorRuntimeException("record_decode needs a schema, a binseq and optionally the degree of parallelism");
+			if (node[0]->GetNodeType() != NodeType::String) throw Carbon::ExecutorRuntimeException("first parameter of record_decode must be a schema string");
+			if (node[1]->GetNodeType() != NodeType::Bits) throw Carbon::ExecutorRuntimeException("second parameter of record_decode must be a binseq");
+			int degreeOfParallelism = 0;
+			if (node.size() == 3) {
+				if (node[2]->GetNodeType() != NodeType::Integer) throw Carbon::ExecutorRuntimeException("third parameter of record_decode must be an integer");
+				degreeOfParallelism = (int)reinterpret_cast<NodeInteger&>(*node[2]).Value;
+			}
+			auto decoder = CompileRecordSchema(reinterpret_cast<NodeString&>(*node[0]).Value);
+			auto& seq = reinterpret_cast<NodeBits&>(*node[1]).Value;
+			auto count = decoder->record_count(seq);
+			auto& columns = decoder->columns();
+			std::vector<Ref<NodeIntegerArray>> arrays(columns.size());
+			for (auto& array : arrays) {
+				array = MakeNode<NodeIntegerArray>((size_t)count);
+			}
+			ParallelFor(count, 1 << 14, degreeOfParallelism, [&](binseq::u64 begin, binseq::u64 end) {
+				std::vector<binseq::s64*> output(arrays.size());
+				for (size_t c = 0; c < arrays.size(); c++) {
+					output[c] = arrays[c]->Vector.data() + begin;
+				}
+				decoder->decode(seq, begin, end - begin, output.data());
+			});
+			auto result = MakeNode<NodeObject>();
+			for (size_t c = 0; c < columns.size(); c++) {
+				result->SetAttributeValue(decoder->fields()[columns[c]].name, arrays[c]);
+			}
+			return result;
+		}
+
+		static Ref<Node> verbose(ExecutorImp* ex, std::vector<Ref<Node>>& node) {
+			if (node.size() > 1) {
+				throw Carbon::ExecutorRuntimeException("verbose accepts only one or zero parameters of string which should contain the words tree, none, submit");
+			}
+			if (node.size() == 1) {
+				if (node[0]->GetNodeType() == NodeType::String) {
+					auto& node0 = reinterpret_cast<NodeString&>(*node[0]);
+					auto& str = node0.Value;
+					if (str.find("submit") != std::string::npos) ex->VERBOSE_SUBMIT = true;
+					if (str.find("tree") != std::string::npos) ex->VERBOSE_TREE = true;
+					if (str.find("performance") != std::string::npos) ex->VERBOSE_PERFORMANCE = true;
+					if (str.find("bytecode") != std::string::npos) ex->VERBOSE_BYTECODE = true;
+					if (str.find("types") != std::string::npos) ex->VERBOSE_TYPES = true;
+					if (str.find("none") != std::string::npos) ex->VERBOSE_SUBMIT = ex->VERBOSE_TREE = ex->VERBOSE_PERFORMANCE = ex->VERBOSE_BYTECODE = ex->VERBOSE_TYPES = false;
+				} else throw Carbon::ExecutorRuntimeException("parameter is not a string");
+			}
+			std::string acc = "";
+			if (ex->VERBOSE_SUBMIT) acc += "submit";
+			if (ex->VERBOSE_TREE) {
 				if (acc.size() > 0) {
 					acc += " ";
 				}
 				acc += "tree";
 			}
-			return std::make_shared<NodeString>(acc);
+			if (ex->VERBOSE_BYTECODE) {
+				if (acc.size() > 0) {
+					acc += " ";
+				}
+				acc += "bytecode";
+			}
+			if (ex->VERBOSE_TYPES) {
+				if (acc.size() > 0) {
+					acc += " ";
+				}
+				acc += "types";
+			}
+			return MakeNode<NodeString>(acc);
+		}
+
+		static Ref<Node> optimize(ExecutorImp* ex, std::vector<Ref<Node>>& node) {
+			if (node.size() > 1) {
+				throw Carbon::ExecutorRuntimeException("optimize accepts only one or zero parameters of string which should contain the words types, constants, none");
+			}
+			if (node.size() == 1) {
+				if (node[0]->GetNodeType() == NodeType::String) {
+					auto& str = reinterpret_cast<NodeString&>(*node[0]).Value;
+					if (str.find("types") != std::string::npos) ex->TYPE_INFERENCE = true;
+					if (str.find("constants") != std::string::npos) ex->FOLD_CONSTANTS = true;
+					if (str.find("none") != std::string::npos) ex->TYPE_INFERENCE = ex->FOLD_CONSTANTS = false;
+				} else throw Carbon::ExecutorRuntimeException("parameter is not a string");
+			}
+			std::string acc = ex->TYPE_INFERENCE ? "types" : "";
+			if (ex->FOLD_CONSTANTS) {
+				if (acc.size() > 0) {
+					acc += " ";
+				}
+				acc += "constants";
+			}
+			return MakeNode<NodeString>(acc);
 		}
 		
-		static std::shared_ptr<Node> properties(ExecutorImp* ex, std::vector<std::shared_ptr<Node>>& node) {
+		static Ref<Node> properties(ExecutorImp* ex, std::vector<Ref<Node>>& node) {
 			if (node.size() == 0) {
 				auto keys = ex->SymbolTable.GlobalKeys();
-				auto arr = std::make_shared<NodeArray>(keys.size());
+				auto arr = MakeNode<NodeArray>(keys.size());
 				for (auto i = 0; i < keys.size(); i++) {
-					arr->Vector[i] = std::make_shared<NodeString>(keys[i]);
+					arr->Vector[i] = MakeNode<NodeString>(keys[i]);
 				}
 				return arr;
 			} else if (node.size() == 1) {
 				if (node[0]->GetNodeType() == NodeType::DynamicObject) {
 					auto& obj = reinterpret_cast<NodeObject&>(*node[0]);
-					auto arr = std::make_shared<NodeArray>();
+					auto arr = MakeNode<NodeArray>();
 					std::vector<std::string> propList;
 					for (auto key : obj.GetAttributeKeys()) {
-						arr->Vector.push_back(std::make_shared<NodeString>(key));
+						arr->Vector.push_back(MakeNode<NodeString>(key));
 					}
 					return arr;
 				} else return ex->Error("first parameter of properties must be an object");
@@ -2321,218 +4067,241 @@ namespace Carbon {
 		namespace op {
 
 
-			static std::shared_ptr<Node> _not(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> _not(std::vector<Ref<Node>>& node) {
 				if (node.size() == 1) {
-					if (node[0]->GetNodeType() == NodeType::Bit) {
+					if (node[0]->GetNodeType() == NodeType::SparseBits) {
+						return PickBitsRepresentation(binseq::_not(reinterpret_cast<NodeSparseBits&>(*node[0]).Value));
+					} else if (node[0]->GetNodeType() == NodeType::Bit) {
 						auto& v = reinterpret_cast<NodeBit&>(*node[0]);
-						return std::make_shared<NodeBit>(!v.Value);
+						return MakeNode<NodeBit>(!v.Value);
 					} else if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& v = reinterpret_cast<NodeBits&>(*node[0]);
-						return std::make_shared<NodeBits>(binseq::_not(v.Value));
+						return MakeNode<NodeBits>(binseq::_not(v.Value));
 					} else throw Carbon::ExecutorRuntimeException("not operator only works on binseq or bit");
 				} else throw Carbon::ExecutorRuntimeException("not operator requires 1 parameter");
 			}
 
-			static std::shared_ptr<Node> _and(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> _and(std::vector<Ref<Node>>& node) {
 				if (node.size() == 2) {
-					if (node[0]->GetNodeType() == NodeType::Bit) {
+					if (HasSparseOperand(node)) {
+						return SparseOperator(node, [](const binseq::sparse_sequence& l, const binseq::sparse_sequence& r) { return binseq::_and(l, r); });
+					} else if (node[0]->GetNodeType() == NodeType::Bit) {
 						auto& l = reinterpret_cast<NodeBit&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBit&>(*node[1]);
-						return std::make_shared<NodeBit>((l.Value && r.Value));
+						return MakeNode<NodeBit>((l.Value && r.Value));
 					} else if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::_and(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::_and(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise operator only works on binseq or bit");
 				} else throw Carbon::ExecutorRuntimeException("bitwise operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> _or(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> _or(std::vector<Ref<Node>>& node) {
 				if (node.size() == 2) {
-					if (node[0]->GetNodeType() == NodeType::Bit) {
+					if (HasSparseOperand(node)) {
+						return SparseOperator(node, [](const binseq::sparse_sequence& l, const binseq::sparse_sequence& r) { return binseq::_or(l, r); });
+					} else if (node[0]->GetNodeType() == NodeType::Bit) {
 						auto& l = reinterpret_cast<NodeBit&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBit&>(*node[1]);
-						return std::make_shared<NodeBit>((l.Value || r.Value));
+						return MakeNode<NodeBit>((l.Value || r.Value));
 					} else if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::_or(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::_or(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise operator only works on binseq or bit");
 				} else throw Carbon::ExecutorRuntimeException("bitwise operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> _xor(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> _xor(std::vector<Ref<Node>>& node) {
 				if (node.size() == 2) {
-					if (node[0]->GetNodeType() == NodeType::Bit) {
+					if (HasSparseOperand(node)) {
+						return SparseOperator(node, [](const binseq::sparse_sequence& l, const binseq::sparse_sequence& r) { return binseq::_xor(l, r); });
+					} else if (node[0]->GetNodeType() == NodeType::Bit) {
 						auto& l = reinterpret_cast<NodeBit&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBit&>(*node[1]);
-						return std::make_shared<NodeBit>(l.Value != r.Value);
+						return MakeNode<NodeBit>(l.Value != r.Value);
 					} else if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::_xor(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::_xor(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise operator only works on binseq or bit");
 				} else throw Carbon::ExecutorRuntimeException("bitwise operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> nand(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> nand(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, nand);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bit) {
 						auto& l = reinterpret_cast<NodeBit&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBit&>(*node[1]);
-						return std::make_shared<NodeBit>(!(l.Value && r.Value));
+						return MakeNode<NodeBit>(!(l.Value && r.Value));
 					} else if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::nand(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::nand(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise operator only works on binseq or bit");
 				} else throw Carbon::ExecutorRuntimeException("bitwise operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> nor(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> nor(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, nor);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bit) {
 						auto& l = reinterpret_cast<NodeBit&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBit&>(*node[1]);
-						return std::make_shared<NodeBit>(!(l.Value || r.Value));
+						return MakeNode<NodeBit>(!(l.Value || r.Value));
 					} else if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::nor(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::nor(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise operator only works on binseq or bit");
 				} else throw Carbon::ExecutorRuntimeException("bitwise operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> nxor(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> nxor(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, nxor);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bit) {
 						auto& l = reinterpret_cast<NodeBit&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBit&>(*node[1]);
-						return std::make_shared<NodeBit>(l.Value == r.Value);
+						return MakeNode<NodeBit>(l.Value == r.Value);
 					} else if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::nxor(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::nxor(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise operator only works on binseq or bit");
 				} else throw Carbon::ExecutorRuntimeException("bitwise operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> andc(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> andc(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, andc);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::andc(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::andc(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise cut operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise cut operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> orc(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> orc(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, orc);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::orc(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::orc(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise cut operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise cut operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> xorc(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> xorc(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, xorc);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::xorc(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::xorc(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise cut operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise cut operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> nandc(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> nandc(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, nandc);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::nandc(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::nandc(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise cut operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise cut operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> norc(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> norc(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, norc);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::norc(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::norc(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise cut operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise cut operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> nxorc(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> nxorc(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, nxorc);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::nxorc(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::nxorc(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise cut operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise cut operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> andr(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> andr(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, andr);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::andr(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::andr(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> orr(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> orr(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, orr);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::orr(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::orr(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> xorr(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> xorr(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, xorr);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::xorr(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::xorr(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> nandr(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> nandr(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, nandr);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::nandr(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::nandr(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> norr(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> norr(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, norr);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::norr(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::norr(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator requires 2 parameters");
 			}
 
-			static std::shared_ptr<Node> nxorr(std::vector<std::shared_ptr<Node>>& node) {
+			static Ref<Node> nxorr(std::vector<Ref<Node>>& node) {
+				if (HasSparseOperand(node)) return DenseOperator(node, nxorr);
 				if (node.size() == 2) {
 					if (node[0]->GetNodeType() == NodeType::Bits) {
 						auto& l = reinterpret_cast<NodeBits&>(*node[0]);
 						auto& r = reinterpret_cast<NodeBits&>(*node[1]);
-						return std::make_shared<NodeBits>(binseq::nxorr(l.Value, r.Value));
+						return MakeNode<NodeBits>(binseq::nxorr(l.Value, r.Value));
 					} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator only works on binseq");
 				} else throw Carbon::ExecutorRuntimeException("bitwise repeat operator requires 2 parameters");
 			}
@@ -2545,13 +4314,17 @@ namespace Carbon {
 
 	ExecutorImp::ExecutorImp() {
 		this->ControlLevel = 0;
-		this->SymbolTable.Global("void") = std::make_shared<Node>(NodeType::None);
-		this->SymbolTable.Global("error") = std::make_shared<Node>(NodeType::Error);
+		this->SealingDisabled = false;
+		this->SealEpoch = 1;
+		this->InferFunctionTypes = [this](BytecodeChunk& chunk) { InferTypes(chunk, false); };
+		this->SymbolTable.Global("void") = MakeNode<Node>(NodeType::None);
+		this->SymbolTable.Global("error") = MakeNode<Node>(NodeType::Error);
 		//system commands
 		RegisterNativeFunction("system", native::system, false);
 		RegisterNativeFunction("exit", native::exit, false);
 		RegisterInternalNativeFunction("delete", native::del, false);
 		RegisterInternalNativeFunction("verbose", native::verbose, false);
+		RegisterInternalNativeFunction("optimize", native::optimize, false);
 
 		// paralellization
 		RegisterInternalNativeFunction("parallel", native::parallel, false);
@@ -2565,21 +4338,23 @@ namespace Carbon {
 		RegisterNativeFunction("print", native::print, false);
 
 		//type information
-		RegisterNativeFunction("type", native::type, true);
+		RegisterNativeFunction("type", native::type, true, NodeType::String);
 
 		//type casting / new instance
-		RegisterNativeFunction("integer", native::cast_integer, true);
-		RegisterNativeFunction("float", native::cast_float, true);
+		RegisterNativeFunction("integer", native::cast_integer, true, NodeType::Integer);
+		RegisterNativeFunction("float", native::cast_float, true, NodeType::Float);
 		RegisterNativeFunction("string", native::cast_string, true);
 		RegisterNativeFunction("binseq", native::cast_bits, true);
 		RegisterNativeFunction("bit", native::cast_bit, true);
 		RegisterNativeFunction("array", native::cast_array, true);
+		RegisterNativeFunction("intarray", native::cast_intarray, true);
+		RegisterNativeFunction("floatarray", native::cast_floatarray, true);
 		RegisterNativeFunction("object", native::cast_object, true);
 
 		//container operations
 		RegisterNativeFunction("get", native::get, true);
-		RegisterNativeFunction("set", native::set, true);
-		RegisterNativeFunction("length", native::length, true);
+		RegisterNativeFunction("set", native::set, false);
+		RegisterNativeFunction("length", native::length, true, NodeType::Integer);
 		RegisterInternalNativeFunction("properties", native::properties, false);
 
 		//selectors
@@ -2619,63 +4394,152 @@ namespace Carbon {
 
 		//testing
 
-		RegisterNativeFunction("popcount", native::popcount, true);
+		RegisterNativeFunction("popcount", native::popcount, true, NodeType::Integer);
+
+		//compressed sequences
+		RegisterNativeFunction("sparse", native::sparse, true);
+
+		//integer codes
+		RegisterNativeFunction("gamma_encode", native::gamma_encode, true);
+		RegisterNativeFunction("gamma_decode", native::gamma_decode, true);
+		RegisterNativeFunction("delta_encode", native::delta_encode, true);
+		RegisterNativeFunction("delta_decode", native::delta_decode, true);
+		RegisterNativeFunction("rice_encode", native::rice_encode, true);
+		RegisterNativeFunction("rice_decode", native::rice_decode, true);
+		RegisterNativeFunction("varint_encode", native::varint_encode, true);
+		RegisterNativeFunction("varint_decode", native::varint_decode, true);
+		RegisterNativeFunction("zigzag_encode", native::zigzag_encode, true);
+		RegisterNativeFunction("zigzag_decode", native::zigzag_decode, true);
+
+		//entropy coders
+		RegisterNativeFunction("huffman_encode", native::huffman_encode, true);
+		RegisterNativeFunction("huffman_decode", native::huffman_decode, true);
+		RegisterNativeFunction("ans_encode", native::ans_encode, true);
+		RegisterNativeFunction("ans_decode", native::ans_decode, true);
+
+		//compression
+		RegisterNativeFunction("compress", native::compress, true);
+		RegisterNativeFunction("decompress", native::decompress, true);
+
+		//randomness tests
+		RegisterNativeFunction("nistFrequency", native::nistFrequency, true);
+		RegisterNativeFunction("nistBlockFrequency", native::nistBlockFrequency, true);
+		RegisterNativeFunction("nistRuns", native::nistRuns, true);
+		RegisterNativeFunction("nistLongestRun", native::nistLongestRun, true);
+		RegisterNativeFunction("nistRank", native::nistRank, true);
+		RegisterNativeFunction("nistDft", native::nistDft, true);
+		RegisterNativeFunction("nistNonOverlappingTemplate", native::nistNonOverlappingTemplate, true);
+		RegisterNativeFunction("nistOverlappingTemplate", native::nistOverlappingTemplate, true);
+		RegisterNativeFunction("nistUniversal", native::nistUniversal, true);
+		RegisterNativeFunction("nistLinearComplexity", native::nistLinearComplexity, true);
+		RegisterNativeFunction("nistSerial", native::nistSerial, true);
+		RegisterNativeFunction("nistApproximateEntropy", native::nistApproximateEntropy, true);
+		RegisterNativeFunction("nistCumulativeSums", native::nistCumulativeSums, true);
+		RegisterNativeFunction("nistRandomExcursion", native::nistRandomExcursion, true);
+		RegisterNativeFunction("nistRandomExcursionVariant", native::nistRandomExcursionVariant, true);
+
+		//cellular automata
+		RegisterNativeFunction("life", native::life, true);
+		RegisterNativeFunction("elementary", native::elementary, true);
+
+		//bit matrices
+		RegisterNativeFunction("bitmatrix", native::bitmatrix, true);
+		RegisterNativeFunction("rows", native::rows, true);
+		RegisterNativeFunction("cols", native::cols, true);
+		RegisterNativeFunction("transpose", native::transpose, true);
+		RegisterNativeFunction("matmul", native::matmul, true);
+		RegisterNativeFunction("rank", native::rank, true);
+		RegisterNativeFunction("solve", native::solve, true);
+
+		//shift registers and checksums
+		RegisterNativeFunction("linear_complexity", native::linear_complexity, true);
+		RegisterNativeFunction("connection_polynomial", native::connection_polynomial, true);
+		RegisterNativeFunction("lfsr", native::lfsr, true);
+		RegisterNativeFunction("crc", native::crc, true);
+
+		//correlation
+		RegisterNativeFunction("autocorr", native::autocorr, true);
+		RegisterNativeFunction("xcorr", native::xcorr, true);
+
+		//spectral analysis
+		RegisterNativeFunction("fft", native::fft, true);
+		RegisterNativeFunction("magnitude", native::magnitude, true);
+		RegisterNativeFunction("threshold_count", native::threshold_count, true);
+
+		//bit counting
+		RegisterNativeFunction("block_popcount", native::block_popcount, true);
+		RegisterNativeFunction("pattern_histogram", native::pattern_histogram, true);
+
+		//vertical counters
+		RegisterNativeFunction("column_count", native::column_count, true);
+		RegisterNativeFunction("majority", native::majority, true);
+		RegisterNativeFunction("threshold", native::threshold, true);
+		RegisterNativeFunction("reduce_and", native::reduce_and, true);
+		RegisterNativeFunction("reduce_or", native::reduce_or, true);
+		RegisterNativeFunction("reduce_xor", native::reduce_xor, true);
+
+		//random generators
+		RegisterNativeFunction("random_bits", native::random_bits, true);
+		RegisterNativeFunction("random_ints", native::random_ints, true);
+		RegisterNativeFunction("random_floats", native::random_floats, true);
+
+		//binary records
+		RegisterNativeFunction("record_layout", native::record_layout, true);
+		RegisterNativeFunction("record_decode", native::record_decode, true);
 
 	}
 
 	/* function call dispatch */
 
-	inline std::shared_ptr<Node> ExecutorImp::ExecuteCall(NodeCommand& node) {
+	Value ExecutorImp::Call(NodeFunction& function, Value* arguments, size_t count) {
+		if (function.Native) {
+			CallStack::Arguments paramlist(CallStack::Current(), arguments, count);
+			if (function.InternalNative)
+			{
+				return reinterpret_cast<internal_native_function_ptr>(function.nativeptr)(this, paramlist.List);
+			}
+			else
+			{
+				return function.nativeptr(paramlist.List);
+			}
+		}
+		auto& body = BytecodeCompiler::FunctionBody(function, InferFunctionTypes, VERBOSE_BYTECODE ? stdout : nullptr);
+		SymbolTable.Reserve(body.SlotCount);
+		SymbolTable.Push();
+		size_t functionParameterCount = function.ParameterSlots.size();
+		size_t parametersToPass = functionParameterCount > count ? count : functionParameterCount;
+		for (size_t i = 0; i < parametersToPass; i++)
+			SymbolTable.Local(function.ParameterSlots[i]) = arguments[i];
+		for (size_t i = parametersToPass; i < functionParameterCount; i++)
+			SymbolTable.Local(function.ParameterSlots[i]) = noneValue;
+		auto result = Run(body);
+		SymbolTable.Pop();
+		while (result.GetNodeType() == NodeType::Return) {
+			result = reinterpret_cast<NodeReturn&>(result.GetNode()).Value;
+		}
+		return result;
+	}
+
+	inline Ref<Node> ExecutorImp::ExecuteCall(NodeCommand& node) {
 		// function node
-		NodeFunction* function = nullptr;
-		auto fnnodeptr = node.Children[0];
+		Ref<Node> fnnodeptr = node.Children[0];
 		if (fnnodeptr->GetNodeType() == NodeType::Atom)
 		{
 			// we ereceived function name, perform lookup
-			auto fname = reinterpret_cast<NodeAtom*>(&*node.Children[0])->AtomText;
-			std::shared_ptr<Node> nodeptr = SymbolTable[fname];
-			if (nodeptr != nullptr && nodeptr->GetNodeType() == NodeType::Function) {
-				function = reinterpret_cast<NodeFunction*>(&*nodeptr);
-			}
-			else throw ExecutorRuntimeException(fname + " is not a function");
+			auto& fname = reinterpret_cast<NodeAtom&>(*fnnodeptr).AtomText;
+			fnnodeptr = SymbolTable[fname].Box();
+			if (fnnodeptr == nullptr || fnnodeptr->GetNodeType() != NodeType::Function)
+				throw ExecutorRuntimeException(fname + " is not a function");
 		}
-		else if(fnnodeptr->GetNodeType() == NodeType::Function)
+		else if (fnnodeptr->GetNodeType() != NodeType::Function)
 		{
-			// we received function directly
-			function = reinterpret_cast<NodeFunction*>(&*fnnodeptr);
+			throw ExecutorRuntimeException("parameter is not a function");
 		}
-		if (function != nullptr) {
-			std::vector<std::shared_ptr<Node>> paramlist;
-			for (auto i = ++node.Children.begin(); i != node.Children.end(); ++i) {
-				paramlist.push_back(ExecuteStatement(*i));
-			}
-			if (function->Native) {
-				if (function->InternalNative)
-				{
-					return reinterpret_cast<internal_native_function_ptr>(function->nativeptr)(this, paramlist);
-				}
-				else
-				{
-					return function->nativeptr(paramlist);
-				}
-			} else {
-				SymbolTable.Push();
-				unsigned functionParameterCount = function->ParameterList.size();
-				unsigned callParamCount = paramlist.size();
-				unsigned parametersToPass = functionParameterCount > callParamCount ? callParamCount : functionParameterCount;
-				for (unsigned i = 0; i < parametersToPass; i++)
-					SymbolTable.Local(function->ParameterList[i]) = paramlist[i];
-				for (unsigned i = parametersToPass; i < functionParameterCount; i++)
-					SymbolTable.Local(function->ParameterList[i]) = std::make_shared<Node>(NodeType::None);
-				auto result = ExecuteStatement(function->Implementation);
-				SymbolTable.Pop();
-				while (result->GetNodeType() == NodeType::Return) {
-					result = reinterpret_cast<NodeReturn&>(*result).Value;
-				}
-				return result;
-			}
-		}
-		else throw ExecutorRuntimeException("parameter is not a function");
+		std::vector<Value> paramlist;
+		for (auto i = ++node.Children.begin(); i != node.Children.end(); ++i) {
+			paramlist.push_back(ExecuteStatement(*i));
+		}
+		return Call(reinterpret_cast<NodeFunction&>(*fnnodeptr), paramlist.data(), paramlist.size()).Box();
 	}
 
 }
@@ -10,8 +10,11 @@ void Carbon::ParallelTaskGroup::AddTask(std::function<void()> task)
 	this->mutex.unlock();
 }
 
+static thread_local bool isWorkerThread = false;
+
 void Carbon::ThreadPool::ThreadMethod(int threadId)
 {
+	isWorkerThread = true;
 	ParallelTaskGroup* taskGroupPtr = nullptr;
 	// check for the end
 	while (this->beingDisposed != true)
@@ -159,6 +162,16 @@ Carbon::ThreadPool::~ThreadPool()
 
 }
 
+int Carbon::ThreadPool::GetNumberOfThreads() const
+{
+	return this->numberOfThreads;
+}
+
+bool Carbon::ThreadPool::IsWorkerThread()
+{
+	return isWorkerThread;
+}
+
 bool Carbon::ParallelTaskGroup::IsDone() const
 {
 	return this->done;
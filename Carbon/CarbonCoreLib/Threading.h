@@ -48,6 +48,9 @@ namespace Carbon
 		ThreadPool();
 		ThreadPool(int numberOfThreads);
 		~ThreadPool();
+		int GetNumberOfThreads() const;
+		// true when called from one of the worker threads of any pool
+		static bool IsWorkerThread();
 	};
 
 	template <typename TLambdaContainer>
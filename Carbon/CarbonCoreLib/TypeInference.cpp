@@ -0,0 +1,542 @@
+#include "TypeInference.h"
+#include <map>
+
+namespace Carbon
+{
+	// type the pass could not prove, no value has it
+	static const NodeType Unknown = static_cast<NodeType>(-1);
+
+	// local mode flag of the symbol table, Either where paths disagree
+	enum class ModeFlag : signed char {
+		Off,
+		On,
+		Either
+	};
+
+	// what is known of the innermost binding of a variable, the binding was
+	// made in scope Bound or an outer one, scopes are counted from the one
+	// the chunk starts in
+	struct VariableFact {
+		NodeType Type;
+		int Bound;
+	};
+
+	// abstract state before one instruction
+	struct TypeState {
+		bool Reached = false;
+		int Depth = 0;
+		ModeFlag Mode = ModeFlag::Off;
+		std::vector<NodeType> Registers;
+		std::vector<ModeFlag> Saved; // flag SetMode saved into the register
+		std::vector<int> Functions; // slot GetFunction loaded the register from, -1 otherwise
+		std::vector<int> Known; // constant the register holds, -1 otherwise
+		std::map<int, VariableFact> Variables;
+	};
+
+	class TypeInferencePass {
+	public:
+		TypeInferencePass(BytecodeChunk& chunk, TypeInference::Environment& environment)
+			: chunk(chunk), environment(environment), states(chunk.Code.size()) { }
+
+		bool Solve(bool entry);
+		std::unique_ptr<TypedCode> Rewrite(unsigned epoch) const;
+		void Dump(FILE* out, const TypedCode* typed) const;
+
+	private:
+		BytecodeChunk& chunk;
+		TypeInference::Environment& environment;
+		std::vector<TypeState> states;
+		// constants appended for sealed globals by slot and for folded
+		// instructions by index, -1 when there is none
+		mutable std::map<int, int> sealed;
+		mutable std::map<int, int> folded;
+
+		TypeState Entry(bool entry) const;
+		Ref<Node> Callee(const TypeState& state, const Instruction& instruction) const;
+		Ref<Node> Native(const TypeState& state, const Instruction& instruction) const;
+		int Sealed(const TypeState& state, const Instruction& instruction) const;
+		int Fold(int pc, const TypeState& state) const;
+		NodeType ArithmeticResult(const TypeState& state, const Instruction& instruction) const;
+		void Step(int pc, TypeState& state) const;
+		static bool Merge(TypeState& into, const TypeState& from);
+	};
+
+	static bool WritesRegister(OpCode op) {
+		switch (op) {
+			case OpCode::SetVariable:
+			case OpCode::SetLocal:
+			case OpCode::SetMember:
+			case OpCode::PushScope:
+			case OpCode::PopScope:
+			case OpCode::RestoreMode:
+			case OpCode::Jump:
+			case OpCode::JumpIfFalse:
+			case OpCode::JumpIfFalseUnchecked:
+			case OpCode::Return:
+			case OpCode::Throw:
+				return false;
+			default:
+				return true;
+		}
+	}
+
+	static void SetRegister(TypeState& state, int r, NodeType type) {
+		state.Registers[r] = type;
+		state.Saved[r] = ModeFlag::Either;
+		state.Functions[r] = -1;
+		state.Known[r] = -1;
+	}
+
+	static void SetConstant(TypeState& state, int r, const BytecodeChunk& chunk, int index) {
+		SetRegister(state, r, chunk.Constants[index].GetNodeType());
+		state.Known[r] = index;
+	}
+
+	// folded values which a script can change in place, copied every time
+	static bool IsMutable(const Value& value) {
+		return value.GetNodeType() == NodeType::String || value.GetNodeType() == NodeType::Bits;
+	}
+
+	static bool IsScalar(const Value& value) {
+		auto type = value.GetNodeType();
+		return type == NodeType::Integer || type == NodeType::Float || type == NodeType::Bit;
+	}
+
+	TypeState TypeInferencePass::Entry(bool entry) const {
+		TypeState state;
+		state.Reached = true;
+		state.Registers.assign(chunk.RegisterCount, Unknown);
+		state.Saved.assign(chunk.RegisterCount, ModeFlag::Either);
+		state.Functions.assign(chunk.RegisterCount, -1);
+		state.Known.assign(chunk.RegisterCount, -1);
+		if (!entry) return state;
+		for (auto& instruction : chunk.Code) {
+			switch (instruction.Op) {
+				case OpCode::GetVariable:
+				case OpCode::SetVariable:
+				case OpCode::SetLocal: {
+					auto value = environment.Binding(instruction.B);
+					if (value != nullptr && !value->IsEmpty()) state.Variables[instruction.B] = VariableFact{ value->GetNodeType(), 0 };
+					break;
+				}
+				default:
+					break;
+			}
+		}
+		return state;
+	}
+
+	// native bound to the callee when the chunk is compiled, only natives
+	// which cannot reach the symbol table
+	Ref<Node> TypeInferencePass::Callee(const TypeState& state, const Instruction& instruction) const {
+		int slot = state.Functions[instruction.B];
+		if (slot < 0) return nullptr;
+		auto value = environment.Binding(slot);
+		if (value == nullptr || value->GetNodeType() != NodeType::Function) return nullptr;
+		auto& function = reinterpret_cast<NodeFunction&>(value->GetNode());
+		if (!function.Native || function.InternalNative) return nullptr;
+		return value->Box();
+	}
+
+	// callee which always returns the same type
+	Ref<Node> TypeInferencePass::Native(const TypeState& state, const Instruction& instruction) const {
+		auto native = Callee(state, instruction);
+		if (native == nullptr || reinterpret_cast<NodeFunction&>(*native).Result == NodeType::None) return nullptr;
+		return native;
+	}
+
+	// constant with the value of a sealed global the instruction reads, a
+	// search ends in the global scope because nothing else binds the name
+	int TypeInferencePass::Sealed(const TypeState& state, const Instruction& instruction) const {
+		auto mode = static_cast<LookupMode>(instruction.C);
+		if (mode == LookupMode::Local || (mode == LookupMode::Dynamic && state.Mode != ModeFlag::Off)) return -1;
+		auto known = sealed.find(instruction.B);
+		if (known != sealed.end()) return known->second;
+		int index = -1;
+		auto value = environment.Sealed(instruction.B);
+		if (value != nullptr) {
+			index = (int)chunk.Constants.size();
+			chunk.Constants.push_back(*value);
+		}
+		sealed[instruction.B] = index;
+		return index;
+	}
+
+	// constant with the result of an operator or of a pure native when all
+	// operands are constants, -1 otherwise
+	int TypeInferencePass::Fold(int pc, const TypeState& state) const {
+		auto& instruction = chunk.Code[pc];
+		Ref<Node> callee;
+		int first = instruction.B, count = instruction.C;
+		switch (instruction.Op) {
+			case OpCode::Arithmetic:
+				break;
+			case OpCode::Prefix:
+				count = 1;
+				break;
+			case OpCode::Call:
+				callee = Callee(state, instruction);
+				if (callee == nullptr || !reinterpret_cast<NodeFunction&>(*callee).Pure) return -1;
+				first++;
+				break;
+			default:
+				return -1;
+		}
+		for (int i = 0; i < count; i++) {
+			if (state.Known[first + i] < 0) return -1;
+		}
+		auto done = folded.find(pc);
+		if (done != folded.end()) return done->second;
+		std::vector<Value> operands;
+		if (callee != nullptr) operands.push_back(callee);
+		for (int i = 0; i < count; i++) operands.push_back(chunk.Constants[state.Known[first + i]]);
+		int index = -1;
+		Value result;
+		if (environment.Evaluate(instruction, operands.data(), result)) {
+			index = (int)chunk.Constants.size();
+			chunk.Constants.push_back(result);
+		}
+		folded[pc] = index;
+		return index;
+	}
+
+	NodeType TypeInferencePass::ArithmeticResult(const TypeState& state, const Instruction& instruction) const {
+		auto operands = state.Registers.data() + instruction.B;
+		if (instruction.C == 2) {
+			switch (TypedArithmetic(instruction.Operator, operands[0], operands[1])) {
+				case OpCode::Arithmetic: break;
+				case OpCode::AddInt:
+				case OpCode::SubtractInt:
+				case OpCode::MultiplyInt:
+				case OpCode::DivideInt: return NodeType::Integer;
+				case OpCode::AddFloat:
+				case OpCode::SubtractFloat:
+				case OpCode::MultiplyFloat:
+				case OpCode::DivideFloat: return NodeType::Float;
+				case OpCode::ConcatBits:
+				case OpCode::RepeatBits: return NodeType::Bits;
+				default: return NodeType::Bit;
+			}
+		}
+		for (int i = 1; i < instruction.C; i++) {
+			if (operands[i] != operands[0]) return Unknown;
+		}
+		switch (instruction.Operator) {
+			case InstructionType::ADD:
+			case InstructionType::SUBTRACT:
+			case InstructionType::MULTIPLY:
+			case InstructionType::DIVIDE:
+				if (operands[0] == NodeType::Integer || operands[0] == NodeType::Float) return operands[0];
+				if (operands[0] == NodeType::String && instruction.Operator == InstructionType::ADD) return NodeType::String;
+				return Unknown;
+			default:
+				return Unknown;
+		}
+	}
+
+	// state after the instruction when it does not throw
+	void TypeInferencePass::Step(int pc, TypeState& state) const {
+		auto& instruction = chunk.Code[pc];
+		int a = instruction.A;
+		switch (instruction.Op) {
+			case OpCode::LoadConstant:
+			case OpCode::CopyConstant:
+				SetConstant(state, a, chunk, instruction.B);
+				break;
+			case OpCode::GetVariable: {
+				int constant = Sealed(state, instruction);
+				if (constant >= 0) {
+					// other values of a sealed global can still be changed in place
+					SetConstant(state, a, chunk, constant);
+					if (!IsScalar(chunk.Constants[constant])) state.Known[a] = -1;
+					break;
+				}
+				auto fact = state.Variables.find(instruction.B);
+				SetRegister(state, a, fact != state.Variables.end() ? fact->second.Type : Unknown);
+				break;
+			}
+			case OpCode::SetVariable: {
+				// a search writes the visible binding or binds in the top scope
+				int bound = state.Depth;
+				auto mode = static_cast<LookupMode>(instruction.C);
+				bool search = mode == LookupMode::Search || (mode == LookupMode::Dynamic && state.Mode == ModeFlag::Off);
+				auto fact = state.Variables.find(instruction.B);
+				if (search && fact != state.Variables.end()) bound = fact->second.Bound;
+				state.Variables[instruction.B] = VariableFact{ state.Registers[a], bound };
+				break;
+			}
+			case OpCode::SetLocal:
+				state.Variables[instruction.B] = VariableFact{ state.Registers[a], state.Depth };
+				break;
+			case OpCode::GetFunction:
+				SetRegister(state, a, NodeType::Function);
+				state.Functions[a] = instruction.B;
+				break;
+			case OpCode::Arithmetic: {
+				int constant = Fold(pc, state);
+				if (constant >= 0) SetConstant(state, a, chunk, constant);
+				else SetRegister(state, a, ArithmeticResult(state, instruction));
+				break;
+			}
+			case OpCode::Prefix: {
+				int constant = Fold(pc, state);
+				if (constant >= 0) {
+					SetConstant(state, a, chunk, constant);
+					break;
+				}
+				auto type = state.Registers[instruction.B];
+				bool numeric = type == NodeType::Integer || type == NodeType::Float || type == NodeType::Bit;
+				SetRegister(state, a, numeric ? type : Unknown);
+				break;
+			}
+			case OpCode::Call:
+			case OpCode::CallNative: {
+				int constant = Fold(pc, state);
+				auto native = Native(state, instruction);
+				if (constant >= 0) {
+					SetConstant(state, a, chunk, constant);
+				} else if (native != nullptr) {
+					SetRegister(state, a, reinterpret_cast<NodeFunction&>(*native).Result);
+				} else {
+					// the function may assign any variable and leave the flag set
+					SetRegister(state, a, Unknown);
+					state.Variables.clear();
+					state.Mode = ModeFlag::Either;
+				}
+				break;
+			}
+			case OpCode::MakeArray:
+				SetRegister(state, a, NodeType::DynamicArray);
+				break;
+			case OpCode::MakeObject:
+				SetRegister(state, a, NodeType::DynamicObject);
+				break;
+			case OpCode::PushScope:
+				state.Depth++;
+				break;
+			case OpCode::PopScope:
+				state.Depth -= a;
+				for (auto i = state.Variables.begin(); i != state.Variables.end();) {
+					if (i->second.Bound > state.Depth) i = state.Variables.erase(i);
+					else ++i;
+				}
+				break;
+			case OpCode::SetMode:
+				SetRegister(state, a, NodeType::Bit);
+				state.Saved[a] = state.Mode;
+				state.Mode = instruction.B != 0 ? ModeFlag::On : ModeFlag::Off;
+				break;
+			case OpCode::RestoreMode:
+				state.Mode = state.Saved[a];
+				break;
+			case OpCode::MakeReturn:
+				SetRegister(state, a, NodeType::Return);
+				break;
+			default:
+				if (WritesRegister(instruction.Op)) SetRegister(state, a, Unknown);
+				break;
+		}
+	}
+
+	// joins the state of another path into the state at a jump target,
+	// true when the state changed
+	bool TypeInferencePass::Merge(TypeState& into, const TypeState& from) {
+		if (!into.Reached) {
+			into = from;
+			return true;
+		}
+		bool changed = false;
+		for (size_t r = 0; r < into.Registers.size(); r++) {
+			if (into.Registers[r] != from.Registers[r] && into.Registers[r] != Unknown) {
+				into.Registers[r] = Unknown;
+				changed = true;
+			}
+			if (into.Saved[r] != from.Saved[r] && into.Saved[r] != ModeFlag::Either) {
+				into.Saved[r] = ModeFlag::Either;
+				changed = true;
+			}
+			if (into.Functions[r] != from.Functions[r] && into.Functions[r] != -1) {
+				into.Functions[r] = -1;
+				changed = true;
+			}
+			if (into.Known[r] != from.Known[r] && into.Known[r] != -1) {
+				into.Known[r] = -1;
+				changed = true;
+			}
+		}
+		if (into.Mode != from.Mode && into.Mode != ModeFlag::Either) {
+			into.Mode = ModeFlag::Either;
+			changed = true;
+		}
+		for (auto i = into.Variables.begin(); i != into.Variables.end();) {
+			auto other = from.Variables.find(i->first);
+			if (other == from.Variables.end()) {
+				i = into.Variables.erase(i);
+				changed = true;
+				continue;
+			}
+			if (i->second.Type != other->second.Type && i->second.Type != Unknown) {
+				i->second.Type = Unknown;
+				changed = true;
+			}
+			if (i->second.Bound < other->second.Bound) {
+				i->second.Bound = other->second.Bound;
+				changed = true;
+			}
+			++i;
+		}
+		return changed;
+	}
+
+	// worklist over the instructions until the states stop changing, false
+	// when paths meet at different scope depths which the compiler does not do
+	bool TypeInferencePass::Solve(bool entry) {
+		if (states.empty()) return false;
+		states[0] = Entry(entry);
+		std::vector<int> worklist{ 0 };
+		std::vector<bool> queued(states.size(), false);
+		queued[0] = true;
+		while (!worklist.empty()) {
+			int pc = worklist.back();
+			worklist.pop_back();
+			queued[pc] = false;
+			auto& instruction = chunk.Code[pc];
+			TypeState next = states[pc];
+			Step(pc, next);
+			int successors[2];
+			int count = 0;
+			switch (instruction.Op) {
+				case OpCode::Return:
+				case OpCode::Throw:
+					break;
+				case OpCode::Jump:
+					successors[count++] = instruction.B;
+					break;
+				case OpCode::JumpIfFalse:
+				case OpCode::JumpIfFalseUnchecked:
+					successors[count++] = pc + 1;
+					successors[count++] = instruction.B;
+					break;
+				default:
+					successors[count++] = pc + 1;
+					break;
+			}
+			for (int i = 0; i < count; i++) {
+				int target = successors[i];
+				if (target < 0 || target >= (int)states.size()) continue;
+				auto& state = states[target];
+				if (state.Reached && state.Depth != next.Depth) return false;
+				if (Merge(state, next) && !queued[target]) {
+					queued[target] = true;
+					worklist.push_back(target);
+				}
+			}
+		}
+		return true;
+	}
+
+	// copy of the code with every proven instruction replaced, null when
+	// nothing was proven, the code reading sealed globals is tagged with the
+	// seal epoch
+	std::unique_ptr<TypedCode> TypeInferencePass::Rewrite(unsigned epoch) const {
+		std::unique_ptr<TypedCode> typed(new TypedCode);
+		typed->Code = chunk.Code;
+		typed->Callees.resize(chunk.Code.size());
+		bool proven = false;
+		for (size_t pc = 0; pc < chunk.Code.size(); pc++) {
+			auto& state = states[pc];
+			if (!state.Reached) continue;
+			auto& instruction = typed->Code[pc];
+			switch (instruction.Op) {
+				case OpCode::GetVariable: {
+					int constant = Sealed(state, instruction);
+					if (constant < 0) break;
+					instruction.Op = OpCode::LoadConstant;
+					instruction.B = constant;
+					typed->Epoch = epoch;
+					proven = true;
+					break;
+				}
+				case OpCode::Arithmetic:
+				case OpCode::Prefix: {
+					int constant = Fold((int)pc, state);
+					if (constant >= 0) {
+						instruction.Op = IsMutable(chunk.Constants[constant]) ? OpCode::CopyConstant : OpCode::LoadConstant;
+						instruction.B = constant;
+						proven = true;
+						break;
+					}
+					if (instruction.Op != OpCode::Arithmetic || instruction.C != 2) break;
+					auto operands = state.Registers.data() + instruction.B;
+					auto op = UncheckedArithmetic(TypedArithmetic(instruction.Operator, operands[0], operands[1]));
+					if (op == OpCode::Arithmetic) break;
+					instruction.Op = op;
+					proven = true;
+					break;
+				}
+				case OpCode::JumpIfFalse:
+					if (state.Registers[instruction.A] != NodeType::Bit) break;
+					instruction.Op = OpCode::JumpIfFalseUnchecked;
+					proven = true;
+					break;
+				case OpCode::Call: {
+					int constant = Fold((int)pc, state);
+					if (constant >= 0) {
+						// still guarded by the callee, the arguments are left unused
+						instruction.Op = OpCode::CallFolded;
+						instruction.C = constant;
+						typed->Callees[pc] = Callee(state, instruction);
+						proven = true;
+						break;
+					}
+					auto native = Native(state, instruction);
+					if (native == nullptr) break;
+					instruction.Op = OpCode::CallNative;
+					typed->Callees[pc] = std::move(native);
+					proven = true;
+					break;
+				}
+				default:
+					break;
+			}
+		}
+		if (!proven) return nullptr;
+		return typed;
+	}
+
+	static const char* TypeName(NodeType type) {
+		return type == Unknown ? "?" : GetTypeText(type);
+	}
+
+	void TypeInferencePass::Dump(FILE* out, const TypedCode* typed) const {
+		fprintf(out, "types:\n");
+		for (size_t pc = 0; pc < chunk.Code.size(); pc++) {
+			auto& instruction = typed != nullptr ? typed->Code[pc] : chunk.Code[pc];
+			fprintf(out, "%4d  %-24s", (int)pc, OpCodeName(instruction.Op));
+			if (!states[pc].Reached) {
+				fprintf(out, " unreachable\n");
+				continue;
+			}
+			TypeState next = states[pc];
+			Step((int)pc, next);
+			switch (instruction.Op) {
+				case OpCode::SetVariable:
+				case OpCode::SetLocal:
+					fprintf(out, " %s %s", GetSymbolName(instruction.B).c_str(), TypeName(next.Variables[instruction.B].Type));
+					break;
+				default:
+					if (WritesRegister(instruction.Op)) fprintf(out, " r%d %s", instruction.A, TypeName(next.Registers[instruction.A]));
+					break;
+			}
+			fprintf(out, "\n");
+		}
+	}
+
+	void TypeInference::Run(BytecodeChunk& chunk, Environment& environment, bool entry, unsigned epoch, FILE* dump) {
+		TypeInferencePass pass(chunk, environment);
+		if (!pass.Solve(entry)) return;
+		chunk.Typed = pass.Rewrite(epoch);
+		if (dump != nullptr) pass.Dump(dump, chunk.Typed.get());
+	}
+
+}
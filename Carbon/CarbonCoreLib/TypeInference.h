@@ -0,0 +1,40 @@
+#pragma once
+#include "Bytecode.h"
+#include <cstdio>
+
+namespace Carbon
+{
+	// Flow sensitive type inference over the bytecode of one chunk. Follows
+	// the types of registers and of the variables the chunk assigns, calls
+	// of script functions forget the variables because with dynamic scoping
+	// they may assign any of them. Where the operand types are proven the
+	// typed code of the chunk gets the unchecked form of the instruction,
+	// calls of natives with a known result type become CallNative which is
+	// guarded by the function it expects. Registers holding constants are
+	// followed too, reads of sealed globals load their value and operators
+	// or pure natives on constants are computed in advance.
+	class TypeInference {
+	public:
+		// what the pass asks the executor about
+		class Environment {
+		public:
+			// innermost binding of a slot now, null when the slot is unbound
+			virtual const Value* Binding(int slot) = 0;
+			// value of a global which is not assigned again, null otherwise
+			virtual const Value* Sealed(int slot) = 0;
+			// result of an operator or of a call on constant operands, the
+			// callee is the first operand of a call, false when the result
+			// should be computed when the code runs
+			virtual bool Evaluate(const Instruction& instruction, const Value* operands, Value& result) = 0;
+		protected:
+			~Environment() = default;
+		};
+
+		// fills in chunk.Typed when anything was proven, entry tells that the
+		// chunk starts running with the bindings seen now like top level
+		// statements do, epoch is the seal epoch of the sealed values, the
+		// inferred types are listed to dump when given
+		static void Run(BytecodeChunk& chunk, Environment& environment, bool entry, unsigned epoch, FILE* dump = nullptr);
+	};
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "AstNodes.h"
+#include <cstddef>
+#include <memory>
+
+namespace Carbon
+{
+	// Value held in registers and variables of the executor. Integers, floats
+	// and bits are kept in place, every other value through its node. Scalar
+	// nodes are unpacked on the way in, Box makes a node again where one is
+	// needed like native arguments and container elements.
+	class Value {
+	public:
+		Value() : type(NodeType::None), integer(0) { }
+		Value(std::nullptr_t) : Value() { }
+		Value(const Ref<Node>& from);
+		Value(Ref<Node>&& from);
+		static Value Integer(long long value);
+		static Value Float(double value);
+		static Value Bit(bool value);
+
+		// type of the value, an empty value is None without a node
+		NodeType GetNodeType() const { return type; }
+		// nothing was assigned, lookups of undefined names end here
+		bool IsEmpty() const { return type == NodeType::None && node == nullptr; }
+		long long GetInteger() const { return integer; }
+		double GetFloat() const { return number; }
+		bool GetBit() const { return bit; }
+		// the node of values which are not scalars
+		Node& GetNode() const { return *node; }
+		// node of the value, scalars get a new one
+		Ref<Node> Box() const;
+
+	private:
+		NodeType type;
+		union {
+			long long integer;
+			double number;
+			bool bit;
+		};
+		Ref<Node> node;
+		bool Unpack(const Node& from);
+	};
+
+	inline bool Value::Unpack(const Node& from) {
+		switch (type) {
+			case NodeType::Integer: integer = reinterpret_cast<const NodeInteger&>(from).Value; return true;
+			case NodeType::Float: number = reinterpret_cast<const NodeFloat&>(from).Value; return true;
+			case NodeType::Bit: bit = reinterpret_cast<const NodeBit&>(from).Value; return true;
+			default: return false;
+		}
+	}
+
+	inline Value::Value(const Ref<Node>& from) : type(NodeType::None), integer(0) {
+		if (from == nullptr) return;
+		type = from->GetNodeType();
+		if (!Unpack(*from)) node = from;
+	}
+
+	inline Value::Value(Ref<Node>&& from) : type(NodeType::None), integer(0) {
+		if (from == nullptr) return;
+		type = from->GetNodeType();
+		if (!Unpack(*from)) node = std::move(from);
+	}
+
+	inline Value Value::Integer(long long value) {
+		Value result;
+		result.type = NodeType::Integer;
+		result.integer = value;
+		return result;
+	}
+
+	inline Value Value::Float(double value) {
+		Value result;
+		result.type = NodeType::Float;
+		result.number = value;
+		return result;
+	}
+
+	inline Value Value::Bit(bool value) {
+		Value result;
+		result.type = NodeType::Bit;
+		result.bit = value;
+		return result;
+	}
+
+	inline Ref<Node> Value::Box() const {
+		switch (type) {
+			case NodeType::Integer: return MakeNode<NodeInteger>(integer);
+			case NodeType::Float: return MakeNode<NodeFloat>(number);
+			case NodeType::Bit: return MakeNode<NodeBit>(bit);
+			default: return node;
+		}
+	}
+
+}
@@ -45,7 +45,7 @@ namespace UnitTestBinseqLib
 			auto a = bit_sequence(u16(0x00ff));
 			Assert::IsTrue(bit_sequence(u8(0xff)) == subseq(a,0,8));   
 			Assert::IsTrue(bit_sequence(u8(0x00)) == subseq(a,8,8));   
-			Assert::IsTrue(bit_sequence(u8(0x0f)) == subseq(a,4,8));  
+			Assert::IsTrue(bit_sequence(u8(0xf0)) == subseq(a,4,8));  
 		}             
 
 		TEST_METHOD(BitSequenceSubseq2)
@@ -84,7 +84,7 @@ namespace UnitTestBinseqLib
 
 		TEST_METHOD(BitSequenceConcat3)
 		{
-			auto a = bit_sequence(u8(3));
+			auto a = bit_sequence(u8(0xc0));
 			auto c = subseq(a,1,2) + subseq(a,0,4) + subseq(a,4,2) + subseq(a,1,2);
 			Assert::IsTrue(c.size() == 10);
 			Assert::IsTrue(c[0] == true);              
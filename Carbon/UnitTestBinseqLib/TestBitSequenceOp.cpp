@@ -63,17 +63,98 @@ namespace UnitTestBinseqLib
 
 		TEST_METHOD(BitSequenceOpRepeat2){
 			auto a = bit_sequence(u16(0xffff));
-			auto b = bit_sequence(u8(0x01));
+			auto b = bit_sequence(u8(0x80));
 			auto c = head(b,3);
 			auto d = andr(c,a);
-			Assert::IsTrue(d == bit_sequence(u16(0x9249)));
+			Assert::IsTrue(d == bit_sequence(u16(0x4992)));
 		}
 
 		TEST_METHOD(BitSequenceOpRepeat3){
-			auto a = bit_sequence(u8(0x0f));
+			auto a = bit_sequence(u8(0xf0));
 			auto b = repeat(repeat(a,4),8);
 			Assert::IsTrue(b == bit_sequence(u8(0xff)));
 		}
 
+		// bits in stream order which do not repeat within a word
+		static bit_sequence Pattern(u64 size, u64 seed) {
+			auto seq = repeat(bit_sequence(u8(0)), size);
+			for (u64 i = 0; i < size; i++) seq[i] = (i * 7 + seed) % 11 < 5;
+			return seq;
+		}
+
+		static bool SameBits(const bit_sequence& a, u64 offset, const bit_sequence& b) {
+			for (u64 i = 0; i < b.size(); i++) if (a[offset + i] != b[i]) return false;
+			return true;
+		}
+
+		TEST_METHOD(BitSequenceOpConcatUnaligned){
+			const u64 sizes[] = { 1, 3, 8, 61, 64, 67, 100, 127, 128, 129, 190, 256 };
+			for (auto x : sizes) for (auto y : sizes) {
+				auto a = Pattern(x, 1);
+				auto b = Pattern(y, 4);
+				auto c = a + b;
+				Assert::IsTrue(c.size() == x + y);
+				Assert::IsTrue(SameBits(c, 0, a));
+				Assert::IsTrue(SameBits(c, x, b));
+				Assert::IsTrue(head(c, x) == a);
+				Assert::IsTrue(tail(c, x) == b);
+			}
+		}
+
+		TEST_METHOD(BitSequenceOpConcatInlineBoundary){
+			auto a = Pattern(100, 2) + Pattern(28, 3);
+			Assert::IsTrue(a.size() == 128);
+			auto b = a + repeat(bit_sequence(u8(0xff)), 1);
+			Assert::IsTrue(b.size() == 129);
+			Assert::IsTrue(SameBits(b, 0, a));
+			Assert::IsTrue(b[128] == true);
+			Assert::IsTrue(head(b, 128) == a);
+		}
+
+		TEST_METHOD(BitSequenceOpSubseqUnaligned){
+			auto a = Pattern(300, 5);
+			const u64 offsets[] = { 0, 1, 5, 63, 64, 65, 127, 128, 129, 200 };
+			const u64 sizes[] = { 1, 7, 59, 64, 65, 128, 129, 150 };
+			for (auto offset : offsets) for (auto size : sizes) {
+				if (offset + size > a.size()) continue;
+				auto b = subseq(a, offset, size);
+				Assert::IsTrue(b.size() == size);
+				Assert::IsTrue(SameBits(a, offset, b));
+				Assert::IsTrue(b == Pattern(size, 5 + offset * 7));
+			}
+		}
+
+		// every bit takes part in comparisons, the first one is the most significant
+		TEST_METHOD(BitSequenceOpCompareEveryBit){
+			const u64 sizes[] = { 1, 7, 8, 63, 64, 65, 127, 128, 129, 200 };
+			for (auto size : sizes) {
+				auto a = Pattern(size, 6);
+				for (u64 i = 0; i < size; i++) {
+					auto b = a;
+					b[i] = !a[i];
+					Assert::IsTrue(a != b);
+					Assert::IsTrue(!(a == b));
+					Assert::IsTrue(a[i] ? a > b : a < b);
+				}
+				auto c = a;
+				c[0] = true;
+				if (size > 1) c[size - 1] = false;
+				auto d = a;
+				d[0] = false;
+				if (size > 1) d[size - 1] = true;
+				Assert::IsTrue(c > d);
+			}
+		}
+
+		// bits past the end of a shortened sequence are not compared
+		TEST_METHOD(BitSequenceOpCompareIgnoresUnusedBits){
+			auto a = Pattern(64, 1);
+			auto b = a;
+			b[63] = !a[63];
+			Assert::IsTrue(head(a, 63) == head(b, 63));
+			Assert::IsTrue(head(a, 63) <= head(b, 63));
+			Assert::IsTrue(head(a, 63) >= head(b, 63));
+		}
+
 	};
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <exception>
+#include <stdexcept>
+#include <vector>
+#include "../BinseqLib/entropy.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace binseq;
+
+namespace UnitTestBinseqLib
+{
+	TEST_CLASS(EntropyUnitTest)
+	{
+	public:
+
+		typedef bit_sequence(*Encoder)(const s64*, size_t, bool);
+		typedef std::vector<s64>(*Decoder)(const bit_sequence&, bool*);
+
+		// skewed byte symbols, most of them small
+		static std::vector<s64> Skewed(size_t count) {
+			std::vector<s64> symbols(count);
+			u64 x = 0x2545f4914f6cdd1dull;
+			for (auto& s : symbols) {
+				x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+				s64 zeros = 0;
+				while (zeros < 20 && (x >> zeros & 1) == 0) zeros++;
+				s = zeros * 3 + s64(x >> 62);
+			}
+			return symbols;
+		}
+
+		static void RoundTrips(Encoder encode, Decoder decode, const std::vector<s64>& symbols, bool text = false) {
+			auto seq = encode(symbols.data(), symbols.size(), text);
+			bool decodedText = !text;
+			Assert::IsTrue(decode(seq, &decodedText) == symbols);
+			Assert::IsTrue(decodedText == text);
+		}
+
+		static void RoundTripsEverything(Encoder encode, Decoder decode) {
+			RoundTrips(encode, decode, {});
+			RoundTrips(encode, decode, { 7 });
+			RoundTrips(encode, decode, std::vector<s64>(1000, -3));
+			RoundTrips(encode, decode, Skewed(5000));
+			RoundTrips(encode, decode, { 'h', 'e', 'l', 'l', 'o' }, true);
+			RoundTrips(encode, decode, { -0x7fffffffffffffffll - 1, 0x7fffffffffffffffll, 0, -1, 0x7fffffffffffffffll });
+			std::vector<s64> wide;
+			for (s64 i = 0; i < 3000; i++) wide.push_back(i * i * 7919 - 5000000);
+			RoundTrips(encode, decode, wide);
+		}
+
+		// encodings of increasing length cross the 128 bit boundary between inline and heap storage
+		static void RoundTripsAroundTheInlineBoundary(Encoder encode, Decoder decode) {
+			bool crossed = false;
+			std::vector<s64> symbols;
+			for (int i = 0; i < 64; i++) {
+				symbols.push_back(i % 3 == 0 ? 1 : 2);
+				auto seq = encode(symbols.data(), symbols.size(), false);
+				crossed = crossed || seq.size() == 128 || seq.size() == 129;
+				Assert::IsTrue(decode(seq, nullptr) == symbols);
+			}
+			Assert::IsTrue(crossed || encode(symbols.data(), symbols.size(), false).size() > 129);
+		}
+
+		static void TruncationFails(Encoder encode, Decoder decode) {
+			auto symbols = Skewed(200);
+			auto seq = encode(symbols.data(), symbols.size(), false);
+			for (u64 bits = 0; bits < seq.size(); bits++) {
+				auto prefix = head(seq, bits);
+				Assert::ExpectException<std::invalid_argument>([&]() { decode(prefix, nullptr); });
+			}
+		}
+
+		// a flipped bit either decodes to as many symbols or fails, but never reads out of bounds
+		static void CorruptionIsDetectedOrHarmless(Encoder encode, Decoder decode) {
+			auto symbols = Skewed(300);
+			auto seq = encode(symbols.data(), symbols.size(), false);
+			for (u64 i = 0; i < seq.size(); i++) {
+				auto corrupted = seq;
+				corrupted[i] = !corrupted[i];
+				try {
+					Assert::IsTrue(decode(corrupted, nullptr).size() == symbols.size());
+				} catch (std::invalid_argument&) { }
+			}
+		}
+
+		TEST_METHOD(HuffmanRoundTrip){
+			RoundTripsEverything(huffman_encode, huffman_decode);
+		}
+
+		TEST_METHOD(AnsRoundTrip){
+			RoundTripsEverything(ans_encode, ans_decode);
+		}
+
+		TEST_METHOD(HuffmanAroundTheInlineBoundary){
+			RoundTripsAroundTheInlineBoundary(huffman_encode, huffman_decode);
+		}
+
+		TEST_METHOD(AnsAroundTheInlineBoundary){
+			RoundTripsAroundTheInlineBoundary(ans_encode, ans_decode);
+		}
+
+		TEST_METHOD(HuffmanCompressesSkewedInput){
+			auto symbols = Skewed(5000);
+			Assert::IsTrue(huffman_encode(symbols.data(), symbols.size(), false).size() < symbols.size() * 5);
+			Assert::IsTrue(ans_encode(symbols.data(), symbols.size(), false).size() < symbols.size() * 5);
+		}
+
+		TEST_METHOD(TruncatedHuffmanFails){
+			TruncationFails(huffman_encode, huffman_decode);
+		}
+
+		TEST_METHOD(TruncatedAnsFails){
+			TruncationFails(ans_encode, ans_decode);
+		}
+
+		TEST_METHOD(CorruptedHuffman){
+			CorruptionIsDetectedOrHarmless(huffman_encode, huffman_decode);
+		}
+
+		TEST_METHOD(CorruptedAns){
+			CorruptionIsDetectedOrHarmless(ans_encode, ans_decode);
+		}
+
+		TEST_METHOD(GarbageIsRejected){
+			auto garbage = repeat(bit_sequence(u64(0x5bd1e9955bd1e995ull)), 4000);
+			Assert::ExpectException<std::invalid_argument>([&]() { huffman_decode(garbage, nullptr); });
+			Assert::ExpectException<std::invalid_argument>([&]() { ans_decode(garbage, nullptr); });
+		}
+
+	};
+}
@@ -0,0 +1,174 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+#include "../BinseqLib/integer_codes.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace binseq;
+
+namespace UnitTestBinseqLib
+{
+	TEST_CLASS(IntegerCodesUnitTest)
+	{
+	public:
+
+		// values of every bit length, with the extremes of u64
+		static std::vector<u64> Values(u64 minimum) {
+			std::vector<u64> values;
+			u64 x = 0x9e3779b97f4a7c15ull;
+			for (u32 bits = 0; bits <= 64; bits++) {
+				x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+				u64 value = bits == 64 ? x | (u64(1) << 63) : bits == 0 ? 0 : (x >> (64 - bits)) | (u64(1) << (bits - 1));
+				if (value >= minimum) values.push_back(value);
+			}
+			values.push_back(~u64(0));
+			values.push_back(minimum);
+			return values;
+		}
+
+		// every prefix of the encoding either ends on a code boundary and decodes
+		// to the values before it, or ends inside a code and fails
+		template <class Encode, class Decode>
+		static void TruncationFailsInsideCodes(const std::vector<u64>& values, Encode encode, Decode decode) {
+			std::vector<u64> boundaries;
+			for (size_t i = 0; i <= values.size(); i++) {
+				boundaries.push_back(encode(values.data(), i).size());
+			}
+			auto all = encode(values.data(), values.size());
+			size_t next = 0;
+			for (u64 bits = 0; bits <= all.size(); bits++) {
+				auto prefix = head(all, bits);
+				if (bits == boundaries[next]) {
+					auto decoded = decode(prefix);
+					Assert::IsTrue(decoded.size() == next);
+					Assert::IsTrue(std::equal(decoded.begin(), decoded.end(), values.begin()));
+					next++;
+				} else {
+					Assert::ExpectException<std::invalid_argument>([&]() { decode(prefix); });
+				}
+			}
+			Assert::IsTrue(next == values.size() + 1);
+		}
+
+		TEST_METHOD(GammaRoundTrip){
+			auto values = Values(1);
+			auto seq = gamma_encode(values.data(), values.size());
+			Assert::IsTrue(gamma_decode(seq) == values);
+		}
+
+		TEST_METHOD(DeltaRoundTrip){
+			auto values = Values(1);
+			auto seq = delta_encode(values.data(), values.size());
+			Assert::IsTrue(delta_decode(seq) == values);
+		}
+
+		TEST_METHOD(RiceRoundTrip){
+			const u32 ks[] = { 0, 1, 7, 31, 63, 64 };
+			for (auto k : ks) {
+				std::vector<u64> values;
+				for (auto value : Values(0)) {
+					// the quotient is limited, values are kept below 2^(k+20)
+					values.push_back(k + 20 >= 64 ? value : value & ((u64(1) << (k + 20)) - 1));
+				}
+				auto seq = rice_encode(values.data(), values.size(), k);
+				Assert::IsTrue(rice_decode(seq, k) == values);
+			}
+		}
+
+		TEST_METHOD(VarintRoundTrip){
+			auto values = Values(0);
+			auto seq = varint_encode(values.data(), values.size());
+			Assert::IsTrue(seq.size() % 8 == 0);
+			Assert::IsTrue(varint_decode(seq) == values);
+		}
+
+		TEST_METHOD(ZigzagRoundTrip){
+			const s64 values[] = { 0, -1, 1, -2, 2, 0x7fffffffffffffffll, -0x7fffffffffffffffll - 1 };
+			Assert::IsTrue(zigzag_encode(-1) == 1);
+			Assert::IsTrue(zigzag_encode(1) == 2);
+			for (auto value : values) Assert::IsTrue(zigzag_decode(zigzag_encode(value)) == value);
+		}
+
+		TEST_METHOD(EmptyInputRoundTrips){
+			Assert::IsTrue(gamma_encode(nullptr, 0).size() == 0);
+			Assert::IsTrue(gamma_decode(bit_sequence()).empty());
+			Assert::IsTrue(delta_decode(delta_encode(nullptr, 0)).empty());
+			Assert::IsTrue(rice_decode(rice_encode(nullptr, 0, 3), 3).empty());
+			Assert::IsTrue(varint_decode(varint_encode(nullptr, 0)).empty());
+		}
+
+		TEST_METHOD(EncodingsAroundTheInlineBoundary){
+			// a gamma coded 1 is a single bit, rice with k = 7 takes 8 bits per value
+			for (size_t count = 120; count <= 136; count++) {
+				std::vector<u64> ones(count, 1);
+				auto seq = gamma_encode(ones.data(), ones.size());
+				Assert::IsTrue(seq.size() == count);
+				Assert::IsTrue(gamma_decode(seq) == ones);
+			}
+			for (size_t count = 14; count <= 18; count++) {
+				std::vector<u64> values(count, 0x55);
+				auto seq = rice_encode(values.data(), values.size(), 7);
+				Assert::IsTrue(seq.size() == count * 8);
+				Assert::IsTrue(rice_decode(seq, 7) == values);
+			}
+		}
+
+		TEST_METHOD(ZeroIsRejected){
+			u64 zero = 0;
+			Assert::ExpectException<std::invalid_argument>([&]() { gamma_encode(&zero, 1); });
+			Assert::ExpectException<std::invalid_argument>([&]() { delta_encode(&zero, 1); });
+		}
+
+		TEST_METHOD(RiceParameterAndQuotientAreChecked){
+			u64 value = u64(1) << 40;
+			Assert::ExpectException<std::invalid_argument>([&]() { rice_encode(&value, 1, 65); });
+			Assert::ExpectException<std::invalid_argument>([&]() { rice_decode(bit_sequence(u8(0x80)), 65); });
+			Assert::ExpectException<std::invalid_argument>([&]() { rice_encode(&value, 1, 2); });
+		}
+
+		TEST_METHOD(TruncatedGammaFails){
+			TruncationFailsInsideCodes(Values(1), gamma_encode, gamma_decode);
+		}
+
+		TEST_METHOD(TruncatedDeltaFails){
+			TruncationFailsInsideCodes(Values(1), delta_encode, delta_decode);
+		}
+
+		TEST_METHOD(TruncatedRiceFails){
+			std::vector<u64> values = { 0, 1, 100, 5000, 3 };
+			TruncationFailsInsideCodes(values,
+				[](const u64* v, size_t n) { return rice_encode(v, n, 5); },
+				[](const bit_sequence& seq) { return rice_decode(seq, 5); });
+		}
+
+		TEST_METHOD(TruncatedVarintFails){
+			auto values = Values(0);
+			auto seq = varint_encode(values.data(), values.size());
+			size_t bytes = 0;
+			for (size_t i = 0; i < values.size(); i++) {
+				auto last = bytes;
+				bytes = size_t(varint_encode(values.data(), i + 1).size() / 8);
+				for (auto cut = last + 1; cut < bytes; cut++) {
+					Assert::ExpectException<std::invalid_argument>([&]() { varint_decode(head(seq, cut * 8)); });
+				}
+			}
+			Assert::ExpectException<std::invalid_argument>([&]() { varint_decode(head(seq, 12)); });
+		}
+
+		TEST_METHOD(OverlongVarintFails){
+			// eleven continuation groups can't fit into 64 bits
+			auto seq = repeat(bit_sequence(u8(0x80)), 11 * 8) + bit_sequence(u8(0x01));
+			Assert::ExpectException<std::invalid_argument>([&]() { varint_decode(seq); });
+		}
+
+		TEST_METHOD(OverlongGammaFails){
+			// 64 zeros announce a value of 65 bits
+			auto seq = repeat(bit_sequence(u8(0)), 64) + repeat(bit_sequence(u8(0xff)), 65);
+			Assert::ExpectException<std::invalid_argument>([&]() { gamma_decode(seq); });
+		}
+
+	};
+}
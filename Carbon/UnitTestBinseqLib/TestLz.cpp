@@ -0,0 +1,177 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+#include "../BinseqLib/lz.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace binseq;
+
+namespace UnitTestBinseqLib
+{
+	TEST_CLASS(LzUnitTest)
+	{
+	public:
+
+		static std::vector<u8> Bytes(const bit_sequence& seq) {
+			auto src = reinterpret_cast<const u8*>(seq.address());
+			return std::vector<u8>(src, src + size_t((seq.size() + 7) >> 3));
+		}
+
+		static bit_sequence FromBytes(const std::vector<u8>& bytes) {
+			auto seq = repeat(bit_sequence(u8(0)), u64(bytes.size()) * 8);
+			if (!bytes.empty()) std::memcpy(seq.address(), bytes.data(), bytes.size());
+			return seq;
+		}
+
+		static std::vector<u8> Random(size_t count) {
+			std::vector<u8> bytes(count);
+			u64 x = 0x9e3779b97f4a7c15ull;
+			for (auto& b : bytes) {
+				x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+				b = u8(x >> 56);
+			}
+			return bytes;
+		}
+
+		// text like input, short repeated words
+		static std::vector<u8> Repetitive(size_t count) {
+			static const char words[] = "the quick brown fox jumps over the lazy dog, ";
+			std::vector<u8> bytes(count);
+			for (size_t i = 0; i < count; i++) bytes[i] = u8(words[(i * 7 / 5) % (sizeof(words) - 1)]);
+			return bytes;
+		}
+
+		static void RoundTrips(const bit_sequence& seq, bool text = false, const block_runner& run = nullptr) {
+			auto frame = lz_compress(seq, text, run);
+			bool decodedText = !text;
+			auto back = lz_decompress(frame, &decodedText, run);
+			Assert::IsTrue(back.size() == seq.size());
+			Assert::IsTrue(back == seq);
+			Assert::IsTrue(decodedText == text);
+		}
+
+		static void Rejects(const std::vector<u8>& frame) {
+			auto seq = FromBytes(frame);
+			Assert::ExpectException<std::invalid_argument>([&]() { lz_decompress(seq); });
+		}
+
+		TEST_METHOD(LzRoundTripSmall){
+			RoundTrips(bit_sequence());
+			RoundTrips(bit_sequence(u8(0x80)));
+			RoundTrips(head(bit_sequence(u8(0xa5)), 7));
+			RoundTrips(FromBytes(Repetitive(1000)), true);
+		}
+
+		// sizes on both sides of the 128 bit inline storage
+		TEST_METHOD(LzRoundTripAroundTheInlineBoundary){
+			auto source = FromBytes(Random(40));
+			for (u64 bits = 100; bits <= 160; bits++) {
+				RoundTrips(head(source, bits));
+			}
+		}
+
+		// a partial last byte is masked so stale bits don't leak into the frame
+		TEST_METHOD(LzUnalignedTailIsMasked){
+			auto seq = tail(FromBytes(Repetitive(300)), 3);
+			auto frame = lz_compress(seq);
+			Assert::IsTrue(lz_decompress(frame) == seq);
+			Assert::IsTrue(frame == lz_compress(head(seq, seq.size())));
+		}
+
+		TEST_METHOD(LzRoundTripManyBlocks){
+			auto seq = FromBytes(Repetitive(lz_block_size * 5 / 2));
+			auto frame = lz_compress(seq);
+			Assert::IsTrue(frame.size() < seq.size() / 4);
+			RoundTrips(seq);
+		}
+
+		// runners may split and reorder the blocks, the frame stays the same
+		TEST_METHOD(LzRunnerDoesNotChangeTheFrame){
+			auto bytes = Repetitive(lz_block_size * 3);
+			auto random = Random(lz_block_size);
+			bytes.insert(bytes.end(), random.begin(), random.end());
+			auto seq = FromBytes(bytes);
+			block_runner backwards = [](u64 count, const std::function<void(u64, u64)>& fn) {
+				for (u64 b = count; b-- > 0;) fn(b, b + 1);
+			};
+			Assert::IsTrue(lz_compress(seq, false, backwards) == lz_compress(seq));
+			RoundTrips(seq, false, backwards);
+		}
+
+		TEST_METHOD(LzStoresIncompressibleBlocks){
+			auto bytes = Random(lz_block_size + 1000);
+			auto frame = Bytes(lz_compress(FromBytes(bytes)));
+			// header, two block sizes, then the blocks as they are
+			Assert::IsTrue(frame.size() == 16 + 8 + bytes.size());
+			Assert::IsTrue(frame[16 + 3] == 0x80 && frame[20 + 3] == 0x80);
+			Assert::IsTrue(std::memcmp(frame.data() + 24, bytes.data(), bytes.size()) == 0);
+			RoundTrips(FromBytes(bytes));
+			Assert::IsTrue(lz_compress_block(bytes.data(), 1000, std::vector<u8>(1000).data()) == 0);
+		}
+
+		TEST_METHOD(LzTruncatedFramesFail){
+			for (auto& bytes : { Repetitive(3000), Random(300) }) {
+				auto frame = Bytes(lz_compress(FromBytes(bytes)));
+				for (size_t size = 0; size < frame.size(); size++) {
+					Rejects(std::vector<u8>(frame.begin(), frame.begin() + size));
+				}
+				frame.push_back(0);
+				Rejects(frame);
+			}
+		}
+
+		TEST_METHOD(LzCorruptedHeadersFail){
+			auto frame = Bytes(lz_compress(FromBytes(Repetitive(3000))));
+			auto corrupt = [&](size_t at, u8 value) {
+				auto copy = frame;
+				copy[at] = value;
+				Rejects(copy);
+			};
+			corrupt(0, 'c');
+			corrupt(1, 'X');
+			corrupt(2, 2);
+			corrupt(14, 0x00); // block size 0
+			corrupt(14, 0x08); // block size above lz_block_size
+			corrupt(11, 0xff); // more bits than can be allocated
+			corrupt(7, 0x01); // more bits than the block table covers
+
+			auto stored = Bytes(lz_compress(FromBytes(Random(300))));
+			Assert::IsTrue(stored[16 + 3] == 0x80);
+			stored[16] ^= 1; // stored size must match the block
+			Rejects(stored);
+
+			Assert::ExpectException<std::invalid_argument>([&]() { lz_decompress(head(FromBytes(frame), frame.size() * 8 - 1)); });
+		}
+
+		// corrupted block data fails or decodes to the same size, never out of bounds
+		TEST_METHOD(LzCorruptedBlocksAreDetectedOrHarmless){
+			auto seq = FromBytes(Repetitive(2000));
+			auto frame = Bytes(lz_compress(seq));
+			for (size_t i = 20; i < frame.size(); i++) {
+				for (u8 flip : { u8(0x01), u8(0x10), u8(0xff) }) {
+					auto copy = frame;
+					copy[i] ^= flip;
+					try {
+						Assert::IsTrue(lz_decompress(FromBytes(copy)).size() == seq.size());
+					} catch (std::invalid_argument&) { }
+				}
+			}
+		}
+
+		TEST_METHOD(LzBlockWithWrongSizeFails){
+			auto bytes = Repetitive(1000);
+			std::vector<u8> packed(bytes.size()), out(bytes.size() + 1);
+			size_t size = lz_compress_block(bytes.data(), bytes.size(), packed.data());
+			Assert::IsTrue(size > 0 && size < bytes.size());
+			lz_decompress_block(packed.data(), size, out.data(), bytes.size());
+			Assert::IsTrue(std::memcmp(out.data(), bytes.data(), bytes.size()) == 0);
+			Assert::ExpectException<std::invalid_argument>([&]() { lz_decompress_block(packed.data(), size, out.data(), bytes.size() - 1); });
+			Assert::ExpectException<std::invalid_argument>([&]() { lz_decompress_block(packed.data(), size, out.data(), bytes.size() + 1); });
+			Assert::ExpectException<std::invalid_argument>([&]() { lz_decompress_block(packed.data(), size - 1, out.data(), bytes.size()); });
+		}
+
+	};
+}
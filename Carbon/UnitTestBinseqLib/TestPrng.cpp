@@ -0,0 +1,67 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include <exception>
+#include <stdexcept>
+#include <vector>
+#include "../BinseqLib/prng.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace binseq;
+
+namespace UnitTestBinseqLib
+{
+	TEST_CLASS(PrngUnitTest)
+	{
+	public:
+
+		static std::vector<u64> Below(prng_kind kind, u64 bound, u64 count, const block_runner& run = nullptr) {
+			std::vector<u64> values((size_t)count);
+			random_below(kind, 7, 3, bound, values.data(), count, run);
+			return values;
+		}
+
+		// with a bound of about 2/3 of 2^64 plain multiply and shift maps two
+		// words to every even value and one to every odd value
+		TEST_METHOD(RandomBelowIsUnbiased){
+			const u64 bound = 0xaaaaaaaaaaaaaaabull;
+			for (auto kind : { prng_kind::xoshiro256, prng_kind::pcg32, prng_kind::philox }) {
+				auto values = Below(kind, bound, 20000);
+				u64 even = 0;
+				for (auto v : values) {
+					Assert::IsTrue(v < bound);
+					if ((v & 1) == 0) even++;
+				}
+				Assert::IsTrue(even > 9600 && even < 10400);
+			}
+		}
+
+		TEST_METHOD(RandomBelowDoesNotDependOnTheRunner){
+			block_runner backwards = [](u64 count, const std::function<void(u64, u64)>& fn) {
+				for (u64 b = count; b-- > 0;) fn(b, b + 1);
+			};
+			for (u64 bound : { u64(0), u64(1), u64(6), u64(0x8000000000000001ull) }) {
+				auto serial = Below(prng_kind::xoshiro256, bound, 50000);
+				Assert::IsTrue(serial == Below(prng_kind::xoshiro256, bound, 50000, backwards));
+				if (bound == 1) Assert::IsTrue(serial == std::vector<u64>(50000, 0));
+			}
+		}
+
+		TEST_METHOD(RandomBelowKeepsSmallBoundsInRange){
+			auto values = Below(prng_kind::philox, 6, 6000);
+			u64 seen[6] = {};
+			for (auto v : values) {
+				Assert::IsTrue(v < 6);
+				seen[v]++;
+			}
+			for (auto n : seen) Assert::IsTrue(n > 850 && n < 1150);
+		}
+
+		TEST_METHOD(XoshiroStreamIsLimited){
+			u64 word;
+			random_words(prng_kind::xoshiro256, 1, xoshiro_max_stream, &word, 1);
+			Assert::ExpectException<std::invalid_argument>([&]() { random_words(prng_kind::xoshiro256, 1, xoshiro_max_stream + 1, &word, 1); });
+			random_words(prng_kind::pcg32, 1, xoshiro_max_stream + 1, &word, 1);
+		}
+
+	};
+}
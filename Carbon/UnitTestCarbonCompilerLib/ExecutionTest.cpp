@@ -118,6 +118,339 @@ namespace UnitTestCarbonCompilerLib
 			Executing("f=()->1;f()").HasIntegerResult(1);
 		}
 
+		TEST_METHOD(RecordDecodeProducesColumns)
+		{
+			Executing("c=record_decode(\"a:u4,b:s4\",b\"0001 1111 0010 0111\");get(c.a,1)*10+get(c.b,0)").HasIntegerResult(19);
+		}
+
+		TEST_METHOD(RecordDecodeLittleEndianField)
+		{
+			Executing("c=record_decode(\"_:u4,x:u16le,_:u4\",b\"0000 00000001 00000010 0000\");get(c.x,0)").HasIntegerResult(513);
+		}
+
+		TEST_METHOD(RecordLayoutSkipsPadding)
+		{
+			Executing("l=record_layout(\"a:u3,_:u5,b:s8\");l.bits*10+length(l.fields)").HasIntegerResult(162);
+		}
+
+		TEST_METHOD(SparseBitwiseOperators)
+		{
+			Executing("z=repeat(b\"00000000\",100000);a=sparse(z+b\"11110000\"+z);b=sparse(z+b\"10100000\"+z);"
+				"popcount(and(a,b))*100+popcount(or(a,b))*10+popcount(xor(a,b))").HasIntegerResult(242);
+		}
+
+		TEST_METHOD(SparseFallsBackToBinseqWhenDense)
+		{
+			Executing("type(sparse(repeat(b\"10101010\",100000)))==\"binseq\"").HasBitResult(true);
+		}
+
+		TEST_METHOD(GammaCodeRoundTrip)
+		{
+			Executing("e=gamma_encode([1,2,3,1000]);d=gamma_decode(e);length(e)*10000+get(d,3)").HasIntegerResult(261000);
+		}
+
+		TEST_METHOD(VarintOfZigzagRoundTrip)
+		{
+			Executing("d=zigzag_decode(varint_decode(varint_encode(zigzag_encode([5,-300]))));get(d,0)*1000+get(d,1)").HasIntegerResult(4700);
+		}
+
+		TEST_METHOD(HuffmanRoundTripsText)
+		{
+			Executing("huffman_decode(huffman_encode(\"abracadabra\"))==\"abracadabra\"").HasBitResult(true);
+		}
+
+		TEST_METHOD(AnsRoundTripsIntegers)
+		{
+			Executing("d=ans_decode(ans_encode([7,-2,7,7,100]));get(d,1)*1000+get(d,4)").HasIntegerResult(-1900);
+		}
+
+		TEST_METHOD(CompressPreservesBitLength)
+		{
+			Executing("b=b\"1011001\";d=decompress(compress(b));length(d)*10+integer(d==b)").HasIntegerResult(71);
+		}
+
+		TEST_METHOD(CompressShrinksRepetitiveText)
+		{
+			Executing("t=\"carbon \"*1000;c=compress(t);integer(length(c)<length(t)*8)*10+integer(decompress(c)==t)").HasIntegerResult(11);
+		}
+
+		TEST_METHOD(NistTestsMatchReferenceExamples)
+		{
+			Executing("e=b\"1100100100001111110110101010001000100001011010001100001000110100110001001100011001100010100010111000\";"
+				"integer(nistFrequency(e).p*10000.0)*10000+integer(nistRuns(e).p*10000.0)").HasIntegerResult(10955007);
+		}
+
+		TEST_METHOD(NistTestsRunInParallel)
+		{
+			Executing("x=1;data=repeat(b\"00000000\",4096);"
+				"loop(i=0,i<length(data),i=i+1){x=x*1103515245+12345;x=x-x/2147483648*2147483648;if(x<0)x=-x;set(data,i,x<1073741824);}"
+				"r=parallel([nistFrequency,nistRank,nistRandomExcursion],data,2);"
+				"length(r)*10000+get(r,1).bits+integer(get(r,2).applicable)").HasIntegerResult(34096);
+		}
+
+		TEST_METHOD(LifeBlinkerOscillates)
+		{
+			Executing("g=b\"0000000000011100000000000\";v=life(g,5);"
+				"integer(life(g,5,2)==g)*1000+integer(get(v,7))*100+integer(get(v,12))*10+integer(get(v,17))").HasIntegerResult(1111);
+		}
+
+		TEST_METHOD(ElementaryRule90GrowsSierpinski)
+		{
+			Executing("elementary(b\"000010000\",90,2)==b\"001000100\"").HasBitResult(true);
+		}
+
+		TEST_METHOD(BitMatrixMultiplyTransposeAndRank)
+		{
+			Executing("a=bitmatrix(b\"110011\",3);"
+				"integer(binseq(matmul(a,transpose(a)))==b\"0110\")*100+rank(a)*10+rows(transpose(a))").HasIntegerResult(123);
+		}
+
+		TEST_METHOD(BitMatrixSolveFindsSolutionOrVoid)
+		{
+			Executing("a=bitmatrix(b\"110011101\",3);m=bitmatrix(3);set(m,0,2,bit(1));"
+				"integer(get(m,0,2))*100+integer(solve(a,b\"101\")==b\"100\")*10+integer(type(solve(a,b\"100\"))==\"void\")").HasIntegerResult(111);
+		}
+
+		TEST_METHOD(LfsrRoundTripsThroughBerlekampMassey)
+		{
+			Executing("s=lfsr(b\"10011\",b\"1000\",40);"
+				"linear_complexity(s)*10+integer(lfsr(connection_polynomial(s),s,40)==s)").HasIntegerResult(41);
+		}
+
+		TEST_METHOD(CrcMatchesCatalogueCheckValues)
+		{
+			Executing("s=binseq(\"123456789\");"
+				"integer(crc(s,\"crc-32\")==3421780262)*10+integer(crc(s,16,4129,45738,bit(1),0)==25552)").HasIntegerResult(11);
+		}
+
+		TEST_METHOD(AutocorrVanishesAtThePeriod)
+		{
+			Executing("r=autocorr(b\"110110110110\",3);"
+				"length(r)*1000+get(r,1)*100+get(r,2)*10+get(r,3)").HasIntegerResult(4770);
+		}
+
+		TEST_METHOD(XcorrFindsTheShift)
+		{
+			Executing("x=xcorr(b\"10010111\",b\"0010010111\",3);"
+				"get(x,3)*100+get(x,5)*10+length(x)").HasIntegerResult(407);
+		}
+
+		TEST_METHOD(FftOfAlternatingBitsPeaksAtNyquist)
+		{
+			Executing("f=fft(b\"10101010\");m=magnitude(f);"
+				"integer(get(m,4))*100+length(m)*10+threshold_count(f,1.0)").HasIntegerResult(854);
+		}
+
+		TEST_METHOD(FloatArrayFeedsFft)
+		{
+			Executing("f=floatarray(4);set(f,0,1.0);set(f,1,1.0);set(f,2,1.0);set(f,3,1.0);x=fft(f);"
+				"integer(get(x,0))*100+length(x)*10+integer(type(f)==\"floatarray\")").HasIntegerResult(461);
+		}
+
+		TEST_METHOD(BlockPopcountSkipsThePartialBlock)
+		{
+			Executing("c=block_popcount(b\"1111000010101010111\",8);"
+				"get(c,0)*100+get(c,1)*10+length(c)").HasIntegerResult(442);
+		}
+
+		TEST_METHOD(PatternHistogramOverlappingAndBackToBack)
+		{
+			Executing("h=pattern_histogram(b\"0110\",2,bit(1));g=pattern_histogram(b\"0110\",2,bit(0));"
+				"get(h,3)*1000+get(h,1)*100+get(g,3)*10+length(g)").HasIntegerResult(1104);
+		}
+
+		TEST_METHOD(ColumnCountAcrossSequences)
+		{
+			Executing("c=column_count([b\"1100\",b\"1010\",b\"1001\"]);"
+				"get(c,0)*1000+get(c,1)*100+get(c,2)*10+length(c)").HasIntegerResult(3114);
+		}
+
+		TEST_METHOD(MajorityAndThresholdMasks)
+		{
+			Executing("a=[b\"1100\",b\"1010\",b\"1001\"];"
+				"integer(majority(a)==b\"1000\")*100+integer(threshold(a,1)==b\"1111\")*10+integer(threshold(a,4)==b\"0000\")").HasIntegerResult(111);
+		}
+
+		TEST_METHOD(ReduceAndOrXorOverArray)
+		{
+			Executing("a=[b\"1100\",b\"1010\",b\"1001\"];"
+				"integer(reduce_and(a)==b\"1000\")*100+integer(reduce_or(a)==b\"1111\")*10+integer(reduce_xor(a)==b\"1111\")").HasIntegerResult(111);
+		}
+
+		TEST_METHOD(ReduceMatchesPairwiseOperators)
+		{
+			Executing("x=b\"0110100110010110\";y=b\"0011001111001100\";z=b\"1111000000001111\";"
+				"integer(reduce_xor([x,y,z],2)==xor(xor(x,y),z))*10+integer(reduce_and([x,y,z])==and(and(x,y),z))").HasIntegerResult(11);
+		}
+
+		TEST_METHOD(RandomBitsAreReproducibleAcrossParallelism)
+		{
+			Executing("a=random_bits(100000,7,\"xoshiro256**\",0,1);b=random_bits(100000,7,\"xoshiro256**\",0,4);"
+				"c=random_bits(100000,7,\"xoshiro256**\",1);"
+				"integer(a==b)*100+integer(a!=c)*10+integer(random_bits(64,3,\"philox4x32\")==random_bits(64,3,\"philox4x32\",0,2))").HasIntegerResult(111);
+		}
+
+		TEST_METHOD(RandomIntsAndFloatsStayInRange)
+		{
+			Executing("r=random_ints(1000,6,1,\"pcg32\");f=random_floats(1000,1);m=0;lo=1;"
+				"loop(local i=0,i<1000,i=i+1){if(get(r,i)>m)m=get(r,i);if(get(f,i)<0.0)lo=0;if(get(f,i)>=1.0)lo=0;};"
+				"m*100+lo*10+integer(type(f)==\"floatarray\")").HasIntegerResult(511);
+		}
+
+		TEST_METHOD(BreakAndContinueLeaveLoopScopes)
+		{
+			Executing("s=0;i=0;loop(i<10,i=i+1){if(i==2)continue;if(i==6)break;local t=i;s=s+t;};"
+				"s*100+i").HasIntegerResult(1306);
+		}
+
+		TEST_METHOD(CalledFunctionsSeeCallerLocals)
+		{
+			Executing("x=1;f=function(){return x;};g=function(){local x=5;return f();};"
+				"fib=function(n){if(n<2)return n;return fib(n-1)+fib(n-2);};"
+				"fib(15)*100+f()*10+g()").HasIntegerResult(61015);
+		}
+
+		TEST_METHOD(ShadowedBindingsComeBackAfterCalls)
+		{
+			Executing("x=1;f=function(x){local y=x*2;return y;};"
+				"r=function(n){local k=n;if(n>0)r(n-1);return k;};"
+				"a=f(10);x*1000+a*10+r(5)").HasIntegerResult(1205);
+		}
+
+		TEST_METHOD(VariablesAreResolvedWhenAccessed)
+		{
+			Executing("f=function(){return z;};z=4;a=f();z=6;a*10+f()").HasIntegerResult(46);
+		}
+
+		TEST_METHOD(DeepRecursionSpansRegisterSegments)
+		{
+			Executing("f=function(n){if(n<1)return 0;return 1+f(n-1);};f(3000)").HasIntegerResult(3000);
+		}
+
+		TEST_METHOD(ScalarsCopyIntoContainersByValue)
+		{
+			Executing("a=5;b=a;a=a+1;o={v:a};o.v=o.v+1;x=[a,b,o.v];"
+				"get(x,0)*100+get(x,1)*10+get(x,2)").HasIntegerResult(657);
+		}
+
+		TEST_METHOD(ObjectsOutliveTheNameTheyWereCreatedWith)
+		{
+			Executing("o={v:1};a=[o];delete(\"o\");p=get(a,0);p.v=7;q=get(a,0);q.v").HasIntegerResult(7);
+		}
+
+		TEST_METHOD(MemberAccessFollowsTheShapeOfEachObject)
+		{
+			Executing("f=function(o){return o.x*10+o.y;};a={x:1,y:2};b={y:3,x:4};c={x:5,y:6,z:0};"
+				"s=0;loop(i=0,i<3,i=i+1){s=s+f(a)+f(b)+f(c);c.y=c.y+1;b.z=1;};s").HasIntegerResult(336);
+		}
+
+		TEST_METHOD(RepeatedKeysOfObjectLiteralsKeepTheLastValue)
+		{
+			Executing("o={a:1,b:2,a:3};p=properties(o);length(p)*10+o.a").HasIntegerResult(23);
+		}
+
+		TEST_METHOD(ComputedKeysMeetMemberOperatorsOfTheSameName)
+		{
+			Executing("o={a:1};k=\"computedKeyOnly\";set(o,k,5);x=o.computedKeyOnly;o.computedKeyOnly=x+1;"
+				"length(properties(o))*100+get(o,k)*10+x").HasIntegerResult(265);
+		}
+
+		TEST_METHOD(TypedArithmeticFallsBackForOtherOperands)
+		{
+			Executing("f=function(a,b){return a+b;};x=f(1,2);y=f(1.5,2.5);z=f(\"a\",\"bc\");"
+				"c=function(a,b){return a<b;};p=c(1,2);q=c(2.5,1.5);"
+				"x*1000+length(z)*100+f(3,4)*10").HasIntegerResult(3370);
+		}
+
+		TEST_METHOD(LongIntegerSumsKeepTheirOrder)
+		{
+			Executing("a=2;b=3;c=5;a*b*c+20-a-b-c+1+2").HasIntegerResult(43);
+		}
+
+		TEST_METHOD(InferredTypesGiveTheSameResultsAsCheckedCode)
+		{
+			Executing("f=function(n){s=0;loop(i=0,i<n,i=i+1){s=s+integer(i)*2;};return s;};"
+				"a=f(10);optimize(\"none\");b=f(10);optimize(\"types\");"
+				"s=0;loop(i=0,i<5,i=i+1){s=s+i;};a*1000+b+s").HasIntegerResult(90100);
+		}
+
+		TEST_METHOD(RebindingANativeLeavesTheProvenCode)
+		{
+			Executing("h=function(n){t=0;loop(j=0,j<n,j=j+1){t=t+integer(j);if(j==1)integer=function(x){return 100;};};return t;};"
+				"h(4)").HasIntegerResult(201);
+		}
+
+		TEST_METHOD(FoldedBinseqsAreCopiedOnEveryEvaluation)
+		{
+			Executing("w=64;h=32;f=function(){z=repeat(b\"0\",w*h);set(z,3,1==1);return popcount(z)*10000+length(z);};"
+				"f();if(\"ab\"+\"c\"==\"abc\")f()").HasIntegerResult(12048);
+		}
+
+		TEST_METHOD(AssignedGlobalsAreNotPropagated)
+		{
+			Executing("c=3;k=2;m=function(){return c*k;};p=function(c){return m();};"
+				"a=m();k=5;a*100+p(4)").HasIntegerResult(620);
+		}
+
+		TEST_METHOD(ConcatenationKeepsUnalignedBits)
+		{
+			Executing("integer(b\"11111111\"+b\"1\"==b\"111111111\")+integer(b\"1111\"+b\"1111\"==b\"11111111\")"
+				"+integer(b\"1011011101111\"+b\"1\"==b\"10110111011111\")*10"
+				"+popcount(repeat(b\"1\",70)+b\"0\"+repeat(b\"1\",61))*100").HasIntegerResult(13112);
+		}
+
+		TEST_METHOD(SubseqReadsAcrossWordBoundaries)
+		{
+			Executing("x=repeat(b\"10110\",130);integer(subseq(x,61,9)==b\"011010110\")+integer(head(x,13)==b\"1011010110101\")*10"
+				"+integer(subseq(x,3,70)==b\"10\"+repeat(b\"10110\",68))*100+integer(tail(b\"1011011101111\",5)==b\"11101111\")*1000").HasIntegerResult(1111);
+		}
+
+		TEST_METHOD(RepeatFillsLengthsWhichAreNotWholeBytes)
+		{
+			Executing("integer(b\"1\"*5==b\"11111\")+popcount(repeat(b\"1\",200))*10+popcount(repeat(b\"101\",200))*10000").HasIntegerResult(1332001);
+		}
+
+		TEST_METHOD(SparseOperandsWorkInDenseOperators)
+		{
+			Executing("a=sparse(repeat(b\"0\",100000)+b\"00010000\");type(a)==\"sparse\"").HasBitResult(true);
+			Executing("a=sparse(repeat(b\"0\",100000)+b\"00010000\");"
+				"popcount(nand(a,a))+popcount(subseq(a,100000,8))*1000000+length(a+a)").HasIntegerResult(1300023);
+		}
+
+		TEST_METHOD(SparseResultsOfDenseOperatorsStayCompressed)
+		{
+			Executing("a=sparse(repeat(b\"0\",100000)+b\"00010000\");type(head(a,100000)+tail(a,8))==\"sparse\"").HasBitResult(true);
+		}
+
+		TEST_METHOD(IntegerCodesRejectValuesTheyCantRepresent)
+		{
+			Executing("gamma_encode([3,-1])").ShouldFail();
+			Executing("delta_encode([0])").ShouldFail();
+			Executing("rice_encode([-5],3)").ShouldFail();
+			Executing("length(varint_decode(varint_encode([-5])))").HasIntegerResult(1);
+			Executing("get(varint_decode(varint_encode([-5])),0)").HasIntegerResult(-5);
+		}
+
+		TEST_METHOD(BinseqComparisonUsesEveryBit)
+		{
+			Executing("repeat(b\"0\",64) == repeat(b\"0\",63) + b\"1\"").HasBitResult(false);
+			Executing("b\"0000000\" != b\"1000000\"").HasBitResult(true);
+			Executing("b\"1000000\" > b\"0000001\"").HasBitResult(true);
+		}
+
+		TEST_METHOD(NistDftReportsTheBitsItTested)
+		{
+			Executing("nistDft(repeat(b\"0110\",1000)).bits").HasIntegerResult(1000);
+			Executing("nistDft(repeat(b\"0110\",3000000)).bits").HasIntegerResult(1048576);
+		}
+
+		TEST_METHOD(BitMatrixEquality)
+		{
+			Executing("a=bitmatrix(b\"1001\",2);b=bitmatrix(b\"1001\",2);integer(a==b)*10+integer(a!=b)").HasIntegerResult(10);
+			Executing("a=bitmatrix(b\"1001\",2);integer(a==transpose(bitmatrix(b\"1100\",2)))*10+integer(a!=bitmatrix(b\"1001\",4))").HasIntegerResult(1);
+			Executing("a=bitmatrix(2);a==b\"1001\"").ShouldFail();
+		}
+
 		TEST_ALL_METHOD()
 		{
 			RUN_TEST_METHOD(EmptyReturnShouldNotFail);
@@ -141,6 +474,62 @@ namespace UnitTestCarbonCompilerLib
 			RUN_TEST_METHOD(ArrayOfObjectConstruction);
 			RUN_TEST_METHOD(LineCommentsAreIgnored);
 			RUN_TEST_METHOD(ArrowFunctionWithEmptyParamList);
+			RUN_TEST_METHOD(RecordDecodeProducesColumns);
+			RUN_TEST_METHOD(RecordDecodeLittleEndianField);
+			RUN_TEST_METHOD(RecordLayoutSkipsPadding);
+			RUN_TEST_METHOD(SparseBitwiseOperators);
+			RUN_TEST_METHOD(SparseFallsBackToBinseqWhenDense);
+			RUN_TEST_METHOD(GammaCodeRoundTrip);
+			RUN_TEST_METHOD(VarintOfZigzagRoundTrip);
+			RUN_TEST_METHOD(HuffmanRoundTripsText);
+			RUN_TEST_METHOD(AnsRoundTripsIntegers);
+			RUN_TEST_METHOD(CompressPreservesBitLength);
+			RUN_TEST_METHOD(CompressShrinksRepetitiveText);
+			RUN_TEST_METHOD(NistTestsMatchReferenceExamples);
+			RUN_TEST_METHOD(NistTestsRunInParallel);
+			RUN_TEST_METHOD(LifeBlinkerOscillates);
+			RUN_TEST_METHOD(ElementaryRule90GrowsSierpinski);
+			RUN_TEST_METHOD(BitMatrixMultiplyTransposeAndRank);
+			RUN_TEST_METHOD(BitMatrixSolveFindsSolutionOrVoid);
+			RUN_TEST_METHOD(LfsrRoundTripsThroughBerlekampMassey);
+			RUN_TEST_METHOD(CrcMatchesCatalogueCheckValues);
+			RUN_TEST_METHOD(AutocorrVanishesAtThePeriod);
+			RUN_TEST_METHOD(XcorrFindsTheShift);
+			RUN_TEST_METHOD(FftOfAlternatingBitsPeaksAtNyquist);
+			RUN_TEST_METHOD(FloatArrayFeedsFft);
+			RUN_TEST_METHOD(BlockPopcountSkipsThePartialBlock);
+			RUN_TEST_METHOD(PatternHistogramOverlappingAndBackToBack);
+			RUN_TEST_METHOD(ColumnCountAcrossSequences);
+			RUN_TEST_METHOD(MajorityAndThresholdMasks);
+			RUN_TEST_METHOD(ReduceAndOrXorOverArray);
+			RUN_TEST_METHOD(ReduceMatchesPairwiseOperators);
+			RUN_TEST_METHOD(RandomBitsAreReproducibleAcrossParallelism);
+			RUN_TEST_METHOD(RandomIntsAndFloatsStayInRange);
+			RUN_TEST_METHOD(BreakAndContinueLeaveLoopScopes);
+			RUN_TEST_METHOD(CalledFunctionsSeeCallerLocals);
+			RUN_TEST_METHOD(ShadowedBindingsComeBackAfterCalls);
+			RUN_TEST_METHOD(VariablesAreResolvedWhenAccessed);
+			RUN_TEST_METHOD(DeepRecursionSpansRegisterSegments);
+			RUN_TEST_METHOD(ScalarsCopyIntoContainersByValue);
+			RUN_TEST_METHOD(ObjectsOutliveTheNameTheyWereCreatedWith);
+			RUN_TEST_METHOD(MemberAccessFollowsTheShapeOfEachObject);
+			RUN_TEST_METHOD(RepeatedKeysOfObjectLiteralsKeepTheLastValue);
+			RUN_TEST_METHOD(ComputedKeysMeetMemberOperatorsOfTheSameName);
+			RUN_TEST_METHOD(TypedArithmeticFallsBackForOtherOperands);
+			RUN_TEST_METHOD(LongIntegerSumsKeepTheirOrder);
+			RUN_TEST_METHOD(InferredTypesGiveTheSameResultsAsCheckedCode);
+			RUN_TEST_METHOD(RebindingANativeLeavesTheProvenCode);
+			RUN_TEST_METHOD(FoldedBinseqsAreCopiedOnEveryEvaluation);
+			RUN_TEST_METHOD(AssignedGlobalsAreNotPropagated);
+			RUN_TEST_METHOD(ConcatenationKeepsUnalignedBits);
+			RUN_TEST_METHOD(SubseqReadsAcrossWordBoundaries);
+			RUN_TEST_METHOD(RepeatFillsLengthsWhichAreNotWholeBytes);
+			RUN_TEST_METHOD(SparseOperandsWorkInDenseOperators);
+			RUN_TEST_METHOD(SparseResultsOfDenseOperatorsStayCompressed);
+			RUN_TEST_METHOD(IntegerCodesRejectValuesTheyCantRepresent);
+			RUN_TEST_METHOD(BinseqComparisonUsesEveryBit);
+			RUN_TEST_METHOD(NistDftReportsTheBitsItTested);
+			RUN_TEST_METHOD(BitMatrixEquality);
 		}
 
 
@@ -155,7 +544,7 @@ namespace UnitTestCarbonCompilerLib
 			std::wstring message;
 			Executor executor;
 			bool failed;
-			std::shared_ptr<Node> result;
+			Carbon::Ref<Node> result;
 
 		public:
 			Executing(const char* str) {
@@ -183,6 +572,10 @@ namespace UnitTestCarbonCompilerLib
 				Assert::IsFalse(failed, message.c_str());
 				return *this;
 			}
+			Executing& ShouldFail() {
+				Assert::IsTrue(failed, L"Was expecting an error");
+				return *this;
+			}
 			Executing& HaveResultType(NodeType type) {
 				ShouldNotFail();
 				if (type == result->GetNodeType()) {
@@ -70,6 +70,10 @@
             inline void IsFalse(bool a, const wchar_t* message = L"Shoud be false") {
                 if (a) Fail(message);
             }
+
+            inline void IsTrue(bool a, const wchar_t* message = L"Should be true") {
+                if (!a) Fail(message);
+            }
         }
 
         inline int TestSummary() {
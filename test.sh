@@ -4,6 +4,8 @@ files=(
     ./Carbon/UnitTestCarbonCompilerLib/ErrorMessageFormatter.cpp
     ./Carbon/CarbonCoreLib/Executor.cpp
     ./Carbon/CarbonCoreLib/AstNodes.cpp
+    ./Carbon/CarbonCoreLib/Bytecode.cpp
+    ./Carbon/CarbonCoreLib/TypeInference.cpp
     ./Carbon/CarbonCoreLib/Threading.cpp
     ./Carbon/CarbonCompilerLib/Lexer.cpp
     ./Carbon/CarbonCompilerLib/Parser.cpp
@@ -11,6 +13,22 @@ files=(
     ./Carbon/BinseqLib/binseq.cpp
     ./Carbon/BinseqLib/bit_sequence.cpp
     ./Carbon/BinseqLib/popcount.cpp
+    ./Carbon/BinseqLib/bit_stream.cpp
+    ./Carbon/BinseqLib/record.cpp
+    ./Carbon/BinseqLib/sparse_sequence.cpp
+    ./Carbon/BinseqLib/integer_codes.cpp
+    ./Carbon/BinseqLib/entropy.cpp
+    ./Carbon/BinseqLib/lz.cpp
+    ./Carbon/BinseqLib/nist.cpp
+    ./Carbon/BinseqLib/automaton.cpp
+    ./Carbon/BinseqLib/bit_matrix.cpp
+    ./Carbon/BinseqLib/lfsr.cpp
+    ./Carbon/BinseqLib/crc.cpp
+    ./Carbon/BinseqLib/fft.cpp
+    ./Carbon/BinseqLib/correlation.cpp
+    ./Carbon/BinseqLib/histogram.cpp
+    ./Carbon/BinseqLib/vertical.cpp
+    ./Carbon/BinseqLib/prng.cpp
     ./Carbon/CarbonCommonLib/Instruction.cpp
 )
 